@@ -53,10 +53,19 @@ bot_list_entry_t * bot_list = NULL; /**< Liste aller bekannten Bots */
 int16_t my_state = BOT_STATE_AVAILABLE; /**< Der eigene Status */
 
 #ifdef BOT_2_BOT_PAYLOAD_AVAILABLE
-static int16_t bot_2_bot_payload_size = 0;			/**< Anzahl der (noch) zu sendenden oder erwarteten Bytes */
-static uint8_t * bot_2_bot_data = NULL;				/**< Zeiger auf die zu sendenden oder empfangenen Daten */
+static int16_t bot_2_bot_payload_size = 0;			/**< Anzahl der zu sendenden oder erwarteten Bytes, beim Sender -1 nach Abbruch und -2 nach Abschluss */
+static uint8_t * bot_2_bot_data = NULL;				/**< Zeiger auf den Anfang der zu sendenden oder empfangenen Daten */
 static uint8_t addr_active_transfer = 0;			/**< Bot-Adresse des derzeit aktiven Transfers */
+static uint8_t addr_last_transfer = 0;				/**< Bot-Adresse des zuletzt abgeschlossenen Empfangs, fuer wiederholte Abschluss-ACKs */
 static void (* bot_2_bot_callback)(void) = NULL;	/**< Callback-Funktion, die nach Abschluss des Empfangs ausgefuehrt wird */
+static uint8_t bot_2_bot_chunk_size = 0;			/**< Bytes pro Paket des aktiven Transfers, 0 solange der Empfaenger nicht zugestimmt hat */
+static uint16_t bot_2_bot_chunks = 0;				/**< Anzahl der Pakete des aktiven Transfers */
+static uint16_t bot_2_bot_base = 0;					/**< Erstes noch nicht bestaetigtes (Sender) bzw. erwartetes (Empfaenger) Paket */
+static uint16_t bot_2_bot_next = 0;					/**< Naechstes noch nie gesendete Paket (Sender) */
+static uint32_t bot_2_bot_received = 0;				/**< Bit i gesetzt: Paket (bot_2_bot_base + i) ist beim Empfaenger angekommen */
+static uint32_t bot_2_bot_resent = 0;				/**< Bit i gesetzt: Paket (bot_2_bot_base + i) wurde nach einer Luecke bereits wiederholt (Sender) */
+static uint8_t bot_2_bot_window = 0;				/**< Anzahl der Pakete ab bot_2_bot_base, die unterwegs sein duerfen (Sender) */
+static uint8_t bot_2_bot_unacked = 0;				/**< Anzahl der seit dem letzten ACK empfangenen Pakete (Empfaenger) */
 
 #ifdef BOT_2_BOT_PAYLOAD_TEST_AVAILABLE
 static uint8_t payload_test_buffer[255]; /**< Datenpuffer fuer Bot-2-Bot-Payload-Test */
@@ -317,7 +326,177 @@ uint8_t get_type_of_payload_function(void(* func)(void)) {
 }
 
 /**
- * Sendet eine Payload-Transferanfrage an einen anderen Bot
+ * Setzt den Zustand des Payload-Transfers zurueck
+ */
+static void bot_2_bot_reset_transfer(void) {
+	bot_2_bot_data = NULL;
+	bot_2_bot_callback = NULL;
+	addr_active_transfer = 0;
+	bot_2_bot_chunk_size = 0;
+	bot_2_bot_chunks = 0;
+	bot_2_bot_base = 0;
+	bot_2_bot_next = 0;
+	bot_2_bot_received = 0;
+	bot_2_bot_resent = 0;
+	bot_2_bot_window = 0;
+	bot_2_bot_unacked = 0;
+}
+
+/**
+ * Legt die Paketgroesse des aktiven Transfers fest und berechnet daraus die Anzahl der Pakete
+ * \param chunk_size	Bytes pro Paket
+ */
+static void bot_2_bot_set_chunk_size(uint8_t chunk_size) {
+	bot_2_bot_chunk_size = chunk_size;
+	bot_2_bot_chunks = (uint16_t) ((bot_2_bot_payload_size + chunk_size - 1) / chunk_size);
+	if (bot_2_bot_chunks == 0) {
+		bot_2_bot_chunks = 1; // auch 0 Bytes werden mit einem (leeren) Paket abgeschlossen
+	}
+}
+
+/**
+ * Liefert die Anzahl der Bytes eines Pakets
+ * \param chunk	Nummer des Pakets
+ * \return		Bytes im Paket
+ */
+static uint8_t bot_2_bot_chunk_length(uint16_t chunk) {
+	const int16_t rest = (int16_t) (bot_2_bot_payload_size - (int16_t) (chunk * bot_2_bot_chunk_size));
+	return (uint8_t) (rest < bot_2_bot_chunk_size ? rest : bot_2_bot_chunk_size);
+}
+
+/**
+ * Liest die Payload des empfangenen Kommandos, Bytes, die nicht in den Puffer passen, werden verworfen
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ * \param *data	Zielpuffer
+ * \param size	Groesse des Zielpuffers in Byte
+ * \return		Anzahl der in den Puffer gelesenen Bytes oder -1, falls die Payload nicht komplett gelesen werden konnte
+ */
+static int16_t bot_2_bot_read_payload(command_t * cmd, void * data, uint8_t size) {
+	uint8_t len = cmd->payload;
+#ifdef MCU
+	/* warten, bis Payload-Daten im Empfangspuffer */
+	uint16_t ticks = TIMER_GET_TICKCOUNT_16;
+	while (uart_data_available() < len && (uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) < MS_TO_TICKS(COMMAND_TIMEOUT)) {}
+#endif // MCU
+	const uint8_t n = len < size ? len : size;
+	if (n && cmd_functions.read(data, n) != n) {
+		return -1;
+	}
+	len = (uint8_t) (len - n);
+	while (len) {
+		uint8_t dummy[8];
+		const uint8_t m = len < sizeof(dummy) ? len : sizeof(dummy);
+		if (cmd_functions.read(dummy, m) != m) {
+			return -1;
+		}
+		len = (uint8_t) (len - m);
+	}
+	return n;
+}
+
+/**
+ * Sendet ein Paket des aktiven Transfers
+ * \param chunk	Nummer des Pakets
+ */
+static void bot_2_bot_send_chunk(uint16_t chunk) {
+	const uint8_t len = bot_2_bot_chunk_length(chunk);
+	const int16_t last_packet = chunk == bot_2_bot_chunks - 1;
+	LOG_DEBUG(" Sende Paket %u mit %u Bytes zu Bot %u", chunk, len, addr_active_transfer);
+	command_write_rawdata_to(CMD_BOT_2_BOT, BOT_CMD_PAYLOAD, addr_active_transfer, last_packet, (int16_t) chunk, len,
+		bot_2_bot_data + chunk * bot_2_bot_chunk_size);
+}
+
+/**
+ * Sendet neue Pakete, solange das vom Empfaenger erlaubte Fenster nicht ausgeschoepft ist
+ */
+static void bot_2_bot_send_window(void) {
+	while (bot_2_bot_next < bot_2_bot_chunks && (uint16_t) (bot_2_bot_next - bot_2_bot_base) < bot_2_bot_window) {
+		bot_2_bot_send_chunk(bot_2_bot_next);
+		++bot_2_bot_next;
+	}
+}
+
+/**
+ * Wiederholt Pakete, die der Empfaenger noch nicht bestaetigt hat
+ * \param holes_only	1: nur Luecken unterhalb des hoechsten bestaetigten Pakets, die noch nicht wiederholt wurden;
+ * 						0: alle gesendeten, aber unbestaetigten Pakete (nach Timeout)
+ */
+static void bot_2_bot_resend_missing(uint8_t holes_only) {
+	uint16_t end = bot_2_bot_next;
+	if (holes_only) {
+		/* nur bis zum hoechsten selektiv bestaetigten Paket */
+		end = bot_2_bot_base;
+		uint8_t i;
+		for (i = 0; i < 32; ++i) {
+			if (bot_2_bot_received & (1UL << i)) {
+				end = (uint16_t) (bot_2_bot_base + i);
+			}
+		}
+	}
+	uint16_t chunk;
+	for (chunk = bot_2_bot_base; chunk < end; ++chunk) {
+		const uint32_t bit = 1UL << (chunk - bot_2_bot_base);
+		if ((bot_2_bot_received & bit) || (holes_only && (bot_2_bot_resent & bit))) {
+			continue;
+		}
+		bot_2_bot_send_chunk(chunk);
+		bot_2_bot_resent |= bit;
+	}
+}
+
+/**
+ * Sendet eine (selektive) Empfangsbestaetigung fuer den aktiven Transfer
+ * \param to	Adresse des Senders
+ */
+static void bot_2_bot_send_ack(uint8_t to) {
+	bot_2_bot_ack_t ack;
+	ack.received = bot_2_bot_received;
+	ack.window = BOT_2_BOT_PAYLOAD_WINDOW;
+	LOG_DEBUG(" bestaetige Bot %u Pakete bis %u, received=0x%lx", to, bot_2_bot_base, (unsigned long) ack.received);
+	command_write_rawdata_to(CMD_BOT_2_BOT, BOT_CMD_ACK, to, (int16_t) bot_2_bot_base, 3, sizeof(ack), &ack);
+	bot_2_bot_unacked = 0;
+}
+
+/**
+ * Wartet hoechstens BOT_2_BOT_PAYLOAD_TIMEOUT ms auf das naechste vollstaendige Kommando und wertet es aus
+ * \return	0, falls ein Kommando ausgewertet wurde, 1 bei Timeout, sonst Fehlercode von command_read()
+ */
+static int8_t bot_2_bot_wait_command(void) {
+#ifdef MCU
+	uint16_t ticks = TIMER_GET_TICKCOUNT_16;
+	while (uart_data_available() < sizeof(command_t)) {
+		if ((uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) > MS_TO_TICKS(BOT_2_BOT_PAYLOAD_TIMEOUT)) {
+			return 1;
+		}
+	}
+#elif ! defined ARM_LINUX_BOARD
+	/* Teilstuecke eines Kommandos sind kein Timeout, daher bis zur echten Frist weiter warten */
+	struct timeval start, now;
+	GETTIMEOFDAY(&start, NULL);
+	int remaining = BOT_2_BOT_PAYLOAD_TIMEOUT;
+	while (tcp_data_wait(remaining) < (int) sizeof(command_t)) {
+		GETTIMEOFDAY(&now, NULL);
+		const long elapsed = (now.tv_sec - start.tv_sec) * 1000L + (now.tv_usec - start.tv_usec) / 1000L;
+		if (elapsed >= BOT_2_BOT_PAYLOAD_TIMEOUT) {
+			return 1;
+		}
+		remaining = (int) (BOT_2_BOT_PAYLOAD_TIMEOUT - elapsed);
+	}
+#endif // MCU
+	const int8_t result = command_read();
+	if (result == 0) {
+		command_evaluate();
+		return 0;
+	}
+	/* CRC-Fehler und Pakete fuer andere Adressen sind kein Grund zum Abbruch */
+	return (int8_t) (result == -20 || result == -10 ? 0 : result);
+}
+
+/**
+ * Sendet eine Payload-Transferanfrage an einen anderen Bot und uebertraegt anschliessend die Daten.
+ * Die Daten werden in nummerierten Paketen zu hoechstens BOT_2_BOT_PAYLOAD_CHUNK_SIZE Bytes verschickt,
+ * dabei duerfen so viele Pakete unbestaetigt unterwegs sein, wie der Empfaenger per ACK erlaubt.
+ * Fehlende Pakete meldet der Empfaenger selektiv und nur diese werden wiederholt.
  * \param to			Empfaengeradresse
  * \param type			Typ der Daten fuer den anderen Bot
  * \param *data			Zeiger auf zu sendende Daten
@@ -329,47 +508,62 @@ int8_t bot_2_bot_send_payload_request(uint8_t to, uint8_t type, void * data, int
 		/* kein loop-back */
 		return -1;
 	}
+	if (size < 0) {
+		return -2;
+	}
 	LOG_DEBUG("Fordere Payload-Senderecht (%u) vom Typ %u bei Bot %u an", BOT_CMD_REQ, type, to);
 	LOG_DEBUG(" zu sendende Daten umfassen %d Bytes @ 0x%lx", size, (size_t) data);
-	command_write_to(CMD_BOT_2_BOT, BOT_CMD_REQ, to, size, type, 0);
+	bot_2_bot_reset_transfer();
 	bot_2_bot_data = data;
 	bot_2_bot_payload_size = size;
 	addr_active_transfer = to;
-	/* warten auf ACK */
+	command_write_to(CMD_BOT_2_BOT, BOT_CMD_REQ, to, size, type, 0);
+
+	/* Daten senden, bis alles bestaetigt ist */
 #ifdef ARM_LINUX_BOARD
 	cmd_func_t old_func = cmd_functions;
 	set_bot_2_sim();
 #endif // ARM_LINUX_BOARD
-#ifdef MCU
-	uint16_t ticks = TIMER_GET_TICKCOUNT_16;
-#endif
+	int8_t result = 0;
+	uint8_t retries = 0;
 	while (bot_2_bot_payload_size >= 0) {
-#ifdef MCU
-		while (uart_data_available() < sizeof(command_t) && (uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) < MS_TO_TICKS(COMMAND_TIMEOUT)) {}
-		if (command_read() == 0) {
-			command_evaluate();
+		const uint16_t base = bot_2_bot_base;
+		const uint8_t chunk_size = bot_2_bot_chunk_size;
+		const int8_t res = bot_2_bot_wait_command();
+		if (res < 0) {
+			LOG_DEBUG(" command_read() meldet Fehler %d, Abbruch", res);
+			result = -4;
+			break;
 		}
-		if ((uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) > MS_TO_TICKS(COMMAND_TIMEOUT)) {
-			return -3;
+		if (res == 0) {
+			if (bot_2_bot_base != base || bot_2_bot_chunk_size != chunk_size) {
+				retries = 0; // Fortschritt
+			}
+			continue;
 		}
-#else	// PC
-		LOG_DEBUG(" Warte auf (naechstes) ACK von Bot %u", to);
-		if (receive_until_frame(CMD_BOT_2_BOT/*BOT_CMD_ACK*/) != 0) {
-			LOG_DEBUG(" receive_until_frame() meldet Fehler, Abbruch");
-#ifdef ARM_LINUX_BOARD
-			cmd_functions = old_func;
-#endif // ARM_LINUX_BOARD
-			bot_2_bot_data = NULL;
-			bot_2_bot_callback = NULL;
-			bot_2_bot_payload_size = 0;
-			addr_active_transfer = 0;
-			return -4;
+
+		/* Timeout */
+		if (++retries > BOT_2_BOT_PAYLOAD_RETRIES) {
+			LOG_DEBUG(" Keine Antwort von Bot %u, Abbruch", to);
+			result = -3;
+			break;
+		}
+		if (bot_2_bot_chunk_size == 0) {
+			LOG_DEBUG(" Keine Antwort auf Anfrage, wiederhole sie");
+			command_write_to(CMD_BOT_2_BOT, BOT_CMD_REQ, to, size, type, 0);
+		} else {
+			LOG_DEBUG(" Timeout, wiederhole unbestaetigte Pakete ab %u", bot_2_bot_base);
+			bot_2_bot_resend_missing(0);
 		}
-#endif // MCU
 	}
 #ifdef ARM_LINUX_BOARD
 	cmd_functions = old_func;
 #endif // ARM_LINUX_BOARD
+	if (result != 0) {
+		bot_2_bot_reset_transfer();
+		bot_2_bot_payload_size = 0;
+		return result;
+	}
 	if (bot_2_bot_payload_size == -2) {
 		LOG_DEBUG(" Alle Daten fehlerfrei zu Bot %u uebertragen", to);
 		return 0;
@@ -386,20 +580,17 @@ void bot_2_bot_handle_payload_request(command_t * cmd) {
 	LOG_DEBUG("Payload-Sendeanfrage von Bot %u erhalten", cmd->from);
 	LOG_DEBUG(" werte Payload-Sendeanfrage aus...");
 	int16_t size = cmd->data_l;
-	bot_2_bot_payload_size = size;
 	LOG_DEBUG("  Anfrage umfasst %d Bytes", size);
 	uint8_t type = (uint8_t) cmd->data_r;
 	LOG_DEBUG("  und ist vom Typ %u", type);
 	uint8_t error = 0;
-	if (type > sizeof(bot_2_bot_payload_mappings) / sizeof(bot_2_bot_payload_mappings[0])) {
+	if (type >= sizeof(bot_2_bot_payload_mappings) / sizeof(bot_2_bot_payload_mappings[0])) {
 		LOG_DEBUG("  Typ %u ist ungueltig, Abbruch", type);
 		error = 1;
-	}
-	if (bot_2_bot_payload_mappings[type].data == NULL) {
+	} else if (bot_2_bot_payload_mappings[type].data == NULL) {
 		LOG_DEBUG("  Typ %u ist nicht aktiv", type);
 		error = 1;
-	}
-	if (size > bot_2_bot_payload_mappings[type].size) {
+	} else if (size < 0 || size > bot_2_bot_payload_mappings[type].size) {
 		LOG_DEBUG("  Datenumfang ist fuer Typ %u zu gross, max. %u Bytes", type, bot_2_bot_payload_mappings[type].size);
 		error = 1;
 	}
@@ -412,36 +603,36 @@ void bot_2_bot_handle_payload_request(command_t * cmd) {
 		/* Anfrage ablehnen */
 		LOG_DEBUG(" Lehne Anfrage ab, error=%u", error);
 		command_write_to(CMD_BOT_2_BOT, BOT_CMD_ACK, cmd->from, 0, 1, 0);
-		bot_2_bot_payload_size = 0;
-	} else {
-		/* Anfrage ok, ACK senden */
-		int16_t window_size = BOT_2_BOT_PAYLOAD_WINDOW_SIZE;
-		LOG_DEBUG(" Anfrage akzeptiert, setze window_size auf %d", window_size);
-		command_write_to(CMD_BOT_2_BOT, BOT_CMD_ACK, cmd->from, window_size, 0, 0);
-
-		/* Typ setzen */
-		bot_2_bot_callback = bot_2_bot_payload_mappings[type].function;
-		LOG_DEBUG("  Callback-Funktion = 0x%lx", (size_t)bot_2_bot_callback);
-		bot_2_bot_data = bot_2_bot_payload_mappings[type].data;
-		LOG_DEBUG("  Datenpuffer @ 0x%lx", (size_t)bot_2_bot_data);
-		addr_active_transfer = cmd->from;
+		return;
+	}
+
+	/* Anfrage ok, Typ setzen und ACK mit Paketgroesse und Fenster senden */
+	bot_2_bot_reset_transfer();
+	bot_2_bot_payload_size = size;
+	bot_2_bot_callback = bot_2_bot_payload_mappings[type].function;
+	LOG_DEBUG("  Callback-Funktion = 0x%lx", (size_t) bot_2_bot_callback);
+	bot_2_bot_data = bot_2_bot_payload_mappings[type].data;
+	LOG_DEBUG("  Datenpuffer @ 0x%lx", (size_t) bot_2_bot_data);
+	addr_active_transfer = cmd->from;
+	addr_last_transfer = 0;
+	bot_2_bot_set_chunk_size(BOT_2_BOT_PAYLOAD_CHUNK_SIZE);
+	bot_2_bot_ack_t ack;
+	ack.received = 0;
+	ack.window = BOT_2_BOT_PAYLOAD_WINDOW;
+	LOG_DEBUG(" Anfrage akzeptiert, %u Pakete zu %u Bytes, window=%u", bot_2_bot_chunks, bot_2_bot_chunk_size, ack.window);
+	command_write_rawdata_to(CMD_BOT_2_BOT, BOT_CMD_ACK, cmd->from, BOT_2_BOT_PAYLOAD_CHUNK_SIZE, 0, sizeof(ack), &ack);
+
 #ifdef MCU
-		/* warten auf Kommando, dem die Payload-Daten folgen */
-		uint16_t ticks = TIMER_GET_TICKCOUNT_16;
-		while (42) {
-			while (uart_data_available() < sizeof(command_t) && (uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) < MS_TO_TICKS(COMMAND_TIMEOUT)) {}
-			if (command_read() == 0) {
-				command_evaluate();
-				if (received_command.from == cmd->from && received_command.request.command == CMD_BOT_2_BOT && received_command.request.subcommand == BOT_CMD_PAYLOAD) {
-					break;
-				}
-			}
-			if ((uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) > MS_TO_TICKS(COMMAND_TIMEOUT)) {
-				break;
-			}
+	/* Pakete direkt hier abholen, bis der Transfer fertig ist, sonst laeuft der UART-Empfangspuffer ueber */
+	uint8_t timeouts = 0;
+	while (addr_active_transfer == cmd->from && timeouts <= BOT_2_BOT_PAYLOAD_RETRIES) {
+		const int8_t res = bot_2_bot_wait_command();
+		if (res < 0) {
+			break;
 		}
-#endif // MCU
+		timeouts = res == 1 ? (uint8_t) (timeouts + 1) : 0;
 	}
+#endif // MCU
 }
 
 /**
@@ -449,7 +640,13 @@ void bot_2_bot_handle_payload_request(command_t * cmd) {
  * \param *cmd	Zeiger auf das empfangene Kommando
  */
 void bot_2_bot_handle_payload_ack(command_t * cmd) {
-	if (bot_2_bot_data == NULL) {
+	bot_2_bot_ack_t ack;
+	memset(&ack, 0, sizeof(ack));
+	if (bot_2_bot_read_payload(cmd, &ack, sizeof(ack)) < 0) {
+		LOG_DEBUG("ACK von Bot %u unvollstaendig", cmd->from);
+		return;
+	}
+	if (bot_2_bot_data == NULL || bot_2_bot_callback != NULL) {
 		LOG_DEBUG("ACK von Bot %u empfangen, aber gar kein Transfer aktiv!", cmd->from);
 		return;
 	}
@@ -458,48 +655,51 @@ void bot_2_bot_handle_payload_ack(command_t * cmd) {
 		return;
 	}
 	switch (cmd->data_r) {
-	case 0: {
-			/* Der andere Bot hat unsere Anfrage akzeptiert */
-			uint8_t window_size = (uint8_t) cmd->data_l;
-			int16_t to_send = bot_2_bot_payload_size;
-			LOG_DEBUG(" ACK von Bot %u, habe noch %d Bytes zu senden", cmd->from, to_send);
-			LOG_DEBUG("  Bot %u hat window_size=%d festgelegt", cmd->from, window_size);
-			to_send = (int16_t) (to_send - window_size);
-			int16_t last_packet = 0;
-			if (to_send < 0) {
-				/* Rest */
-				window_size = (uint8_t) (window_size + to_send);
-				to_send = 0;
-				last_packet = 1;
-			}
-			bot_2_bot_payload_size = to_send;
-			LOG_DEBUG(" Sende %d Bytes zu Bot %u", window_size, cmd->from);
-			command_write_rawdata_to(CMD_BOT_2_BOT, BOT_CMD_PAYLOAD, cmd->from, last_packet, 0,	window_size, bot_2_bot_data);
-			bot_2_bot_data += window_size;
+	case 0:
+		/* Der andere Bot hat unsere Anfrage akzeptiert */
+		if (bot_2_bot_chunk_size != 0) {
+			break; // Anfrage wurde wiederholt, Transfer laeuft bereits
+		}
+		if (cmd->data_l <= 0 || cmd->data_l > MAX_PAYLOAD) {
+			bot_2_bot_payload_size = -1;
 			break;
 		}
+		bot_2_bot_set_chunk_size((uint8_t) cmd->data_l);
+		LOG_DEBUG(" ACK von Bot %u, sende %u Pakete zu %u Bytes, window=%u", cmd->from, bot_2_bot_chunks, bot_2_bot_chunk_size,
+			ack.window);
+		/* fall through */
+
+	case 3: {
+		/* Empfangsbestaetigung: alle Pakete vor data_l sind angekommen, danach die in ack.received markierten */
+		const uint16_t base = (uint16_t) cmd->data_l;
+		if (cmd->data_r == 3) {
+			if (bot_2_bot_chunk_size == 0 || (uint16_t) (base - bot_2_bot_base) > (uint16_t) (bot_2_bot_next - bot_2_bot_base)) {
+				LOG_DEBUG(" veraltetes ACK fuer Paket %u ignoriert", base);
+				break;
+			}
+			const uint16_t shift = (uint16_t) (base - bot_2_bot_base);
+			bot_2_bot_resent = shift < 32 ? bot_2_bot_resent >> shift : 0;
+			bot_2_bot_base = base;
+			bot_2_bot_received = ack.received;
+		}
+		bot_2_bot_window = ack.window == 0 ? 1 : (ack.window > 32 ? 32 : ack.window);
+		bot_2_bot_resend_missing(1);
+		bot_2_bot_send_window();
+		break;
+	}
 
 	case 1:
 		/* Abbruch */
 		LOG_DEBUG(" Bot %u hat Anfrage abgelehnt", cmd->from);
-		bot_2_bot_callback = NULL;
-		bot_2_bot_data = NULL;
+		bot_2_bot_reset_transfer();
 		bot_2_bot_payload_size = -1;
-		addr_active_transfer = 0;
 		break;
 
 	case 2:
 		/* fertig */
-		bot_2_bot_callback = NULL;
-		bot_2_bot_data = NULL;
-		addr_active_transfer = 0;
-		if (bot_2_bot_payload_size != 0) {
-			bot_2_bot_payload_size = -1;
-			LOG_DEBUG(" Bot %u hat Abschluss gemeldet, habe aber noch %d Bytes zu senden", cmd->from, bot_2_bot_payload_size);
-		} else {
-			bot_2_bot_payload_size = -2;
-			LOG_DEBUG(" Bot %u hat Abschluss gemeldet", cmd->from);
-		}
+		bot_2_bot_reset_transfer();
+		bot_2_bot_payload_size = -2;
+		LOG_DEBUG(" Bot %u hat Abschluss gemeldet", cmd->from);
 		break;
 	}
 }
@@ -509,52 +709,56 @@ void bot_2_bot_handle_payload_ack(command_t * cmd) {
  * \param *cmd	Zeiger auf das empfangene Kommando
  */
 void bot_2_bot_handle_payload_data(command_t * cmd) {
-	if (addr_active_transfer != cmd->from) {
-		LOG_DEBUG("ACK von Bot %u empfangen, aber kein Transfer von diesem Bot aktiv!", cmd->from);
+	const uint16_t chunk = (uint16_t) cmd->data_r;
+	if (addr_active_transfer != cmd->from || bot_2_bot_callback == NULL || chunk >= bot_2_bot_chunks
+		|| cmd->payload != bot_2_bot_chunk_length(chunk)) {
+		uint8_t dummy;
+		bot_2_bot_read_payload(cmd, &dummy, 0);
+		if (addr_active_transfer == 0 && addr_last_transfer == cmd->from) {
+			/* Abschluss-ACK ging verloren, Sender wiederholt noch */
+			command_write_to(CMD_BOT_2_BOT, BOT_CMD_ACK, cmd->from, 0, 2, 0);
+		} else {
+			LOG_DEBUG("Paket %u von Bot %u passt zu keinem aktiven Transfer", chunk, cmd->from);
+		}
 		return;
 	}
 
-	uint8_t size = cmd->payload;
-	LOG_DEBUG(" Payload mit %u Bytes angekuendigt", size);
-#ifdef MCU
-	/* warten, bis Payload-Daten im Empfangspuffer */
-	uint16_t ticks = TIMER_GET_TICKCOUNT_16;
-	while (uart_data_available() < size && (uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) < MS_TO_TICKS(COMMAND_TIMEOUT)) {}
-	if ((uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) > MS_TO_TICKS(COMMAND_TIMEOUT)) {
-		return;
-	}
-#endif // MCU
-	uint8_t n = (uint8_t) cmd_functions.read(bot_2_bot_data, size);
-	LOG_DEBUG(" %u Bytes der Payload gelesen", n);
-	if (size != n) {
-		int16_t result = 1;
-		command_write_to(CMD_BOT_2_BOT, BOT_CMD_ACK, cmd->from, 0, result, 0);
-		bot_2_bot_data = NULL;
-		bot_2_bot_callback = NULL;
-		bot_2_bot_payload_size = 0;
+	LOG_DEBUG(" Paket %u mit %u Bytes empfangen", chunk, cmd->payload);
+	if (bot_2_bot_read_payload(cmd, bot_2_bot_data + chunk * bot_2_bot_chunk_size, cmd->payload) < 0) {
 		LOG_DEBUG(" Fehler beim Lesen, Abbruch");
+		command_write_to(CMD_BOT_2_BOT, BOT_CMD_ACK, cmd->from, 0, 1, 0);
+		bot_2_bot_reset_transfer();
+		bot_2_bot_payload_size = 0;
 		return;
 	}
-	bot_2_bot_data += n;
-	if (cmd->data_l == 1) {
+
+	const uint16_t offset = (uint16_t) (chunk - bot_2_bot_base);
+	const uint8_t duplicate = chunk < bot_2_bot_base || (offset < 32 && (bot_2_bot_received & (1UL << offset)));
+	if (chunk >= bot_2_bot_base && offset < 32) {
+		bot_2_bot_received |= 1UL << offset;
+	}
+	while (bot_2_bot_received & 1) {
+		bot_2_bot_received >>= 1;
+		++bot_2_bot_base;
+	}
+
+	if (bot_2_bot_base == bot_2_bot_chunks) {
 		/* fertig */
 		LOG_DEBUG(" Daten komplett empfangen");
 		LOG_DEBUG(" fuehre Callback 0x%lx aus", (size_t) bot_2_bot_callback);
 		bot_2_bot_callback();
-		bot_2_bot_data = NULL;
-		bot_2_bot_callback = NULL;
+		addr_last_transfer = cmd->from;
+		bot_2_bot_reset_transfer();
 		bot_2_bot_payload_size = 0;
-		addr_active_transfer = 0;
 		/* letztes ACK senden */
 		LOG_DEBUG(" bestaetige Bot %u den Abschluss der Uebertragung", cmd->from);
-		int16_t result = 2;
-		command_write_to(CMD_BOT_2_BOT, BOT_CMD_ACK, cmd->from, 0, result, 0);
-	} else {
-		/* ACK senden */
-		int16_t window_size = BOT_2_BOT_PAYLOAD_WINDOW_SIZE;
-		int16_t result = 0;
-		LOG_DEBUG(" bestaetige Bot %u den Empfang, window_size=%d", cmd->from, window_size);
-		command_write_to(CMD_BOT_2_BOT, BOT_CMD_ACK, cmd->from, window_size, result, 0);
+		command_write_to(CMD_BOT_2_BOT, BOT_CMD_ACK, cmd->from, 0, 2, 0);
+		return;
+	}
+
+	/* bestaetigen, sobald ein halbes Fenster angekommen ist, bei Luecken und Duplikaten sofort */
+	if (++bot_2_bot_unacked >= (BOT_2_BOT_PAYLOAD_WINDOW + 1) / 2 || bot_2_bot_received != 0 || duplicate) {
+		bot_2_bot_send_ack(cmd->from);
 	}
 }
 
@@ -568,7 +772,6 @@ void bot_2_bot_print_recv_data(void) {
 	printf("bot_2_bot_data @ 0x%lx\n", (long unsigned int) bot_2_bot_data);
 	printf("size = 0x%x\n", size);
 	uint8_t * ptr = bot_2_bot_data;
-	ptr -= size;
 	printf("data: \n");
 	for (i = 0; i < size; i++) {
 		printf("%02x ", *ptr);
@@ -185,7 +185,7 @@ void bot_send_stack_b2b(Behaviour_t * caller, uint8_t bot) {
 	}
 	if (caller) {
 		caller->subResult = result.subresult;
-		caller->active = BEHAVIOUR_ACTIVE;
+		set_behaviour_active(caller, BEHAVIOUR_ACTIVE);
 	}
 }
 #endif // BOT_2_BOT_PAYLOAD_AVAILABLE
@@ -62,7 +62,7 @@ void bot_get_utilization_behaviour(Behaviour_t * data) {
 	case 2:
 #ifdef MAP_AVAILABLE
 		/* Verhalten wurde beendet */
-		if (map_update_fifo.count > 0 || map_locked() == 1) {
+		if (map_update_pending() > 0 || map_locked() == 1) {
 			/* Map-Update abwarten */
 			os_calc_utilization();
 		} else
@@ -0,0 +1,242 @@
+/*
+ * c't-Bot
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ * This program is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307, USA.
+ *
+ */
+
+/**
+ * \file 	behaviour_profile.c
+ * \brief 	Laufzeitstatistik der Verhalten in bot_behave()
+ * \date 	18.10.2026
+ */
+
+#include "bot-logic/bot-logic.h"
+
+#ifdef BEHAVIOUR_PROFILE_AVAILABLE
+#include "log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifdef MCU
+typedef uint32_t profile_sum_t;	/**< Datentyp fuer aufsummierte Zeiten [us] */
+#else
+typedef uint64_t profile_sum_t;	/**< Datentyp fuer aufsummierte Zeiten [us] */
+#endif
+
+/** Laufzeitstatistik eines Verhaltens */
+typedef struct {
+	uint32_t calls;							/**< Anzahl der Aufrufe */
+	profile_sum_t total;					/**< gesamte Laufzeit [us] */
+	uint32_t max;							/**< laengste Laufzeit [us] */
+	uint16_t hist[BEHAVIOUR_PROFILE_BUCKETS];	/**< Histogramm der Laufzeiten, Klasse i umfasst [2^i, 2^(i+1)) us */
+} behaviour_profile_t;
+
+static behaviour_profile_t * profile = NULL;	/**< Statistik je Verhalten, Index = Position in der Verhaltensliste */
+static uint8_t profile_count = 0;				/**< Anzahl der Eintraege in profile */
+static uint32_t cycle_last = 0;					/**< Beginn des letzten Durchlaufs von bot_behave() */
+static uint32_t cycle_count = 0;				/**< Anzahl der gemessenen Zyklen */
+static profile_sum_t cycle_total = 0;			/**< Summe der gemessenen Zykluszeiten [us] */
+static uint32_t cycle_max = 0;					/**< laengste Zykluszeit [us] */
+
+/**
+ * Legt die Statistik fuer alle Verhalten an, nachdem die Verhaltensliste aufgebaut wurde
+ * \param count	Anzahl der Verhalten in der Liste
+ */
+void bot_profile_init(uint8_t count) {
+	free(profile);
+	profile = calloc(count, sizeof(behaviour_profile_t));
+	profile_count = profile ? count : 0;
+	if (profile == NULL) {
+		LOG_ERROR("bot_profile_init(): kein Speicher fuer %u Verhalten", count);
+	}
+	bot_profile_reset(NULL);
+}
+
+/**
+ * Markiert den Beginn eines Durchlaufs von bot_behave() und misst die Zykluszeit
+ */
+void bot_profile_cycle(void) {
+	const uint32_t now = bot_profile_time();
+	if (cycle_last != 0) {
+		const uint32_t dt = now - cycle_last;
+		cycle_total += dt;
+		++cycle_count;
+		if (dt > cycle_max) {
+			cycle_max = dt;
+		}
+	}
+	cycle_last = now == 0 ? 1 : now;
+}
+
+/**
+ * Verbucht einen Aufruf eines Verhaltens
+ * \param slot	Position des Verhaltens in der Verhaltensliste
+ * \param start	Zeitpunkt vor dem Aufruf der Work-Routine (bot_profile_time())
+ */
+void bot_profile_add(uint8_t slot, uint32_t start) {
+	if (slot >= profile_count) {
+		return;
+	}
+	const uint32_t dt = bot_profile_time() - start;
+	behaviour_profile_t * p = &profile[slot];
+	++p->calls;
+	p->total += dt;
+	if (dt > p->max) {
+		p->max = dt;
+	}
+
+	uint8_t bucket = 0;
+	uint32_t limit = 2;
+	while (bucket < BEHAVIOUR_PROFILE_BUCKETS - 1 && dt >= limit) {
+		++bucket;
+		limit <<= 1;
+	}
+	if (p->hist[bucket] == UINT16_MAX) {
+		/* Histogramm halbieren, die Verteilung bleibt erhalten */
+		uint8_t i;
+		for (i = 0; i < BEHAVIOUR_PROFILE_BUCKETS; ++i) {
+			p->hist[i] >>= 1;
+		}
+	}
+	++p->hist[bucket];
+}
+
+/**
+ * Schaetzt ein Perzentil der Laufzeit aus dem Histogramm
+ * \param *p		Statistik des Verhaltens
+ * \param permille	gesuchtes Perzentil [Promille]
+ * \return			Obergrenze der Histogramm-Klasse, in der das Perzentil liegt, hoechstens das Maximum [us]
+ */
+static uint32_t profile_percentile(const behaviour_profile_t * p, uint16_t permille) {
+	uint32_t sum = 0;
+	uint8_t i;
+	for (i = 0; i < BEHAVIOUR_PROFILE_BUCKETS; ++i) {
+		sum += p->hist[i];
+	}
+	const uint32_t target = (sum * permille + 999U) / 1000U;
+	uint32_t count = 0;
+	for (i = 0; i < BEHAVIOUR_PROFILE_BUCKETS - 1; ++i) {
+		count += p->hist[i];
+		if (count >= target) {
+			return (2UL << i) < p->max ? (2UL << i) : p->max;
+		}
+	}
+	return p->max;
+}
+
+/**
+ * Berechnet den Anteil eines Verhaltens an der gesamten Zykluszeit
+ * \param *p	Statistik des Verhaltens
+ * \return		Anteil [Promille]
+ */
+static uint16_t profile_share(const behaviour_profile_t * p) {
+	const profile_sum_t base = cycle_total / 1000U;
+	if (base == 0) {
+		return 0;
+	}
+	return (uint16_t) (p->total / base);
+}
+
+/**
+ * Gibt die Laufzeitstatistik aller bisher aufgerufenen Verhalten aus
+ * \param *caller	Der Verhaltensdatensatz des Aufrufers
+ * \param csv		0: Tabelle per LOG, 1: CSV (PC: in BEHAVIOUR_PROFILE_FILE, MCU: per LOG)
+ */
+void bot_profile_dump(Behaviour_t * caller, uint8_t csv) {
+#ifdef PC
+	FILE * fp = NULL;
+	if (csv) {
+		fp = fopen(BEHAVIOUR_PROFILE_FILE, "w");
+		if (fp == NULL) {
+			LOG_ERROR("Konnte %s nicht oeffnen", BEHAVIOUR_PROFILE_FILE);
+			if (caller) {
+				caller->subResult = BEHAVIOUR_SUBFAIL;
+			}
+			return;
+		}
+		fprintf(fp, "prio,calls,total_us,mean_us,p50_us,p90_us,p99_us,max_us,share_permille\n");
+	}
+#endif // PC
+	const unsigned long cycle_mean = cycle_count ? (unsigned long) (cycle_total / cycle_count) : 0;
+	if (! csv) {
+		LOG_INFO("%lu Zyklen, mean %lu us, max %lu us", (unsigned long) cycle_count, cycle_mean, (unsigned long) cycle_max);
+		LOG_INFO("Prio    calls   total[ms] mean  p50   p90   p99   max [us] Anteil[%%o]");
+	} else {
+#ifdef MCU
+		LOG_RAW("prio,calls,total_us,mean_us,p50_us,p90_us,p99_us,max_us,share_permille");
+#endif
+	}
+
+	Behaviour_t * beh = NULL;
+	uint8_t slot;
+	for (slot = 0; slot < profile_count; ++slot) {
+		beh = get_next_behaviour(beh);
+		if (beh == NULL) {
+			break;
+		}
+		const behaviour_profile_t * p = &profile[slot];
+		if (p->calls == 0) {
+			continue;
+		}
+		const unsigned long mean = (unsigned long) (p->total / p->calls);
+		const unsigned long p50 = (unsigned long) profile_percentile(p, 500);
+		const unsigned long p90 = (unsigned long) profile_percentile(p, 900);
+		const unsigned long p99 = (unsigned long) profile_percentile(p, 990);
+		const unsigned share = profile_share(p);
+		if (! csv) {
+			LOG_INFO("%3u %10lu %10lu %5lu %5lu %5lu %5lu %5lu %4u", beh->priority, (unsigned long) p->calls,
+				(unsigned long) (p->total / 1000U), mean, p50, p90, p99, (unsigned long) p->max, share);
+		} else {
+#ifdef PC
+			fprintf(fp, "%u,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%u\n", beh->priority, (unsigned long) p->calls,
+				(unsigned long) p->total, mean, p50, p90, p99, (unsigned long) p->max, share);
+#else
+			LOG_RAW("%u,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%u", beh->priority, (unsigned long) p->calls,
+				(unsigned long) p->total, mean, p50, p90, p99, (unsigned long) p->max, share);
+#endif // PC
+		}
+	}
+
+#ifdef PC
+	if (fp) {
+		fclose(fp);
+		LOG_INFO("Laufzeitstatistik nach %s geschrieben", BEHAVIOUR_PROFILE_FILE);
+	}
+#endif // PC
+	if (caller) {
+		caller->subResult = BEHAVIOUR_SUBSUCCESS;
+	}
+}
+
+/**
+ * Setzt die Laufzeitstatistik zurueck
+ * \param *caller	Der Verhaltensdatensatz des Aufrufers
+ */
+void bot_profile_reset(Behaviour_t * caller) {
+	if (profile) {
+		memset(profile, 0, profile_count * sizeof(behaviour_profile_t));
+	}
+	cycle_last = 0;
+	cycle_count = 0;
+	cycle_total = 0;
+	cycle_max = 0;
+	if (caller) {
+		caller->subResult = BEHAVIOUR_SUBSUCCESS;
+	}
+}
+
+#endif // BEHAVIOUR_PROFILE_AVAILABLE
@@ -40,6 +40,8 @@
 #include "rc5.h"
 #include "rc5-codes.h"
 #include "gui.h"
+#include "timer.h"
+#include "uart.h"
 
 #define REMOTE_CALL_IDLE 0
 #define REMOTE_CALL_SCHEDULED 1
@@ -234,6 +236,10 @@ const remotecall_entry_t remotecall_beh_list[] PROGMEM = {
 #ifdef BEHAVIOUR_GET_UTILIZATION_AVAILABLE
 	PREPARE_REMOTE_CALL(bot_get_utilization, 1, "uint8 beh", 1),
 #endif
+#ifdef BEHAVIOUR_PROFILE_AVAILABLE
+	PREPARE_REMOTE_CALL_ALIAS(bot_profile_dump, 1, "uint8 csv", 1),
+	PREPARE_REMOTE_CALL_ALIAS(bot_profile_reset, 0, "", 0),
+#endif
 
 	/* Test-Verhalten */
 #ifdef BEHAVIOUR_TURN_TEST_AVAILABLE
@@ -540,6 +546,48 @@ void bot_remotecall_list(void) {
 	}
 }
 
+#ifdef COMMAND_AVAILABLE
+/**
+ * Sim fordert die Liste aller Remote-Calls an (SUB_REMOTE_CALL_LIST)
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void remotecall_handle_list(command_t * cmd) {
+	(void) cmd;
+	LOG_DEBUG("RemoteCall-CMD: Liste");
+	bot_remotecall_list();
+}
+
+/**
+ * Sim gibt einen Remote-Call in Auftrag (SUB_REMOTE_CALL_ORDER), Name und Parameter folgen als Payload
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void remotecall_handle_order(command_t * cmd) {
+	LOG_DEBUG("RemoteCall empfangen. Data=%u Bytes", cmd->payload);
+	uint8_t buffer[REMOTE_CALL_BUFFER_SIZE];
+	uint16_t ticks = TIMER_GET_TICKCOUNT_16;
+#ifdef MCU
+	while (uart_data_available() < cmd->payload && (uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) < MS_TO_TICKS(COMMAND_TIMEOUT));
+#endif
+	cmd_functions.read(buffer, cmd->payload);
+	if ((uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) < MS_TO_TICKS(COMMAND_TIMEOUT)) {
+		bot_remotecall_from_command((char *) &buffer);
+	} else {
+		int16_t result = BEHAVIOUR_SUBFAIL;
+		command_write(CMD_REMOTE_CALL, SUB_REMOTE_CALL_DONE, result, result, 0);
+	}
+}
+
+/**
+ * Sim bricht die laufenden Remote-Calls ab (SUB_REMOTE_CALL_ABORT)
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void remotecall_handle_abort(command_t * cmd) {
+	(void) cmd;
+	LOG_DEBUG("RemoteCalls werden abgebrochen");
+	bot_remotecall_cancel();
+}
+#endif // COMMAND_AVAILABLE
+
 #if defined DISPLAY_REMOTECALL_AVAILABLE && defined KEYPAD_AVAILABLE
 static remote_call_data_t keypad_params[REMOTE_CALL_MAX_PARAM]; /**< eingebene Parameter */
 static uint8_t keypad_param_index= 0; /**< aktueller Parameter */
@@ -59,14 +59,13 @@ void bot_scan_onthefly_behaviour(Behaviour_t * data) {
 	static int16_t last_location_x, last_location_y;
 	static int16_t last_dist_x, last_dist_y, last_dist_head;
 	static int16_t last_border_x, last_border_y, last_border_head;
-	static uint8_t index = 0;
 
 	(void) data; // kein warning
 
 	/* Verhalten je nach Cache-Fuellstand */
-	uint8_t cache_free = (uint8_t) (map_update_fifo.size - map_update_fifo.count);
+	uint16_t cache_free = map_update_free();
 	if (cache_free < SCAN_OTF_CACHE_LEVEL_THRESHOLD) {
-		if (cache_free == 1) {
+		if (cache_free <= 1) {
 			/* Cache ganz voll */
 			if (scan_otf_modes.data.map_mode &&
 					sensBorderL < BORDER_DANGEROUS && sensBorderR < BORDER_DANGEROUS) {
@@ -95,11 +94,10 @@ void bot_scan_onthefly_behaviour(Behaviour_t * data) {
 	}
 
 	/* Cache updaten, falls sich der Bot weit genug bewegt hat. */
-	index++;
-	if (index == MAP_UPDATE_CACHE_SIZE) {
-		index = 0;
+	map_cache_t * cache_tmp = map_update_get_entry();
+	if (cache_tmp == NULL) {
+		return;
 	}
-	map_cache_t * cache_tmp = &map_update_cache[index];
 	cache_tmp->mode.raw = 0;
 	cache_tmp->dataL = 0;
 	cache_tmp->dataR = 0;
@@ -191,7 +189,7 @@ void bot_scan_onthefly_behaviour(Behaviour_t * data) {
 		LOG_DEBUG("neuer Eintrag: x=%d y=%d head=%f distance=%d loaction=%d border=%d", cache_tmp->x_pos, cache_tmp->y_pos, cache_tmp->heading / 10.0f, cache_tmp->mode.distance, cache_tmp->mode.location, cache_tmp->mode.border);
 #endif
 
-		_inline_fifo_put(&map_update_fifo, index, False);
+		map_update_put_entry();
 	}
 }
 
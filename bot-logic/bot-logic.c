@@ -59,6 +59,11 @@
 #define BEHAVIOUR_PRIO_MAX	200	/**< Prioritaet, die ein Verhalten hoechstens haben darf, um deaktiviert zu werden */
 
 static Behaviour_t * behaviour = NULL; /**< Liste mit allen Verhalten */
+static Behaviour_t * * behaviour_by_index = NULL; /**< Verhalten nach Position in der Liste, also nach Prioritaet sortiert */
+static uint8_t * behaviour_active_mask = NULL; /**< Bitmaske der aktiven Verhalten, Bit i gehoert zu behaviour_by_index[i] */
+static Behaviour_t * * behaviour_hash = NULL; /**< Hashtabelle (offene Adressierung) der Verhalten nach ihrer Work-Routine */
+static uint16_t behaviour_hash_mask = 0; /**< Groesse von behaviour_hash - 1, Groesse ist eine Zweierpotenz */
+static uint8_t behaviour_count = 0; /**< Anzahl der Verhalten in der Liste */
 int16_t target_speed_l = BOT_SPEED_STOP; /**< Sollgeschwindigkeit linker Motor - darum kuemmert sich bot_base() */
 int16_t target_speed_r = BOT_SPEED_STOP; /**< Sollgeschwindigkeit rechter Motor - darum kuemmert sich bot_base() */
 int16_t speedWishLeft;	/**< Puffervariable fuer die Verhaltensfunktionen absolute Geschwindigkeit links */
@@ -72,6 +77,7 @@ float factorWishRight;	/**< Puffervariable fuer die Verhaltensfunktionen Modifik
 static void insert_behaviour_to_list(Behaviour_t * * list, Behaviour_t * behave);
 static Behaviour_t * new_behaviour(uint8_t priority, void (* work) (struct _Behaviour_t * data), uint8_t active);
 static void bot_base_behaviour(Behaviour_t * data);
+static void build_behaviour_index(void);
 int8_t register_emergency_proc(void (* fkt)(void));
 
 
@@ -299,6 +305,14 @@ void bot_behave_init(void) {
 
 	// Grundverhalten, setzt aeltere FB-Befehle um, aktiv
 	insert_behaviour_to_list(&behaviour, new_behaviour(2, bot_base_behaviour, BEHAVIOUR_ACTIVE));
+
+	/* Index, Hashtabelle und Aktiv-Maske erst jetzt aufbauen, die Liste ist nun vollstaendig */
+	build_behaviour_index();
+
+#ifdef BEHAVIOUR_PROFILE_AVAILABLE
+	/* Laufzeitstatistik fuer alle Verhalten der Liste anlegen */
+	bot_profile_init(behaviour_count);
+#endif // BEHAVIOUR_PROFILE_AVAILABLE
 }
 
 
@@ -333,6 +347,9 @@ static Behaviour_t * new_behaviour(uint8_t priority, void (* work) (struct _Beha
 	newbehaviour->next = NULL;
 	newbehaviour->work = work;
 	newbehaviour->caller = NULL;
+	newbehaviour->callee = NULL;
+	newbehaviour->sibling = NULL;
+	newbehaviour->index = 0;
 	newbehaviour->subResult = BEHAVIOUR_SUBSUCCESS;
 	return newbehaviour;
 }
@@ -379,6 +396,149 @@ static void insert_behaviour_to_list(Behaviour_t * * list, Behaviour_t * behave)
 	}
 }
 
+/**
+ * Berechnet die Startposition einer Work-Routine in der Hashtabelle
+ * \param function	Die Funktion, die das Verhalten realisiert
+ * \return			Index in behaviour_hash
+ */
+static uint16_t behaviour_hash_of(BehaviourFunc_t function) {
+	size_t h = (size_t) function;
+	h ^= h >> 3; // Funktionen sind ausgerichtet, die untersten Bits tragen kaum Information
+	h ^= h >> 9;
+	return (uint16_t) (h & behaviour_hash_mask);
+}
+
+/**
+ * Baut nach dem Fuellen der Verhaltensliste die Positionen, die Hashtabelle und die Maske der
+ * aktiven Verhalten auf. Schlaegt das fehl, arbeiten alle Funktionen weiterhin auf der Liste.
+ */
+static void build_behaviour_index(void) {
+	Behaviour_t * job;
+	uint16_t count = 0;
+	for (job = behaviour; job; job = job->next) {
+		job->index = (uint8_t) count;
+		++count;
+	}
+	if (count > 255) {
+		LOG_ERROR("build_behaviour_index(): zu viele Verhalten (%u)", count);
+		return;
+	}
+	behaviour_count = (uint8_t) count;
+
+	uint16_t size = 2;
+	while (size < 2 * count) {
+		size <<= 1;
+	}
+	behaviour_by_index = malloc(count * sizeof(Behaviour_t *));
+	behaviour_active_mask = calloc((count + 7) / 8, 1);
+	behaviour_hash = calloc(size, sizeof(Behaviour_t *));
+	if (behaviour_by_index == NULL || behaviour_active_mask == NULL || behaviour_hash == NULL) {
+		LOG_ERROR("build_behaviour_index(): kein Speicher fuer %u Verhalten", count);
+		free(behaviour_by_index);
+		free(behaviour_active_mask);
+		free(behaviour_hash);
+		behaviour_by_index = NULL;
+		behaviour_active_mask = NULL;
+		behaviour_hash = NULL;
+		return;
+	}
+	behaviour_hash_mask = (uint16_t) (size - 1);
+
+	for (job = behaviour; job; job = job->next) {
+		behaviour_by_index[job->index] = job;
+		if (job->active) {
+			behaviour_active_mask[job->index >> 3] |= (uint8_t) (1 << (job->index & 7));
+		}
+		/* lineares Sondieren, die Tabelle ist hoechstens halb voll */
+		uint16_t h = behaviour_hash_of(job->work);
+		while (behaviour_hash[h] != NULL) {
+			h = (uint16_t) ((h + 1) & behaviour_hash_mask);
+		}
+		behaviour_hash[h] = job;
+	}
+}
+
+/**
+ * Schaltet ein Verhalten an oder aus, ohne Aufrufer oder subResult zu veraendern.
+ * Behaviour_t::active darf nur hierueber geaendert werden, damit bot_behave() den Wechsel mitbekommt.
+ * \param *beh		Verhaltensdatensatz
+ * \param active	BEHAVIOUR_ACTIVE oder BEHAVIOUR_INACTIVE
+ */
+void set_behaviour_active(Behaviour_t * beh, uint8_t active) {
+	bit_t tmp = { active };
+	beh->active = tmp.bit;
+	if (behaviour_active_mask == NULL) {
+		return; // Index noch nicht aufgebaut, build_behaviour_index() uebernimmt den Zustand
+	}
+	const uint8_t bit = (uint8_t) (1 << (beh->index & 7));
+	if (active) {
+		behaviour_active_mask[beh->index >> 3] |= bit;
+	} else {
+		behaviour_active_mask[beh->index >> 3] &= (uint8_t) ~bit;
+	}
+}
+
+/**
+ * Traegt den Aufrufer eines Verhaltens ein und pflegt dabei die Callee-Listen von altem und neuem Aufrufer.
+ * Behaviour_t::caller darf nur hierueber geaendert werden, damit deactivate_called_behaviours() den
+ * Aufrufbaum direkt ablaufen kann.
+ * \param *job		aufgerufenes Verhalten
+ * \param *caller	neuer Aufrufer oder NULL
+ */
+static void set_caller(Behaviour_t * job, Behaviour_t * caller) {
+	if (job->caller == caller) {
+		return;
+	}
+	if (job->caller) {
+		/* aus der Callee-Liste des alten Aufrufers austragen */
+		Behaviour_t * * ptr = &job->caller->callee;
+		while (*ptr && *ptr != job) {
+			ptr = &(*ptr)->sibling;
+		}
+		if (*ptr) {
+			*ptr = job->sibling;
+		}
+	}
+	job->sibling = NULL;
+	job->caller = caller;
+	if (caller) {
+		job->sibling = caller->callee;
+		caller->callee = job;
+	}
+}
+
+/**
+ * Liefert das naechste aktive Verhalten in der Reihenfolge der Prioritaeten.
+ * Die Maske wird bei jedem Aufruf neu gelesen, so laufen auch Verhalten, die im selben Durchlauf von
+ * bot_behave() durch ein hoeher priorisiertes Verhalten aktiviert wurden.
+ * \param *job	zuletzt bearbeitetes Verhalten oder NULL fuer den Anfang
+ * \return		naechstes aktives Verhalten oder NULL, falls es keins mehr gibt
+ */
+static Behaviour_t * get_next_active_behaviour(Behaviour_t * job) {
+	if (behaviour_active_mask == NULL) {
+		for (job = job ? job->next : behaviour; job; job = job->next) {
+			if (job->active) {
+				return job;
+			}
+		}
+		return NULL;
+	}
+
+	uint16_t i = job ? job->index + 1 : 0;
+	while (i < behaviour_count) {
+		const uint8_t bits = (uint8_t) (behaviour_active_mask[i >> 3] >> (i & 7));
+		if (bits == 0) {
+			i = (uint16_t) ((i | 7) + 1); // Rest des Bytes ist inaktiv
+			continue;
+		}
+		if (bits & 1) {
+			return behaviour_by_index[i];
+		}
+		++i;
+	}
+	return NULL;
+}
+
 /**
  * Liefert das Verhalten zurueck, welches durch function implementiert ist
  * \param function	Die Funktion, die das Verhalten realisiert
@@ -387,11 +547,22 @@ static void insert_behaviour_to_list(Behaviour_t * * list, Behaviour_t * behave)
 Behaviour_t * get_behaviour(BehaviourFunc_t function) {
 	Behaviour_t * job; // Zeiger auf ein Verhalten
 
-	// Einmal durch die Liste gehen, bis wir den gewuenschten Eintrag haben
-	for (job = behaviour; job; job = job->next) {
+	if (behaviour_hash == NULL) {
+		// Einmal durch die Liste gehen, bis wir den gewuenschten Eintrag haben
+		for (job = behaviour; job; job = job->next) {
+			if (job->work == function) {
+				return job;
+			}
+		}
+		return NULL;
+	}
+
+	uint16_t h = behaviour_hash_of(function);
+	while ((job = behaviour_hash[h]) != NULL) {
 		if (job->work == function) {
 			return job;
 		}
+		h = (uint16_t) ((h + 1) & behaviour_hash_mask);
 	}
 	return NULL;
 }
@@ -426,8 +597,8 @@ void deactivate_behaviour(Behaviour_t * beh) {
 		LOG_DEBUG("Verhalten %u wird deaktiviert", beh->priority);
 	}
 #endif
-	beh->active = BEHAVIOUR_INACTIVE;
-	beh->caller = NULL;	// Caller loeschen, damit Verhalten auch ohne BEHAVIOUR_OVERRIDE neu gestartet werden koennen
+	set_behaviour_active(beh, BEHAVIOUR_INACTIVE);
+	set_caller(beh, NULL);	// Caller loeschen, damit Verhalten auch ohne BEHAVIOUR_OVERRIDE neu gestartet werden koennen
 }
 
 /**
@@ -444,31 +615,6 @@ uint8_t behaviour_is_activated(BehaviourFunc_t function) {
 	return job->active;
 }
 
-/**
- * liefert !=0 zurueck, wenn function ueber eine beliebige Kette (job->caller->caller ....) von anderen Verhalten job aufgerufen hat
- * \param *job			Zeiger auf den Datensatz des aufgerufenen Verhaltens
- * \param *caller_beh	Das Verhalten, das urspruenglich aufgerufen hat
- * \return 				0 wenn keine Call-Abhaengigkeit besteht, ansonsten die Anzahl der Stufen
- */
-static uint8_t isInCallHierarchy(Behaviour_t * job, Behaviour_t * caller_beh) {
-	uint8_t level = 0;
-
-	if (job == NULL) {
-		LOG_DEBUG("kein Verhaltensdatensatz gegeben");
-		return 0; // Liste ist leer
-	}
-
-	for (; job->caller; job = job->caller) {
-		LOG_DEBUG("  ueberpruefe Verhalten %u mit caller %u...", job->priority, job->caller->priority);
-		level++;
-		if (job->caller == caller_beh) {
-			LOG_DEBUG("   Verhalten %u wurde direkt von %u aufgerufen", job->priority, job->caller->priority);
-			return level; // Direkter Aufrufer in Tiefe level gefunden
-		}
-	}
-	return 0; // function kommt in Caller-Liste von job nicht vor
-} // O(n), n:=|Caller-Liste|
-
 /**
  * Deaktiviert alle von diesem Verhalten aufgerufenen Verhalten.
  * Das Verhalten selbst bleibt aktiv und bekommt ein BEHAVIOUR_SUBCANCEL in seine Datanestruktur eingetragen.
@@ -480,53 +626,25 @@ void deactivate_called_behaviours(Behaviour_t * caller) {
 		return;
 	}
 
-	LOG_DEBUG(""); // new line
 	LOG_DEBUG("Callees von Verhalten %u sollen abgeschaltet werden.", caller->priority);
-	LOG_DEBUG("Beginne mit dem Durchsuchen der Liste");
-	// Einmal durch die Liste gehen, und alle aktiven Funktionen pruefen, ob sie von dem uebergebenen Verhalten aktiviert wurden
-	uint8_t i = 0;
-	Behaviour_t * job; // Zeiger auf ein Verhalten
-	Behaviour_t * beh_of_function = NULL;
-	for (job = behaviour; job; job = job->next) { // n mal
-		if (job->active == BEHAVIOUR_ACTIVE) {
-			i++;
-			LOG_DEBUG("Verhalten mit Prio = %u ist ACTIVE, Durchlauf %u", job->priority, i);
-			uint8_t level = isInCallHierarchy(job, caller); // O(n)
-			LOG_DEBUG(" und hat Level %u Call-Abhaengigkeit", level);
-			/* die komplette Caller-Liste (aber auch nur die) abschalten */
-			Behaviour_t * ptr = job;
-			for (; level > 0; --level) { // n mal
-				Behaviour_t * beh;
-				for (beh = behaviour; beh; beh = beh->next) { // n mal
-					/* Falls das Verhalten Caller eines anderen Verhaltens ist, duerfen wir es (noch) nicht deaktivieren! */
-					if (beh->caller == ptr) {
-						LOG_DEBUG("  Verhalten %u ist Caller eines anderen Verhaltens", ptr->priority);
-						break;
-					}
-				} // O(n)
-				Behaviour_t * tmp = ptr;
-				ptr = ptr->caller; // zur naechsten Ebene
-				if (beh == NULL) {
-					LOG_DEBUG("  Verhalten %u wird in Tiefe %u abgeschaltet", tmp->priority, level);
-					tmp->active = BEHAVIOUR_INACTIVE; // callee abschalten
-					tmp->subResult = BEHAVIOUR_SUBCANCEL;
-					tmp->caller = NULL; // Caller loeschen, damit Verhalten auch ohne BEHAVIOUR_OVERRIDE neu gestartet werden koennen
-				}
-			}	// O(n^2)
-			LOG_DEBUG(""); // new line
+	/* Aufrufbaum unterhalb von caller von den Blaettern her abbauen, ein Verhalten wird erst
+	 * abgeschaltet, wenn es selbst keine Callees mehr hat */
+	while (caller->callee) {
+		Behaviour_t * job = caller->callee;
+		while (job->callee) {
+			job = job->callee; // eine Ebene tiefer
 		}
-		if (job == caller) {
-			/* Verhalten fuer spaeter merken, wenn wir hier eh schon die ganze Liste absuchen */
-			beh_of_function = job;
-		}
-	} // O(n^3)
+		LOG_DEBUG("  Verhalten %u wird abgeschaltet", job->priority);
+		set_behaviour_active(job, BEHAVIOUR_INACTIVE); // callee abschalten
+		job->subResult = BEHAVIOUR_SUBCANCEL;
+		set_caller(job, NULL); // Caller loeschen, damit Verhalten auch ohne BEHAVIOUR_OVERRIDE neu gestartet werden koennen
+	} // O(m * d), m:=|Teilbaum|, d:=Tiefe
+
 	/* Verhaltenseintrag zu function benachrichtigen und wieder aktiv schalten */
-	if (beh_of_function != NULL) {
-		LOG_DEBUG("Verhalten %u wird aktiviert", beh_of_function->priority);
-		beh_of_function->subResult = BEHAVIOUR_SUBCANCEL; // externer Abbruch
-		beh_of_function->active = BEHAVIOUR_ACTIVE;
-	}
-} // O(n^3)
+	LOG_DEBUG("Verhalten %u wird aktiviert", caller->priority);
+	caller->subResult = BEHAVIOUR_SUBCANCEL; // externer Abbruch
+	set_behaviour_active(caller, BEHAVIOUR_ACTIVE);
+}
 
 /**
  * Ruft ein anderes Verhalten auf und merkt sich den Ruecksprung
@@ -572,7 +690,7 @@ Behaviour_t * switch_to_behaviour(Behaviour_t * from, void (* to)(Behaviour_t *)
 		}
 		if (job->caller) {
 			// Wir wollenalso ueberschreiben, aber nett zum alten Aufrufer sein und ihn darueber benachrichtigen
-			job->caller->active = BEHAVIOUR_ACTIVE;	// alten Aufrufer reaktivieren
+			set_behaviour_active(job->caller, BEHAVIOUR_ACTIVE);	// alten Aufrufer reaktivieren
 			job->caller->subResult = BEHAVIOUR_SUBFAIL;	// er bekam aber nicht das gewuenschte Resultat
 		}
 	}
@@ -580,7 +698,7 @@ Behaviour_t * switch_to_behaviour(Behaviour_t * from, void (* to)(Behaviour_t *)
 	if (from) {
 		if (beh_mode.background == 0) {
 			// laufendes Verhalten abschalten
-			from->active = BEHAVIOUR_INACTIVE;
+			set_behaviour_active(from, BEHAVIOUR_INACTIVE);
 			from->subResult = BEHAVIOUR_SUBRUNNING;
 		} else {
 			from->subResult = BEHAVIOUR_SUBBACKGR;
@@ -588,9 +706,9 @@ Behaviour_t * switch_to_behaviour(Behaviour_t * from, void (* to)(Behaviour_t *)
 	}
 
 	// neues Verhalten aktivieren
-	job->active = BEHAVIOUR_ACTIVE;
+	set_behaviour_active(job, BEHAVIOUR_ACTIVE);
 	// Aufrufer sichern
-	job->caller = from;
+	set_caller(job, from);
 
 #ifdef DEBUG_BOT_LOGIC
 	if (from) {
@@ -613,10 +731,10 @@ Behaviour_t * switch_to_behaviour(Behaviour_t * from, void (* to)(Behaviour_t *)
  */
 void exit_behaviour(Behaviour_t * data, uint8_t state) {
 	LOG_DEBUG("exit_behaviour(0x%lx (Prio %u), %u)", (size_t) data, data->priority, state);
-	data->active = BEHAVIOUR_INACTIVE; // Unterverhalten deaktivieren
+	set_behaviour_active(data, BEHAVIOUR_INACTIVE); // Unterverhalten deaktivieren
 	LOG_DEBUG("Verhalten %u wurde beendet", data->priority);
 	if (data->caller) {
-		data->caller->active = BEHAVIOUR_ACTIVE; // aufrufendes Verhalten aktivieren
+		set_behaviour_active(data->caller, BEHAVIOUR_ACTIVE); // aufrufendes Verhalten aktivieren
 
 		union {
 			uint8_t byte;
@@ -626,7 +744,7 @@ void exit_behaviour(Behaviour_t * data, uint8_t state) {
 
 		LOG_DEBUG("Caller %u wurde wieder aktiviert", data->caller->priority);
 	}
-	data->caller = NULL; // Job erledigt, Verweis loeschen
+	set_caller(data, NULL); // Job erledigt, Verweis loeschen
 }
 
 /**
@@ -639,9 +757,9 @@ void deactivateAllBehaviours(void) {
 		if ((job->priority >= BEHAVIOUR_PRIO_MIN) && (job->priority <= BEHAVIOUR_PRIO_MAX)) {
             // Verhalten deaktivieren
 			LOG_DEBUG("Verhalten %u wird deaktiviert", job->priority);
-			job->active = BEHAVIOUR_INACTIVE;
+			set_behaviour_active(job, BEHAVIOUR_INACTIVE);
 			job->subResult = BEHAVIOUR_SUBCANCEL;
-			job->caller = NULL; // Caller loeschen, damit Verhalten auch ohne BEHAVIOUR_OVERRIDE neu gestartet werden koennen
+			set_caller(job, NULL); // Caller loeschen, damit Verhalten auch ohne BEHAVIOUR_OVERRIDE neu gestartet werden koennen
 		}
 	}
 }
@@ -657,51 +775,58 @@ void bot_behave(void) {
 	float factorRight = 1.0f; // Puffer fuer Modifikatoren
 #endif // BEHAVIOUR_FACTOR_WISH_AVAILABLE
 
-	/* Solange noch Verhalten in der Liste sind...
+#ifdef BEHAVIOUR_PROFILE_AVAILABLE
+	bot_profile_cycle();
+#endif // BEHAVIOUR_PROFILE_AVAILABLE
+
+	/* Solange noch aktive Verhalten da sind...
 	   (Achtung: Wir werten die Jobs sortiert nach Prioritaet aus. Wichtige zuerst einsortieren!!!) */
-	for (job = behaviour; job; job = job->next) {
-		if (job->active) {
-			/* WunschVariablen initialisieren */
-			speedWishLeft = BOT_SPEED_IGNORE;
-			speedWishRight = BOT_SPEED_IGNORE;
+	for (job = get_next_active_behaviour(NULL); job; job = get_next_active_behaviour(job)) {
+		/* WunschVariablen initialisieren */
+		speedWishLeft = BOT_SPEED_IGNORE;
+		speedWishRight = BOT_SPEED_IGNORE;
 
 #ifdef BEHAVIOUR_FACTOR_WISH_AVAILABLE
-			factorWishLeft = 1.0f;
-			factorWishRight = 1.0f;
+		factorWishLeft = 1.0f;
+		factorWishRight = 1.0f;
 #endif // BEHAVIOUR_FACTOR_WISH_AVAILABLE
 
-			if (job->work) { // hat das Verhalten eine Work-Routine
-				job->work(job); // Verhalten ausfuehren
-			} else { // wenn nicht: Verhalten deaktivieren, da es nicht sinnvoll arbeiten kann
-				job->active = BEHAVIOUR_INACTIVE;
-			}
+		if (job->work) { // hat das Verhalten eine Work-Routine
+#ifdef BEHAVIOUR_PROFILE_AVAILABLE
+			const uint32_t start = bot_profile_time();
+			job->work(job); // Verhalten ausfuehren
+			bot_profile_add(job->index, start);
+#else
+			job->work(job); // Verhalten ausfuehren
+#endif // BEHAVIOUR_PROFILE_AVAILABLE
+		} else { // wenn nicht: Verhalten deaktivieren, da es nicht sinnvoll arbeiten kann
+			set_behaviour_active(job, BEHAVIOUR_INACTIVE);
+		}
 
 #ifdef BEHAVIOUR_FACTOR_WISH_AVAILABLE
-			/* Modifikatoren sammeln  */
-			factorLeft  *= factorWishLeft;
-			factorRight *= factorWishRight;
+		/* Modifikatoren sammeln  */
+		factorLeft  *= factorWishLeft;
+		factorRight *= factorWishRight;
 #endif // BEHAVIOUR_FACTOR_WISH_AVAILABLE
 
-           /* Geschwindigkeit aendern? */
-			if ((speedWishLeft != BOT_SPEED_IGNORE) || (speedWishRight != BOT_SPEED_IGNORE)) {
+		/* Geschwindigkeit aendern? */
+		if ((speedWishLeft != BOT_SPEED_IGNORE) || (speedWishRight != BOT_SPEED_IGNORE)) {
 #ifdef BEHAVIOUR_FACTOR_WISH_AVAILABLE
-				if (speedWishLeft != BOT_SPEED_IGNORE) {
-					speedWishLeft = (int16_t) (speedWishLeft * factorLeft);
-				}
-				if (speedWishRight != BOT_SPEED_IGNORE) {
-					speedWishRight = (int16_t) (speedWishRight * factorRight);
-				}
+			if (speedWishLeft != BOT_SPEED_IGNORE) {
+				speedWishLeft = (int16_t) (speedWishLeft * factorLeft);
+			}
+			if (speedWishRight != BOT_SPEED_IGNORE) {
+				speedWishRight = (int16_t) (speedWishRight * factorRight);
+			}
 #endif // BEHAVIOUR_FACTOR_WISH_AVAILABLE
 
-				motor_set(speedWishLeft, speedWishRight);
-				break; // Wenn ein Verhalten Werte direkt setzen will, nicht weitermachen
-			}
-		}
-		/* Dieser Punkt wird nur erreicht, wenn keine Regel im System die Motoren beeinflusen will */
-		if (job->next == NULL) {
-			motor_set(BOT_SPEED_IGNORE, BOT_SPEED_IGNORE);
+			motor_set(speedWishLeft, speedWishRight);
+			return; // Wenn ein Verhalten Werte direkt setzen will, nicht weitermachen
 		}
 	}
+
+	/* Dieser Punkt wird nur erreicht, wenn keine Regel im System die Motoren beeinflusen will */
+	motor_set(BOT_SPEED_IGNORE, BOT_SPEED_IGNORE);
 }
 
 /**
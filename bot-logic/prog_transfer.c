@@ -0,0 +1,237 @@
+/*
+ * c't-Bot
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ * This program is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307, USA.
+ *
+ */
+
+/**
+ * \file 	prog_transfer.c
+ * \brief 	Empfang von Programmen (uBasic oder ABL) vom Sim
+ * \date 	18.10.2026
+ */
+
+#include "bot-logic.h"
+
+#if defined COMMAND_AVAILABLE && (defined BEHAVIOUR_UBASIC_AVAILABLE || defined BEHAVIOUR_ABL_AVAILABLE)
+#include "prog_transfer.h"
+#include "command.h"
+#include "init.h"
+#include "sdfat_fs.h"
+#include "eeprom.h"
+#include "timer.h"
+#include "uart.h"
+#include "led.h"
+#include "log.h"
+#include <string.h>
+
+//#define DEBUG_PROG_TRANSFER // Schalter, um auf einmal alle Debugs an oder aus zu machen
+
+#ifndef DEBUG_PROG_TRANSFER
+#undef LOG_DEBUG
+#define LOG_DEBUG(...) {} /**< Log-Dummy */
+#endif
+
+#ifdef SDFAT_AVAILABLE
+static pFatFile prog_file; /**< Datei fuer das empfangene Programm */
+#endif // SDFAT_AVAILABLE
+static uint16_t prog_size = 0; /**< Noch zu empfangende Bytes des Programms */
+
+/**
+ * Vorbereitung auf ein neues Programm (Basic oder ABL), die Payload enthaelt den Dateinamen
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void prog_transfer_prepare(command_t * cmd) {
+	LOG_DEBUG("Programm-Empfang:");
+	const uint8_t type = (uint8_t) cmd->data_l;
+	prog_size = (uint16_t) cmd->data_r;
+	LOG_DEBUG(" Typ=%u Laenge=%u", type, prog_size);
+	const uint8_t len = cmd->payload;
+	LOG_DEBUG(" len=%u", len);
+	char filename[len + 1];
+	uint16_t ticks = TIMER_GET_TICKCOUNT_16;
+#ifdef MCU
+	while (uart_data_available() < len &&
+		(uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) < MS_TO_TICKS(COMMAND_TIMEOUT));
+#endif
+	cmd_functions.read(filename, len);
+	if ((uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) < MS_TO_TICKS(COMMAND_TIMEOUT)) {
+		/* OK */
+		filename[len] = 0;
+		LOG_DEBUG(" Datei:\"%s\"", filename);
+		void* buffer = type == 0 ? GET_MMC_BUFFER(ubasic_buffer) : GET_MMC_BUFFER(abl_buffer);
+#ifdef SDFAT_AVAILABLE
+		/* Datei anlegen */
+		LOG_DEBUG(" prog_size=%u", prog_size);
+		if (sdfat_open(filename, &prog_file, SDFAT_O_RDWR | SDFAT_O_TRUNC | SDFAT_O_CREAT)) {
+			LOG_ERROR("Fehler beim Dateizugriff");
+			prog_size = 0;
+			return;
+		}
+#endif // SDFAT_AVAILABLE
+		memset(buffer, 0, SD_BLOCK_SIZE);
+		/* falls uBasic / ABL laeuft, abbrechen */
+#if defined BEHAVIOUR_UBASIC_AVAILABLE && defined BEHAVIOUR_ABL_AVAILABLE
+		Behaviour_t* const beh = type == 0 ? get_behaviour(bot_ubasic_behaviour) : get_behaviour(bot_abl_behaviour);
+#elif defined BEHAVIOUR_UBASIC_AVAILABLE
+		Behaviour_t* const beh = type == 0 ? get_behaviour(bot_ubasic_behaviour) : NULL;
+#elif defined BEHAVIOUR_ABL_AVAILABLE
+		Behaviour_t* const beh = type == 0 ? NULL : get_behaviour(bot_abl_behaviour);
+#endif
+		deactivate_called_behaviours(beh);
+		deactivate_behaviour(beh);
+		/* evtl. hatte uBasic / ABL einen RemoteCall gestartet, daher dort aufraeumen */
+		activateBehaviour(NULL, bot_remotecall_behaviour);
+		/* Datei laden */
+		switch (type) {
+#ifdef BEHAVIOUR_UBASIC_AVAILABLE
+		case 0:
+			/* uBasic */
+			bot_ubasic_load_file(filename, &prog_file);
+			break;
+#endif // BEHAVIOUR_UBASIC_AVAILABLE
+#ifdef BEHAVIOUR_ABL_AVAILABLE
+		case 1:
+			/* ABL */
+			abl_load(filename);
+			break;
+#endif // BEHAVIOUR_ABL_AVAILABLE
+		}
+	} else {
+		/* Fehler */
+		LOG_ERROR("Timeout beim Programmempfang");
+		prog_size = 0;
+	}
+}
+
+/**
+ * Datenteil eines Programms
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void prog_transfer_data(command_t * cmd) {
+	if (prog_size == 0) {
+		LOG_DEBUG(" Datenempfang fehlerhaft");
+		return;
+	}
+	const uint16_t done = (uint16_t) cmd->data_r;
+	const uint8_t type = (uint8_t) cmd->data_l;
+	LOG_DEBUG(" type=%u %u Bytes (%u Bytes insgesamt)", type, cmd->payload, cmd->payload + done);
+	void* buffer = type == 0 ? GET_MMC_BUFFER(ubasic_buffer) : GET_MMC_BUFFER(abl_buffer);
+	const uint16_t index = (uint16_t) done % SD_BLOCK_SIZE;
+	buffer += index;
+	uint16_t ticks = TIMER_GET_TICKCOUNT_16;
+#ifdef MCU
+	while (uart_data_available() < cmd->payload && (uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) < MS_TO_TICKS(COMMAND_TIMEOUT));
+#endif
+	const int16_t n = cmd_functions.read(buffer, cmd->payload);
+	if (n != cmd->payload) {
+		LOG_DEBUG(" Datenempfang fehlerhaft");
+		prog_size = 0;
+		return;
+	}
+	prog_size -= (uint16_t) n;
+	LOG_DEBUG(" prog_size=%u", prog_size);
+	if ((uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) < MS_TO_TICKS(COMMAND_TIMEOUT)) {
+		/* OK */
+//		puts(buffer);
+		if (index + (uint16_t) n == SD_BLOCK_SIZE || prog_size == 0) {
+			/* Puffer in Datei schreiben */
+			LOG_DEBUG(" Puffer rausschreiben...");
+#ifdef SDFAT_AVAILABLE
+			if (sdfat_write(prog_file, type == 0 ? GET_MMC_BUFFER(ubasic_buffer) : GET_MMC_BUFFER(abl_buffer), SD_BLOCK_SIZE) != SD_BLOCK_SIZE) {
+				/* Fehler */
+				LOG_ERROR("Fehler beim Dateizugriff");
+				prog_size = 0;
+				return;
+			}
+#else // EEPROM
+			const uint16_t block = (uint16_t) done / SD_BLOCK_SIZE;
+#if defined __AVR_ATmega1284P__ || defined PC
+			if (block > 6) {
+#elif defined MCU_ATMEGA644X
+			if (block > 2) {
+#else // ATmega32
+			if (block > 0) {
+#endif // MCU-Typ
+				return;
+			}
+#ifdef LED_AVAILABLE
+			LED_on(LED_ROT);
+#endif
+			ctbot_eeprom_write_block(&abl_eeprom_data[block << 9], GET_MMC_BUFFER(abl_buffer), 512);
+#ifdef LED_AVAILABLE
+			LED_off(LED_ROT);
+#endif
+#endif // SDFAT_AVAILABLE
+			memset(type == 0 ? GET_MMC_BUFFER(ubasic_buffer) : GET_MMC_BUFFER(abl_buffer), 0, SD_BLOCK_SIZE);
+			if (prog_size == 0) {
+				/* Progamm vollstaendig empfangen */
+				sdfat_flush(prog_file);
+				if (type == 1) { // ABL
+					sdfat_close(prog_file);
+				}
+				LOG_DEBUG("->fertig");
+			}
+		}
+	} else {
+		/* Fehler */
+		LOG_ERROR("Timeout beim Programmempfang");
+		prog_size = 0;
+	}
+}
+
+/**
+ * Startet ein uebertragenes Programm
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void prog_transfer_start(command_t * cmd) {
+	switch ((uint8_t) cmd->data_l) {
+#ifdef BEHAVIOUR_UBASIC_AVAILABLE
+	case 0:
+		/* uBasic */
+		bot_ubasic(NULL);
+		break;
+#endif // BEHAVIOUR_UBASIC_AVAILABLE
+#ifdef BEHAVIOUR_ABL_AVAILABLE
+	case 1:
+		/* ABL */
+		bot_abl(NULL, NULL);
+		break;
+#endif // BEHAVIOUR_ABL_AVAILABLE
+	}
+}
+
+/**
+ * Bricht ein laufendes Programm ab
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void prog_transfer_stop(command_t * cmd) {
+	switch ((uint8_t) cmd->data_l) {
+#ifdef BEHAVIOUR_UBASIC_AVAILABLE
+	case 0:
+		/* uBasic */
+		bot_ubasic_break();
+		break;
+#endif // BEHAVIOUR_UBASIC_AVAILABLE
+#ifdef BEHAVIOUR_ABL_AVAILABLE
+	case 1: {
+		/* ABL */
+		abl_cancel();
+		break;
+	}
+#endif // BEHAVIOUR_ABL_AVAILABLE
+	}
+}
+#endif // COMMAND_AVAILABLE && (BEHAVIOUR_UBASIC_AVAILABLE || BEHAVIOUR_ABL_AVAILABLE)
@@ -151,7 +151,7 @@ void post_behaviour(void) {
 #ifdef ARM_LINUX_BOARD
 	set_bot_2_atmega();
 #endif // ARM_LINUX_BOARD
-	command_write(CMD_DONE, SUB_CMD_NORM, simultime, 0, 0); // flusht auch den Sendepuffer
+	command_write(CMD_DONE, SUB_CMD_NORM, simultime, simulcycle, 0); // quittiert den Sim-Zyklus, flusht auch den Sendepuffer
 
 #ifdef DEBUG_TIMES
 	/* Zum Debuggen der Zeiten */
@@ -193,6 +193,10 @@ void ctbot_shutdown(void) {
 	log_flush();
 #endif
 
+#if defined COMMAND_AVAILABLE && defined COMMAND_STATS
+	command_print_stats();
+#endif
+
 #ifdef SDFAT_AVAILABLE
 	sdfat_c_sync_vol();
 #endif
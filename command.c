@@ -40,6 +40,8 @@ EEPROM uint8_t bot_address = CMD_BROADCAST; /**< Kommunikations-Adresse des Bots
 #include "rc5.h"
 #include "rc5-codes.h"
 #include "bot-logic.h"
+#include "behaviour_remotecall.h"
+#include "prog_transfer.h"
 #include "bot-2-sim.h"
 #include "bot-2-atmega.h"
 #include "bot-2-bot.h"
@@ -57,11 +59,13 @@ EEPROM uint8_t bot_address = CMD_BROADCAST; /**< Kommunikations-Adresse des Bots
 #include <stdio.h>
 #include <stddef.h>
 #include <stdlib.h>
+#ifdef PC
+#include <sys/time.h>
+#endif
 
 
 //#define CRC_CHECK				/**< Soll die Kommunikation per CRC-Checksumme abgesichert werden? */
 #define CHECK_CMD_ADDRESS		/**< soll die Zieladresse der Kommandos ueberprueft werden? */
-#define COMMAND_TIMEOUT 15		/**< Anzahl an ms, die maximal auf fehlende Daten gewartet wird */
 #define BOT_2_RPI_TIMEOUT 20000UL /**< Timeout fuer ARM-Boards */
 
 /* CRC aktivieren fuer ARM-Boards, Adress-Check deaktivieren */
@@ -97,6 +101,8 @@ cmd_func_t cmd_functions = {
 	.read = NULL,
 	.crc_check = NULL,
 	.crc_calc = NULL,
+	.peek = NULL,
+	.skip = NULL,
 };
 
 
@@ -109,6 +115,7 @@ cmd_func_t cmd_functions = {
 #define LOG_DEBUG(...) {}
 #endif
 
+
 /**
  * Initialisiert die (High-Level-)Kommunikation
  */
@@ -143,27 +150,143 @@ void command_init(void) {
 	cmd_functions.read = uart_read;
 	cmd_functions.crc_check = uart_check_crc;
 	cmd_functions.crc_calc = uart_calc_crc;
+	cmd_functions.peek = NULL;
+	cmd_functions.skip = NULL;
 #endif // MCU
 
 	LOG_DEBUG("command_init() done.");
 }
 
+/**
+ * Prueft ein empfangenes Kommando und uebernimmt es nach received_command
+ * \param *command	Zeiger auf das Kommando, Startcode ist bereits geprueft
+ * \return			0 falls alles OK, sonst Fehlercode wie command_read()
+ */
+static int8_t check_command(command_t * command) {
+#ifdef PC
+#if BYTE_ORDER == BIG_ENDIAN
+	uint16_t store; // Puffer fuer die Endian-Konvertierung
+#endif
+#endif // PC
+
+	// validate (Startcode ist bereits ok, sonst waeren wir nicht hier)
+	if (command->CRC == CMD_STOPCODE) {
+#ifdef DEBUG_COMMAND_NOISY
+		LOG_DEBUG("Command is valid");
+#endif
+
+#ifdef CRC_CHECK
+		if (! cmd_functions.crc_check(command)) {
+			LOG_ERROR("CRC ungueltig:");
+#ifdef DEBUG_COMMAND
+			command_display(command);
+#endif
+			memcpy(&received_command, command, sizeof(command_t));
+			return -20;
+		} else {
+#ifdef DEBUG_COMMAND_NOISY
+			LOG_DEBUG("CRC korrekt");
+#endif // DEBUG_COMMAND_NOISY
+		}
+#endif // CRC_CHECK
+
+#ifdef CHECK_CMD_ADDRESS
+		/* Ist das Paket ueberhaupt fuer uns? */
+		if ((command->to != CMD_BROADCAST) && (command->to != CMD_IGNORE_ADDR) && (command->to != get_bot_address()) && (command->request.command != CMD_WELCOME)) {
+			LOG_DEBUG("Fehler: Paket To= %d statt %u", command->to, get_bot_address());
+#ifdef LOG_AVAILABLE
+			command_display(command);
+#endif
+			return -10;
+		}
+#endif // CHECK_CMD_ADDRESS
+
+		// Transfer
+		memcpy(&received_command, command, sizeof(command_t));
+#ifdef PC
+#if BYTE_ORDER == BIG_ENDIAN
+		/* Umwandeln der 16 bit Werte in Big Endian */
+		store = received_command.data_l;
+		received_command.data_l = store << 8;
+		received_command.data_l |= (store >> 8) & 0xff;
+
+		store = received_command.data_r;
+		received_command.data_r = store << 8;
+		received_command.data_r |= (store >> 8) & 0xff;
+#endif // BYTE_ORDER == BIG_ENDIAN
+#endif // PC
+
+#ifdef DEBUG_COMMAND_NOISY
+		LOG_DEBUG("Command received:");
+		command_display(&received_command);
+#endif
+		return 0;
+	} else { // Command not valid
+		LOG_ERROR("Invalid Command:");
+		command_display(command);
+		return -6;
+	}
+}
+
+/**
+ * Liest ein Kommando aus dem Empfangspuffer der Verbindung (cmd_functions.peek()), ist blockierend!
+ * Bytes vor dem Startcode und Startcodes ohne passenden Stopcode werden einzeln verworfen, so dass
+ * der Parser auch auf einem Startcode innerhalb verworfener Daten wieder aufsetzt. Die Payload bleibt im Puffer.
+ * \return	0 falls alles OK, sonst Fehlercode wie command_read()
+ */
+static int8_t command_read_stream(void) {
+	for (;;) {
+		const uint8_t * data = cmd_functions.peek(sizeof(command_t));
+		if (! data) {
+			LOG_ERROR("command_read(): peek() failed");
+			return -1;
+		}
+
+		/* Suche nach dem Beginn des Frames */
+		uint8_t start = 0;
+		while (start < sizeof(command_t) && data[start] != CMD_STARTCODE) {
+			start++;
+		}
+		if (start) {
+			LOG_DEBUG("verwerfe %u Bytes vor dem Startcode", start);
+			cmd_functions.skip(start);
+			continue;
+		}
+
+		command_t * command = (command_t *) data;
+		if (command->CRC != CMD_STOPCODE) {
+			LOG_DEBUG("kein Stopcode, suche naechsten Startcode");
+			cmd_functions.skip(1);
+			continue;
+		}
+
+		const int8_t result = check_command(command);
+		const uint8_t payload = command->payload;
+		cmd_functions.skip(sizeof(command_t));
+		if (result == -10 && payload) {
+			/* Payload eines fremden Pakets verwerfen */
+			cmd_functions.peek(payload);
+			cmd_functions.skip(payload);
+		}
+		return result;
+	}
+}
+
 /**
  * Liest ein Kommando ein, ist blockierend!
- * Greift auf cmd_functions.read() zurueck
+ * Greift auf cmd_functions.read() zurueck, bzw. auf cmd_functions.peek(), falls die Verbindung einen Empfangspuffer hat
  * Achtung, die Payload wird nicht mitgelesen!
  */
 int8_t command_read(void) {
+	if (cmd_functions.peek) {
+		return command_read_stream();
+	}
+
 	int16_t bytesRcvd;
 	int8_t start = 0; // Start des Kommandos
 	int8_t i;
 	command_t * command; // Pointer zum Casten der empfangegen Daten
 	uint8_t buffer[RCVBUFSIZE]; // Puffer
-#ifdef PC
-#if BYTE_ORDER == BIG_ENDIAN
-	uint16_t store; // Puffer fuer die Endian-Konvertierung
-#endif
-#endif // PC
 
 #ifdef MCU
 	uint16_t old_ticks; // alte Systemzeit
@@ -243,63 +366,23 @@ int8_t command_read(void) {
 	//	command_display(command);
 #endif
 
-	// validate (Startcode ist bereits ok, sonst waeren wir nicht hier)
-	if (command->CRC == CMD_STOPCODE) {
-#ifdef DEBUG_COMMAND_NOISY
-		LOG_DEBUG("Command is valid");
-#endif
-
-#ifdef CRC_CHECK
-		if (! cmd_functions.crc_check(command)) {
-			LOG_ERROR("CRC ungueltig:");
-#ifdef DEBUG_COMMAND
-			command_display(command);
-#endif
-			memcpy(&received_command, command, sizeof(command_t));
-			return -20;
-		} else {
-#ifdef DEBUG_COMMAND_NOISY
-			LOG_DEBUG("CRC korrekt");
-#endif // DEBUG_COMMAND_NOISY
-		}
-#endif // CRC_CHECK
-
-#ifdef CHECK_CMD_ADDRESS
-		/* Ist das Paket ueberhaupt fuer uns? */
-		if ((command->to != CMD_BROADCAST) && (command->to != CMD_IGNORE_ADDR) && (command->to != get_bot_address()) && (command->request.command != CMD_WELCOME)) {
-			LOG_DEBUG("Fehler: Paket To= %d statt %u", command->to, get_bot_address());
-#ifdef LOG_AVAILABLE
-			command_display(command);
-#endif
-			return -10;
-		}
-#endif // CHECK_CMD_ADDRESS
-
-		// Transfer
-		memcpy(&received_command, command, sizeof(command_t));
-#ifdef PC
-#if BYTE_ORDER == BIG_ENDIAN
-		/* Umwandeln der 16 bit Werte in Big Endian */
-		store = received_command.data_l;
-		received_command.data_l = store << 8;
-		received_command.data_l |= (store >> 8) & 0xff;
-
-		store = received_command.data_r;
-		received_command.data_r = store << 8;
-		received_command.data_r |= (store >> 8) & 0xff;
-#endif // BYTE_ORDER == BIG_ENDIAN
-#endif // PC
+	return check_command(command);
+}
 
-#ifdef DEBUG_COMMAND_NOISY
-		LOG_DEBUG("Command received:");
-		command_display(&received_command);
-#endif
-		return 0;
-	} else { // Command not valid
-		LOG_ERROR("Invalid Command:");
-		command_display(command);
-		return -6;
+/**
+ * Liefert die Payload des zuletzt empfangenen Kommandos direkt aus dem Empfangspuffer der Verbindung
+ * und entfernt sie dort, ist blockierend!
+ * \return	Zeiger auf die Payload (gueltig bis zum naechsten Lesen) oder NULL, falls die Verbindung keinen Empfangspuffer hat
+ */
+const void * command_payload(void) {
+	if (! cmd_functions.peek || received_command.payload == 0) {
+		return NULL;
+	}
+	const void * data = cmd_functions.peek(received_command.payload);
+	if (data) {
+		cmd_functions.skip(received_command.payload);
 	}
+	return data;
 }
 
 /**
@@ -398,32 +481,61 @@ uint8_t command_write_to_internal(uint8_t command, uint8_t subcommand, uint8_t t
 	request.subcommand = tmp.bits;
 
 	request.direction = DIR_REQUEST; // Anfrage
-	cmd_to_send.startCode = CMD_STARTCODE;
-	cmd_to_send.CRC = CMD_STOPCODE;
-	cmd_to_send.request = request;
-	cmd_to_send.from = get_bot_address();
-	cmd_to_send.to = to;
-	cmd_to_send.payload = payload;
-	cmd_to_send.data_l = data_l;
-	cmd_to_send.data_r = data_r;
-	cmd_to_send.seq = count++;
+#if defined PC && ! defined ARM_LINUX_BOARD
+	command_t cmd_buf; // wird ohne os_enterCS() aufgerufen, daher nicht cmd_to_send verwenden
+	command_t * const cmd = &cmd_buf;
+#else
+	command_t * const cmd = &cmd_to_send;
+#endif
+	cmd->startCode = CMD_STARTCODE;
+	cmd->CRC = CMD_STOPCODE;
+	cmd->request = request;
+	cmd->from = get_bot_address();
+	cmd->to = to;
+	cmd->payload = payload;
+	cmd->data_l = data_l;
+	cmd->data_r = data_r;
+#if defined PC && ! defined ARM_LINUX_BOARD
+	/* per TCP vergibt tcp_commit() die Sequenznummer beim Einreihen, damit sie in Sendereihenfolge ankommt */
+	const uint8_t defer_seq = cmd_functions.write == tcp_write;
+	cmd->seq = defer_seq ? 0 : __atomic_fetch_add(&count, 1, __ATOMIC_RELAXED);
+#elif defined PC
+	cmd->seq = __atomic_fetch_add(&count, 1, __ATOMIC_RELAXED);
+#else
+	cmd->seq = count++;
+#endif
 
 #ifdef DEBUG_COMMAND
 	LOG_DEBUG("Command written:");
-	command_display(&cmd_to_send);
+	command_display(cmd);
 #endif
 
 #ifdef CRC_CHECK
-	cmd_functions.crc_calc(&cmd_to_send);
+	cmd_functions.crc_calc(cmd);
 #endif // CRC_CHECK
 
-	if (send_cmd(&cmd_to_send) != sizeof(command_t)) {
+	if (send_cmd(cmd) != sizeof(command_t)) {
 		return 1;
 	}
+#if defined PC && ! defined ARM_LINUX_BOARD
+	if (defer_seq) {
+		tcp_defer_seq();
+	}
+#endif
 
 	return 0;
 }
 
+#if defined PC && ! defined ARM_LINUX_BOARD
+/* tcp_write() puffert threadlokal und tcp_commit() reiht nur vollstaendige Kommandos ein,
+ * daher muessen sich die Threads hier nicht gegenseitig ausschliessen */
+#define command_lock()
+#define command_unlock()
+#else
+#define command_lock() os_enterCS()		/**< Schuetzt cmd_to_send und den Kommunikationskanal */
+#define command_unlock() os_exitCS()	/**< Gibt cmd_to_send und den Kommunikationskanal wieder frei */
+#endif
+
 /**
  * Uebertraegt ein Kommando und wartet nicht auf eine Antwort
  * \param command		Kennung zum Command
@@ -434,7 +546,7 @@ uint8_t command_write_to_internal(uint8_t command, uint8_t subcommand, uint8_t t
  * \param payload 		Anzahl der Bytes, die diesem Kommando als Payload folgen
  */
 void command_write_to(uint8_t command, uint8_t subcommand, uint8_t to, int16_t data_l, int16_t data_r, uint8_t payload) {
-	os_enterCS();
+	command_lock();
 #ifdef ARM_LINUX_BOARD
 	cmd_func_t old_func = cmd_functions;
 	if (to != CMD_IGNORE_ADDR) {
@@ -443,14 +555,12 @@ void command_write_to(uint8_t command, uint8_t subcommand, uint8_t to, int16_t d
 #endif // ARM_LINUX_BOARD
 	command_write_to_internal(command, subcommand, to, data_l, data_r, payload);
 #ifdef PC
-	if (command == CMD_BOT_2_BOT) {
-		flushSendBuffer();
-	}
+	tcp_commit(command == CMD_BOT_2_BOT);
 #endif // PC
 #ifdef ARM_LINUX_BOARD
 	cmd_functions = old_func;
 #endif // ARM_LINUX_BOARD
-	os_exitCS();
+	command_unlock();
 }
 
 /**
@@ -462,7 +572,7 @@ void command_write_to(uint8_t command, uint8_t subcommand, uint8_t to, int16_t d
  * \param payload 		Anzahl der Bytes, die diesem Kommando als Payload folgen
  */
 void command_write(uint8_t command, uint8_t subcommand, int16_t data_l, int16_t data_r, uint8_t payload) {
-	os_enterCS();
+	command_lock();
 #ifdef ARM_LINUX_BOARD
 	cmd_func_t old_func = cmd_functions;
 	if (command == CMD_MAP || command == CMD_REMOTE_CALL) {
@@ -474,11 +584,9 @@ void command_write(uint8_t command, uint8_t subcommand, int16_t data_l, int16_t
 	cmd_functions = old_func;
 #endif // ARM_LINUX_BOARD
 #ifdef PC
-	if (command == CMD_DONE) {
-		flushSendBuffer(); // Flushen hier, bevor das Mutex freigegeben wird!
-	}
+	tcp_commit(command == CMD_DONE);
 #endif // PC
-	os_exitCS();
+	command_unlock();
 }
 
 /**
@@ -495,7 +603,7 @@ void command_write_rawdata_to(uint8_t command, uint8_t subcommand, uint8_t to, i
 	if (! cmd_functions.write) {
 		return;
 	}
-	os_enterCS();
+	command_lock();
 #ifdef ARM_LINUX_BOARD
 	cmd_func_t old_func = cmd_functions;
 	if (command == CMD_MAP || command == CMD_REMOTE_CALL || command == CMD_LOG || command == CMD_BOT_2_BOT) {
@@ -506,16 +614,14 @@ void command_write_rawdata_to(uint8_t command, uint8_t subcommand, uint8_t to, i
 		cmd_functions.write(data, payload);
 	}
 #ifdef PC
-	if (command == CMD_BOT_2_BOT) {
-		flushSendBuffer();
-	}
+	tcp_commit(command == CMD_BOT_2_BOT);
 #endif // PC
 #ifdef ARM_LINUX_BOARD
 	if (command == CMD_MAP || command == CMD_REMOTE_CALL) {
 		cmd_functions = old_func;
 	}
 #endif // ARM_LINUX_BOARD
-	os_exitCS();
+	command_unlock();
 }
 
 /**
@@ -557,6 +663,138 @@ void command_write_data(uint8_t command, uint8_t subcommand, int16_t data_l, int
 }
 
 #ifdef BOT_2_SIM_AVAILABLE
+static uint8_t snapshot_active = 0; /**< Hat der Sim das Snapshot-Format bestaetigt? */
+
+#if defined PC && BYTE_ORDER == BIG_ENDIAN
+/**
+ * Wandelt die 16 Bit Werte eines Snapshots zwischen Little und Big Endian um
+ * \param *snapshot	Zeiger auf den Snapshot
+ */
+static void snapshot_swap(sensor_snapshot_t * snapshot) {
+	int16_t * p_data = (int16_t *) snapshot;
+	uint8_t i;
+	for (i = 0; i < offsetof(sensor_snapshot_t, trans) / sizeof(int16_t); ++i) {
+		const uint16_t value = (uint16_t) p_data[i];
+		p_data[i] = (int16_t) ((value << 8) | (value >> 8));
+	}
+}
+#endif // PC && BIG_ENDIAN
+
+/**
+ * Wertet ein CMD_SENS_SNAPSHOT-Kommando vom Sim aus und liest dazu dessen Anhang.
+ * Ein Snapshot ohne Anhang bestaetigt nur das Format.
+ */
+static void snapshot_evaluate(void) {
+	const uint8_t len = received_command.payload;
+	if (received_command.data_l != SENSOR_SNAPSHOT_VERSION || (len && len != sizeof(sensor_snapshot_t))) {
+		LOG_DEBUG("Snapshot-Version %d mit %u Bytes nicht unterstuetzt", received_command.data_l, len);
+		/* Anhang verwerfen, ohne Empfangspuffer synchronisiert sich command_read() am naechsten Startcode */
+		command_payload();
+		return;
+	}
+
+	sensor_snapshot_t snapshot;
+	if (len) {
+		const void * data = command_payload();
+		if (data) {
+			memcpy(&snapshot, data, sizeof(snapshot));
+		} else {
+			uint16_t ticks = TIMER_GET_TICKCOUNT_16;
+#ifdef MCU
+			while (uart_data_available() < len && (uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) < MS_TO_TICKS(COMMAND_TIMEOUT));
+#endif
+			if (cmd_functions.read(&snapshot, len) != len || (uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) >= MS_TO_TICKS(COMMAND_TIMEOUT)) {
+				LOG_ERROR("Timeout beim Empfang des Snapshots");
+				return;
+			}
+		}
+	}
+	snapshot_active = 1;
+	if (! len) {
+		return;
+	}
+
+#if defined PC && BYTE_ORDER == BIG_ENDIAN
+	snapshot_swap(&snapshot);
+#endif
+
+#ifdef PC
+	/* wie die einzelnen Kommandos in command_evaluate() */
+	(*sensor_update_distance)(&sensDistL, &sensDistLToggle, sensDistDataL, snapshot.dist[0]);
+	(*sensor_update_distance)(&sensDistR, &sensDistRToggle, sensDistDataR, snapshot.dist[1]);
+#ifdef ARM_LINUX_BOARD
+	sensEncL = snapshot.enc[0];
+	sensEncR = snapshot.enc[1];
+#else
+	sensEncL += snapshot.enc[0];
+	sensEncR += snapshot.enc[1];
+#endif // ARM_LINUX_BOARD
+	sensBorderL = snapshot.border[0];
+	sensBorderR = snapshot.border[1];
+	sensLineL = snapshot.line[0];
+	sensLineR = snapshot.line[1];
+	sensLDRL = snapshot.ldr[0];
+	sensLDRR = snapshot.ldr[1];
+	sensTrans = snapshot.trans;
+	sensDoor = snapshot.door;
+	sensError = snapshot.error;
+#ifdef MOUSE_AVAILABLE
+	sensMouseDX = (int8_t) snapshot.mouse[0];
+	sensMouseDY = (int8_t) snapshot.mouse[1];
+#endif
+#ifdef BPS_AVAILABLE
+	sensBPS = (uint16_t) snapshot.bps;
+#endif
+#endif // PC
+
+#ifdef RC5_AVAILABLE
+	rc5_receive(snapshot.rc5);
+#endif
+}
+
+/**
+ * Sendet alle Sensor- und Aktuatorwerte als ein Kommando (CMD_SENS_SNAPSHOT) an den Sim,
+ * sofern der Sim das Format durch eigene Snapshots bestaetigt hat
+ * \return	0, falls gesendet, 1 falls der Sim einzelne Kommandos erwartet
+ */
+uint8_t command_write_snapshot(void) {
+	if (! snapshot_active) {
+		return 1;
+	}
+
+	sensor_snapshot_t snapshot;
+	memset(&snapshot, 0, sizeof(snapshot));
+	snapshot.dist[0] = sensDistL;
+	snapshot.dist[1] = sensDistR;
+	snapshot.enc[0] = sensEncL;
+	snapshot.enc[1] = sensEncR;
+	snapshot.border[0] = sensBorderL;
+	snapshot.border[1] = sensBorderR;
+	snapshot.line[0] = sensLineL;
+	snapshot.line[1] = sensLineR;
+	snapshot.ldr[0] = sensLDRL;
+	snapshot.ldr[1] = sensLDRR;
+#ifdef MOUSE_AVAILABLE
+	snapshot.mouse[0] = sensMouseDX;
+	snapshot.mouse[1] = sensMouseDY;
+#endif
+	snapshot.motor[0] = speed_l;
+	snapshot.motor[1] = speed_r;
+	snapshot.bps = (int16_t) sensBPS;
+	snapshot.trans = sensTrans;
+	snapshot.door = sensDoor;
+	snapshot.error = sensError;
+#ifdef LED_AVAILABLE
+	snapshot.led = led;
+#endif
+#if defined PC && BYTE_ORDER == BIG_ENDIAN
+	snapshot_swap(&snapshot);
+#endif
+
+	command_write_rawdata(CMD_SENS_SNAPSHOT, SUB_CMD_NORM, SENSOR_SNAPSHOT_VERSION, 0, sizeof(snapshot), &snapshot);
+	return 0;
+}
+
 /**
  * Registriert den Bot beim Sim und teilt diesem dabei mit, welche
  * Features aktiviert sind
@@ -572,6 +810,7 @@ void register_bot(void) {
 			unsigned basic:1;		// | 8
 			unsigned map:1;			// | 16
 			unsigned remotecall:1;	// | 32
+			unsigned snapshot:1;	// | 64
 		} PACKED_FORCE data;
 		int16_t raw;
 	} features = {
@@ -606,570 +845,561 @@ void register_bot(void) {
 #else
 			0,
 #endif
+			1,
 		}
 	};
 
+	/* Snapshots erst wieder senden, wenn der Sim sie bestaetigt hat */
+	snapshot_active = 0;
+
 	/* Bot beim Sim anmelden */
 #if defined MCU || defined ARM_LINUX_BOARD
 	command_write(CMD_WELCOME, SUB_WELCOME_REAL, features.raw, 0, 0);
 #else
-	command_write(CMD_WELCOME, SUB_WELCOME_SIM, features.raw, 0, 0);
+	/* data_r: Pipeline-Fenster, Sims ohne Pipeline-Modus ignorieren es und bleiben im Lockstep */
+	command_write(CMD_WELCOME, SUB_WELCOME_SIM, features.raw, bot_2_sim_window, 0);
 #endif // ARM_LINUX_BOARD
 }
 #endif // BOT_2_SIM_AVAILABLE
 
+#ifdef BOT_2_SIM_AVAILABLE
 /**
- * Wertet das Kommando im Puffer aus
- * \return 1, wenn Kommando schon bearbeitet wurde, 0 sonst
+ * Sim begruesst den Bot, Bot meldet sich an und fordert ggf. eine Adresse an
+ * \param *cmd	Zeiger auf das empfangene Kommando
  */
-int8_t command_evaluate(void) {
-#ifdef RC5_AVAILABLE
-	static uint16_t RC5_Last_Toggle = 0xffff;
-#endif
-#if defined BEHAVIOUR_UBASIC_AVAILABLE || defined BEHAVIOUR_ABL_AVAILABLE
-#ifdef SDFAT_AVAILABLE
-	static pFatFile prog_file;
-#endif // SDFAT_AVAILABLE
-	static uint16_t prog_size = 0;
-#endif // BEHAVIOUR_UBASIC_AVAILABLE || BEHAVIOUR_ABL_AVAILABLE
-	int8_t analyzed = 1;
+static void handle_welcome(command_t * cmd) {
+	(void) cmd;
+	/* Bot beim Sim anmelden */
+	register_bot();
 
-#if defined LOG_AVAILABLE && defined CHECK_CMD_ADDRESS
-	if (received_command.from != CMD_SIM_ADDR && received_command.from != CMD_IGNORE_ADDR) {
-		LOG_DEBUG("Weitergeleitetes Kommando:");
+	if (get_bot_address() == CMD_BROADCAST) {
+		/* Adresse anfordern */
+		command_write(CMD_ID, SUB_ID_REQUEST, 0, 0, 0);
 	}
-#ifdef DEBUG_COMMAND_NOISY
-		command_display(&received_command);
-#endif // DEBUG_COMMAND_NOISY
-#endif // LOG_AVAILABLE
-	/* woher ist das Kommando? */
-#ifdef CHECK_CMD_ADDRESS
-	if (received_command.from == CMD_SIM_ADDR || received_command.from == CMD_IGNORE_ADDR) {
-#endif
-		/* Daten vom ct-Sim */
-		switch (received_command.request.command) {
-#ifdef RC5_AVAILABLE
-		case CMD_SENS_RC5:
-			rc5_ir_data.ir_data = (uint16_t) received_command.data_l
-#ifndef ARM_LINUX_BOARD
-				| (RC5_Last_Toggle & RC5_TOGGLE)
-#endif
-				;
-			if (received_command.data_l != 0) {
-				RC5_Last_Toggle = 0xffff ^ (RC5_Last_Toggle & RC5_TOGGLE);
-			}
-			break;
-#endif // RC5_AVAILABLE
-
-		case CMD_WELCOME:
-#ifdef BOT_2_SIM_AVAILABLE
-			/* Bot beim Sim anmelden */
-			register_bot();
-
-			if (get_bot_address() == CMD_BROADCAST) {
-				/* Adresse anfordern */
-				command_write(CMD_ID, SUB_ID_REQUEST, 0, 0, 0);
-			}
-#ifdef BOT_2_BOT_AVAILABLE
-			/* hello (bot-)world! */
-			else {
-				command_write_to(BOT_CMD_WELCOME, SUB_CMD_NORM, CMD_BROADCAST, 0, 0, 0);
-			}
-#endif // BOT_2_BOT_AVAILABLE
-#endif // BOT_2_SIM_AVAILABLE
-			break;
-		case CMD_ID:
-			if (received_command.request.subcommand == SUB_ID_OFFER) {
-#ifdef LOG_AVAILABLE
-				LOG_DEBUG("Bekomme eine Adresse angeboten: %u", (uint8_t) received_command.data_l);
-#endif // LOG_AVAILABLE
-				set_bot_address((uint8_t) received_command.data_l); // Setze Adresse
-				command_write(CMD_ID, SUB_ID_SET, received_command.data_l, 0, 0); // Und bestaetige dem Sim das ganze
 #ifdef BOT_2_BOT_AVAILABLE
-				/* hello (bot-)world! */
-				command_write_to(BOT_CMD_WELCOME, SUB_CMD_NORM, CMD_BROADCAST, 0, 0, 0);
+	/* hello (bot-)world! */
+	else {
+		command_write_to(BOT_CMD_WELCOME, SUB_CMD_NORM, CMD_BROADCAST, 0, 0, 0);
+	}
 #endif // BOT_2_BOT_AVAILABLE
-			}
-			break;
-
-#if defined MOUSE_AVAILABLE && defined BOT_2_SIM_AVAILABLE
-		case CMD_SENS_MOUSE_PICTURE: // Sim fragt nach dem Bild
-			mouse_transmit_picture();
-			break;
-#endif // MOUSE_AVAILABLE
-
-#ifdef BEHAVIOUR_REMOTECALL_AVAILABLE
-		case CMD_REMOTE_CALL:
-			LOG_DEBUG("RemoteCall-CMD:");
-			switch (received_command.request.subcommand) {
-			case SUB_REMOTE_CALL_LIST:
-				LOG_DEBUG(" Liste");
-				bot_remotecall_list();
-				break;
-			case SUB_REMOTE_CALL_ORDER: {
-				LOG_DEBUG("RemoteCall empfangen. Data=%u Bytes", received_command.payload);
-				uint8_t buffer[REMOTE_CALL_BUFFER_SIZE];
-				uint16_t ticks = TIMER_GET_TICKCOUNT_16;
-#ifdef MCU
-				while (uart_data_available() < received_command.payload && (uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) < MS_TO_TICKS(COMMAND_TIMEOUT));
-#endif
-				cmd_functions.read(buffer, received_command.payload);
-				if ((uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) < MS_TO_TICKS(COMMAND_TIMEOUT)) {
-					bot_remotecall_from_command((char *) &buffer);
-				} else {
-					int16_t result = BEHAVIOUR_SUBFAIL;
-					command_write(CMD_REMOTE_CALL, SUB_REMOTE_CALL_DONE, result, result, 0);
-				}
-				break;
-			}
-			case SUB_REMOTE_CALL_ABORT: {
-				LOG_DEBUG("RemoteCalls werden abgebrochen");
-				bot_remotecall_cancel();
-				break;
-			}
+}
 
-			default:
-				LOG_DEBUG("unbekanntes Subkommando: %c", received_command.request.subcommand);
-				break;
-			}
-			break;
-#endif // BEHAVIOUR_REMOTECALL_AVAILABLE
-
-#ifdef MAP_2_SIM_AVAILABLE
-		case CMD_MAP:
-			switch (received_command.request.subcommand) {
-			case SUB_MAP_REQUEST:
-				map_2_sim_send();
-				break;
-			}
-			break;
-#endif // MAP_2_SIM_AVAILABLE
+/**
+ * Snapshot aller Sensorwerte vom Sim
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_snapshot(command_t * cmd) {
+	(void) cmd;
+	snapshot_evaluate();
+}
 
-		case CMD_SHUTDOWN:
-			ctbot_shutdown();
-			break;
+#ifdef MOUSE_AVAILABLE
+/**
+ * Sim fragt nach dem Bild des Maussensors
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_mouse_picture(command_t * cmd) {
+	(void) cmd;
+	mouse_transmit_picture();
+}
+#endif // MOUSE_AVAILABLE
+#endif // BOT_2_SIM_AVAILABLE
 
-#if defined BEHAVIOUR_UBASIC_AVAILABLE || defined BEHAVIOUR_ABL_AVAILABLE
-		case CMD_PROGRAM: {
-			LOG_DEBUG("Programm-Empfang:");
-			switch (received_command.request.subcommand) {
-			case SUB_PROGRAM_PREPARE: {
-				/* Vorbereitung auf neues Programm */
-				const uint8_t type = (uint8_t) received_command.data_l;
-				prog_size = (uint16_t) received_command.data_r;
-				LOG_DEBUG(" Typ=%u Laenge=%u", type, prog_size);
-				const uint8_t len = received_command.payload;
-				LOG_DEBUG(" len=%u", len);
-				char filename[len + 1];
-				uint16_t ticks = TIMER_GET_TICKCOUNT_16;
-#ifdef MCU
-				while (uart_data_available() < len &&
-					(uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) < MS_TO_TICKS(COMMAND_TIMEOUT));
-#endif
-				cmd_functions.read(filename, len);
-				if ((uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) < MS_TO_TICKS(COMMAND_TIMEOUT)) {
-					/* OK */
-					filename[len] = 0;
-					LOG_DEBUG(" Datei:\"%s\"", filename);
-					void* buffer = type == 0 ? GET_MMC_BUFFER(ubasic_buffer) : GET_MMC_BUFFER(abl_buffer);
-#ifdef SDFAT_AVAILABLE
-					/* Datei anlegen */
-					LOG_DEBUG(" prog_size=%u", prog_size);
-					if (sdfat_open(filename, &prog_file, SDFAT_O_RDWR | SDFAT_O_TRUNC | SDFAT_O_CREAT)) {
-						LOG_ERROR("Fehler beim Dateizugriff");
-						prog_size = 0;
-						break;
-					}
-#endif // SDFAT_AVAILABLE
-					memset(buffer, 0, SD_BLOCK_SIZE);
-					/* falls uBasic / ABL laeuft, abbrechen */
-#if defined BEHAVIOUR_UBASIC_AVAILABLE && defined BEHAVIOUR_ABL_AVAILABLE
-					Behaviour_t* const beh = type == 0 ? get_behaviour(bot_ubasic_behaviour) : get_behaviour(bot_abl_behaviour);
-#elif defined BEHAVIOUR_UBASIC_AVAILABLE
-					Behaviour_t* const beh = type == 0 ? get_behaviour(bot_ubasic_behaviour) : NULL;
-#elif defined BEHAVIOUR_ABL_AVAILABLE
-					Behaviour_t* const beh = type == 0 ? NULL : get_behaviour(bot_abl_behaviour);
-#endif
-					deactivate_called_behaviours(beh);
-					deactivate_behaviour(beh);
-					/* evtl. hatte uBasic / ABL einen RemoteCall gestartet, daher dort aufraeumen */
-					activateBehaviour(NULL, bot_remotecall_behaviour);
-					/* Datei laden */
-					switch (type) {
-#ifdef BEHAVIOUR_UBASIC_AVAILABLE
-					case 0:
-						/* uBasic */
-						bot_ubasic_load_file(filename, &prog_file);
-						break;
-#endif // BEHAVIOUR_UBASIC_AVAILABLE
-#ifdef BEHAVIOUR_ABL_AVAILABLE
-					case 1:
-						/* ABL */
-						abl_load(filename);
-						break;
-#endif // BEHAVIOUR_ABL_AVAILABLE
-					}
-				} else {
-					/* Fehler */
-					LOG_ERROR("Timeout beim Programmempfang");
-					prog_size = 0;
-				}
-				break;
-			}
+/**
+ * Bot herunterfahren
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_shutdown(command_t * cmd) {
+	(void) cmd;
+	ctbot_shutdown();
+}
 
-			case SUB_PROGRAM_DATA: {
-				/* Datenteil eines Programms */
-				if (prog_size == 0) {
-					LOG_DEBUG(" Datenempfang fehlerhaft");
-					break;
-				}
-				const uint16_t done = (uint16_t) received_command.data_r;
-				const uint8_t type = (uint8_t) received_command.data_l;
-				LOG_DEBUG(" type=%u %u Bytes (%u Bytes insgesamt)", type, received_command.payload, received_command.payload + done);
-				void* buffer = type == 0 ? GET_MMC_BUFFER(ubasic_buffer) : GET_MMC_BUFFER(abl_buffer);
-				const uint16_t index = (uint16_t) done % SD_BLOCK_SIZE;
-				buffer += index;
-				uint16_t ticks = TIMER_GET_TICKCOUNT_16;
-#ifdef MCU
-				while (uart_data_available() < received_command.payload && (uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) < MS_TO_TICKS(COMMAND_TIMEOUT));
-#endif
-				const int16_t n = cmd_functions.read(buffer, received_command.payload);
-				if (n != received_command.payload) {
-					LOG_DEBUG(" Datenempfang fehlerhaft");
-					prog_size = 0;
-					break;
-				}
-				prog_size -= (uint16_t) n;
-				LOG_DEBUG(" prog_size=%u", prog_size);
-				if ((uint16_t) (TIMER_GET_TICKCOUNT_16 - ticks) < MS_TO_TICKS(COMMAND_TIMEOUT)) {
-					/* OK */
-//					puts(buffer);
-					if (index + (uint16_t) n == SD_BLOCK_SIZE || prog_size == 0) {
-						/* Puffer in Datei schreiben */
-						LOG_DEBUG(" Puffer rausschreiben...");
-#ifdef SDFAT_AVAILABLE
-						if (sdfat_write(prog_file, type == 0 ? GET_MMC_BUFFER(ubasic_buffer) : GET_MMC_BUFFER(abl_buffer), SD_BLOCK_SIZE) != SD_BLOCK_SIZE) {
-							/* Fehler */
-							LOG_ERROR("Fehler beim Dateizugriff");
-							prog_size = 0;
-							break;
-						}
-#else // EEPROM
-						const uint16_t block = (uint16_t) done / SD_BLOCK_SIZE;
-#if defined __AVR_ATmega1284P__ || defined PC
-						if (block > 6) {
-#elif defined MCU_ATMEGA644X
-						if (block > 2) {
-#else // ATmega32
-						if (block > 0) {
-#endif // MCU-Typ
-							break;
-						}
-#ifdef LED_AVAILABLE
-						LED_on(LED_ROT);
-#endif
-						ctbot_eeprom_write_block(&abl_eeprom_data[block << 9], GET_MMC_BUFFER(abl_buffer), 512);
-#ifdef LED_AVAILABLE
-						LED_off(LED_ROT);
-#endif
-#endif // SDFAT_AVAILABLE
-						memset(type == 0 ? GET_MMC_BUFFER(ubasic_buffer) : GET_MMC_BUFFER(abl_buffer), 0, SD_BLOCK_SIZE);
-						if (prog_size == 0) {
-							/* Progamm vollstaendig empfangen */
-							sdfat_flush(prog_file);
-							if (type == 1) { // ABL
-								sdfat_close(prog_file);
-							}
-							LOG_DEBUG("->fertig");
-						}
-					}
-				} else {
-					/* Fehler */
-					LOG_ERROR("Timeout beim Programmempfang");
-					prog_size = 0;
-				}
-				break;
-			}
+#ifdef PC
+/* Einige Kommandos ergeben nur fuer simulierte Bots Sinn */
 
-			case SUB_PROGRAM_START:
-				/* Programm starten */
-				switch ((uint8_t) received_command.data_l) {
-#ifdef BEHAVIOUR_UBASIC_AVAILABLE
-				case 0:
-					/* uBasic */
-					bot_ubasic(NULL);
-					break;
-#endif // BEHAVIOUR_UBASIC_AVAILABLE
-#ifdef BEHAVIOUR_ABL_AVAILABLE
-				case 1:
-					/* ABL */
-					bot_abl(NULL, NULL);
-					break;
-#endif // BEHAVIOUR_ABL_AVAILABLE
-				}
-				break;
-
-			case SUB_PROGRAM_STOP:
-				/* Programm abbrechen */
-				switch ((uint8_t) received_command.data_l) {
-#ifdef BEHAVIOUR_UBASIC_AVAILABLE
-				case 0:
-					/* uBasic */
-					bot_ubasic_break();
-					break;
-#endif // BEHAVIOUR_UBASIC_AVAILABLE
-#ifdef BEHAVIOUR_ABL_AVAILABLE
-				case 1: {
-					/* ABL */
-					abl_cancel();
-					break;
-				}
-#endif // BEHAVIOUR_ABL_AVAILABLE
-				}
-				break;
-
-			default:
-				LOG_DEBUG("unbekanntes Subkommando: %c", received_command.request.subcommand);
-				break;
-			}
-			break;
-		}
-#endif // BEHAVIOUR_UBASIC_AVAILABLE || BEHAVIOUR_ABL_AVAILABLE
+/**
+ * Abstandssensoren
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_sens_ir(command_t * cmd) {
+	(*sensor_update_distance)(&sensDistL, &sensDistLToggle, sensDistDataL, cmd->data_l);
+	(*sensor_update_distance)(&sensDistR, &sensDistRToggle,	sensDistDataR, cmd->data_r);
+}
 
-#ifdef PC
-		/* Einige Kommandos ergeben nur fuer simulierte Bots Sinn */
-		case CMD_SENS_IR: {
-			(*sensor_update_distance)(&sensDistL, &sensDistLToggle, sensDistDataL, received_command.data_l);
-			(*sensor_update_distance)(&sensDistR, &sensDistRToggle,	sensDistDataR, received_command.data_r);
-			break;
-		}
-		case CMD_SENS_ENC:
+/**
+ * Radencoder
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_sens_enc(command_t * cmd) {
 #ifdef ARM_LINUX_BOARD
-			sensEncL = received_command.data_l;
-			sensEncR = received_command.data_r;
+	sensEncL = cmd->data_l;
+	sensEncR = cmd->data_r;
 #else
-			sensEncL += received_command.data_l;
-			sensEncR += received_command.data_r;
+	sensEncL += cmd->data_l;
+	sensEncR += cmd->data_r;
 #endif // ARM_LINUX_BOARD
-			break;
-		case CMD_SENS_BORDER:
-			sensBorderL = received_command.data_l;
-			sensBorderR = received_command.data_r;
-			break;
-		case CMD_SENS_LINE:
-			sensLineL = received_command.data_l;
-			sensLineR = received_command.data_r;
-			break;
-		case CMD_SENS_LDR:
-			sensLDRL = received_command.data_l;
-			sensLDRR = received_command.data_r;
-			break;
-		case CMD_SENS_DOOR:
-			sensDoor = (uint8_t) received_command.data_l;
-			break;
-		case CMD_SENS_TRANS:
-			sensTrans = (uint8_t) received_command.data_l;
-			break;
+}
+
+/**
+ * Abgrundsensoren
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_sens_border(command_t * cmd) {
+	sensBorderL = cmd->data_l;
+	sensBorderR = cmd->data_r;
+}
+
+/**
+ * Liniensensoren
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_sens_line(command_t * cmd) {
+	sensLineL = cmd->data_l;
+	sensLineR = cmd->data_r;
+}
+
+/**
+ * Helligkeitssensoren
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_sens_ldr(command_t * cmd) {
+	sensLDRL = cmd->data_l;
+	sensLDRR = cmd->data_r;
+}
+
+/**
+ * Klappensensor
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_sens_door(command_t * cmd) {
+	sensDoor = (uint8_t) cmd->data_l;
+}
+
+/**
+ * Transportfach-Sensor
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_sens_trans(command_t * cmd) {
+	sensTrans = (uint8_t) cmd->data_l;
+}
+
 #ifdef MOUSE_AVAILABLE
-		case CMD_SENS_MOUSE:
-			sensMouseDX = received_command.data_l;
-			sensMouseDY = received_command.data_r;
-			break;
+/**
+ * Maussensor
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_sens_mouse(command_t * cmd) {
+	sensMouseDX = cmd->data_l;
+	sensMouseDY = cmd->data_r;
+}
 #endif // MOUSE_AVAILABLE
-		case CMD_SENS_ERROR:
-			sensError = (uint8_t) received_command.data_l;
-			break;
+
+/**
+ * Motor- oder Batteriefehler
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_sens_error(command_t * cmd) {
+	sensError = (uint8_t) cmd->data_l;
+}
+
 #ifdef BPS_AVAILABLE
-		case CMD_SENS_BPS:
-			sensBPS = received_command.data_l;
-			break;
+/**
+ * Bot Positioning System
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_sens_bps(command_t * cmd) {
+	sensBPS = cmd->data_l;
+}
 #endif // BPS_AVAILABLE
-		case CMD_DONE: {
+
+/**
+ * Ende eines Update-Zyklus, aktualisiert die Systemzeit
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_done(command_t * cmd) {
 #ifdef ARM_LINUX_BOARD
-			static uint32_t last = 0;
-			static uint32_t sum = 0;
-			static uint16_t cnt = 0;
-			union {
-				int16_t s16;
-				uint16_t u16;
-			} low;
-			low.s16 = received_command.data_l;
-			union {
-				int16_t s16;
-				uint16_t u16;
-			} high;
-			high.s16 = received_command.data_r;
-			const uint32_t tick = (uint32_t) low.u16 | ((uint32_t) high.u16 << 16);
-			LOG_DEBUG("time_diff=%lu us", (uint32_t) (tick - last) * 176);
-			const uint32_t diff = (tick - last) * 176;
-			if (diff > BOT_2_RPI_TIMEOUT && last != 0) {
-				LOG_ERROR(" diff=%lu", diff);
-				LOG_DEBUG(" tick=%lu\tlast=%lu", tick, last);
-				LOG_DEBUG(" received_command.data_l=%d\treceived_command.data_r=%d", received_command.data_l, received_command.data_r);
-			}
-			last = tick;
-			tickCount = tick;
-			sum += diff;
-			cnt++;
-			if (cnt == 1024) {
-				LOG_INFO("time_diff avg=%lu us", sum / cnt);
-				fflush(stdout);
-				cnt = 0;
-				sum = 0;
-			}
+	static uint32_t last = 0;
+	static uint32_t sum = 0;
+	static uint16_t cnt = 0;
+	union {
+		int16_t s16;
+		uint16_t u16;
+	} low;
+	low.s16 = cmd->data_l;
+	union {
+		int16_t s16;
+		uint16_t u16;
+	} high;
+	high.s16 = cmd->data_r;
+	const uint32_t tick = (uint32_t) low.u16 | ((uint32_t) high.u16 << 16);
+	LOG_DEBUG("time_diff=%lu us", (uint32_t) (tick - last) * 176);
+	const uint32_t diff = (tick - last) * 176;
+	if (diff > BOT_2_RPI_TIMEOUT && last != 0) {
+		LOG_ERROR(" diff=%lu", diff);
+		LOG_DEBUG(" tick=%lu\tlast=%lu", tick, last);
+		LOG_DEBUG(" received_command.data_l=%d\treceived_command.data_r=%d", cmd->data_l, cmd->data_r);
+	}
+	last = tick;
+	tickCount = tick;
+	sum += diff;
+	cnt++;
+	if (cnt == 1024) {
+		LOG_INFO("time_diff avg=%lu us", sum / cnt);
+		fflush(stdout);
+		cnt = 0;
+		sum = 0;
+	}
 #else
-			simultime = received_command.data_l;
-			system_time_isr(); // Einmal pro Update-Zyklus aktualisieren wir die Systemzeit
+	simultime = cmd->data_l;
+	simulcycle = cmd->data_r; // wird mit dem naechsten CMD_DONE quittiert
+#ifdef BOT_2_SIM_AVAILABLE
+	if (bot_2_sim_free_running) {
+		return; // Systemzeit kommt aus der Echtzeit
+	}
+#endif // BOT_2_SIM_AVAILABLE
+	system_time_isr(); // Einmal pro Update-Zyklus aktualisieren wir die Systemzeit
 #endif // ARM_LINUX_BOARD
-			break;
-		}
+}
 #endif // PC
 
-		case CMD_AKT_LCD: {
 #if defined DISPLAY_MCU_AVAILABLE || defined ARM_LINUX_BOARD
-			void (* display_func)(void) = NULL;
+/**
+ * Liefert die Anzeige-Funktion, deren Screen die LCD-Kommandos darstellt
+ * \return	Zeiger auf die Anzeige-Funktion
+ */
+static inline void (* lcd_display_func(void))(void) {
 #ifdef BOT_2_RPI_AVAILABLE
-			display_func = linux_display;
+	return linux_display;
 #elif defined ARM_LINUX_BOARD
-			display_func = atmega_display;
+	return atmega_display;
+#else
+	return NULL;
 #endif
-			switch (received_command.request.subcommand) {
-			case SUB_LCD_CLEAR:
-				if (screen_functions[display_screen] == display_func) {
-					display_clear();
-					LOG_DEBUG("command_evaluate(): SUB_LCD_CLEAR: display_clear() from ATmega");
-				}
-				break;
-			case SUB_LCD_CURSOR:
-				if (screen_functions[display_screen] == display_func) {
-					display_cursor((uint8_t) (received_command.data_r + 1), (uint8_t) (received_command.data_l + 1));
-					LOG_DEBUG("command_evaluate(): SUB_LCD_CURSOR: display_cursor(%d, %d) from ATmega", received_command.data_r + 1, received_command.data_l + 1);
-				}
-				break;
-			case SUB_LCD_DATA: {
-				if (screen_functions[display_screen] == display_func) {
-					display_cursor((uint8_t) (received_command.data_r + 1), (uint8_t) (received_command.data_l + 1));
-					LOG_DEBUG("command_evaluate(): SUB_LCD_DATA: display_cursor(%d, %d) from ATmega", received_command.data_r + 1, received_command.data_l + 1);
-					LOG_DEBUG(" payload=%u", received_command.payload);
-				}
+}
+
+/**
+ * LCD loeschen
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_lcd_clear(command_t * cmd) {
+	(void) cmd;
+	if (screen_functions[display_screen] == lcd_display_func()) {
+		display_clear();
+		LOG_DEBUG("command_evaluate(): SUB_LCD_CLEAR: display_clear() from ATmega");
+	}
+}
+
+/**
+ * LCD-Cursor setzen
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_lcd_cursor(command_t * cmd) {
+	if (screen_functions[display_screen] == lcd_display_func()) {
+		display_cursor((uint8_t) (cmd->data_r + 1), (uint8_t) (cmd->data_l + 1));
+		LOG_DEBUG("command_evaluate(): SUB_LCD_CURSOR: display_cursor(%d, %d) from ATmega", cmd->data_r + 1, cmd->data_l + 1);
+	}
+}
+
+/**
+ * Text auf dem LCD ausgeben, der Text folgt als Payload
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_lcd_data(command_t * cmd) {
+	void (* display_func)(void) = lcd_display_func();
+	if (screen_functions[display_screen] == display_func) {
+		display_cursor((uint8_t) (cmd->data_r + 1), (uint8_t) (cmd->data_l + 1));
+		LOG_DEBUG("command_evaluate(): SUB_LCD_DATA: display_cursor(%d, %d) from ATmega", cmd->data_r + 1, cmd->data_l + 1);
+		LOG_DEBUG(" payload=%u", cmd->payload);
+	}
 #ifdef MCU
-				uint16_t ticks = TIMER_GET_TICKCOUNT_16;
+	uint16_t ticks = TIMER_GET_TICKCOUNT_16;
 #endif
 #ifdef ARM_LINUX_BOARD
 #ifdef DEBUG_COMMAND
-				char debug_buf[21];
-				memset(debug_buf, 0, sizeof(debug_buf));
-				struct timeval start, now;
-				gettimeofday(&start, NULL);
+	char debug_buf[21];
+	memset(debug_buf, 0, sizeof(debug_buf));
+	struct timeval start, now;
+	gettimeofday(&start, NULL);
 #endif // DEBUG_COMMAND
 #endif // ARM_LINUX_BOARD
-				uint8_t i;
-				for (i = 0; i < received_command.payload; ++i) {
+	uint8_t i;
+	for (i = 0; i < cmd->payload; ++i) {
 #ifdef MCU
-					while (uart_data_available() < 1 && (uint16_t)(TIMER_GET_TICKCOUNT_16 - ticks) < MS_TO_TICKS(COMMAND_TIMEOUT)) {}
+		while (uart_data_available() < 1 && (uint16_t)(TIMER_GET_TICKCOUNT_16 - ticks) < MS_TO_TICKS(COMMAND_TIMEOUT)) {}
 #endif
-					uint8_t n;
-					char buffer;
-					if ((n = (uint8_t) (cmd_functions.read(&buffer, 1))) != 1) {
-						LOG_ERROR("command_evaluate(): SUB_LCD_DATA: error while receiving display data, n=%d i=%u", n, i);
+		uint8_t n;
+		char buffer;
+		if ((n = (uint8_t) (cmd_functions.read(&buffer, 1))) != 1) {
+			LOG_ERROR("command_evaluate(): SUB_LCD_DATA: error while receiving display data, n=%d i=%u", n, i);
 #ifdef MCU
-						LOG_ERROR(" uart_data_available()=%d", uart_data_available());
+			LOG_ERROR(" uart_data_available()=%d", uart_data_available());
 #endif
-						i = 0;
-						break;
-					}
-					if (i < 20 && screen_functions[display_screen] == display_func) {
-						display_data(buffer);
+			i = 0;
+			break;
+		}
+		if (i < 20 && screen_functions[display_screen] == display_func) {
+			display_data(buffer);
 #ifdef DEBUG_COMMAND
-						debug_buf[i] = buffer;
+			debug_buf[i] = buffer;
 #endif
-					}
-				}
+		}
+	}
 #ifdef DEBUG_COMMAND
-				gettimeofday(&now, NULL);
-				const uint64_t t = (now.tv_sec - start.tv_sec) * 1000000UL + now.tv_usec - start.tv_usec;
-				LOG_DEBUG("command_evaluate(): SUB_LCD_DATA: receive took %llu us", t);
-				if (i) {
-					LOG_DEBUG("command_evaluate(): SUB_LCD_DATA: display_data() %u bytes from ATmega", i);
-					LOG_DEBUG(" \"%s\"", debug_buf);
-				}
+	gettimeofday(&now, NULL);
+	const uint64_t t = (now.tv_sec - start.tv_sec) * 1000000UL + now.tv_usec - start.tv_usec;
+	LOG_DEBUG("command_evaluate(): SUB_LCD_DATA: receive took %llu us", t);
+	if (i) {
+		LOG_DEBUG("command_evaluate(): SUB_LCD_DATA: display_data() %u bytes from ATmega", i);
+		LOG_DEBUG(" \"%s\"", debug_buf);
+	}
 #endif // DEBUG_COMMAND
-				break;
-			}
-			} // switch subcommand
+}
 #endif // DISPLAY_MCU_AVAILABLE || ARM_LINUX_BOARD
-			break;
-		}
 
 #ifdef ARM_LINUX_BOARD
-		case CMD_LOG: {
-			char log_buffer[received_command.payload + 1];
-			log_buffer[received_command.payload] = 0;
-			uint8_t i, n;
-			for (i = 0; i < received_command.payload; ++i) {
-				if ((n = cmd_functions.read(&log_buffer[i], 1)) != 1) {
-					LOG_ERROR("command_evaluate(): CMD_LOG: error while receiving log data, n=%d i=%u", n, i);
-					LOG_ERROR(" uart_data_available()=%d", uart_data_available());
-					break;
-				}
-			}
-			LOG_RAW("MCU - %s", log_buffer);
+/**
+ * Log-Ausgabe des ATmega, der Text folgt als Payload
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_log(command_t * cmd) {
+	char log_buffer[cmd->payload + 1];
+	log_buffer[cmd->payload] = 0;
+	uint8_t i, n;
+	for (i = 0; i < cmd->payload; ++i) {
+		if ((n = cmd_functions.read(&log_buffer[i], 1)) != 1) {
+			LOG_ERROR("command_evaluate(): CMD_LOG: error while receiving log data, n=%d i=%u", n, i);
+			LOG_ERROR(" uart_data_available()=%d", uart_data_available());
 			break;
 		}
+	}
+	LOG_RAW("MCU - %s", log_buffer);
+}
 #endif // ARM_LINUX_BOARD
 
 #ifdef BOT_2_RPI_AVAILABLE
-		case CMD_AKT_MOT:
-			motor_set(received_command.data_l, received_command.data_r);
-			break;
-		case CMD_AKT_SERVO:
-			servo_set(SERVO1, (uint8_t) received_command.data_l);
-			servo_set(SERVO2, (uint8_t) received_command.data_r);
-			break;
-		case CMD_AKT_LED: {
-				uint8_t led = LED_get() & LED_TUERKIS;
-				led = (uint8_t) (led | (received_command.data_l & ~LED_TUERKIS)); // LED_TUERKIS wird fuer Fehleranzeige auf ATmega-Seite verwendet
-				LED_set(led);
-				break;
-		}
-		case CMD_SETTINGS:
-			switch (received_command.request.subcommand) {
-			case SUB_SETTINGS_DISTSENS:
-				if (received_command.data_l == 0) {
-					sensor_update_distance = sensor_dist_straight;
-				} else if (received_command.data_l == 1) {
-					sensor_update_distance = sensor_dist_lookup;
-				}
-				break;
-			}
-			break;
+/**
+ * Motorgeschwindigkeit vom Linux-Board
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_akt_mot(command_t * cmd) {
+	motor_set(cmd->data_l, cmd->data_r);
+}
+
+/**
+ * Servos vom Linux-Board
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_akt_servo(command_t * cmd) {
+	servo_set(SERVO1, (uint8_t) cmd->data_l);
+	servo_set(SERVO2, (uint8_t) cmd->data_r);
+}
+
+/**
+ * LEDs vom Linux-Board
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_akt_led(command_t * cmd) {
+	uint8_t led = LED_get() & LED_TUERKIS;
+	led = (uint8_t) (led | (cmd->data_l & ~LED_TUERKIS)); // LED_TUERKIS wird fuer Fehleranzeige auf ATmega-Seite verwendet
+	LED_set(led);
+}
+
+/**
+ * Auswertung der Distanzsensoren umschalten
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+static void handle_settings_distsens(command_t * cmd) {
+	if (cmd->data_l == 0) {
+		sensor_update_distance = sensor_dist_straight;
+	} else if (cmd->data_l == 1) {
+		sensor_update_distance = sensor_dist_lookup;
+	}
+}
 #endif // BOT_2_RPI_AVAILABLE
 
-		default:
-			analyzed = 0; // Command was not analysed yet
-			break;
+/**
+ * Dispatch-Tabelle fuer Kommandos vom Sim, liegt auf dem MCU im Flash.
+ * Die Tabelle wird linear durchsucht, daher stehen die haeufigsten Kommandos vorne.
+ * Andere Module tragen ihre Kommandos ueber das Makro <MODUL>_CMD_HANDLERS aus ihrem Header ein.
+ */
+static const cmd_handler_entry_t cmd_handlers[] PROGMEM = {
+#ifdef BOT_2_SIM_AVAILABLE
+	CMD_HANDLER(CMD_SENS_SNAPSHOT, CMD_SUB_ANY, handle_snapshot)
+#endif
+#ifdef PC
+	CMD_HANDLER(CMD_DONE, CMD_SUB_ANY, handle_done)
+	CMD_HANDLER(CMD_SENS_IR, CMD_SUB_ANY, handle_sens_ir)
+	CMD_HANDLER(CMD_SENS_ENC, CMD_SUB_ANY, handle_sens_enc)
+	CMD_HANDLER(CMD_SENS_BORDER, CMD_SUB_ANY, handle_sens_border)
+	CMD_HANDLER(CMD_SENS_LINE, CMD_SUB_ANY, handle_sens_line)
+	CMD_HANDLER(CMD_SENS_LDR, CMD_SUB_ANY, handle_sens_ldr)
+	CMD_HANDLER(CMD_SENS_DOOR, CMD_SUB_ANY, handle_sens_door)
+	CMD_HANDLER(CMD_SENS_TRANS, CMD_SUB_ANY, handle_sens_trans)
+#ifdef MOUSE_AVAILABLE
+	CMD_HANDLER(CMD_SENS_MOUSE, CMD_SUB_ANY, handle_sens_mouse)
+#endif
+	CMD_HANDLER(CMD_SENS_ERROR, CMD_SUB_ANY, handle_sens_error)
+#ifdef BPS_AVAILABLE
+	CMD_HANDLER(CMD_SENS_BPS, CMD_SUB_ANY, handle_sens_bps)
+#endif
+#endif // PC
+	RC5_CMD_HANDLERS
+#ifdef BOT_2_RPI_AVAILABLE
+	CMD_HANDLER(CMD_AKT_MOT, CMD_SUB_ANY, handle_akt_mot)
+	CMD_HANDLER(CMD_AKT_SERVO, CMD_SUB_ANY, handle_akt_servo)
+	CMD_HANDLER(CMD_AKT_LED, CMD_SUB_ANY, handle_akt_led)
+	CMD_HANDLER(CMD_SETTINGS, SUB_SETTINGS_DISTSENS, handle_settings_distsens)
+#endif
+#if defined DISPLAY_MCU_AVAILABLE || defined ARM_LINUX_BOARD
+	CMD_HANDLER(CMD_AKT_LCD, SUB_LCD_CLEAR, handle_lcd_clear)
+	CMD_HANDLER(CMD_AKT_LCD, SUB_LCD_CURSOR, handle_lcd_cursor)
+	CMD_HANDLER(CMD_AKT_LCD, SUB_LCD_DATA, handle_lcd_data)
+#endif
+#ifdef ARM_LINUX_BOARD
+	CMD_HANDLER(CMD_LOG, CMD_SUB_ANY, handle_log)
+#endif
+	MAP_CMD_HANDLERS
+	REMOTECALL_CMD_HANDLERS
+	PROG_TRANSFER_CMD_HANDLERS
+#ifdef BOT_2_SIM_AVAILABLE
+	CMD_HANDLER(CMD_WELCOME, CMD_SUB_ANY, handle_welcome)
+	BOT_2_SIM_CMD_HANDLERS
+#ifdef MOUSE_AVAILABLE
+	CMD_HANDLER(CMD_SENS_MOUSE_PICTURE, CMD_SUB_ANY, handle_mouse_picture)
+#endif
+#endif // BOT_2_SIM_AVAILABLE
+	CMD_HANDLER(CMD_SHUTDOWN, CMD_SUB_ANY, handle_shutdown)
+};
+
+#define CMD_HANDLER_COUNT (sizeof(cmd_handlers) / sizeof(cmd_handlers[0])) /**< Anzahl der Eintraege in cmd_handlers */
+
+/**
+ * Sucht den Eintrag zu einem Kommando in der Dispatch-Tabelle.
+ * Ein Eintrag fuer das Subkommando hat Vorrang vor einem Eintrag mit CMD_SUB_ANY.
+ * \param command		Kommando
+ * \param subcommand	Subkommando
+ * \return				Index in cmd_handlers oder 255, falls es keinen Eintrag gibt
+ */
+static uint8_t handler_find(uint8_t command, uint8_t subcommand) {
+	uint8_t any = 255;
+	uint8_t i;
+	for (i = 0; i < CMD_HANDLER_COUNT; ++i) {
+		if (pgm_read_byte(&cmd_handlers[i].command) != command) {
+			continue;
+		}
+		const uint8_t sub = pgm_read_byte(&cmd_handlers[i].subcommand);
+		if (sub == subcommand) {
+			return i;
+		}
+		if (sub == CMD_SUB_ANY && any == 255) {
+			any = i;
+		}
+	}
+	return any;
+}
+
+#ifdef COMMAND_STATS
+/** Statistik eines Eintrags der Dispatch-Tabelle */
+typedef struct {
+	uint32_t calls;		/**< Anzahl der Aufrufe */
+	uint32_t time_us;	/**< Summe der Laufzeiten [us] */
+} cmd_handler_stats_t;
+
+static cmd_handler_stats_t cmd_handler_stats[CMD_HANDLER_COUNT]; /**< Statistik je Eintrag von cmd_handlers */
+
+/**
+ * Zeitbasis fuer die Handler-Statistik
+ * \return	Zeit [us], laeuft nach 2^32 us ueber
+ */
+static uint32_t stats_time_us(void) {
+#ifdef PC
+	/* Systemzeit des Bots ist auf dem PC die Simulationszeit, daher echte Zeit nehmen */
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return (uint32_t) now.tv_sec * 1000000UL + (uint32_t) now.tv_usec;
+#else
+	return timer_get_us32();
+#endif // PC
+}
+
+/**
+ * Liefert die Statistik eines Eintrags der Dispatch-Tabelle
+ * \param index		Index des Eintrags, ab 0
+ * \param *p_stats	Zeiger auf Puffer fuer die Statistik
+ * \return			1, falls es den Eintrag index gibt, sonst 0
+ */
+uint8_t command_get_stats(uint8_t index, command_stats_t * p_stats) {
+	if (index >= CMD_HANDLER_COUNT) {
+		return 0;
+	}
+	p_stats->command = pgm_read_byte(&cmd_handlers[index].command);
+	p_stats->subcommand = pgm_read_byte(&cmd_handlers[index].subcommand);
+	p_stats->calls = cmd_handler_stats[index].calls;
+	p_stats->time_us = cmd_handler_stats[index].time_us;
+	return 1;
+}
+
+/**
+ * Gibt Aufrufe und Laufzeit aller Handler per LOG aus
+ */
+void command_print_stats(void) {
+	command_stats_t stats;
+	uint8_t i;
+	for (i = 0; command_get_stats(i, &stats); ++i) {
+		if (stats.calls) {
+			LOG_INFO("Kommando %c/%c: %lu Aufrufe, %lu us (%lu us pro Aufruf)", stats.command, stats.subcommand ? stats.subcommand : '*',
+				stats.calls, stats.time_us, stats.time_us / stats.calls);
+		}
+	}
+}
+#endif // COMMAND_STATS
+
+/**
+ * Wertet das Kommando im Puffer aus.
+ * Kommandos vom Sim werden ueber die Dispatch-Tabelle cmd_handlers ausgewertet,
+ * Kommandos anderer Bots ueber b2b_cmd_functions.
+ */
+void command_evaluate(void) {
+#if defined LOG_AVAILABLE && defined CHECK_CMD_ADDRESS
+	if (received_command.from != CMD_SIM_ADDR && received_command.from != CMD_IGNORE_ADDR) {
+		LOG_DEBUG("Weitergeleitetes Kommando:");
+	}
+#ifdef DEBUG_COMMAND_NOISY
+		command_display(&received_command);
+#endif // DEBUG_COMMAND_NOISY
+#endif // LOG_AVAILABLE
+	/* woher ist das Kommando? */
+#ifdef CHECK_CMD_ADDRESS
+	if (received_command.from == CMD_SIM_ADDR || received_command.from == CMD_IGNORE_ADDR) {
+#endif
+		/* Daten vom ct-Sim */
+		const uint8_t index = handler_find(received_command.request.command, received_command.request.subcommand);
+		if (index == 255) {
+			LOG_DEBUG("kein Handler fuer %c/%c", received_command.request.command, received_command.request.subcommand);
+			return;
 		}
+		const cmd_handler_t handler = (cmd_handler_t) pgm_read_word(&cmd_handlers[index].handler);
+#ifdef COMMAND_STATS
+		const uint32_t start = stats_time_us();
+#endif
+		handler(&received_command);
+#ifdef COMMAND_STATS
+		cmd_handler_stats[index].time_us += stats_time_us() - start;
+		++cmd_handler_stats[index].calls;
+#endif
 #ifdef CHECK_CMD_ADDRESS
 	} else { // woher ist das Kommando?
 #ifdef BOT_2_BOT_AVAILABLE
-		if (received_command.request.command == CMD_BOT_2_BOT) {
-			/* kein loop-back */
-			if (received_command.from != get_bot_address()) {
-				/* Kommando kommt von einem anderen Bot */
-				if (received_command.request.subcommand >= get_bot2bot_cmds()) {
-					/* ungueltig */
-					return 0;
-				}
+		/* kein loop-back */
+		if (received_command.request.command == CMD_BOT_2_BOT && received_command.from != get_bot_address()) {
+			/* Kommando kommt von einem anderen Bot */
+			if (received_command.request.subcommand < get_bot2bot_cmds()) {
 				b2b_cmd_functions[received_command.request.subcommand](&received_command);
 			}
-		} else {
-			return 0;
 		}
 #endif // BOT_2_BOT_AVAILABLE
-		analyzed = 1;
 	}
 #endif // CHECK_CMD_ADDRESS
-	return analyzed;
 }
 
 /**
@@ -32,6 +32,7 @@
 #include "uart.h"
 #include "ct-Bot.h"
 #include "bot-logic.h"
+#include "command.h"
 
 #define BOT_2_BOT_PAYLOAD_TEST_AVAILABLE	/**< Aktiviert Test-Code fuer Bot-2-Bot Kommunikation mit Payload */
 
@@ -66,11 +67,31 @@ typedef struct _bot_list_entry_t {
 #define BOT_2_BOT_REMOTECALL	get_type_of_payload_function(bot_2_bot_handle_remotecall)
 #define BOT_2_BOT_POS_STORE		get_type_of_payload_function(bot_2_bot_handle_pos_store_data)
 
-#define BOT_2_BOT_PAYLOAD_WINDOW_SIZE	32
-
-#if defined MCU && BOT_2_BOT_PAYLOAD_WINDOW_SIZE > UART_BUFSIZE_IN
-#error "BOT_2_BOT_PAYLOAD_WINDOW_SIZE zu gross"
+#ifdef MCU
+#define BOT_2_BOT_PAYLOAD_CHUNK_SIZE	32	/**< Maximale Anzahl an Bytes pro Payload-Paket */
+/** Anzahl der Pakete, die gleichzeitig unterwegs sein duerfen (so viele, wie in den UART-Empfangspuffer passen) */
+#define BOT_2_BOT_PAYLOAD_WINDOW		(UART_BUFSIZE_IN / (BOT_2_BOT_PAYLOAD_CHUNK_SIZE + 12) > 0 ? \
+	UART_BUFSIZE_IN / (BOT_2_BOT_PAYLOAD_CHUNK_SIZE + 12) : 1)
+#define BOT_2_BOT_PAYLOAD_TIMEOUT		15	/**< Anzahl an ms, die maximal auf ein ACK gewartet wird, bevor erneut gesendet wird */
+#else
+#define BOT_2_BOT_PAYLOAD_CHUNK_SIZE	128	/**< Maximale Anzahl an Bytes pro Payload-Paket */
+#define BOT_2_BOT_PAYLOAD_WINDOW		16	/**< Anzahl der Pakete, die gleichzeitig unterwegs sein duerfen */
+#define BOT_2_BOT_PAYLOAD_TIMEOUT		250	/**< Anzahl an ms, die maximal auf ein ACK gewartet wird, bevor erneut gesendet wird */
+#endif // MCU
+#define BOT_2_BOT_PAYLOAD_RETRIES		5	/**< Anzahl der Wiederholungen nach Timeout, bevor der Transfer abgebrochen wird */
+
+#if defined MCU && BOT_2_BOT_PAYLOAD_CHUNK_SIZE > UART_BUFSIZE_IN
+#error "BOT_2_BOT_PAYLOAD_CHUNK_SIZE zu gross"
+#endif
+#if BOT_2_BOT_PAYLOAD_WINDOW > 32 || BOT_2_BOT_PAYLOAD_CHUNK_SIZE > MAX_PAYLOAD
+#error "BOT_2_BOT_PAYLOAD_WINDOW oder BOT_2_BOT_PAYLOAD_CHUNK_SIZE zu gross"
 #endif
+
+/** Datentyp fuer die Payload der Payload-Bestaetigungen (BOT_CMD_ACK) */
+typedef struct {
+	uint32_t received;	/**< Bit i gesetzt: Paket (data_l + i) wurde bereits empfangen (selektive Bestaetigung) */
+	uint8_t window;		/**< Anzahl der Pakete ab data_l, die der Empfaenger aufnehmen kann */
+} PACKED_FORCE bot_2_bot_ack_t;
 #endif	// BOT_2_BOT_PAYLOAD_AVAILABLE
 
 extern bot_list_entry_t * bot_list;					/**< Liste aller bekannten Bots */
@@ -149,7 +170,10 @@ void publish_bot_state(int16_t state);
 uint8_t get_type_of_payload_function(void(* func)(void));
 
 /**
- * Sendet eine Payload-Transferanfrage an einen anderen Bot
+ * Sendet eine Payload-Transferanfrage an einen anderen Bot und uebertraegt anschliessend die Daten.
+ * Die Daten werden in nummerierten Paketen zu hoechstens BOT_2_BOT_PAYLOAD_CHUNK_SIZE Bytes verschickt,
+ * dabei duerfen so viele Pakete unbestaetigt unterwegs sein, wie der Empfaenger per ACK erlaubt.
+ * Fehlende Pakete meldet der Empfaenger selektiv und nur diese werden wiederholt.
  * \param to			Empfaengeradresse
  * \param type			Typ der Daten fuer den anderen Bot
  * \param *data			Zeiger auf zu sendende Daten
@@ -27,6 +27,7 @@
 #define BOT2SIM_H_
 
 #ifdef BOT_2_SIM_AVAILABLE
+#include "command.h"
 
 #ifdef CREATE_TRACEFILE_AVAILABLE
 #include <stdio.h>
@@ -57,6 +58,24 @@ void bot_2_sim_inform(void);
  */
 void bot_2_sim_inform(void);
 
+#ifndef ARM_LINUX_BOARD
+#define BOT_2_SIM_MAX_WINDOW	64	/**< Maximale Anzahl an Zyklen, die der Sim im Pipeline-Modus vorauslaufen darf */
+#define BOT_2_SIM_FREE_CYCLE	10	/**< Dauer eines Bot-Zyklus im freilaufenden Modus [ms] */
+
+/**
+ * Pipeline-Fenster in Zyklen, wird dem Sim bei der Anmeldung mitgeteilt. Der Sim darf dann so viele
+ * Zyklen verschicken, bevor er auf das CMD_DONE des Bots warten muss, das den jeweiligen Zyklus quittiert.
+ * 0 (default): Lockstep, jeder Zyklus kostet einen kompletten Round-Trip
+ */
+extern uint8_t bot_2_sim_window;
+
+/**
+ * Freilaufender Modus (Hardware-in-the-Loop): Die Systemzeit kommt aus der Echtzeit statt aus simultime,
+ * der Bot wartet nicht auf CMD_DONE, sondern verarbeitet die Kommandos des Sims, sobald sie eintreffen.
+ */
+extern uint8_t bot_2_sim_free_running;
+#endif // ! ARM_LINUX_BOARD
+
 
 #include <sys/time.h>
 #ifdef WIN32
@@ -75,6 +94,15 @@ void gettimeofday_win(struct timeval * p, void * tz /* IGNORED */);
  */
 void set_bot_2_sim(void);
 
+/**
+ * Sim bietet dem Bot eine Adresse an (SUB_ID_OFFER)
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void bot_2_sim_id_offer(command_t * cmd);
+
+/** Eintraege der Sim-Verbindung fuer die Dispatch-Tabelle in command.c */
+#define BOT_2_SIM_CMD_HANDLERS CMD_HANDLER(CMD_ID, SUB_ID_OFFER, bot_2_sim_id_offer)
+
 #else // ! BOT_2_SIM_AVAILABLE
 
 /*
@@ -84,5 +112,7 @@ static inline void set_bot_2_sim(void) {
 	// NOP
 }
 
+#define BOT_2_SIM_CMD_HANDLERS /**< ohne BOT_2_SIM_AVAILABLE keine Eintraege fuer die Dispatch-Tabelle */
+
 #endif // BOT_2_SIM_AVAILABLE
 #endif // BOT2SIM_H_
@@ -78,6 +78,7 @@
 #define BEHAVIOUR_DELAY_AVAILABLE 					/**< Delay-Routine als Verhalten */
 #define BEHAVIOUR_CANCEL_BEHAVIOUR_AVAILABLE 		/**< Deaktivieren von Verhalten, wenn eine Abbruchbedingung erfuellt ist */
 //#define BEHAVIOUR_GET_UTILIZATION_AVAILABLE		/**< CPU-Auslastung eines Verhaltens messen */
+//#define BEHAVIOUR_PROFILE_AVAILABLE				/**< Laufzeitstatistik aller Verhalten in bot_behave() */
 //#define BEHAVIOUR_HW_TEST_AVAILABLE 				/**< Testverhalten (ehemals TEST_AVAILABLE_ANALOG, _DIGITAL, _MOTOR) */
 
 /* Veraltete Verhalten */
@@ -222,7 +223,6 @@
 
 #ifndef MCU
 #undef BEHAVIOUR_CALIBRATE_PID_AVAILABLE
-#undef BEHAVIOUR_GET_UTILIZATION_AVAILABLE
 #endif // MCU
 
 #ifdef BEHAVIOUR_SERVO_AVAILABLE
@@ -313,6 +313,7 @@
 #include "behaviour_delay.h"
 #include "behaviour_cancel_behaviour.h"
 #include "behaviour_get_utilization.h"
+#include "behaviour_profile.h"
 #include "behaviour_transport_pillar.h"
 #include "behaviour_drive_stack.h"
 #include "behaviour_drive_area.h"
@@ -0,0 +1,91 @@
+/*
+ * c't-Bot
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ * This program is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307, USA.
+ *
+ */
+
+/**
+ * \file 	behaviour_profile.h
+ * \brief 	Laufzeitstatistik der Verhalten in bot_behave()
+ *
+ * Zaehlt fuer jedes Verhalten die Aufrufe, die gesamte und maximale Laufzeit seiner Work-Routine und fuehrt
+ * ein logarithmisches Histogramm fuer Perzentile. Der Anteil am Zyklus bezieht sich auf die Zeit zwischen
+ * zwei Durchlaeufen von bot_behave(), also auf die gesamte Hauptschleife.
+ * \date 	18.10.2026
+ */
+
+#ifndef BEHAVIOUR_PROFILE_H_
+#define BEHAVIOUR_PROFILE_H_
+
+#ifdef BEHAVIOUR_PROFILE_AVAILABLE
+#include "timer.h"
+#ifdef PC
+#include "bot-2-sim.h"
+#include <sys/time.h>
+#endif
+
+#define BEHAVIOUR_PROFILE_BUCKETS	16	/**< Anzahl der Histogramm-Klassen, Klasse i umfasst [2^i, 2^(i+1)) us */
+#ifdef PC
+#define BEHAVIOUR_PROFILE_FILE		"behaviour_profile.csv"	/**< Datei fuer die CSV-Ausgabe */
+#endif
+
+/**
+ * Liefert die aktuelle Zeit fuer die Laufzeitmessung
+ * \return	Zeit [us], laeuft ueber
+ */
+static inline uint32_t bot_profile_time(void) {
+#ifdef PC
+	struct timeval tv;
+	GETTIMEOFDAY(&tv, NULL);
+	return (uint32_t) tv.tv_sec * 1000000UL + (uint32_t) tv.tv_usec;
+#else
+	return timer_get_us32();
+#endif // PC
+}
+
+/**
+ * Legt die Statistik fuer alle Verhalten an, nachdem die Verhaltensliste aufgebaut wurde
+ * \param count	Anzahl der Verhalten in der Liste
+ */
+void bot_profile_init(uint8_t count);
+
+/**
+ * Markiert den Beginn eines Durchlaufs von bot_behave() und misst die Zykluszeit
+ */
+void bot_profile_cycle(void);
+
+/**
+ * Verbucht einen Aufruf eines Verhaltens
+ * \param slot	Position des Verhaltens in der Verhaltensliste
+ * \param start	Zeitpunkt vor dem Aufruf der Work-Routine (bot_profile_time())
+ */
+void bot_profile_add(uint8_t slot, uint32_t start);
+
+/**
+ * Gibt die Laufzeitstatistik aller bisher aufgerufenen Verhalten aus
+ * \param *caller	Der Verhaltensdatensatz des Aufrufers
+ * \param csv		0: Tabelle per LOG, 1: CSV (PC: in BEHAVIOUR_PROFILE_FILE, MCU: per LOG)
+ */
+void bot_profile_dump(Behaviour_t * caller, uint8_t csv);
+
+/**
+ * Setzt die Laufzeitstatistik zurueck
+ * \param *caller	Der Verhaltensdatensatz des Aufrufers
+ */
+void bot_profile_reset(Behaviour_t * caller);
+
+#endif // BEHAVIOUR_PROFILE_AVAILABLE
+#endif // BEHAVIOUR_PROFILE_H_
@@ -28,6 +28,7 @@
 #define BEHAVIOUR_REMOTECALL_H_
 
 #ifdef BEHAVIOUR_REMOTECALL_AVAILABLE
+#include "command.h"
 
 #define REMOTE_CALL_FUNCTION_NAME_LEN 20	/**< Laenge der Funktionsnamen */
 #define PARAM_TEXT_LEN 40					/**< Laenge des Parameterstrings */
@@ -93,6 +94,32 @@ void bot_remotecall_cancel(void);
  */
 void bot_remotecall_list(void);
 
+#ifdef COMMAND_AVAILABLE
+/**
+ * Sim fordert die Liste aller Remote-Calls an (SUB_REMOTE_CALL_LIST)
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void remotecall_handle_list(command_t * cmd);
+
+/**
+ * Sim gibt einen Remote-Call in Auftrag (SUB_REMOTE_CALL_ORDER), Name und Parameter folgen als Payload
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void remotecall_handle_order(command_t * cmd);
+
+/**
+ * Sim bricht die laufenden Remote-Calls ab (SUB_REMOTE_CALL_ABORT)
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void remotecall_handle_abort(command_t * cmd);
+
+/** Eintraege der Remote-Calls fuer die Dispatch-Tabelle in command.c */
+#define REMOTECALL_CMD_HANDLERS \
+	CMD_HANDLER(CMD_REMOTE_CALL, SUB_REMOTE_CALL_LIST, remotecall_handle_list) \
+	CMD_HANDLER(CMD_REMOTE_CALL, SUB_REMOTE_CALL_ORDER, remotecall_handle_order) \
+	CMD_HANDLER(CMD_REMOTE_CALL, SUB_REMOTE_CALL_ABORT, remotecall_handle_abort)
+#endif // COMMAND_AVAILABLE
+
 /**
  * Sucht den Index des Remote-Calls heraus
  * \param *call	String mit dem Namen der gesuchten fkt
@@ -105,4 +132,8 @@ uint8_t get_remotecall_id(const char * call);
  */
 void remotecall_display(void);
 #endif // BEHAVIOUR_REMOTECALL_AVAILABLE
+
+#ifndef REMOTECALL_CMD_HANDLERS
+#define REMOTECALL_CMD_HANDLERS /**< ohne Remote-Calls keine Eintraege fuer die Dispatch-Tabelle */
+#endif
 #endif // BEHAVIOUR_REMOTECALL_H_
@@ -50,9 +50,12 @@ typedef struct _Behaviour_t {
    void (* work) (struct _Behaviour_t * data); 	/**< Zeiger auf die Funktion, die das Verhalten bearbeitet */
    uint8_t priority;							/**< Prioritaet */
    struct _Behaviour_t * caller;				/**< aufrufendes Verhalten */
-   unsigned active:1;							/**< Ist das Verhalten aktiv */
+   unsigned active:1;							/**< Ist das Verhalten aktiv, nur per set_behaviour_active() aendern */
    unsigned subResult:3;						/**< War das aufgerufene Unterverhalten erfolgreich (==1)? */
    struct _Behaviour_t * next;					/**< Naechster Eintrag in der Liste */
+   struct _Behaviour_t * callee;				/**< zuletzt aufgerufenes Verhalten, weitere Callees ueber callee->sibling */
+   struct _Behaviour_t * sibling;				/**< naechstes Verhalten mit demselben Aufrufer */
+   uint8_t index;								/**< Position in der Verhaltensliste, Bit in der Maske der aktiven Verhalten */
 } PACKED Behaviour_t;
 
 /** Dieser Typ definiert eine Funktion die das eigentliche Verhalten ausfuehrt */
@@ -109,6 +112,14 @@ static inline void deactivateBehaviour(BehaviourFunc_t function) {
 	deactivate_behaviour(get_behaviour(function));
 }
 
+/**
+ * Schaltet ein Verhalten an oder aus, ohne Aufrufer oder subResult zu veraendern.
+ * Behaviour_t::active darf nur hierueber geaendert werden, damit bot_behave() den Wechsel mitbekommt.
+ * \param *beh		Verhaltensdatensatz
+ * \param active	BEHAVIOUR_ACTIVE oder BEHAVIOUR_INACTIVE
+ */
+void set_behaviour_active(Behaviour_t * beh, uint8_t active);
+
 /**
  * Rueckgabe von True, wenn das Verhalten gerade laeuft (aktiv ist), sonst False
  * \param function Die Funktion, die das Verhalten realisiert.
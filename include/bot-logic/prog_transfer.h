@@ -0,0 +1,66 @@
+/*
+ * c't-Bot
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ * This program is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307, USA.
+ *
+ */
+
+/**
+ * \file 	prog_transfer.h
+ * \brief 	Empfang von Programmen (uBasic oder ABL) vom Sim
+ * \date 	18.10.2026
+ */
+
+#ifndef PROG_TRANSFER_H_
+#define PROG_TRANSFER_H_
+
+#if defined COMMAND_AVAILABLE && (defined BEHAVIOUR_UBASIC_AVAILABLE || defined BEHAVIOUR_ABL_AVAILABLE)
+#include "command.h"
+
+/**
+ * Vorbereitung auf ein neues Programm (Basic oder ABL), die Payload enthaelt den Dateinamen
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void prog_transfer_prepare(command_t * cmd);
+
+/**
+ * Datenteil eines Programms
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void prog_transfer_data(command_t * cmd);
+
+/**
+ * Startet ein uebertragenes Programm
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void prog_transfer_start(command_t * cmd);
+
+/**
+ * Bricht ein laufendes Programm ab
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void prog_transfer_stop(command_t * cmd);
+
+/** Eintraege des Programm-Empfangs fuer die Dispatch-Tabelle in command.c */
+#define PROG_TRANSFER_CMD_HANDLERS \
+	CMD_HANDLER(CMD_PROGRAM, SUB_PROGRAM_PREPARE, prog_transfer_prepare) \
+	CMD_HANDLER(CMD_PROGRAM, SUB_PROGRAM_DATA, prog_transfer_data) \
+	CMD_HANDLER(CMD_PROGRAM, SUB_PROGRAM_START, prog_transfer_start) \
+	CMD_HANDLER(CMD_PROGRAM, SUB_PROGRAM_STOP, prog_transfer_stop)
+
+#else
+#define PROG_TRANSFER_CMD_HANDLERS /**< ohne uBasic und ABL keine Eintraege fuer die Dispatch-Tabelle */
+#endif // COMMAND_AVAILABLE && (BEHAVIOUR_UBASIC_AVAILABLE || BEHAVIOUR_ABL_AVAILABLE)
+#endif // PROG_TRANSFER_H_
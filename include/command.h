@@ -30,11 +30,17 @@
 #include "eeprom.h"
 
 #define MAX_PAYLOAD 255  		/**< Max. Anzahl Bytes, die an ein Command angehaengt werden koennen */
+#define COMMAND_TIMEOUT 15		/**< Anzahl an ms, die maximal auf fehlende Daten (Payload) gewartet wird */
+
+#ifdef PC
+#define COMMAND_STATS			/**< Aufrufe und Laufzeit je Kommando-Handler erfassen */
+#endif
 
 #define CMD_STARTCODE	'>'		/**< Anfang eines Kommandos */
 #define CMD_STOPCODE	'<'		/**< Ende eines Kommandos */
 
 #define SUB_CMD_NORM	'N' 	/**< Standard-Subkommando */
+#define CMD_SUB_ANY		0		/**< Platzhalter fuer CMD_HANDLER(): Handler gilt fuer alle Subkommandos */
 
 // Sensoren
 #define CMD_SENS_IR	    'I'		/**< Abstandssensoren */
@@ -48,6 +54,9 @@
 #define CMD_SENS_ERROR  'e'		/**< Motor- oder Batteriefehler */
 #define CMD_SENS_RC5 	'R'		/**< IR-Fernbedienung */
 #define CMD_SENS_BPS	'b'		/**< Bot Positioning System */
+#define CMD_SENS_SNAPSHOT	'F'	/**< Alle Sensor- und Aktuatorwerte eines Zyklus im Anhang (sensor_snapshot_t), data_l = Version */
+
+#define SENSOR_SNAPSHOT_VERSION	1	/**< Version des Formats von sensor_snapshot_t */
 
 #define CMD_SENS_MOUSE_PICTURE	'P'	/**< Bild vom Maussensor in data_l steht, welche Nummer der 1. Pixel hat */
 
@@ -95,11 +104,13 @@
 #define SUB_MAP_DATA_2		'E'	/**< Map-Daten Teil 2 */
 #define SUB_MAP_DATA_3		'F'	/**< Map-Daten Teil 3 */
 #define SUB_MAP_DATA_4		'G'	/**< Map-Daten Teil 4 */
-#define SUB_MAP_REQUEST		'R'	/**< Aufforderung die komplette Karte (neu) zu uebertragen */
+#define SUB_MAP_REQUEST		'R'	/**< Aufforderung die komplette Karte (neu) zu uebertragen, data_l = SUB_MAP_DELTA: Sim versteht das Delta-Format */
 #define SUB_MAP_LINE		'L'	/**< Linie zeichnen */
 #define SUB_MAP_CIRCLE		'C'	/**< Kreis zeichnen */
 #define SUB_MAP_CLEAR_LINES	'X'	/**< Linien loeschen */
 #define SUB_MAP_CLEAR_CIRCLES	'Y' /**< Kreise loeschen */
+#define SUB_MAP_DELTA		'Z'	/**< Geaenderte Bytes eines Map-Blocks ab Offset data_r, RLE-komprimiert (siehe map_2_sim_main()) */
+#define SUB_MAP_POSITION	'P'	/**< Bot-Position (data_l, data_r) und Ausrichtung (Anhang) fuer die Map-Anzeige im Delta-Format */
 
 #define CMD_SHUTDOWN		'q' /**< Kommando zum Herunterfahren */
 
@@ -151,6 +162,23 @@ typedef struct {
 	uint8_t CRC;		/**< Markiert das Ende des Commands */
 } PACKED_FORCE command_t;
 
+/** Anhang von CMD_SENS_SNAPSHOT, ersetzt die einzelnen Sensor- und Aktuator-Kommandos eines Zyklus (Little Endian) */
+typedef struct {
+	int16_t dist[2];	/**< Abstandssensoren links / rechts */
+	int16_t enc[2];		/**< Radencoder links / rechts */
+	int16_t border[2];	/**< Abgrundsensoren links / rechts */
+	int16_t line[2];	/**< Liniensensoren links / rechts */
+	int16_t ldr[2];		/**< Helligkeitssensoren links / rechts */
+	int16_t mouse[2];	/**< Maussensor dX / dY */
+	int16_t motor[2];	/**< Motorgeschwindigkeit links / rechts */
+	int16_t rc5;		/**< IR-Fernbedienung */
+	int16_t bps;		/**< Bot Positioning System */
+	uint8_t trans;		/**< Ueberwachung Transportfach */
+	uint8_t door;		/**< Ueberwachung Klappe */
+	uint8_t error;		/**< Motor- oder Batteriefehler */
+	uint8_t led;		/**< Zustand der LEDs */
+} PACKED_FORCE sensor_snapshot_t;
+
 extern command_t received_command; /**< Puffer fuer empfangenes Kommando */
 extern command_t cmd_to_send; /**< Puffer fuer zu sendendes Kommando */
 
@@ -158,6 +186,8 @@ typedef int16_t (* read_func_t)(void * data, int16_t length); /**< Funktion zum
 typedef int16_t (* write_func_t)(const void * data, int16_t length); /**< Funktion zum Schreiben von Daten einer Verbindung */
 typedef uint8_t (* check_crc_func_t)(command_t * cmd); /**< Funktion zum Ueberpruefen der CRC Checksumme */
 typedef void (* calc_crc_func_t)(command_t * cmd); /**< Funktion zum Berechnen der CRC Checksumme */
+typedef const void * (* peek_func_t)(int16_t length); /**< Funktion, die die naechsten Bytes einer Verbindung liefert, ohne sie zu entfernen */
+typedef void (* skip_func_t)(int16_t length); /**< Funktion, die Bytes einer Verbindung verwirft */
 
 /** Verbindungsabhaengige Funktionen zur Kommandoverarbeitung */
 typedef struct {
@@ -165,10 +195,41 @@ typedef struct {
 	write_func_t write; /**< Daten auf die Verbindung schreiben */
 	check_crc_func_t crc_check; /**< CRC Checksumme ueberpruefen */
 	calc_crc_func_t crc_calc; /**< CRC Checksumme berechnen und ins Kommando schreiben */
+	peek_func_t peek; /**< Daten im Empfangspuffer der Verbindung ansehen (NULL, falls es keinen gibt) */
+	skip_func_t skip; /**< Daten aus dem Empfangspuffer der Verbindung entfernen */
 } cmd_func_t;
 
 extern cmd_func_t cmd_functions; /**< Funktionspointer fuer Kommandoverarbeitung */
 
+typedef void (* cmd_handler_t)(command_t * cmd); /**< Funktion, die ein empfangenes Kommando auswertet */
+
+/** Eintrag der Dispatch-Tabelle fuer Kommandos vom Sim */
+typedef struct {
+	uint8_t command;		/**< Kommando */
+	uint8_t subcommand;		/**< Subkommando oder CMD_SUB_ANY */
+	cmd_handler_t handler;	/**< Auswertungs-Funktion */
+} cmd_handler_entry_t;
+
+/**
+ * Eintrag fuer die Dispatch-Tabelle in command.c. Jedes Modul stellt seine Eintraege
+ * in einem Makro <MODUL>_CMD_HANDLERS in seinem Header bereit, das leer ist, wenn das
+ * Modul nicht aktiv ist.
+ * \param command		Kommando
+ * \param subcommand	Subkommando oder CMD_SUB_ANY fuer alle Subkommandos ohne eigenen Eintrag
+ * \param handler		Auswertungs-Funktion
+ */
+#define CMD_HANDLER(command, subcommand, handler) { command, subcommand, handler },
+
+#ifdef COMMAND_STATS
+/** Statistik eines Kommando-Handlers */
+typedef struct {
+	uint8_t command;	/**< Kommando */
+	uint8_t subcommand;	/**< Subkommando oder CMD_SUB_ANY */
+	uint32_t calls;		/**< Anzahl der Aufrufe */
+	uint32_t time_us;	/**< Summe der Laufzeiten [us] */
+} command_stats_t;
+#endif // COMMAND_STATS
+
 
 /**
  * Initialisiert die (High-Level-)Kommunikation
@@ -177,10 +238,17 @@ void command_init(void);
 
 /**
  * Liest ein Kommando ein, ist blockierend!
- * greift auf cmd_functions.read() zurueck
+ * greift auf cmd_functions.read() bzw. cmd_functions.peek() zurueck
  */
 int8_t command_read(void);
 
+/**
+ * Liefert die Payload des zuletzt empfangenen Kommandos direkt aus dem Empfangspuffer der Verbindung
+ * und entfernt sie dort, ist blockierend!
+ * \return	Zeiger auf die Payload (gueltig bis zum naechsten Lesen) oder NULL, falls die Verbindung keinen Empfangspuffer hat
+ */
+const void * command_payload(void);
+
 /**
  * Schleife, die Kommandos empfaengt und bearbeitet, bis ein Kommando vom Typ frame kommt
  * \param frame Kommando zum Abbruch
@@ -255,10 +323,25 @@ void command_write_rawdata_to(uint8_t command, uint8_t subcommand, uint8_t to, i
 void command_write_rawdata(uint8_t command, uint8_t subcommand, int16_t data_l, int16_t data_r, uint8_t payload, const void * data);
 
 /**
- * Wertet das Kommando im Puffer aus
- * \return 1, wenn Kommando schon bearbeitet wurde, 0 sonst
+ * Wertet das Kommando im Puffer aus.
+ * Kommandos ohne Eintrag in der Dispatch-Tabelle werden verworfen.
+ */
+void command_evaluate(void);
+
+#ifdef COMMAND_STATS
+/**
+ * Liefert die Statistik eines Eintrags der Dispatch-Tabelle
+ * \param index		Index des Eintrags, ab 0
+ * \param *p_stats	Zeiger auf Puffer fuer die Statistik
+ * \return			1, falls unter index ein Handler registriert ist, sonst 0
  */
-int8_t command_evaluate(void);
+uint8_t command_get_stats(uint8_t index, command_stats_t * p_stats);
+
+/**
+ * Gibt Aufrufe und Laufzeit aller registrierten Handler per LOG aus
+ */
+void command_print_stats(void);
+#endif // COMMAND_STATS
 
 /**
  * Gibt ein Kommando auf dem Bildschirm aus
@@ -272,6 +355,13 @@ void command_display(command_t * command);
  * Features aktiviert sind
  */
 void register_bot(void);
+
+/**
+ * Sendet alle Sensor- und Aktuatorwerte als ein Kommando (CMD_SENS_SNAPSHOT) an den Sim,
+ * sofern der Sim das Format durch eigene Snapshots bestaetigt hat
+ * \return	0, falls gesendet, 1 falls der Sim einzelne Kommandos erwartet
+ */
+uint8_t command_write_snapshot(void);
 #endif // BOT_2_SIM_AVAILABLE
 
 /**
@@ -31,6 +31,7 @@
 #include "bot-logic.h"
 #include "fifo.h"
 #include "os_thread.h"
+#include "command.h"
 
 #define MAP_CLEAR_ON_INIT	/**< Leert die Karte, wenn der Bot gebootet wird */
 #define MAP_USE_TRIG_CACHE	/**< Sollen sin(heading) und cos(heading) mit gecachet werden? */
@@ -47,11 +48,51 @@
 #undef MAP_UPDATE_STACK_SIZE
 #define MAP_UPDATE_STACK_SIZE	220
 #endif
+#ifdef PC
+#define MAP_UPDATE_BATCH		/**< Map-Cache als Queue ohne Sperren, der Update-Thread arbeitet alle wartenden Eintraege auf einmal ab (nur PC) */
+#endif
+
+#ifdef MAP_UPDATE_BATCH
+#define MAP_UPDATE_CACHE_SIZE	256	/**< Groesse des Map-Caches [# Eintraege], muss eine Zweierpotenz sein */
+#else
 #define MAP_UPDATE_CACHE_SIZE	16	/**< Groesse des Map-Caches [# Eintraege] */
+#endif
 #define MAP_2_SIM_STACK_SIZE		256	/**< Groesse des Map-2-Sim-Thread-Stacks [Byte] */
 
 #define MAP_2_SIM_BUFFER_SIZE	32	/**< Anzahl der Bloecke, die fuer Map-2-Sim gecached werden koennen */
 
+#ifdef PC
+#define MAP_2_SIM_BANDWIDTH		1048576L	/**< Datenrate, mit der Map-2-Sim hoechstens sendet [Byte/s] */
+#else
+#define MAP_2_SIM_BANDWIDTH		6400L	/**< Datenrate, mit der Map-2-Sim hoechstens sendet [Byte/s] */
+#endif
+
+#if defined PC && defined MAP_2_SIM_AVAILABLE
+#define MAP_2_SIM_DELTA			/**< Map-2-Sim sendet nur die geaenderten Bytes eines Blocks RLE-komprimiert, falls der Sim das unterstuetzt (nur PC, ca. 2,4 MB RAM) */
+#endif
+
+#if defined PC && ! defined WIN32
+#define MAP_USE_MMAP			/**< Map-Datei komplett per mmap() einblenden, statt sie blockweise zu lesen / schreiben (nur PC, MAP_CACHE_BLOCKS wird dann nicht benutzt) */
+#endif
+
+#ifdef PC
+#define MAP_CACHE_BLOCKS		64	/**< Anzahl der Map-Bloecke, die im RAM gecached werden (1: nur aktueller Block im MMC-Puffer) */
+#else
+#define MAP_CACHE_BLOCKS		1	/**< Anzahl der Map-Bloecke, die im RAM gecached werden (MCU: nur aktueller Block im MMC-Puffer) */
+#endif
+
+#ifdef PC
+#define MAP_USE_RWLOCK			/**< Abfragen sperren die Karte per Reader-/Writer-Lock und warten nur auf den gerade bearbeiteten Map-Cache-Eintrag statt auf den ganzen Cache (nur PC) */
+#endif
+
+#ifdef PC
+#define MAP_SECTION_STATS		/**< Kennzahlen (Min, Max, Summe, Hindernisse) pro Section im RAM fuehren, um Abfragen zu beschleunigen (nur PC, ca. 100 KB RAM) */
+#endif
+
+#ifdef PC
+#define MAP_SPARSE_FILES		/**< Karten-Ex- / Import nur mit belegten Sections (RLE-komprimiert) statt als komplette Map-Datei, alte Dateien koennen weiterhin geladen werden (nur PC) */
+#endif
+
 #define MAP_OBSTACLE_THRESHOLD	-20	/**< Schwellwert, ab dem ein Feld als Hindernis gilt */
 #define MAP_DRIVEN_THRESHOLD	1	/**< Schwellwert, ab dem ein Feld als befahren gilt */
 
@@ -93,9 +134,32 @@ typedef struct {
 	int16_t map_max_y;			/**< belegter Bereich der Karte [Kartenindex]: groesste Y-Koordinate */
 	uint8_t dummy[MAP_BLOCK_SIZE - 10];
 } PACKED_FORCE map_header_t;
+
+#ifdef MAP_SPARSE_FILES
+#define MAP_SPARSE_MAGIC	"CTBM"	/**< Kennung einer exportierten Karte im Sparse-Format */
+#define MAP_SPARSE_VERSION	1		/**< Version des Sparse-Formats */
+
+/** Header einer exportierten Karte im Sparse-Format */
+typedef struct {
+	char magic[4];				/**< MAP_SPARSE_MAGIC */
+	uint8_t version;			/**< MAP_SPARSE_VERSION */
+	uint8_t section_points;		/**< Kantenlaenge einer Section [Felder] */
+	uint16_t sections;			/**< Kantenlaenge der Karte [Sections] */
+	int16_t map_min_x;			/**< belegter Bereich der Karte [Kartenindex]: kleinste X-Koordinate */
+	int16_t map_max_x;			/**< belegter Bereich der Karte [Kartenindex]: groesste X-Koordinate */
+	int16_t map_min_y;			/**< belegter Bereich der Karte [Kartenindex]: kleinste Y-Koordinate */
+	int16_t map_max_y;			/**< belegter Bereich der Karte [Kartenindex]: groesste Y-Koordinate */
+	uint16_t count;				/**< Anzahl der folgenden Sections */
+} PACKED_FORCE map_sparse_header_t;
+
+/** Eintrag einer Section im Sparse-Format, danach folgen length Bytes RLE-Daten (PackBits) */
+typedef struct {
+	uint16_t index;				/**< Index der Section (Y * Kantenlaenge + X) */
+	uint16_t length;			/**< Laenge der RLE-Daten [Byte] */
+} PACKED_FORCE map_sparse_section_t;
+#endif // MAP_SPARSE_FILES
 #endif // SDFAT_AVAILABLE
 
-extern fifo_t map_update_fifo;			/**< Fifo fuer Cache */
 extern map_cache_t map_update_cache[];	/**< Map-Cache */
 extern uint8_t map_update_stack[];		/**< Stack des Update-Threads */
 
@@ -103,6 +167,29 @@ extern uint8_t map_update_stack[];		/**< Stack des Update-Threads */
 extern uint8_t map_2_sim_worker_stack[];	/**< Stack des Map-2-Sim-Threads */
 #endif // MAP_2_SIM_AVAILABLE
 
+/**
+ * Liefert den naechsten freien Eintrag des Map-Caches. Es darf nur einen Thread geben, der Eintraege erzeugt.
+ * \return	Zeiger auf den Eintrag oder NULL, falls der Cache voll ist
+ */
+map_cache_t* map_update_get_entry(void);
+
+/**
+ * Uebergibt den zuletzt per map_update_get_entry() geholten Eintrag an den Update-Thread
+ */
+void map_update_put_entry(void);
+
+/**
+ * Liefert die Anzahl der freien Eintraege des Map-Caches
+ * \return	Anzahl freier Eintraege
+ */
+uint16_t map_update_free(void);
+
+/**
+ * Liefert die Anzahl der Eintraege des Map-Caches, die noch nicht in die Karte eingetragen wurden
+ * \return	Anzahl wartender Eintraege
+ */
+uint16_t map_update_pending(void);
+
 /**
  * Prueft, ob die Karte zurzeit gesperrt ist.
  * \return	1, falls Karte gesperrt, 0 sonst
@@ -229,6 +316,21 @@ int8_t map_load_from_file(const char* file);
  */
 void map_2_sim_send(void);
 
+/**
+ * Bearbeitet die Anforderung der kompletten Karte durch den Sim
+ * \param format	SUB_MAP_DELTA, falls der Sim das Delta-Format versteht, sonst 0
+ */
+void map_2_sim_request(int16_t format);
+
+/**
+ * Wertet die Aufforderung des Sim aus, die Karte zu uebertragen (SUB_MAP_REQUEST)
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void map_2_sim_handle_request(command_t * cmd);
+
+/** Eintraege der Map fuer die Dispatch-Tabelle in command.c */
+#define MAP_CMD_HANDLERS CMD_HANDLER(CMD_MAP, SUB_MAP_REQUEST, map_2_sim_handle_request)
+
 /**
  * Zeichnet eine Linie in die Map-Anzeige des Sim
  * \param from	Startpunkt der Linie (Map-Koordinate)
@@ -282,4 +384,8 @@ void map_display(void);
 #endif // DISPLAY_MAP_AVAILABLE
 
 #endif // MAP_AVAILABLE
+
+#ifndef MAP_CMD_HANDLERS
+#define MAP_CMD_HANDLERS /**< ohne MAP_2_SIM_AVAILABLE keine Eintraege fuer die Dispatch-Tabelle */
+#endif
 #endif // MAP_H_
@@ -27,8 +27,6 @@
 #ifndef _OS_SCHEDULER_H_
 #define _OS_SCHEDULER_H_
 
-#ifdef MCU
-
 #ifdef OS_AVAILABLE
 
 #define OS_TIME_SLICE	10	/**< Dauer einer Zeitscheibe in ms */
@@ -39,6 +37,7 @@
 #define MEASURE_UTILIZATION
 #endif
 
+#ifdef MCU
 extern volatile uint8_t os_scheduling_allowed;	/**< sperrt den Scheduler, falls != 1. Sollte nur per os_enterCS() / os_exitCS() veraendert werden! */
 
 /**
@@ -46,6 +45,7 @@ extern volatile uint8_t os_scheduling_allowed;	/**< sperrt den Scheduler, falls
  * \param tickcount	Wert des Timer-Ticks (32 Bit)
  */
 void os_schedule(uint32_t tickcount);
+#endif // MCU
 
 #ifdef MEASURE_UTILIZATION
 /**
@@ -65,6 +65,7 @@ void os_clear_utilization(void);
 void os_print_utilization(void);
 #endif // MEASURE_UTILIZATION
 
+#ifdef MCU
 /**
  * Berechnet CPU und UART Auslastung
  * @param cpu Zeiger auf Ausgabeparameter fuer CPU-Auslastung
@@ -77,7 +78,7 @@ void os_get_utilizations(uint8_t* cpu, uint8_t* uart_in, uint8_t* uart_out);
  * Handler fuer OS-Display
  */
 void os_display(void);
+#endif // MCU
 
 #endif // OS_AVAILABLE
-#endif // MCU
 #endif // _OS_SCHEDULER_H_
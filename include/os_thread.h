@@ -250,9 +250,23 @@ static inline void os_signal_unlock(os_signal_t * signal) {
 #define OS_TASK_ATTR /**< Attribut fuer main-Funktion eines Threads (Dummy fuer PC) */
 #define OS_SIGNAL_INITIALIZER {0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER} /**< Initialisierungsdaten fuer os_signal_t */
 
-typedef pthread_t Tcb_t;
+#define OS_THREAD_FREE		0	/**< Eintrag in os_threads[] ist unbenutzt */
+#define OS_THREAD_RUNNING	1	/**< Thread ist lauffaehig */
+#define OS_THREAD_SLEEPING	2	/**< Thread schlaeft in os_thread_sleep() */
+#define OS_THREAD_BLOCKED	3	/**< Thread wartet in os_signal_set() auf ein Signal */
 
-extern Tcb_t os_threads[OS_MAX_THREADS]; /**< Thread-Pool (ist gleichzeitig running- und waiting-queue) */
+typedef struct {
+	pthread_t thread;			/**< POSIX-Thread, der zu diesem TCB gehoert */
+	uint32_t nextSchedule;		/**< Zeitpunkt, bis zu dem der Thread schlaeft [176 us] */
+	uint32_t lastSchedule;		/**< CPU-Zeit des Threads beim letzten os_thread_yield() [us] */
+	uint8_t state;				/**< OS_THREAD_FREE, OS_THREAD_RUNNING, OS_THREAD_SLEEPING oder OS_THREAD_BLOCKED */
+#ifdef MEASURE_UTILIZATION
+	uint64_t cpu_time;			/**< CPU-Zeit des Threads bei der letzten Auswertung [ns] */
+	os_stat_data_t statistics;	/**< Statistikdaten des Threads */
+#endif
+} Tcb_t;
+
+extern Tcb_t os_threads[OS_MAX_THREADS]; /**< Thread-Pool, Eintrag 0 ist der Hauptthread */
 extern pthread_mutex_t os_enterCS_mutex; /**< Mutex fuer os_enterCS() / os_exitCS() auf PC */
 
 /**
@@ -275,6 +289,12 @@ extern pthread_mutex_t os_enterCS_mutex; /**< Mutex fuer os_enterCS() / os_exitC
  */
 void os_thread_sleep(uint32_t sleep);
 
+/**
+ * Weckt alle Threads, deren Schlafenszeit abgelaufen ist, und fuehrt abgelaufene verzoegerte Funktionen
+ * aus. Wird im Hauptthread aufgerufen, nachdem die Systemzeit weitergezaehlt wurde.
+ */
+void os_time_update(void);
+
 /**
  * Entfernt ein Signal vom aktuellen Thread
  */
@@ -0,0 +1,89 @@
+/*
+ * c't-Bot
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ * This program is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307, USA.
+ *
+ */
+
+/**
+ * \file 	os_timer.h
+ * \brief 	Verzoegerte Ausfuehrung von Funktionen per hierarchischem Timer-Rad
+ *
+ * Ein Timer haengt in genau einem Slot des Rads, Eintragen und Entfernen kosten daher O(1). Jede Ebene
+ * hat OS_TIMER_SLOTS Slots, ein Slot der Ebene n umfasst OS_TIMER_SLOTS^n Rad-Ticks. Laeuft der Index
+ * einer Ebene ueber, werden die Timer des naechsten Slots der Ebene darueber auf die feineren Ebenen
+ * verteilt. Die Funktionen laufen im Hauptthread, nachdem die Systemzeit weitergezaehlt wurde.
+ * Nur auf dem PC, das MCU fuehrt os_delay_func() weiterhin ueber das Array in mcu/os_thread.c aus.
+ * \date 	18.10.2026
+ */
+
+#ifndef OS_TIMER_H_
+#define OS_TIMER_H_
+
+#if defined OS_AVAILABLE && defined PC
+#include "os_thread.h"
+
+#define OS_TIMER_SHIFT		4	/**< Ein Rad-Tick umfasst 2^OS_TIMER_SHIFT Timer-Ticks (2,8 ms) */
+#define OS_TIMER_BITS		6	/**< 2^OS_TIMER_BITS Slots pro Ebene */
+#define OS_TIMER_LEVELS		4	/**< Anzahl der Ebenen, laengere Zeiten werden beim Weiterschalten erneut einsortiert */
+#define OS_TIMER_SLOTS		(1 << OS_TIMER_BITS)	/**< Anzahl der Slots pro Ebene */
+
+/** Timer im Timer-Rad, der Speicher gehoert dem Aufrufer */
+typedef struct os_timer {
+	struct os_timer * next;		/**< naechster Timer im selben Slot */
+	struct os_timer ** pprev;	/**< Verweis auf diesen Timer im Slot, NULL falls der Timer nicht laeuft */
+	uint32_t expires;			/**< fruehest moegliche Ausfuehrungszeit in Timer-Ticks */
+	os_delayed_func_ptr_t p_func; /**< Zeiger auf Funktion */
+	void * p_data;				/**< Zeiger auf Daten fuer Funktion (optional) */
+} os_timer_t;
+
+/**
+ * Initialisiert einen Timer, muss vor der ersten Verwendung aufgerufen werden
+ * \param *timer	Timer
+ * \param p_func	Funktion, die beim Ablauf aufgerufen wird
+ * \param *p_data	Daten fuer die Funktion oder NULL
+ */
+void os_timer_init(os_timer_t * timer, os_delayed_func_ptr_t p_func, void * p_data);
+
+/**
+ * Startet einen Timer, ein bereits laufender Timer wird dabei neu gestartet
+ * \param *timer	Timer
+ * \param delay_ms	Zeit in ms, nach der die Funktion (fruehestens) ausgefuehrt werden soll
+ */
+void os_timer_start(os_timer_t * timer, uint32_t delay_ms);
+
+/**
+ * Haelt einen Timer an, bevor seine Funktion ausgefuehrt wird
+ * \param *timer	Timer
+ * \return			1, falls der Timer lief, 0 sonst
+ */
+uint8_t os_timer_cancel(os_timer_t * timer);
+
+/**
+ * Prueft, ob ein Timer laeuft
+ * \param *timer	Timer
+ * \return			1, falls der Timer laeuft, 0 sonst
+ */
+static inline uint8_t os_timer_pending(const os_timer_t * timer) {
+	return timer->pprev != NULL;
+}
+
+/**
+ * Fuehrt alle Funktionen aus, deren Zeit abgelaufen ist
+ * \param now	aktuelle Systemzeit in Timer-Ticks
+ */
+void os_timer_run(uint32_t now);
+#endif // OS_AVAILABLE && PC
+#endif // OS_TIMER_H_
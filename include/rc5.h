@@ -48,5 +48,27 @@ void rc5_control(void);
  */
 void default_key_handler(void);
 
+#ifdef COMMAND_AVAILABLE
+#include "command.h"
+
+/**
+ * Uebernimmt einen vom Sim empfangenen RC5-Code
+ * \param code	RC5-Code, 0 falls keine Taste gedrueckt ist
+ */
+void rc5_receive(int16_t code);
+
+/**
+ * Code der IR-Fernbedienung vom Sim (CMD_SENS_RC5)
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void rc5_handle_command(command_t * cmd);
+
+/** Eintraege der Fernbedienung fuer die Dispatch-Tabelle in command.c */
+#define RC5_CMD_HANDLERS CMD_HANDLER(CMD_SENS_RC5, CMD_SUB_ANY, rc5_handle_command)
+#endif // COMMAND_AVAILABLE
 #endif // RC5_AVAILABLE
+
+#ifndef RC5_CMD_HANDLERS
+#define RC5_CMD_HANDLERS /**< ohne RC5_AVAILABLE keine Eintraege fuer die Dispatch-Tabelle */
+#endif
 #endif // RC5_H_
@@ -253,6 +253,32 @@ uint32_t sdfat_get_filesize(pFatFile p_file); /**< \see FatFileWrapper::get_file
 uint8_t sdfat_get_filename(pFatFile p_file, char* p_name, uint16_t size); /**< \see FatFileWrapper::get_filename() */
 uint8_t sdfat_sync_vol(pSdFat p_instance); /**< \see SdFatWrapper::sync_vol() */
 
+#if defined PC && ! defined WIN32
+/**
+ * Maps the beginning of a file into memory (shared, read / write)
+ * \param[in] p_file Pointer to file
+ * \param[in] size Number of bytes to map, file must be at least this large
+ * \return Address of mapping or NULL in case of error (or if not supported)
+ */
+void* sdfat_mmap(pFatFile p_file, uint32_t size);
+
+/**
+ * Writes modified pages of a mapping back to its file
+ * \param[in] p_addr Address of mapping as returned by sdfat_mmap()
+ * \param[in] size Size of mapping in bytes
+ * \return Error code: 0 for success, 1 for error
+ */
+uint8_t sdfat_msync(void* p_addr, uint32_t size);
+
+/**
+ * Removes a mapping created by sdfat_mmap()
+ * \param[in] p_addr Address of mapping as returned by sdfat_mmap()
+ * \param[in] size Size of mapping in bytes
+ * \return Error code: 0 for success, 1 for error
+ */
+uint8_t sdfat_munmap(void* p_addr, uint32_t size);
+#endif // PC && ! WIN32
+
 /**
  * Simple test code for SD Fat library
  * \return 1 in case of success, 0 otherwise
@@ -90,6 +90,7 @@ extern int16_t v_enc_center;	/**< Schnittgeschwindigkeit ueber beide Raeder */
 
 #ifdef PC
 extern int16_t simultime;	/**< Simulierte Zeit */
+extern int16_t simulcycle;	/**< Nummer des letzten Zyklus vom Sim, wird mit CMD_DONE quittiert */
 #endif
 
 #ifdef MEASURE_MOUSE_AVAILABLE
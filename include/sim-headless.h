@@ -0,0 +1,68 @@
+/*
+ * c't-Bot
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ * This program is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307, USA.
+ *
+ */
+
+/**
+ * \file 	sim-headless.h
+ * \brief 	Eingebauter Sim ohne GUI fuer Testlaeufe schneller als Echtzeit
+ *
+ * Der Sim laeuft als eigener Thread im Bot-Prozess und ist ueber ein Socket-Paar mit dem Bot verbunden.
+ * Er spricht das normale Sim-Protokoll, simuliert einen Bot mit Differentialantrieb in einer Welt aus
+ * einer PGM-Datei und schaltet simultime weiter, sobald der Bot seinen Zyklus mit CMD_DONE beendet hat.
+ * \date 	18.10.2026
+ */
+
+#ifndef SIM_HEADLESS_H_
+#define SIM_HEADLESS_H_
+
+#if defined PC && defined BOT_2_SIM_AVAILABLE && ! defined ARM_LINUX_BOARD
+#define SIM_WORLD_RES		10		/**< Aufloesung der Welt [mm / Pixel] */
+#define SIM_WORLD_WALL		64		/**< Pixel mit Grauwert kleiner als dieser sind Hindernisse */
+#define SIM_WORLD_HOLE		96		/**< Pixel mit Grauwert kleiner als dieser (und nicht Hindernis) sind Abgruende */
+#define SIM_WORLD_LINE		128		/**< Pixel mit Grauwert kleiner als dieser (und nicht Abgrund) sind Linien, alles darueber ist Boden */
+#define SIM_CYCLE_MS		10		/**< Simulierte Zeit pro Zyklus [ms] */
+#define SIM_REPORT_MS		60000L	/**< Abstand der Ausgaben zum Echtzeitfaktor [ms simulierter Zeit] */
+#define SIM_SWARM_SPACING	300		/**< Abstand der Startplaetze der Bots eines Schwarms in Y-Richtung [mm] */
+#define SIM_SWARM_SYNC_CYCLES	1		/**< Anzahl der Zyklen, nach denen die Sims eines Schwarms aufeinander warten, 1 = Lockstep */
+
+/**
+ * Laedt die Welt fuer den eingebauten Sim und aktiviert ihn.
+ * \param *filename	Pfad zu einer PGM-Datei (P2 oder P5, SIM_WORLD_RES mm pro Pixel, oberste Zeile = groesstes Y)
+ * 					oder "-" fuer die eingebaute Test-Arena
+ * \return			0, falls alles OK, sonst Fehlercode
+ */
+int8_t sim_headless_init(const char * filename);
+
+/**
+ * Startet den eingebauten Sim, falls er mit sim_headless_init() aktiviert wurde
+ * \return	Socket des Bots fuer die Verbindung zum Sim oder -1, falls der eingebaute Sim nicht aktiv ist
+ */
+int sim_headless_connect(void);
+
+#ifndef WIN32
+/**
+ * Haengt den eingebauten Sim an den Vermittler eines Schwarms und verschiebt den Startplatz des Bots
+ * \param link	Socket (SOCK_SEQPACKET) zum Vermittler, ein Paket enthaelt genau ein Kommando samt Anhang oder
+ * 				ist 1 Byte lang: vom Sim die Bitte um Freigabe des naechsten Zyklus, vom Vermittler die Freigabe
+ * \param index	Nummer des Bots im Schwarm
+ * \param count	Anzahl der Bots im Schwarm
+ */
+void sim_headless_join_swarm(int link, uint8_t index, uint8_t count);
+#endif // ! WIN32
+#endif // PC && BOT_2_SIM_AVAILABLE && ! ARM_LINUX_BOARD
+#endif // SIM_HEADLESS_H_
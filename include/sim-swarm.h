@@ -0,0 +1,49 @@
+/*
+ * c't-Bot
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ * This program is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307, USA.
+ *
+ */
+
+/**
+ * \file 	sim-swarm.h
+ * \brief 	Schwarm-Starter: forkt pro Bot einen Prozess mit eingebautem Sim
+ *
+ * Der Startprozess forkt nach der Auswertung der Kommandozeile einen Bot-Prozess pro Bot. Jeder Bot hat
+ * seinen kompletten Zustand und seinen eingebauten Sim fuer sich, die Welt und alle konstanten Tabellen
+ * teilen sich die Prozesse per Copy-on-Write, das Betriebssystem verteilt sie auf alle Kerne. Der
+ * Startprozess vermittelt Bot-2-Bot-Kommandos zwischen den eingebauten Sims und verteilt die Zeilen von
+ * stdin: "ADRESSE:Zeile" geht an den Bot mit dieser Adresse, alle anderen Zeilen an alle Bots.
+ * Alle SIM_SWARM_SYNC_CYCLES Zyklen gibt er den naechsten Zyklus erst frei, wenn alle Sims so weit sind,
+ * die simulierten Uhren der Bots laufen also im Gleichschritt.
+ * \date 	18.10.2026
+ */
+
+#ifndef SIM_SWARM_H_
+#define SIM_SWARM_H_
+
+#if defined PC && defined BOT_2_SIM_AVAILABLE && ! defined ARM_LINUX_BOARD && ! defined WIN32
+#define SIM_SWARM_MAX_BOTS	64	/**< Maximale Anzahl an Bots in einem Schwarm */
+#define SIM_SWARM_MAX_ADDR	127	/**< Hoechste Bot-Adresse, groessere vergibt der Sim (siehe command_init()) */
+
+/**
+ * Startet count Bots mit den Adressen ab get_bot_address() (0, falls keine gesetzt ist).
+ * Kehrt nur in den Bot-Prozessen zurueck, der Startprozess vermittelt bis zum Ende aller Bots und beendet sich dann.
+ * \param count	Anzahl der Bots
+ * \return		0 im Bot-Prozess, sonst Fehlercode
+ */
+int8_t sim_swarm_start(uint8_t count);
+#endif // PC && BOT_2_SIM_AVAILABLE && ! ARM_LINUX_BOARD && ! WIN32
+#endif // SIM_SWARM_H_
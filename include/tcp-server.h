@@ -48,4 +48,15 @@ void tcp_test_client_init(void);
  * \param runs	Anzahl der Durchlaeufe, 0 fuer unendlich
  */
 void tcp_test_client_run(int runs);
+
+#ifndef WIN32
+/**
+ * Fuehrt den Benchmark aus: startet die Echo-Clients als eigene Prozesse, misst die Round-Trip-Zeiten
+ * aller Runden und gibt Perzentile, Histogramm und Durchsatz aus. Beendet das Programm per exit().
+ * \param *spec	Konfiguration als key=value[,key=value...], "-" fuer die Voreinstellungen:
+ * 				runs, warmup, clients, payload (Bytes pro Kommando), mix (Kommandos einer Runde),
+ * 				format (csv oder json), out (Datei, wird ergaenzt), label (z.B. Commit-ID)
+ */
+void tcp_benchmark_run(const char * spec);
+#endif // ! WIN32
 #endif // TCP_SERVER_H_
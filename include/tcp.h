@@ -37,6 +37,7 @@
 
 extern int tcp_sock;		/**< Unser TCP-Socket */
 extern char * tcp_hostname;	/**< Hostname, auf dem ct-Sim laeuft */
+extern char * tcp_unix_path;	/**< Pfad zum Unix-Domain-Socket eines lokalen Sims, NULL fuer TCP/IP */
 
 /**
  * Uebertrage Daten per TCP/IP
@@ -55,6 +56,20 @@ int16_t tcp_write(const void * data, int16_t length);
  */
 int16_t tcp_read(void * data, int16_t length);
 
+/**
+ * Liefert die naechsten Bytes der TCP/IP-Verbindung, ohne sie aus dem Empfangspuffer zu entfernen.
+ * Achtung: blockierend!
+ * \param length	Anzahl der gewuenschten Bytes
+ * \return 			Zeiger auf die Daten im Empfangspuffer, gueltig bis zum naechsten Lesen; NULL falls keine Verbindung
+ */
+const void * tcp_peek(int16_t length);
+
+/**
+ * Entfernt Bytes aus dem Empfangspuffer, die zuvor per tcp_peek() geholt wurden
+ * \param length	Anzahl der Bytes
+ */
+void tcp_skip(int16_t length);
+
 /**
  * Oeffnet eine TCP-Verbindung zum Server
  * \param *hostname	Symbolischer Name des Host, auf dem ct-Sim laeuft
@@ -62,6 +77,15 @@ int16_t tcp_read(void * data, int16_t length);
  */
 int tcp_openConnection(const char * hostname);
 
+#ifndef WIN32
+/**
+ * Oeffnet eine Verbindung zu einem Sim auf demselben Rechner ueber einen Unix-Domain-Socket
+ * \param *path	Pfad des Sockets
+ * \return		Der Socket
+ */
+int tcp_openUnixConnection(const char * path);
+#endif // ! WIN32
+
 /**
  * Initialisiere TCP/IP Verbindung
  */
@@ -72,20 +96,38 @@ void tcp_init(void);
  */
 void tcp_init_client(void);
 
-#ifndef __WIN32__
+#ifndef ARM_LINUX_BOARD
+/**
+ * Wartet hoechstens timeout ms auf Daten vom Sim und liest das Verfuegbare in den Empfangspuffer.
+ * Liegt dort bereits ein komplettes Kommando, wird nicht gewartet.
+ * \param timeout	maximale Wartezeit [ms], 0 fuer nicht blockierend
+ * \return			Anzahl der Bytes im Empfangspuffer
+ */
+int tcp_data_wait(int timeout);
+#endif // ! ARM_LINUX_BOARD
+
+#ifdef ARM_LINUX_BOARD
 /**
- * Initialisiere TCP/IP Verbindung als Server
+ * Initialisiere TCP/IP Verbindung als Server. Laeuft danach als Thread weiter, nimmt per epoll
+ * mehrere Verbindungen an und meldet neue Daten bzw. getrennte Verbindungen.
  * \param *ptr Datenparameter fuer pthread, wird nicht verwendet
  * \return NULL
  */
 void * tcp_init_server(void * ptr);
 
 /**
- * Ermittelt wie viele Bytes auf dem TCP-Server Socket zur Verfuegung stehen
+ * Ermittelt wie viele Bytes vom aktiven Client des TCP-Servers zur Verfuegung stehen, blockiert nicht.
+ * Schliesst nebenbei getrennte Verbindungen und wechselt reihum zu Clients mit neuen Daten.
  * \return Bytes verfuegbar
  */
 int tcp_data_available(void);
-#endif // __WIN32__
+
+/**
+ * Gibt an, ob seit dem letzten Aufruf ein neuer Client mit dem TCP-Server verbunden wurde
+ * \return True oder False
+ */
+uint8_t tcp_client_accepted(void);
+#endif // ARM_LINUX_BOARD
 /**
  * Gibt an, ob derzeit ein TCP-Client verbunden ist
  * \return True oder False
@@ -95,11 +137,31 @@ static inline uint8_t tcp_client_connected(void) {
 }
 
 /**
- * Schreibt den Sendepuffer auf einen Schlag raus
- * \return -1 bei Fehlern, sonst Anzahl der uebertragenen Bytes
+ * Reiht die seit dem letzten Aufruf per tcp_write() geschriebenen Daten des aufrufenden Threads
+ * als zusammenhaengenden Block in die Sendewarteschlange ein. Bloecke verschiedener Threads werden
+ * nie vermischt, ein Kommando samt Payload kommt also am Stueck beim Empfaenger an.
+ * \param flush	True, falls der Sende-Thread sofort senden soll (z.B. nach CMD_DONE)
+ * \return		Anzahl der eingereihten Bytes
+ */
+int16_t tcp_commit(uint8_t flush);
+
+/**
+ * Ueberlaesst die Sequenznummer des zuletzt per tcp_write() geschriebenen Kommandos tcp_commit(),
+ * die sie beim Einreihen eintraegt
+ */
+void tcp_defer_seq(void);
+
+/**
+ * Uebergibt den Sendepuffer des aufrufenden Threads an den Sende-Thread und weckt diesen
+ * \return -1 bei Fehlern, sonst Anzahl der uebergebenen Bytes
  */
 int16_t flushSendBuffer(void);
 
+/**
+ * Wartet, bis alle bisher eingereihten Daten uebertragen wurden
+ */
+void tcp_wait_sent(void);
+
 /**
  * Schliesst eine TCP-Connection
  * \param sock Der Socket
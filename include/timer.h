@@ -67,6 +67,13 @@ extern double tickCount;
  */
 void system_time_isr(void);
 
+#if defined BOT_2_SIM_AVAILABLE && ! defined ARM_LINUX_BOARD
+/**
+ * Funktion, die die TickCounts um die seit dem letzten Aufruf vergangene Echtzeit erhoeht (freilaufender Modus)
+ */
+void system_time_realtime(void);
+#endif // BOT_2_SIM_AVAILABLE && ! ARM_LINUX_BOARD
+
 /**
  * Setzt die Systemzeit zurueck auf 0
  */
@@ -46,6 +46,10 @@
 #include "command.h"
 #include "motor.h"
 #include "init.h"
+#include "delay.h"
+#ifdef PC
+#include <sys/time.h>
+#endif
 
 #if !defined MMC_AVAILABLE && defined MCU
 #error "Map geht auf dem MCU nicht ohne MMC"
@@ -70,6 +74,7 @@
 //#define DEBUG_MAP_GET_AVERAGE_VERBOSE	// zeichnet belegte Map-Felder, die map_get_average() auswertet rot und freie gruen
 
 //#define MAP_TESTS_AVAILABLE	// Schalter um Test-Code zu aktivieren
+#define MAP_TEST_RAYS_RANGE	2800	/**< map_test_rays() benutzt die Felder im Bereich +/- MAP_TEST_RAYS_RANGE mm um den Ursprung */
 #define MAP_INFO_AVAILABLE		// Schalter um Info-Code zu aktivieren
 #ifdef MCU
 // Soll auch der echte Bot Infos ausgeben, kommentiert man die folgende Zeile aus
@@ -134,6 +139,8 @@
 /** Umkreis einen Messpunkt, der als besetzt aktualisiert wird (Streukreis) [Felder] */
 #define MAP_RADIUS_FIELDS			(MAP_RESOLUTION * MAP_RADIUS / 1000)
 
+#define MAP_HEADER_INTERVAL		5000	/**< Zeit [ms], nach der der Update-Thread einen veraenderten belegten Bereich spaetestens in den Header schreibt */
+
 #define MAP_PRINT_SCALE					/**< Soll das PGM eine Skala erhalten? */
 #define MAP_SCALE	(MAP_RESOLUTION / 2)	/**< Alle wieviel Punkte kommt ein Skalen-Strich */
 
@@ -151,6 +158,7 @@ int16_t map_max_x = MAP_SIZE * MAP_RESOLUTION / 2; /**< belegter Bereich der Kar
 int16_t map_min_y = MAP_SIZE * MAP_RESOLUTION / 2; /**< belegter Bereich der Karte [Kartenindex]: kleinste Y-Koordinate */
 int16_t map_max_y = MAP_SIZE * MAP_RESOLUTION / 2; /**< belegter Bereich der Karte [Kartenindex]: groesste Y-Koordinate */
 static uint8_t min_max_updated = False; /**< wurden die Min- / Max-Werte veraendert? */
+static uint32_t map_header_last_write = 0; /**< Zeitpunkt, zu dem der Header zuletzt geschrieben wurde [Ticks] */
 uint16_t alignment_offset = 0;
 
 /** Datentyp fuer die Elementarfelder einer Gruppe */
@@ -160,17 +168,71 @@ typedef struct {
 
 static pFatFile map_file_desc; /**< Datei-Deskriptor der Map */
 
-static uint8_t map_update_fifo_buffer[MAP_UPDATE_CACHE_SIZE];	/**< Puffer fuer Map-Cache-Indizes / FiFo */
-fifo_t map_update_fifo;										/**< Fifo fuer Map-Cache */
 map_cache_t map_update_cache[MAP_UPDATE_CACHE_SIZE];			/**< Map-Cache */
+#ifdef MAP_UPDATE_BATCH
+/*
+ * Mit MAP_UPDATE_BATCH ist der Map-Cache eine Ring-Queue fuer genau einen Producer (bot_scan_onthefly_behaviour())
+ * und einen Consumer (map_update_main()), die ohne Sperren auskommt. Die Indizes laufen frei um, belegt sind die
+ * Eintraege [tail; head). Der Update-Thread arbeitet unter einer Sperre alle wartenden Eintraege ab und gibt
+ * jeden Eintrag erst frei, wenn er eingetragen ist.
+ */
+#if MAP_UPDATE_CACHE_SIZE & (MAP_UPDATE_CACHE_SIZE - 1)
+#error "MAP_UPDATE_CACHE_SIZE muss mit MAP_UPDATE_BATCH eine Zweierpotenz sein"
+#endif
+static uint16_t map_update_head = 0; /**< Index des naechsten freien Eintrags, schreibt nur der Producer */
+static uint16_t map_update_tail = 0; /**< Index des aeltesten belegten Eintrags, schreibt nur der Consumer */
+static uint8_t map_update_waiting = False; /**< True, solange der Update-Thread auf neue Eintraege wartet */
+static os_signal_t map_update_signal = OS_SIGNAL_INITIALIZER; /**< Signal zum Aufwecken des Update-Threads */
+#else
+static uint8_t map_update_fifo_buffer[MAP_UPDATE_CACHE_SIZE];	/**< Puffer fuer Map-Cache-Indizes / FiFo */
+static fifo_t map_update_fifo;									/**< Fifo fuer Map-Cache */
+static uint8_t map_update_index = 0;							/**< Index des zuletzt uebergebenen Eintrags */
+#endif // MAP_UPDATE_BATCH
 
 uint8_t map_update_stack[MAP_UPDATE_STACK_SIZE];	/**< Stack des Update-Threads */
 static Tcb_t* map_update_thread;					/**< Thread fuer Map-Update */
 static os_signal_t lock_signal = OS_SIGNAL_INITIALIZER; /**< Signal zur Synchronisation von Kartenzugriffen */
+#ifdef MAP_USE_RWLOCK
+/*
+ * Mit MAP_USE_RWLOCK schuetzt ein Reader-/Writer-Lock die Kartendaten. Der Update-Thread sperrt ihn nur fuer
+ * jeweils einen Eintrag des Map-Caches, Abfragen warten also nicht, bis der ganze Cache abgearbeitet ist.
+ * Eine Abfrage sieht alle Eintraege, die vor ihr fertig eingetragen wurden, es fehlen ihr hoechstens die
+ * (maximal MAP_UPDATE_CACHE_SIZE) Eintraege, die noch im Map-Cache warten.
+ * Mit MAP_USE_MMAP veraendern Abfragen keine gemeinsamen Daten und laufen parallel zueinander, mit dem
+ * Block-Cache laden sie evtl. Bloecke nach und sperren daher exklusiv.
+ * lock_signal bleibt gesetzt, solange der Update-Thread Eintraege abarbeitet (map_locked(), map_flush_cache()).
+ */
+static pthread_rwlock_t map_rwlock = PTHREAD_RWLOCK_INITIALIZER; /**< Reader-/Writer-Lock fuer die Kartendaten */
+#endif // MAP_USE_RWLOCK
 
 void map_update_main(void) OS_TASK_ATTR;
 
 #define map_buffer GET_MMC_BUFFER(map_buffer)	/**< Map-Puffer */
+
+#if MAP_CACHE_BLOCKS < 1 || MAP_CACHE_BLOCKS > 255
+#error "MAP_CACHE_BLOCKS muss zwischen 1 und 255 liegen"
+#endif
+
+#ifdef MAP_USE_MMAP
+/*
+ * Mit MAP_USE_MMAP ist die komplette Map-Datei in den Speicher eingeblendet, get_section() liefert
+ * direkt einen Zeiger in das Mapping. Das Betriebssystem schreibt veraenderte Seiten selbst zurueck,
+ * map_flush_cache() erzwingt das per sdfat_msync(). Der aktuelle Block wird nur noch verfolgt, um
+ * den belegten Bereich der Karte und Map-2-Sim beim Blockwechsel zu aktualisieren.
+ */
+static uint8_t* map_mmap = NULL; /**< Anfangsadresse der eingeblendeten Map-Datei */
+static uint32_t map_mmap_size = 0; /**< Groesse des Mappings [Byte] */
+static uint8_t map_mmap_dirty = False; /**< wurde das Mapping seit dem letzten sdfat_msync() veraendert? */
+
+static struct {
+	uint16_t block;		/**< zuletzt benutzter Block; 0xffff: keiner */
+	uint8_t updated;	/**< markiert, ob der Block seit dem letzten Blockwechsel veraendert wurde */
+	int16_t x;			/**< X-Koordinate des Blocks */
+	int16_t y;			/**< Y-Koordinate des Blocks */
+	uint8_t* data;		/**< Zeiger auf die Daten des Blocks im Mapping */
+} map_current_block = { 0xffff, False, 0, 0, NULL }; /**< Daten des aktuellen Blocks */
+
+#elif MAP_CACHE_BLOCKS == 1
 static map_section_t* map[2];					/**< Array mit den Zeigern auf die Elemente, es passen immer 2 Sektionen in den Puffer */
 
 static struct {
@@ -180,6 +242,64 @@ static struct {
 	int16_t y;			/**< Y-Koordinate des Blocks */
 } map_current_block = { 0, False, 0, 0 }; /**< Daten des aktuellen Blocks */
 
+#else // MAP_CACHE_BLOCKS > 1
+/*
+ * Mit MAP_CACHE_BLOCKS > 1 stehen mehrere Bloecke gleichzeitig im RAM. Veraenderte Bloecke
+ * werden erst beim Verdraengen oder per map_flush_cache() in die Map-Datei zurueckgeschrieben.
+ * Verdraengt wird nach dem CLOCK-Verfahren (Second-Chance, Naeherung an LRU).
+ * Der MMC-Puffer map_buffer dient dann nur noch als Zwischenspeicher fuer Header und Kopien.
+ */
+
+/** Eintrag des Block-Caches */
+typedef struct {
+	uint16_t block;		/**< Block, der in diesem Eintrag steht; 0xffff: Eintrag leer */
+	uint8_t updated;	/**< markiert, ob der Block gegenueber der Map-Datei veraendert wurde */
+	uint8_t referenced;	/**< Referenz-Bit fuer die CLOCK-Verdraengung */
+	int16_t x;			/**< X-Koordinate des Blocks */
+	int16_t y;			/**< Y-Koordinate des Blocks */
+	uint8_t data[MAP_BLOCK_SIZE]; /**< Daten des Blocks (2 Sektionen) */
+} map_cache_block_t;
+
+static map_cache_block_t map_cache_blocks[MAP_CACHE_BLOCKS];	/**< Block-Cache */
+static map_cache_block_t* map_current_block = &map_cache_blocks[0]; /**< zuletzt benutzter Eintrag des Block-Caches */
+static uint8_t map_cache_hand = 0; /**< Zeiger der CLOCK-Verdraengung */
+
+/** Statistik des Block-Caches */
+static struct {
+	uint32_t hits;		/**< Anzahl der Zugriffe auf Bloecke im Cache */
+	uint32_t misses;	/**< Anzahl der Zugriffe, fuer die ein Block geladen werden musste */
+	uint32_t writes;	/**< Anzahl der zurueckgeschriebenen Bloecke */
+} map_cache_stat;
+#endif // MAP_CACHE_BLOCKS
+
+#ifdef MAP_SECTION_STATS
+/*
+ * Mit MAP_SECTION_STATS gibt es fuer jede Section einen Eintrag mit Kennzahlen ihrer Felder. Summe und
+ * Anzahlen werden bei jedem Schreibzugriff exakt nachgefuehrt, Minimum und Maximum werden nur erweitert
+ * und schliessen die Feldwerte daher immer ein. Koennten sie zu weit sein, wird die Section als "stale"
+ * vermerkt und ihre Grenzen werden vom Update-Thread neu berechnet, sobald der Update-Fifo leer ist.
+ * get_ratio() und disc_apply(DISC_AVERAGE) muessen die Felder einer Section dann nicht lesen, wenn die
+ * Kennzahlen das Ergebnis schon festlegen (Section komplett innerhalb / ausserhalb des Wertebereichs
+ * oder einheitlich belegt).
+ */
+
+#define MAP_STAT_STALE_SIZE	256	/**< Anzahl der Sections, deren Min / Max gleichzeitig als veraltet vermerkt werden koennen */
+
+/** Kennzahlen einer Section */
+typedef struct {
+	int16_t sum;		/**< Summe aller Feldwerte */
+	uint16_t obstacle;	/**< Anzahl der Felder < MAP_OBSTACLE_THRESHOLD */
+	uint16_t driven;	/**< Anzahl der Felder >= MAP_DRIVEN_THRESHOLD */
+	int8_t min;			/**< kleinster Feldwert (hoechstens zu klein) */
+	int8_t max;			/**< groesster Feldwert (hoechstens zu gross) */
+	uint8_t stale;		/**< True, falls min / max neu berechnet werden muessen */
+} map_section_stat_t;
+
+static map_section_stat_t map_stat[MAP_SECTIONS * MAP_SECTIONS]; /**< Kennzahlen aller Sections, Index: Section-Y * MAP_SECTIONS + Section-X */
+static uint16_t map_stat_stale[MAP_STAT_STALE_SIZE]; /**< Indizes der Sections mit veralteten Min / Max-Werten */
+static uint16_t map_stat_stale_count = 0; /**< Anzahl der Eintraege in map_stat_stale; > MAP_STAT_STALE_SIZE: Liste uebergelaufen */
+#endif // MAP_SECTION_STATS
+
 static uint8_t init_state = 0; /**< Status der Initialisierung (0 (nicht initialisiert), 1 (alles OK)) */
 
 #ifdef MAP_2_SIM_AVAILABLE
@@ -205,6 +325,15 @@ static pFatFile map_2_sim_file_desc; /**< File-Deskriptor fuer Map-2-Sim */
 /** \todo use local buffer */
 #define map_2_sim_buffer GET_MMC_BUFFER(map_2_sim_buffer) /**< Puffer fuer Map-Block (von der MMC) zur Map-2-Sim-Kommunikation */
 static os_signal_t map_2_sim_signal = OS_SIGNAL_INITIALIZER; /**< Signal, um gleichzeitiges Senden von Map-Daten zu verhindern */
+#ifdef MAP_2_SIM_DELTA
+#define MAP_BLOCKS	(MAP_SECTIONS * MAP_SECTIONS / 2) /**< Anzahl der Bloecke in der Karte */
+static uint8_t map_2_sim_delta = False; /**< True, falls der Sim das Delta-Format (SUB_MAP_DELTA) versteht */
+static uint8_t map_2_sim_shadow[MAP_BLOCKS][MAP_BLOCK_SIZE]; /**< Stand der Bloecke im Sim */
+static uint8_t map_2_sim_valid[MAP_BLOCKS / 8]; /**< Bit gesetzt: Block in map_2_sim_shadow entspricht dem Stand im Sim */
+static uint8_t map_2_sim_pending[MAP_BLOCKS / 8]; /**< Bit gesetzt: Block wartet auf das Senden */
+static uint8_t map_2_sim_lost = False; /**< True, falls Bloecke nicht mehr in die Fifo gepasst haben */
+static uint8_t map_2_sim_reset = False; /**< True, falls der Sim die komplette Karte angefordert hat und map_2_sim_valid verworfen werden muss */
+#endif // MAP_2_SIM_DELTA
 #endif // MAP_2_SIM_AVAILABLE
 
 #ifdef PC
@@ -248,6 +377,266 @@ static uint16_t get_block(int16_t x, int16_t y) {
 	return block;
 }
 
+/**
+ * Liest einen Block aus der Map-Datei
+ * \param block		Nummer des Blocks
+ * \param *buffer	Zielpuffer (MAP_BLOCK_SIZE Byte)
+ * \return			0 falls alles OK
+ */
+#ifndef MAP_USE_MMAP
+static uint8_t read_block(uint16_t block, void* buffer) {
+	if (sdfat_seek(map_file_desc, (int32_t) ((block + alignment_offset) * MAP_BLOCK_SIZE) + sizeof(map_header_t), SEEK_SET)) {
+		LOG_DEBUG("map::read_block(): sdfat_seek(0x%x) failed", block + alignment_offset);
+		return 1;
+	}
+	if (sdfat_read(map_file_desc, buffer, MAP_BLOCK_SIZE) != MAP_BLOCK_SIZE) {
+		LOG_DEBUG("map::read_block(): sdfat_read(0x%x) failed", block + alignment_offset);
+		return 2;
+	}
+	return 0;
+}
+#endif // ! MAP_USE_MMAP
+
+#ifdef MAP_2_SIM_DELTA
+/**
+ * Traegt einen veraenderten Block zum Senden an den Sim ein, falls er nicht schon darauf wartet
+ * \param block	Nummer des Blocks
+ */
+static void map_2_sim_queue(uint16_t block) {
+	const uint8_t mask = (uint8_t) (1 << (block & 7));
+	if (__atomic_fetch_or(&map_2_sim_pending[block / 8], mask, __ATOMIC_ACQ_REL) & mask) {
+		return;
+	}
+	if (fifo_put_data(&map_2_sim_fifo, &block, sizeof(block))) {
+		/* Fifo voll, der Block bleibt markiert und wird von map_2_sim_main() spaeter gefunden */
+		__atomic_store_n(&map_2_sim_lost, True, __ATOMIC_RELEASE);
+	}
+}
+#endif // MAP_2_SIM_DELTA
+
+/**
+ * Schreibt einen veraenderten Block in die Map-Datei zurueck und
+ * passt den belegten Bereich der Karte an
+ * \param block		Nummer des Blocks
+ * \param x			X-Koordinate des Blocks
+ * \param y			Y-Koordinate des Blocks
+ * \param *buffer	Daten des Blocks (MAP_BLOCK_SIZE Byte), mit MAP_USE_MMAP unbenutzt
+ * \return			0 falls alles OK
+ */
+static uint8_t swap_out(uint16_t block, int16_t x, int16_t y, const void* buffer) {
+	/* Shrinking */
+	if (x < map_min_x) {
+		map_min_x = x;
+		min_max_updated = True;
+	} else if (x > map_max_x) {
+		map_max_x = x + ((MAP_SECTION_POINTS * 2) - 1);
+		min_max_updated = True;
+	}
+	if (y < map_min_y) {
+		map_min_y = y;
+		min_max_updated = True;
+	} else if (y > map_max_y) {
+		map_max_y = y + (MAP_SECTION_POINTS - 1);
+		min_max_updated = True;
+	}
+
+	/* Dann erstmal sichern */
+#ifdef DEBUG_MAP_TIMES
+	LOG_INFO("writing block 0x%04x", block);
+	uint16_t start_ticks = TIMER_GET_TICKCOUNT_16;
+#endif
+#ifdef MAP_USE_MMAP
+	(void) buffer; // Block steht bereits im Mapping
+	map_mmap_dirty = True;
+#else
+	if (sdfat_seek(map_file_desc, (int32_t) ((block + alignment_offset) * MAP_BLOCK_SIZE) + sizeof(map_header_t), SEEK_SET)) {
+		LOG_DEBUG("map::swap_out(): sdfat_seek(0x%x) failed", block + alignment_offset);
+		return 1;
+	}
+	if (sdfat_write(map_file_desc, buffer, MAP_BLOCK_SIZE) != MAP_BLOCK_SIZE) {
+		LOG_DEBUG("map::swap_out(): sdfat_write(0x%x) failed", block + alignment_offset);
+		return 2;
+	}
+#if MAP_CACHE_BLOCKS > 1
+	++map_cache_stat.writes;
+#endif
+#if defined PC && defined MAP_2_SIM_AVAILABLE
+	/* Map-2-Sim liest den Block ueber einen eigenen File-Deskriptor */
+	sdfat_flush(map_file_desc);
+#endif
+#endif // MAP_USE_MMAP
+
+#ifdef MAP_2_SIM_AVAILABLE
+	map_2_sim_data.pos.x = world_to_map(x_pos);
+	map_2_sim_data.pos.y = world_to_map(y_pos);
+	map_2_sim_data.heading = heading_int;
+#ifdef MEASURE_POSITION_ERRORS_AVAILABLE
+	map_2_sim_data.error = pos_error_radius / (1000 / MAP_RESOLUTION) + (BOT_DIAMETER / 2 / (1000 / MAP_RESOLUTION));
+#endif
+#ifdef MAP_2_SIM_DELTA
+	map_2_sim_queue(block);
+#else
+	fifo_put_data(&map_2_sim_fifo, &block, sizeof(block));
+#endif
+#endif // MAP_2_SIM_AVAILABLE
+
+#ifdef DEBUG_MAP_TIMES
+	uint16_t end_ticks = TIMER_GET_TICKCOUNT_16;
+	LOG_INFO("swapout took %u ms", (end_ticks - start_ticks) * 176 / 1000);
+#endif
+	return 0;
+}
+
+/**
+ * Schreibt alle veraenderten Bloecke in die Map-Datei zurueck, sie bleiben aber im RAM
+ */
+static void write_back_blocks(void) {
+#ifdef MAP_USE_MMAP
+	if (map_current_block.updated == True) {
+		swap_out(map_current_block.block, map_current_block.x, map_current_block.y, map_current_block.data);
+		map_current_block.updated = False;
+	}
+#elif MAP_CACHE_BLOCKS == 1
+	if (map_current_block.updated == True) {
+		swap_out(map_current_block.block, map_current_block.x, map_current_block.y, map_buffer);
+		map_current_block.updated = False;
+	}
+#else
+	uint8_t i;
+	for (i = 0; i < MAP_CACHE_BLOCKS; ++i) {
+		map_cache_block_t* p_entry = &map_cache_blocks[i];
+		if (p_entry->updated == True) {
+			swap_out(p_entry->block, p_entry->x, p_entry->y, p_entry->data);
+			p_entry->updated = False;
+		}
+	}
+#endif // MAP_CACHE_BLOCKS
+}
+
+#if ! defined MAP_SPARSE_FILES || (MAP_CACHE_BLOCKS > 1 && ! defined MAP_USE_MMAP)
+/**
+ * Verwirft alle Bloecke im RAM (ohne sie zurueckzuschreiben), z.B. weil die Map-Datei ueberschrieben wurde
+ * \return	0 falls alles OK
+ */
+static uint8_t invalidate_blocks(void) {
+#ifdef MAP_USE_MMAP
+	map_current_block.updated = False;
+	map_current_block.block = 0xffff;
+
+	/* per sdfat_write() geschriebene Daten muessen im Mapping sichtbar werden */
+	return sdfat_flush(map_file_desc);
+#elif MAP_CACHE_BLOCKS == 1
+	map_current_block.updated = False;
+	map_current_block.block = 0;
+
+	/* Block 0 laden */
+	return read_block(map_current_block.block, map_buffer);
+#else
+	uint8_t i;
+	for (i = 0; i < MAP_CACHE_BLOCKS; ++i) {
+		map_cache_blocks[i].block = 0xffff;
+		map_cache_blocks[i].updated = False;
+		map_cache_blocks[i].referenced = False;
+	}
+	map_current_block = &map_cache_blocks[0];
+	map_cache_hand = 0;
+	return 0;
+#endif // MAP_CACHE_BLOCKS
+}
+#endif // ! MAP_SPARSE_FILES || MAP_CACHE_BLOCKS > 1
+
+#ifndef MAP_SPARSE_FILES
+/**
+ * Laedt den aktuellen Block neu, nachdem der MMC-Puffer als Zwischenspeicher benutzt wurde
+ * \return	0 falls alles OK
+ */
+static uint8_t reload_current_block(void) {
+#if MAP_CACHE_BLOCKS == 1 && ! defined MAP_USE_MMAP
+	return read_block(map_current_block.block, map_buffer);
+#else
+	return 0; // Bloecke liegen nicht im MMC-Puffer
+#endif
+}
+#endif // MAP_SPARSE_FILES
+
+/**
+ * Schreibt den belegten Bereich der Karte in den Header der Map-Datei, falls er sich geaendert hat
+ * \return	0 falls alles OK
+ */
+static uint8_t write_header(void) {
+	if (min_max_updated != True) {
+		return 0;
+	}
+	min_max_updated = False;
+
+#ifdef MAP_USE_MMAP
+	/* Header steht am Anfang des Mappings */
+	map_header_t* p_head_data = (map_header_t*) map_mmap;
+	if (p_head_data->map_min_x != map_min_x || p_head_data->map_max_x != map_max_x
+		|| p_head_data->map_min_y != map_min_y || p_head_data->map_max_y != map_max_y) {
+		p_head_data->map_min_x = map_min_x;
+		p_head_data->map_max_x = map_max_x;
+		p_head_data->map_min_y = map_min_y;
+		p_head_data->map_max_y = map_max_y;
+		map_mmap_dirty = True;
+	}
+	return 0;
+#elif defined MCU
+	/* map_buffer wird gleich ueberschrieben, also aktuellen Block sichern */
+	write_back_blocks();
+
+	uint8_t result = 0;
+	map_header_t* p_head_data = (map_header_t*) map_buffer;
+	sdfat_rewind(map_file_desc);
+	if (sdfat_read(map_file_desc, p_head_data, sizeof(map_header_t)) != sizeof(map_header_t)) {
+		LOG_DEBUG("map::write_header(): sdfat_read(header) failed");
+		result = 1;
+	} else {
+		/* Min- / Max-Werte speichern */
+		p_head_data->map_min_x = map_min_x;
+		p_head_data->map_max_x = map_max_x;
+		p_head_data->map_min_y = map_min_y;
+		p_head_data->map_max_y = map_max_y;
+		sdfat_rewind(map_file_desc);
+		if (sdfat_write(map_file_desc, p_head_data, sizeof(map_header_t)) != sizeof(map_header_t)) {
+			LOG_DEBUG("map::write_header(): sdfat_write(header) failed");
+			result = 2;
+		}
+	}
+	if (result) {
+		min_max_updated = True;
+	}
+
+	/* letzten Block wieder laden */
+	if (reload_current_block()) {
+		result = 3;
+	}
+	return result;
+#else
+	/* PC: Nur den Anfang des Headers (bis einschliesslich map_max_y) schreiben, der Rest ist unbenutzt.
+	 * So wird weder der Header gelesen noch der MMC-Puffer mit dem aktuellen Block benutzt. */
+	struct {
+		uint16_t alignment_offset;
+		int16_t map_min_x;
+		int16_t map_max_x;
+		int16_t map_min_y;
+		int16_t map_max_y;
+	} PACKED_FORCE head = { alignment_offset, map_min_x, map_max_x, map_min_y, map_max_y };
+
+	sdfat_rewind(map_file_desc);
+	if (sdfat_write(map_file_desc, &head, sizeof(head)) != sizeof(head)) {
+		LOG_DEBUG("map::write_header(): sdfat_write(header) failed");
+		min_max_updated = True;
+		return 1;
+	}
+	return 0;
+#endif // MAP_USE_MMAP
+}
+
+#ifdef MAP_SECTION_STATS
+static void stats_rebuild(void);
+#endif
+
 /**
  * Initialisiert die Karte
  * \param clean_map True: Karte wird geloescht, False: Karte bleibt erhalten
@@ -269,11 +658,22 @@ static int8_t init(uint8_t clean_map) {
 	display_cursor(3, 1);
 	display_printf("initialisiert.");
 
+#ifdef MAP_USE_MMAP
+	if (map_mmap) {
+		sdfat_munmap(map_mmap, map_mmap_size);
+		map_mmap = NULL;
+	}
+	map_current_block.block = 0xffff;
+	map_current_block.updated = False;
+#elif MAP_CACHE_BLOCKS == 1
 	// Die Karte auf den Puffer biegen
 	map[0] = (map_section_t*) map_buffer;
 	map[1] = (map_section_t*) (map_buffer + sizeof(map_section_t));
 
 	map_current_block.updated = 0xff; // Die MMC-Karte ist erstmal nicht verfuegbar
+#else
+	invalidate_blocks();
+#endif // MAP_CACHE_BLOCKS
 
 	LOG_DEBUG("map::init(): sdfat_open(\"%s\")...", MAP_FILENAME);
 
@@ -382,6 +782,7 @@ static int8_t init(uint8_t clean_map) {
 	}
 #endif // MAP_2_SIM_AVAILABLE
 
+#if MAP_CACHE_BLOCKS == 1 && ! defined MAP_USE_MMAP
 	map_current_block.updated = False;
 	map_current_block.block = 0;
 
@@ -398,6 +799,26 @@ static int8_t init(uint8_t clean_map) {
 			return 11;
 		}
 	}
+#endif // MAP_CACHE_BLOCKS == 1 && ! MAP_USE_MMAP
+
+#ifdef MAP_USE_MMAP
+	/* Map-Datei komplett einblenden */
+	map_mmap_size = (uint32_t) (MAP_FILE_SIZE + alignment_offset) * MAP_BLOCK_SIZE + sizeof(map_header_t);
+	if (sdfat_get_filesize(map_file_desc) < map_mmap_size) {
+		LOG_DEBUG("map::init(): Datei zu klein fuer mmap: 0x%x < 0x%x", sdfat_get_filesize(map_file_desc), map_mmap_size);
+		return 12;
+	}
+	map_mmap = sdfat_mmap(map_file_desc, map_mmap_size);
+	if (! map_mmap) {
+		LOG_ERROR("map::init(): Map-Datei konnte nicht eingeblendet werden");
+		return 13;
+	}
+	LOG_DEBUG("map::init(): Map-Datei eingeblendet, %u Byte", map_mmap_size);
+#endif // MAP_USE_MMAP
+
+#ifdef MAP_SECTION_STATS
+	stats_rebuild();
+#endif
 
 	/* Thread-Setup */
 	if (init_state == 0) {
@@ -408,7 +829,9 @@ static int8_t init(uint8_t clean_map) {
 		os_mask_stack(map_2_sim_worker_stack, MAP_2_SIM_STACK_SIZE);
 #endif
 #endif // OS_DEBUG
+#ifndef MAP_UPDATE_BATCH
 		fifo_init(&map_update_fifo, map_update_fifo_buffer, (uint8_t) sizeof(map_update_fifo_buffer));
+#endif
 #ifdef MAP_2_SIM_AVAILABLE
 		fifo_init(&map_2_sim_fifo, map_2_sim_cache, sizeof(map_2_sim_cache));
 #endif
@@ -440,9 +863,9 @@ int8_t map_init(void) {
 }
 
 /**
- * Haelt den Bot an und schreibt den Map-Update-Cache komplett zurueck
+ * Wartet, bis der Update-Thread die Karte freigibt. Auf dem MCU haelt der Bot solange an.
  */
-void map_flush_cache(void) {
+static void wait_for_update(void) {
 #ifdef MCU
 	if (map_locked() == 1) {
 		motor_set(BOT_SPEED_STOP, BOT_SPEED_STOP);
@@ -452,33 +875,74 @@ void map_flush_cache(void) {
 	os_signal_set(&lock_signal);
 	/* Sperre sofort wieder freigeben */
 	os_signal_release(&lock_signal);
+}
 
-	sdfat_rewind(map_file_desc);
-	if (sdfat_read(map_file_desc, map_buffer, sizeof(map_header_t)) != sizeof(map_header_t)) {
-		LOG_ERROR("map_flush_cache(): sdfat_read(head) failed");
-		return;
-	}
+/**
+ * Sperrt die Kartendaten fuer einen schreibenden Zugriff
+ */
+static inline void write_lock(void) {
+#ifdef MAP_USE_RWLOCK
+	pthread_rwlock_wrlock(&map_rwlock);
+#endif
+}
 
-	map_header_t* p_head_data = (map_header_t*) map_buffer;
-	p_head_data->map_min_x = map_min_x;
-	p_head_data->map_max_x = map_max_x;
-	p_head_data->map_min_y = map_min_y;
-	p_head_data->map_max_y = map_max_y;
+/**
+ * Gibt die Kartendaten nach einem schreibenden Zugriff wieder frei
+ */
+static inline void write_unlock(void) {
+#ifdef MAP_USE_RWLOCK
+	pthread_rwlock_unlock(&map_rwlock);
+#endif
+}
 
-	sdfat_rewind(map_file_desc);
-	if (sdfat_write(map_file_desc, p_head_data, sizeof(map_header_t)) != sizeof(map_header_t)) {
-		LOG_ERROR("map_flush_cache(): sdfat_write(head) failed");
-	}
+/**
+ * Beginnt eine Abfrage der Karte. Ohne MAP_USE_RWLOCK wird gewartet, bis der Update-Thread den ganzen Map-Cache
+ * abgearbeitet hat.
+ */
+static inline void read_lock(void) {
+#ifdef MAP_USE_RWLOCK
+#ifdef MAP_USE_MMAP
+	pthread_rwlock_rdlock(&map_rwlock);
+#else
+	pthread_rwlock_wrlock(&map_rwlock); // Lesen veraendert den Block-Cache
+#endif
+#else
+	wait_for_update();
+#endif // MAP_USE_RWLOCK
+}
 
-	if (sdfat_seek(map_file_desc, (int32_t) ((map_current_block.block + alignment_offset) * MAP_BLOCK_SIZE) + sizeof(map_header_t), SEEK_SET)) {
-		LOG_ERROR("map_flush_cache(): sdfat_seek(0x%x) failed", map_current_block.block + alignment_offset);
-		return;
-	}
-	if (sdfat_read(map_file_desc, map_buffer, MAP_BLOCK_SIZE) != MAP_BLOCK_SIZE) {
-		LOG_ERROR("map_flush_cache(): sdfat_read(0x%x) failed", map_current_block.block + alignment_offset);
+/**
+ * Beendet eine Abfrage der Karte
+ */
+static inline void read_unlock(void) {
+#ifdef MAP_USE_RWLOCK
+	pthread_rwlock_unlock(&map_rwlock);
+#endif
+}
+
+/**
+ * Haelt den Bot an und schreibt den Map-Update-Cache komplett zurueck
+ */
+void map_flush_cache(void) {
+	wait_for_update();
+	write_lock();
+
+	/* veraenderte Bloecke und Header sichern */
+	write_back_blocks();
+	if (write_header()) {
+		LOG_ERROR("map_flush_cache(): write_header() failed");
 	}
 
+#ifdef MAP_USE_MMAP
+	if (map_mmap_dirty == True) {
+		map_mmap_dirty = False;
+		if (sdfat_msync(map_mmap, map_mmap_size)) {
+			LOG_ERROR("map_flush_cache(): sdfat_msync() failed");
+		}
+	}
+#endif
 	sdfat_flush(map_file_desc);
+	write_unlock();
 }
 
 /**
@@ -527,6 +991,22 @@ static map_section_t* get_section(int16_t x, int16_t y) {
 	// Da immer 2 Sections in einem Block stehen: richtige der beiden Sections raussuchen
 	const uint8_t index = (uint8_t) ((x / MAP_SECTION_POINTS) & 0x1);
 
+#ifdef MAP_USE_MMAP
+	if (map_current_block.block != block) {
+		/* Blockwechsel, belegten Bereich und Map-2-Sim aktualisieren */
+		if (map_current_block.updated == True) {
+			swap_out(map_current_block.block, map_current_block.x, map_current_block.y, map_current_block.data);
+			map_current_block.updated = False;
+		}
+		map_current_block.block = block;
+		map_current_block.x = x & ~((MAP_SECTION_POINTS * 2) - 1); // 32 Einheiten in X-Richtung und
+		map_current_block.y = y & ~(MAP_SECTION_POINTS - 1); // 16 Einheiten in Y-Richtung pro Block
+		map_current_block.data = &map_mmap[((uint32_t) block + alignment_offset) * MAP_BLOCK_SIZE + sizeof(map_header_t)];
+	}
+
+	return (map_section_t*) &map_current_block.data[index * sizeof(map_section_t)];
+
+#elif MAP_CACHE_BLOCKS == 1
 	/* Ist der Block schon geladen? */
 	if (map_current_block.block == block) {
 #ifdef DEBUG_STORAGE
@@ -542,52 +1022,10 @@ static map_section_t* get_section(int16_t x, int16_t y) {
 
 	/* Wurde der Block im RAM veraendert? */
 	if (map_current_block.updated == True) {
-		/* Shrinking */
-		if (map_current_block.x < map_min_x) {
-			map_min_x = map_current_block.x;
-			min_max_updated = True;
-		} else if (map_current_block.x > map_max_x) {
-			map_max_x = map_current_block.x + ((MAP_SECTION_POINTS * 2) - 1);
-			min_max_updated = True;
-		}
-		if (map_current_block.y < map_min_y) {
-			map_min_y = map_current_block.y;
-			min_max_updated = True;
-		} else if (map_current_block.y > map_max_y) {
-			map_max_y = map_current_block.y + (MAP_SECTION_POINTS - 1);
-			min_max_updated = True;
-		}
-
-		/* Dann erstmal sichern */
-#ifdef DEBUG_MAP_TIMES
-		LOG_INFO("writing block 0x%04x%04x", (uint16_t) (mmc_block >> 16), (uint16_t) mmc_block);
-		uint16_t start_ticks = TIMER_GET_TICKCOUNT_16;
-#endif
-		if (sdfat_seek(map_file_desc, (int32_t) ((map_current_block.block + alignment_offset) * MAP_BLOCK_SIZE) + sizeof(map_header_t), SEEK_SET)) {
-			LOG_DEBUG("map::get_section(): sdfat_seek(0x%x) failed", map_current_block.block + alignment_offset);
-			map_current_block.updated = False;
-			return NULL;
-		}
-		if (sdfat_write(map_file_desc, map_buffer, MAP_BLOCK_SIZE) != MAP_BLOCK_SIZE) {
-			LOG_DEBUG("map::get_section(): sdfat_write(0x%x) failed", map_current_block.block + alignment_offset);
+		if (swap_out(map_current_block.block, map_current_block.x, map_current_block.y, map_buffer)) {
 			map_current_block.updated = False;
 			return NULL;
 		}
-
-#ifdef MAP_2_SIM_AVAILABLE
-		map_2_sim_data.pos.x = world_to_map(x_pos);
-		map_2_sim_data.pos.y = world_to_map(y_pos);
-		map_2_sim_data.heading = heading_int;
-#ifdef MEASURE_POSITION_ERRORS_AVAILABLE
-		map_2_sim_data.error = pos_error_radius / (1000 / MAP_RESOLUTION) + (BOT_DIAMETER / 2 / (1000 / MAP_RESOLUTION));
-#endif
-		fifo_put_data(&map_2_sim_fifo, &map_current_block.block, sizeof(map_current_block.block));
-#endif // MAP_2_SIM_AVAILABLE
-
-#ifdef DEBUG_MAP_TIMES
-		uint16_t end_ticks = TIMER_GET_TICKCOUNT_16;
-		LOG_INFO("swapout took %u ms", (end_ticks - start_ticks) * 176 / 1000);
-#endif
 	}
 
 	/* Statusvariablen anpassen */
@@ -598,15 +1036,10 @@ static map_section_t* get_section(int16_t x, int16_t y) {
 
 	/* Lade den neuen Block */
 #ifdef DEBUG_MAP_TIMES
-	LOG_INFO("reading block 0x%04x%04x", (uint16_t)(mmc_block >> 16), (uint16_t) mmc_block);
+	LOG_INFO("reading block 0x%04x", block);
 	uint16_t start_ticks = TIMER_GET_TICKCOUNT_16;
 #endif
-	if (sdfat_seek(map_file_desc, (int32_t) ((block + alignment_offset) * MAP_BLOCK_SIZE) + sizeof(map_header_t), SEEK_SET)) {
-		LOG_DEBUG("map::get_section(): sdfat_seek(0x%x) failed", block + alignment_offset);
-		return NULL;
-	}
-	if (sdfat_read(map_file_desc, map_buffer, MAP_BLOCK_SIZE) != MAP_BLOCK_SIZE) {
-		LOG_DEBUG("map::get_section(): sdfat_read(0x%x) failed", block + alignment_offset);
+	if (read_block(block, map_buffer)) {
 		return NULL;
 	}
 #ifdef DEBUG_MAP_TIMES
@@ -615,30 +1048,374 @@ static map_section_t* get_section(int16_t x, int16_t y) {
 #endif
 
 	return map[index];
+
+#else // MAP_CACHE_BLOCKS > 1
+	map_cache_block_t* p_entry = map_current_block;
+	/* Ist der Block der zuletzt benutzte? */
+	if (p_entry->block != block) {
+		/* Block im Cache suchen */
+		uint8_t i;
+		for (i = 0; i < MAP_CACHE_BLOCKS; ++i) {
+			if (map_cache_blocks[i].block == block) {
+				break;
+			}
+		}
+
+		if (i < MAP_CACHE_BLOCKS) {
+			p_entry = &map_cache_blocks[i];
+			++map_cache_stat.hits;
+		} else {
+			/* Block ist nicht im Cache, Opfer per CLOCK-Verfahren auswaehlen */
+#ifdef DEBUG_STORAGE
+			LOG_DEBUG("ist nicht im Cache");
+#endif
+			++map_cache_stat.misses;
+			for (;;) {
+				p_entry = &map_cache_blocks[map_cache_hand];
+				if (++map_cache_hand == MAP_CACHE_BLOCKS) {
+					map_cache_hand = 0;
+				}
+				if (p_entry->referenced == False) {
+					break;
+				}
+				p_entry->referenced = False; // zweite Chance
+			}
+
+			/* Wurde der Block im RAM veraendert? */
+			if (p_entry->updated == True) {
+				p_entry->updated = False;
+				if (swap_out(p_entry->block, p_entry->x, p_entry->y, p_entry->data)) {
+					p_entry->block = 0xffff;
+					return NULL;
+				}
+			}
+
+			/* Lade den neuen Block */
+			p_entry->block = block;
+			p_entry->x = x & ~((MAP_SECTION_POINTS * 2) - 1); // 32 Einheiten in X-Richtung und
+			p_entry->y = y & ~(MAP_SECTION_POINTS - 1); // 16 Einheiten in Y-Richtung pro Block
+			if (read_block(block, p_entry->data)) {
+				p_entry->block = 0xffff;
+				return NULL;
+			}
+		}
+		map_current_block = p_entry;
+	} else {
+		++map_cache_stat.hits;
+	}
+	p_entry->referenced = True;
+
+	return (map_section_t*) &p_entry->data[index * sizeof(map_section_t)];
+#endif // MAP_CACHE_BLOCKS
 }
 
 /**
- * Prueft, ob die Karte zurzeit gesperrt ist.
- * \return	1, falls Karte gesperrt, 0 sonst
+ * Liefert einen Zeiger auf die Section, in der der Punkt liegt, fuer einen lesenden Zugriff.
+ * Mit MAP_USE_MMAP bleibt dabei der aktuelle Block unveraendert, so dass mehrere Abfragen parallel laufen koennen.
+ * \param x	X-Ordinate der Karte (nicht der Welt!!!)
+ * \param y	Y-Ordinate der Karte (nicht der Welt!!!)
+ * \return	Zeiger auf die Section
  */
-uint8_t map_locked(void) {
-	return lock_signal.value;
+static inline map_section_t* get_section_read(int16_t x, int16_t y) {
+#ifdef MAP_USE_MMAP
+	const uint16_t block = get_block(x, y);
+	if (block == 0xffff) {
+		return NULL;
+	}
+	const uint8_t index = (uint8_t) ((x / MAP_SECTION_POINTS) & 0x1);
+	return (map_section_t*) &map_mmap[((uint32_t) block + alignment_offset) * MAP_BLOCK_SIZE + sizeof(map_header_t) + index * sizeof(map_section_t)];
+#else
+	return get_section(x, y);
+#endif // MAP_USE_MMAP
 }
 
 /**
- * Zugriff auf ein Feld der Karte. Kann lesend oder schreibend sein.
- * \param x		X-Ordinate der Karte
- * \param y		Y-Ordinate der Karte
- * \param value	Neuer Wert des Feldes (> 0 heisst frei, <0 heisst belegt)
- * \param set	0 zum Lesen, 1 zum Schreiben
- * \return		Wert, der jetzt an (x|y) steht
+ * Liefert den naechsten freien Eintrag des Map-Caches. Es darf nur einen Thread geben, der Eintraege erzeugt.
+ * \return	Zeiger auf den Eintrag oder NULL, falls der Cache voll ist
  */
-static int8_t access_field(int16_t x, int16_t y, int8_t value, uint8_t set) {
-	// Suche die Section heraus
-	map_section_t* p_section = get_section(x, y);
-	if (! p_section) {
-		LOG_DEBUG("map::access_field(%d,%d,%d,%u): get_section failed", x, y, value, set);
-		return 0;
+map_cache_t* map_update_get_entry(void) {
+#ifdef MAP_UPDATE_BATCH
+	const uint16_t head = map_update_head;
+	if ((uint16_t) (head - __atomic_load_n(&map_update_tail, __ATOMIC_ACQUIRE)) >= MAP_UPDATE_CACHE_SIZE) {
+		return NULL;
+	}
+	return &map_update_cache[head & (MAP_UPDATE_CACHE_SIZE - 1)];
+#else
+	/* ein Eintrag bleibt frei, denn den aeltesten bearbeitet der Update-Thread evtl. noch */
+	if (map_update_fifo.count >= map_update_fifo.size - 1) {
+		return NULL;
+	}
+	uint8_t index = (uint8_t) (map_update_index + 1);
+	if (index == MAP_UPDATE_CACHE_SIZE) {
+		index = 0;
+	}
+	return &map_update_cache[index];
+#endif // MAP_UPDATE_BATCH
+}
+
+/**
+ * Uebergibt den zuletzt per map_update_get_entry() geholten Eintrag an den Update-Thread
+ */
+void map_update_put_entry(void) {
+#ifdef MAP_UPDATE_BATCH
+	__atomic_store_n(&map_update_head, (uint16_t) (map_update_head + 1), __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&map_update_waiting, __ATOMIC_SEQ_CST)) {
+		/* Update-Thread aufwecken */
+		os_signal_unlock(&map_update_signal);
+	}
+#else
+	if (++map_update_index == MAP_UPDATE_CACHE_SIZE) {
+		map_update_index = 0;
+	}
+	_inline_fifo_put(&map_update_fifo, map_update_index, False);
+#endif // MAP_UPDATE_BATCH
+}
+
+/**
+ * Liefert die Anzahl der freien Eintraege des Map-Caches
+ * \return	Anzahl freier Eintraege
+ */
+uint16_t map_update_free(void) {
+	return (uint16_t) (MAP_UPDATE_CACHE_SIZE - map_update_pending());
+}
+
+/**
+ * Liefert die Anzahl der Eintraege des Map-Caches, die noch nicht in die Karte eingetragen wurden
+ * \return	Anzahl wartender Eintraege
+ */
+uint16_t map_update_pending(void) {
+#ifdef MAP_UPDATE_BATCH
+	return (uint16_t) (__atomic_load_n(&map_update_head, __ATOMIC_ACQUIRE) - __atomic_load_n(&map_update_tail, __ATOMIC_ACQUIRE));
+#else
+	return map_update_fifo.count;
+#endif
+}
+
+#ifdef MAP_UPDATE_BATCH
+/**
+ * Wartet, bis der Map-Cache Eintraege enthaelt
+ * \return	Index hinter dem neuesten Eintrag (head)
+ */
+static uint16_t map_update_wait(void) {
+	uint16_t head = __atomic_load_n(&map_update_head, __ATOMIC_ACQUIRE);
+	while (head == map_update_tail) {
+		os_signal_lock(&map_update_signal);
+		__atomic_store_n(&map_update_waiting, True, __ATOMIC_SEQ_CST);
+		/* erneut pruefen, sonst koennte ein Aufwecken zwischen Pruefung und Warten verloren gehen */
+		head = __atomic_load_n(&map_update_head, __ATOMIC_SEQ_CST);
+		if (head == map_update_tail) {
+			os_signal_set(&map_update_signal);
+			os_signal_release(&map_update_signal);
+			head = __atomic_load_n(&map_update_head, __ATOMIC_ACQUIRE);
+		}
+		__atomic_store_n(&map_update_waiting, False, __ATOMIC_SEQ_CST);
+	}
+	return head;
+}
+#endif // MAP_UPDATE_BATCH
+
+/**
+ * Prueft, ob die Karte zurzeit gesperrt ist.
+ * \return	1, falls Karte gesperrt, 0 sonst
+ */
+uint8_t map_locked(void) {
+	return lock_signal.value;
+}
+
+/**
+ * Markiert den zuletzt per get_section() geholten Block als veraendert
+ */
+static inline void current_block_updated(void) {
+#if MAP_CACHE_BLOCKS == 1 || defined MAP_USE_MMAP
+	map_current_block.updated = True;
+#else
+	map_current_block->updated = True;
+#endif
+}
+
+#ifdef MAP_SECTION_STATS
+/**
+ * Liefert die Kennzahlen der Section, in der ein Feld liegt
+ * \param x	X-Ordinate der Karte, muss innerhalb der Karte liegen
+ * \param y	Y-Ordinate der Karte, muss innerhalb der Karte liegen
+ * \return	Zeiger auf die Kennzahlen
+ */
+static inline map_section_stat_t* get_section_stat(int16_t x, int16_t y) {
+	return &map_stat[(uint16_t) y / MAP_SECTION_POINTS * MAP_SECTIONS + (uint16_t) x / MAP_SECTION_POINTS];
+}
+
+/**
+ * Berechnet die Kennzahlen einer Section aus ihren Feldern neu
+ * \param index	Index der Section in map_stat
+ * \return		0 falls alles OK
+ */
+static uint8_t stat_compute(uint16_t index) {
+	map_section_stat_t* p_stat = &map_stat[index];
+	p_stat->stale = False;
+	const int16_t x = (int16_t) (index % MAP_SECTIONS * MAP_SECTION_POINTS);
+	const int16_t y = (int16_t) (index / MAP_SECTIONS * MAP_SECTION_POINTS);
+	const map_section_t* p_section = get_section(x, y);
+	if (! p_section) {
+		/* Grenzen so weit wie moeglich, damit keine Abfrage die Felder ueberspringt */
+		p_stat->min = -128;
+		p_stat->max = 127;
+		return 1;
+	}
+
+	const int8_t* p_data = &p_section->section[0][0];
+	int16_t sum = 0;
+	uint16_t obstacle = 0, driven = 0;
+	int8_t min = 127, max = -128;
+	uint16_t i;
+	for (i = 0; i < MAP_SECTION_POINTS * MAP_SECTION_POINTS; ++i) {
+		const int8_t value = p_data[i];
+		sum += value;
+		obstacle += value < MAP_OBSTACLE_THRESHOLD;
+		driven += value >= MAP_DRIVEN_THRESHOLD;
+		if (value < min) {
+			min = value;
+		}
+		if (value > max) {
+			max = value;
+		}
+	}
+	p_stat->sum = sum;
+	p_stat->obstacle = obstacle;
+	p_stat->driven = driven;
+	p_stat->min = min;
+	p_stat->max = max;
+	return 0;
+}
+
+/**
+ * Berechnet die Kennzahlen aller Sections neu, z.B. nachdem die Map-Datei ersetzt wurde
+ */
+static void stats_rebuild(void) {
+	uint16_t i;
+	for (i = 0; i < MAP_SECTIONS * MAP_SECTIONS; ++i) {
+		if (stat_compute(i)) {
+			LOG_DEBUG("map::stats_rebuild(): stat_compute(%u) failed", i);
+		}
+	}
+	map_stat_stale_count = 0;
+}
+
+/**
+ * Berechnet Min / Max aller als veraltet vermerkten Sections neu
+ */
+static void stats_refresh(void) {
+	if (map_stat_stale_count > MAP_STAT_STALE_SIZE) {
+		/* Liste uebergelaufen, also alle Sections pruefen */
+		uint16_t i;
+		for (i = 0; i < MAP_SECTIONS * MAP_SECTIONS; ++i) {
+			if (map_stat[i].stale) {
+				stat_compute(i);
+			}
+		}
+	} else {
+		uint16_t i;
+		for (i = 0; i < map_stat_stale_count; ++i) {
+			stat_compute(map_stat_stale[i]);
+		}
+	}
+	map_stat_stale_count = 0;
+}
+
+/**
+ * Fuehrt die Kennzahlen einer Section nach dem Schreiben eines Feldes nach
+ * \param *p_stat	Kennzahlen der Section des Feldes
+ * \param old		bisheriger Feldwert
+ * \param value	neuer Feldwert
+ */
+static inline void stat_update(map_section_stat_t* p_stat, int8_t old, int8_t value) {
+	if (value == old) {
+		return;
+	}
+	p_stat->sum += value - old;
+	p_stat->obstacle += (uint16_t) ((value < MAP_OBSTACLE_THRESHOLD) - (old < MAP_OBSTACLE_THRESHOLD));
+	p_stat->driven += (uint16_t) ((value >= MAP_DRIVEN_THRESHOLD) - (old >= MAP_DRIVEN_THRESHOLD));
+
+	uint8_t shrink = False;
+	if (value < p_stat->min) {
+		p_stat->min = value;
+	} else if (old == p_stat->min) {
+		shrink = True;
+	}
+	if (value > p_stat->max) {
+		p_stat->max = value;
+	} else if (old == p_stat->max) {
+		shrink = True;
+	}
+
+	if (shrink && ! p_stat->stale) {
+		/* Min / Max koennten jetzt zu weit sein */
+		p_stat->stale = True;
+		if (map_stat_stale_count < MAP_STAT_STALE_SIZE) {
+			map_stat_stale[map_stat_stale_count] = (uint16_t) (p_stat - map_stat);
+		}
+		if (map_stat_stale_count <= MAP_STAT_STALE_SIZE) {
+			++map_stat_stale_count;
+		}
+	}
+}
+
+/** Ergebnis von stat_classify() */
+typedef enum {
+	STAT_MIXED,		/**< Felder muessen einzeln geprueft werden */
+	STAT_ALL_IN,	/**< alle Felder liegen im Wertebereich */
+	STAT_ALL_OUT	/**< kein Feld liegt im Wertebereich */
+} PACKED stat_class_t;
+
+/**
+ * Prueft anhand der Kennzahlen einer Section, ob ihre Felder in einem Wertebereich liegen
+ * \param *p_stat	Kennzahlen der Section
+ * \param min_val	minimaler Feldwert
+ * \param max_val	maximaler Feldwert
+ * \return			STAT_ALL_IN, STAT_ALL_OUT oder STAT_MIXED, falls das nicht fuer alle Felder gleich ist
+ */
+static inline stat_class_t stat_classify(const map_section_stat_t* p_stat, int8_t min_val, int8_t max_val) {
+	if (p_stat->min >= min_val && p_stat->max <= max_val) {
+		return STAT_ALL_IN;
+	}
+	if (p_stat->max < min_val || p_stat->min > max_val) {
+		return STAT_ALL_OUT;
+	}
+	if (max_val == 127) {
+		/* Schwellwert-Abfragen lassen sich auch mit veralteten Grenzen ueber die Anzahlen beantworten */
+		if (min_val == MAP_OBSTACLE_THRESHOLD) {
+			if (p_stat->obstacle == 0) {
+				return STAT_ALL_IN;
+			}
+			if (p_stat->obstacle == MAP_SECTION_POINTS * MAP_SECTION_POINTS) {
+				return STAT_ALL_OUT;
+			}
+		} else if (min_val == MAP_DRIVEN_THRESHOLD) {
+			if (p_stat->driven == MAP_SECTION_POINTS * MAP_SECTION_POINTS) {
+				return STAT_ALL_IN;
+			}
+			if (p_stat->driven == 0) {
+				return STAT_ALL_OUT;
+			}
+		}
+	}
+	return STAT_MIXED;
+}
+#endif // MAP_SECTION_STATS
+
+/**
+ * Zugriff auf ein Feld der Karte. Kann lesend oder schreibend sein.
+ * \param x		X-Ordinate der Karte
+ * \param y		Y-Ordinate der Karte
+ * \param value	Neuer Wert des Feldes (> 0 heisst frei, <0 heisst belegt)
+ * \param set	0 zum Lesen, 1 zum Schreiben
+ * \return		Wert, der jetzt an (x|y) steht
+ */
+static int8_t access_field(int16_t x, int16_t y, int8_t value, uint8_t set) {
+	// Suche die Section heraus
+	map_section_t* p_section = set ? get_section(x, y) : get_section_read(x, y);
+	if (! p_section) {
+		LOG_DEBUG("map::access_field(%d,%d,%d,%u): get_section failed", x, y, value, set);
+		return 0;
 	}
 
 	// Berechne den Index innerhalb der Section
@@ -648,12 +1425,175 @@ static int8_t access_field(int16_t x, int16_t y, int8_t value, uint8_t set) {
 	int8_t* data = &p_section->section[index_x][index_y];
 
 	if (set) {
+#ifdef MAP_SECTION_STATS
+		stat_update(get_section_stat(x, y), *data, value);
+#endif
 		*data = value;
-		map_current_block.updated = True;
+		current_block_updated();
 	}
 	return *data;
 }
 
+/**
+ * Addiert einen Betrag saturiert zu einem Feldwert
+ * \param old		bisheriger Feldwert
+ * \param value	Betrag (>0 heisst freier, <0 heisst belegter)
+ * \return		neuer Feldwert in [-127; 127]
+ */
+static inline int8_t add_saturated(int8_t old, int8_t value) {
+	int8_t new_value = (int8_t) (old + value);
+	if (value > 0) {
+		if (new_value < old) {
+			new_value = 127;
+		}
+	} else {
+		if (new_value > old || new_value == -128) {
+			new_value = -127;
+		}
+	}
+	return new_value;
+}
+
+/** Operationen fuer disc_apply() */
+typedef enum {
+	DISC_AVERAGE,	/**< Durchschnitt der Feldwerte bestimmen */
+	DISC_ADD,		/**< Betrag saturiert addieren, Loecher (-128) bleiben unveraendert */
+	DISC_MIN,		/**< Wert eintragen, falls der Feldwert groesser ist */
+	DISC_OCCUPIED	/**< als belegt markieren, der Betrag nimmt mit dem Abstand zum Zentrum ab */
+} PACKED disc_op_t;
+
+/**
+ * Wendet eine Operation auf alle Felder eines Kreises (dX^2 + dY^2 <= radius^2) an.
+ * Der Kreis wird in Section-Hoehe geteilt und darin spaltenweise (X fest) abgearbeitet. Die Felder einer
+ * Spalte liegen innerhalb einer Section hintereinander im Speicher, daher gibt es nur einen get_section()-Aufruf
+ * pro Spalte und Section. Die Bloecke werden in derselben Reihenfolge wie bei einer Section-weisen
+ * Bearbeitung benutzt, es wird also nicht zwischen zwei Bloecken hin- und hergewechselt.
+ * \param x			X-Ordinate des Mittelpunkts (Karte)
+ * \param y			Y-Ordinate des Mittelpunkts (Karte)
+ * \param radius	Radius in Kartenpunkten
+ * \param op		Operation
+ * \param value		DISC_ADD: Betrag; DISC_MIN: Wert; DISC_OCCUPIED: Positionswahrscheinlichkeit [0; 255]
+ * \return			DISC_AVERAGE: Durchschnitt der Feldwerte, sonst 0
+ */
+static int8_t disc_apply(int16_t x, int16_t y, int8_t radius, disc_op_t op, int16_t value) {
+	int32_t sum = 0;
+	int16_t count = 0;
+	const int16_t r_2 = muls8(radius, radius);
+	int16_t band_min, band_max;
+	for (band_min = y - radius; band_min <= y + radius; band_min = band_max + 1) {
+		/* Abschnitt des Kreises innerhalb einer Section-Zeile */
+		band_max = band_min | (MAP_SECTION_POINTS - 1);
+		if (band_max > y + radius) {
+			band_max = y + radius;
+		}
+
+		int8_t dX, dY = 0; // dY: halbe Laenge der aktuellen Spalte
+		for (dX = (int8_t) -radius; dX <= radius; ++dX) {
+			/* Spaltenlaenge an die neue Spalte anpassen */
+			const int16_t dX_2 = muls8(dX, dX);
+			while (dY < radius && dX_2 + muls8((int8_t) (dY + 1), (int8_t) (dY + 1)) <= r_2) {
+				++dY;
+			}
+			while (dX_2 + muls8(dY, dY) > r_2) {
+				--dY;
+			}
+
+			int16_t Y = y - dY;
+			if (Y < band_min) {
+				Y = band_min;
+			}
+			int16_t Y_end = y + dY;
+			if (Y_end > band_max) {
+				Y_end = band_max;
+			}
+			if (Y > Y_end) {
+				continue;
+			}
+			const uint8_t n = (uint8_t) (Y_end - Y + 1);
+
+			const int16_t X = x + dX;
+			map_section_t* p_section = op == DISC_AVERAGE ? get_section_read(X, Y) : get_section(X, Y);
+			if (! p_section) {
+				LOG_DEBUG("map::disc_apply(%d,%d,%d,%u): get_section failed", X, Y, radius, op);
+				count += n; // Felder ausserhalb der Karte zaehlen als 0
+				continue;
+			}
+
+			int8_t* p_data = &p_section->section[(uint16_t) X % MAP_SECTION_POINTS][(uint16_t) Y % MAP_SECTION_POINTS];
+			int8_t* const p_end = p_data + n;
+#ifdef MAP_SECTION_STATS
+			map_section_stat_t* const p_stat = get_section_stat(X, Y);
+#endif
+			uint8_t changed = False;
+			switch (op) {
+			case DISC_AVERAGE:
+#ifdef MAP_SECTION_STATS
+				if (p_stat->min == p_stat->max) {
+					/* Section einheitlich belegt */
+					sum += n * p_stat->min;
+					count += n;
+					break;
+				}
+#endif
+				for (; p_data < p_end; ++p_data) {
+					sum += *p_data;
+				}
+				count += n;
+				break;
+
+			case DISC_ADD:
+				for (; p_data < p_end; ++p_data) {
+					if (*p_data != -128) { // Loecher nicht aktualisieren
+						const int8_t new_value = add_saturated(*p_data, (int8_t) value);
+#ifdef MAP_SECTION_STATS
+						stat_update(p_stat, *p_data, new_value);
+#endif
+						*p_data = new_value;
+						changed = True;
+					}
+				}
+				break;
+
+			case DISC_MIN:
+				for (; p_data < p_end; ++p_data) {
+					if (*p_data > (int8_t) value) {
+#ifdef MAP_SECTION_STATS
+						stat_update(p_stat, *p_data, (int8_t) value);
+#endif
+						*p_data = (int8_t) value;
+						changed = True;
+					}
+				}
+				break;
+
+			case DISC_OCCUPIED: {
+				int8_t dY_cell = (int8_t) (Y - y);
+				for (; p_data < p_end; ++p_data, ++dY_cell) {
+					int8_t h = (int8_t) ((dX_2 + muls8(dY_cell, dY_cell)) / 2);
+					if (h < MAP_STEP_OCCUPIED) {
+						h = MAP_STEP_OCCUPIED;
+					}
+					if (*p_data != -128) {
+						const int8_t new_value = add_saturated(*p_data, (int8_t) ((((- MAP_STEP_OCCUPIED * MAP_STEP_OCCUPIED) / h) + 1) * (uint8_t) value / 255 - 1));
+#ifdef MAP_SECTION_STATS
+						stat_update(p_stat, *p_data, new_value);
+#endif
+						*p_data = new_value;
+						changed = True;
+					}
+				}
+				break;
+			}
+			}
+			if (changed) {
+				current_block_updated();
+			}
+		}
+	}
+
+	return (int8_t) (count > 0 ? sum / count : 0);
+}
+
 /**
  * liefert den Durschnittswert um einen Punkt der Karte herum
  * \param x 		x-Ordinate der Karte
@@ -662,6 +1602,9 @@ static int8_t access_field(int16_t x, int16_t y, int8_t value, uint8_t set) {
  * \return 			Wert des Durchschnitts um das Feld (>0 heisst frei, <0 heisst belegt)
  */
 static int8_t get_average_fields(int16_t x, int16_t y, int8_t radius) {
+#ifndef DEBUG_MAP_GET_AVERAGE_VERBOSE
+	int8_t result = disc_apply(x, y, radius, DISC_AVERAGE, 0);
+#else
 	int32_t avg = 0;
 	int8_t dX, dY;
 	int16_t count = 0;
@@ -674,19 +1617,20 @@ static int8_t get_average_fields(int16_t x, int16_t y, int8_t radius) {
 				int8_t tmp = access_field(x + dX, y + dY, 0, 0);
 				avg += tmp;
 				count++;
-#ifdef DEBUG_MAP_GET_AVERAGE_VERBOSE
 				uint8_t color = tmp < MAP_OBSTACLE_THRESHOLD ? 1 : 0;
 				position_t pos;
 				pos.x = x + dX;
 				pos.y = y + dY;
 				map_draw_line(pos, pos, color);
-#endif // DEBUG_MAP_GET_AVERAGE
 			}
 		}
 	}
 
 	int8_t result = (int8_t)(count > 0 ? avg / count : 0);
+#endif // DEBUG_MAP_GET_AVERAGE_VERBOSE
 #if defined DEBUG_MAP_GET_AVERAGE && !defined DEBUG_MAP_GET_AVERAGE_VERBOSE
+	const int16_t h = muls8(radius, radius);
+	int8_t dX, dY;
 	uint8_t color = result < MAP_OBSTACLE_THRESHOLD ? 1 : 0;
 	for (dX =- radius; dX <= radius; dX++) {
 		for (dY =- radius; dY <= radius; dY++) {
@@ -715,42 +1659,13 @@ int8_t map_get_average(int16_t x, int16_t y, int16_t radius) {
 	int16_t Y = world_to_map(y);
 	int8_t R = (int8_t) (radius / (1000 / MAP_RESOLUTION));
 
-	/* warten bis Karte frei ist */
-	map_flush_cache();
-
+	read_lock();
 	int8_t result = get_average_fields(X, Y, R);
+	read_unlock();
 
 	return result;
 }
 
-/**
- * Aendert den Wert eines Feldes um den angegebenen Betrag
- * \param x		x-Ordinate der Karte (nicht der Welt!!!)
- * \param y		y-Ordinate der Karte (nicht der Welt!!!)
- * \param value	Betrag um den das Feld veraendert wird (>0 heisst freier, <0 heisst belegter)
- */
-static void update_field(int16_t x, int16_t y, int8_t value) {
-	int8_t tmp = access_field(x, y, 0, 0);
-	if (tmp == -128) {
-		// Nicht aktualiseren, wenn es sich um ein Loch handelt
-		return;
-	}
-
-	int8_t new_value = (int8_t) (tmp + value);
-	/* Saturation */
-	if (value > 0) {
-		if (new_value < tmp) {
-			new_value = 127;
-		}
-	} else {
-		if (new_value > tmp || new_value == -128) {
-			new_value = -127;
-		}
-	}
-
-	access_field(x, y, new_value, 1);
-}
-
 /**
  * Aendert den Wert eines Kreises um den angegebenen Betrag
  * \param x			x-Ordinate der Karte (nicht der Welt!!!)
@@ -759,55 +1674,7 @@ static void update_field(int16_t x, int16_t y, int8_t value) {
  * \param value		Betrag um den das Feld veraendert wird (>0 heisst freier, <0 heisst belegter)
  */
 static void update_field_circle(int16_t x, int16_t y, int8_t radius, int8_t value) {
-	const int16_t square = muls8(radius, radius);
-
-	int16_t sec_x_max = (x + radius) / MAP_SECTION_POINTS;
-	int16_t sec_x_min = (x - radius) / MAP_SECTION_POINTS;
-	int16_t sec_y_max = (y + radius) / MAP_SECTION_POINTS;
-	int16_t sec_y_min = (y - radius) / MAP_SECTION_POINTS;
-//	LOG_DEBUG("Betroffene Sektionen X: %d-%d, Y:%d-%d", sec_x_min, sec_x_max, sec_y_min, sec_y_max);
-
-	int16_t sec_x, sec_y, X, Y, dX, dY;
-	int16_t starty, startx, stopx, stopy;
-	// Gehe ueber alle betroffenen Sektionen
-	for (sec_y = sec_y_min; sec_y <= sec_y_max; sec_y++) {
-		// Bereich weiter eingrenzen
-		if (sec_y * MAP_SECTION_POINTS > (y - radius)) {
-			starty = sec_y * MAP_SECTION_POINTS;
-		} else {
-			starty = y - radius;
-		}
-		if ((sec_y + 1) * MAP_SECTION_POINTS < (y + radius)) {
-			stopy = (sec_y + 1) * MAP_SECTION_POINTS;
-		} else {
-			stopy = y + radius;
-		}
-
-		for (sec_x = sec_x_min; sec_x <= sec_x_max; sec_x++) {
-			if (sec_x * MAP_SECTION_POINTS > (x - radius)) {
-				startx = sec_x * MAP_SECTION_POINTS;
-			} else {
-				startx = x - radius;
-			}
-			if ((sec_x + 1) * MAP_SECTION_POINTS < (x + radius)) {
-				stopx = (sec_x + 1) * MAP_SECTION_POINTS;
-			} else {
-				stopx = x + radius;
-			}
-
-			for (Y = starty; Y < stopy; Y++) {
-				int8_t tmp = (int8_t) (y - Y); // Distanz berechnen
-				dY = muls8(tmp, tmp); // Quadrat vorberechnen
-				for (X = startx; X < stopx; X++) {
-					tmp = (int8_t) (x - X); // Distanz berechnen
-					dX = muls8(tmp, tmp); // Quadrat vorberechnen
-					if (dX + dY <= square) { // wenn Punkt unter Bot
-						update_field(X, Y, value); // dann aktualisieren
-					}
-				}
-			}
-		}
-	}
+	disc_apply(x, y, radius, DISC_ADD, value);
 }
 
 /**
@@ -823,50 +1690,7 @@ static void update_occupied(int16_t x, int16_t y, uint8_t location_prob) {
 	(void) location_prob;
 	const uint8_t prob = 255;
 #endif
-	const int8_t r = MAP_RADIUS_FIELDS;
-	const int8_t r_2 = r * r;
-	int16_t X, Y;
-	int8_t dX = r;
-	for (X = x - r; X <= x + r; ++X, --dX) {
-		const int8_t dX_2 = (int8_t) (dX * dX);
-		int8_t dY = r;
-		for (Y = y - r; Y <= y + r; ++Y, --dY) {
-			int8_t h = (int8_t) (dY * dY + dX_2);
-			if (h <= r_2) {
-				h /= 2;
-				if (h < MAP_STEP_OCCUPIED) {
-					h = MAP_STEP_OCCUPIED;
-				}
-				update_field(X, Y, (int8_t) ((((- MAP_STEP_OCCUPIED * MAP_STEP_OCCUPIED) / h) + 1) * prob / 255 - 1));
-			}
-		}
-	}
-}
-
-/**
- * Map-Umfeldaktualisierung mit einem bestimmten Wert ab einer Position xy mit Radius r bei
- * \param x			Map-Koordinate
- * \param y			Map-Koordinate
- * \param radius	Radius des Umfeldes
- * \param value 	Mapwert; nur eingetragen wenn aktueller Mapwert groesser value ist
- */
-static void set_value_field_circle(int16_t x, int16_t y, int8_t radius, int8_t value) {
-	int8_t dX, dY;
-	int16_t h = muls8(radius, radius);
-	for (dX = (int8_t) -radius; dX <= radius; dX++) {
-		int16_t dX2 = muls8(dX, dX);
-		for (dY = (int8_t) -radius; dY <= radius; dY++) {
-			if (dX2 + muls8(dY, dY) <= h) {
-				// nur innerhalb des Umkreises
-				const int16_t x_tmp = x + dX;
-				const int16_t y_tmp = y + dY;
-				if (access_field(x_tmp, y_tmp, 0, 0) > value) {
-					// Mapwert hoeher Richtung frei
-					access_field (x_tmp, y_tmp, value, 1); // dann Wert eintragen
-				}
-			}
-		}
-	}
+	disc_apply(x, y, MAP_RADIUS_FIELDS, DISC_OCCUPIED, prob);
 }
 
 /**
@@ -877,85 +1701,110 @@ static void set_value_field_circle(int16_t x, int16_t y, int8_t radius, int8_t v
  * \param val	im Umkreis einzutragender Wert
  */
 static void set_value_occupied(int16_t x, int16_t y, int8_t val) {
-	int8_t r;
-	// in Map mit dem Radius um x/y eintragen
-	for (r = 1; r <= MAP_RADIUS_FIELDS; r++) {
-		set_value_field_circle(x, y, r, val);
-	}
+	// in Map mit dem Radius um x/y eintragen, wo der Mapwert hoeher (Richtung frei) ist
+	disc_apply(x, y, MAP_RADIUS_FIELDS, DISC_MIN, val);
 }
 
+/** Zustand eines Sensorstrahls, der nach dem Bresenham-Verfahren abgelaufen wird */
+typedef struct {
+	int16_t x;			/**< aktuelles Feld, X-Ordinate der Karte */
+	int16_t y;			/**< aktuelles Feld, Y-Ordinate der Karte */
+	int16_t lh;			/**< Fehlerterm */
+	int8_t s_x;			/**< Schrittrichtung in X-Richtung (+1 / -1) */
+	int8_t s_y;			/**< Schrittrichtung in Y-Richtung (+1 / -1) */
+	int8_t d_long;		/**< Laenge der Linie entlang der Hauptachse */
+	int8_t d_short;		/**< Laenge der Linie entlang der Nebenachse */
+	int8_t steps;		/**< Anzahl der noch zu bearbeitenden Felder */
+	uint8_t x_major;	/**< True, falls X die Hauptachse ist */
+} map_ray_t;
+
 /**
- * Aktualisiert die Karte mit den Daten eines Distanz-Sensors
+ * Initialisiert einen Sensorstrahl vom Sensor bis ein Feld vor dem Hindernis
+ * \param *p_ray	Strahl
  * \param x		X-Achse der Position des Sensors
- * \param y 	Y-Achse der Position des Sensors
- * \param h_sin sin(Blickrichtung)
+ * \param y		Y-Achse der Position des Sensors
+ * \param h_sin	sin(Blickrichtung)
  * \param h_cos	cos(Blickrichtung)
- * \param dist 	Sensorwert
- * \param location_prob Gibt an, wie sicher wir ueber die Position sind [0; 255]
+ * \param dist	Sensorwert
+ * \param *p_end	Kartenkoordinaten des Hindernisses / Ende des Frei-Strahls
  */
-static void update_sensor_distance(int16_t x, int16_t y, float h_sin, float h_cos, int16_t dist, uint8_t location_prob) {
-	// Ort des Sensors in Kartenkoordinaten
-	int16_t X = world_to_map(x);
-	int16_t Y = world_to_map(y);
-
-	int16_t d;
-	if (dist == SENS_IR_INFINITE) {
-		d = SENS_IR_MAX_DIST;
+static void ray_init(map_ray_t* p_ray, int16_t x, int16_t y, float h_sin, float h_cos, int16_t dist, position_t* p_end) {
+	const int16_t d = dist == SENS_IR_INFINITE ? SENS_IR_MAX_DIST : dist;
+
+	// Ort des Sensors und des Hindernisses in Kartenkoordinaten
+	p_ray->x = world_to_map(x);
+	p_ray->y = world_to_map(y);
+	p_end->x = world_to_map(x + (int16_t) (d * h_cos));
+	p_end->y = world_to_map(y + (int16_t) (d * h_sin));
+
+	p_ray->s_x = (int8_t) (p_end->x < p_ray->x ? -1 : 1);
+	p_ray->s_y = (int8_t) (p_end->y < p_ray->y ? -1 : 1);
+	const int8_t dX = (int8_t) abs(p_end->x - p_ray->x); // Laenge der Linie in X-Richtung
+	const int8_t dY = (int8_t) abs(p_end->y - p_ray->y); // Laenge der Linie in Y-Richtung
+
+	/* Hangle Dich an der laengeren Achse entlang und stoppe ein Feld vor dem Hindernis */
+	p_ray->x_major = dX >= dY;
+	if (p_ray->x_major) {
+		p_ray->d_long = dX;
+		p_ray->d_short = (int8_t) (dY > 0 ? dY - 1 : 0);
 	} else {
-		d = dist;
+		p_ray->d_long = dY;
+		p_ray->d_short = (int8_t) (dX > 0 ? dX - 1 : 0);
 	}
+	p_ray->lh = p_ray->d_long / 2;
+	p_ray->steps = p_ray->d_long;
+}
 
-	// liefert die Mapkoordinaten des Hindernisses / Ende des Frei-Strahls
-	int16_t PH_X = world_to_map(x + (int16_t) (d * h_cos));
-	int16_t PH_Y = world_to_map(y + (int16_t) (d * h_sin));
-
-	// Nun markiere alle Felder vor dem Hindernis als frei
-	int8_t i;
-
-	int16_t lX = X; // Beginne mit dem Feld, in dem der Sensor steht
-	int16_t lY = Y;
-
-	const int8_t sX = (int8_t) (PH_X < X ? -1 : 1);
-	int8_t dX = (int8_t) abs(PH_X - X); // Laenge der Linie in X-Richtung
-
-	const int8_t sY =  (int8_t) (PH_Y < Y ? -1 : 1);
-	int8_t dY = (int8_t) abs(PH_Y - Y); // Laenge der Linie in Y-Richtung
-
-#ifdef MEASURE_POSITION_ERRORS_AVAILABLE
-	const int8_t step_value = (int8_t) ((MAP_STEP_FREE_SENSOR - 1) * location_prob / 255 + 1);
-#else
-	const int8_t step_value = MAP_STEP_FREE_SENSOR;
+/**
+ * Markiert die Felder eines Sensorstrahls als freier, bis der Strahl die aktuelle Section verlaesst.
+ * Die Section wird dafuer nur einmal gesucht.
+ * \param *p_ray	Strahl, steht danach auf dem ersten Feld ausserhalb der Section (steps > 0) oder am Ende
+ * \param value	Betrag, um den die Felder veraendert werden
+ */
+static void ray_update_section(map_ray_t* p_ray, int8_t value) {
+	const int16_t sec_x = p_ray->x & ~(MAP_SECTION_POINTS - 1);
+	const int16_t sec_y = p_ray->y & ~(MAP_SECTION_POINTS - 1);
+	map_section_t* p_section = get_section(p_ray->x, p_ray->y);
+	if (! p_section) {
+		LOG_DEBUG("map::ray_update_section(%d,%d): get_section failed", p_ray->x, p_ray->y);
+	}
+#ifdef MAP_SECTION_STATS
+	map_section_stat_t* const p_stat = p_section ? get_section_stat(p_ray->x, p_ray->y) : NULL;
 #endif
 
-	if (dX >= dY) { // Hangle Dich an der laengeren Achse entlang
-		if (dY > 0) dY--; // stoppe ein Feld vor dem Hindernis
-		int8_t lh = dX / 2;
-		for (i = 0; i < dX; ++i) {
-			update_field(lX, lY, step_value);
-			lX += sX;
-			lh = (int8_t) (lh + dY);
-			if (lh >= dX) {
-				lh = (int8_t) (lh - dX);
-				lY += sY;
+	uint8_t changed = False;
+	do {
+		if (p_section) {
+			int8_t* p_data = &p_section->section[(uint16_t) p_ray->x % MAP_SECTION_POINTS][(uint16_t) p_ray->y % MAP_SECTION_POINTS];
+			if (*p_data != -128) { // Loecher nicht aktualisieren
+				const int8_t new_value = add_saturated(*p_data, value);
+#ifdef MAP_SECTION_STATS
+				stat_update(p_stat, *p_data, new_value);
+#endif
+				*p_data = new_value;
+				changed = True;
 			}
 		}
-	} else {
-		if (dX > 0) dX--; // stoppe ein Feld vor dem Hindernis
-		int8_t lh = dY / 2;
-		for (i = 0; i < dY; ++i) {
-			update_field(lX, lY, step_value);
-			lY += sY;
-			lh = (int8_t) (lh + dX);
-			if (lh >= dY) {
-				lh = (int8_t) (lh - dY);
-				lX += sX;
+
+		/* naechstes Feld */
+		p_ray->lh += p_ray->d_short;
+		if (p_ray->x_major) {
+			p_ray->x += p_ray->s_x;
+			if (p_ray->lh >= p_ray->d_long) {
+				p_ray->lh -= p_ray->d_long;
+				p_ray->y += p_ray->s_y;
+			}
+		} else {
+			p_ray->y += p_ray->s_y;
+			if (p_ray->lh >= p_ray->d_long) {
+				p_ray->lh -= p_ray->d_long;
+				p_ray->x += p_ray->s_x;
 			}
 		}
-	}
+	} while (--p_ray->steps > 0 && (p_ray->x & ~(MAP_SECTION_POINTS - 1)) == sec_x && (p_ray->y & ~(MAP_SECTION_POINTS - 1)) == sec_y);
 
-	/* Hindernis eintragen */
-	if (dist <= SENS_IR_MAX_DIST) {
-		update_occupied(PH_X, PH_Y, location_prob);
+	if (changed) {
+		current_block_updated();
 	}
 }
 
@@ -978,23 +1827,48 @@ static void update_distance(int16_t x, int16_t y, float sin_head, float cos_head
 	int16_t Pl_x = x - (int16_t)(DISTSENSOR_POS_SW * sin_head - DISTSENSOR_POS_FW * cos_head);
 	int16_t Pl_y = y + (int16_t)(DISTSENSOR_POS_SW * cos_head + DISTSENSOR_POS_FW * sin_head);
 
-	update_sensor_distance(Pl_x, Pl_y, sin_head, cos_head, distL, location_prob);
-	update_sensor_distance(Pr_x, Pr_y, sin_head, cos_head, distR, location_prob);
+	map_ray_t ray_l, ray_r;
+	position_t end_l, end_r;
+	ray_init(&ray_l, Pl_x, Pl_y, sin_head, cos_head, distL, &end_l);
+	ray_init(&ray_r, Pr_x, Pr_y, sin_head, cos_head, distR, &end_r);
+
+#ifdef MEASURE_POSITION_ERRORS_AVAILABLE
+	const int8_t step_value = (int8_t) ((MAP_STEP_FREE_SENSOR - 1) * location_prob / 255 + 1);
+#else
+	const int8_t step_value = MAP_STEP_FREE_SENSOR;
+#endif
+
+	/* Beide Strahlen verlaufen parallel durch dieselben Sections, also abwechselnd Section fuer Section bearbeiten */
+	while (ray_l.steps > 0 || ray_r.steps > 0) {
+		if (ray_l.steps > 0) {
+			ray_update_section(&ray_l, step_value);
+		}
+		if (ray_r.steps > 0) {
+			ray_update_section(&ray_r, step_value);
+		}
+	}
+
+	/* Hindernisse eintragen */
+	if (distL <= SENS_IR_MAX_DIST) {
+		update_occupied(end_l.x, end_l.y, location_prob);
+	}
+	if (distR <= SENS_IR_MAX_DIST) {
+		update_occupied(end_r.x, end_r.y, location_prob);
+	}
 }
 
 /**
  * Aktualisiert den Standkreis der internen Karte
  * \param x X-Achse der Position in Weltkoordinaten
  * \param y Y-Achse der Position in Weltkoordinaten
- * \param location_prob Gibt an, wie sicher wir ueber die Position sind [0; 255]
+ * \param value Betrag, um den die Felder freier werden, siehe location_value()
  */
-static void update_location(int16_t x, int16_t y, uint8_t location_prob) {
+static void update_location(int16_t x, int16_t y, int8_t value) {
 	int16_t x_map = world_to_map(x);
 	int16_t y_map = world_to_map(y);
 
 	// Aktualisiere die vom Bot selbst belegte Flaeche
-	update_field_circle(x_map, y_map, BOT_DIAMETER / 20 * MAP_RESOLUTION / 100,
-			(int8_t) ((MAP_STEP_FREE_LOCATION - 1) * location_prob / 255 + 1));
+	update_field_circle(x_map, y_map, BOT_DIAMETER / 20 * MAP_RESOLUTION / 100, value);
 }
 
 /**
@@ -1022,6 +1896,58 @@ static void update_border(int16_t x, int16_t y, float sin_head, float cos_head,
 	}
 }
 
+/**
+ * Zaehlt die Felder einer Zeile oder Spalte innerhalb einer Section, deren Werte zwischen min_val und max_val liegen.
+ * Legen die Kennzahlen der Section das Ergebnis schon fest, werden die Felder nicht gelesen.
+ * \param x			X-Ordinate des ersten Feldes (Karte)
+ * \param y			Y-Ordinate des ersten Feldes (Karte)
+ * \param n			Anzahl der Felder, alle muessen in derselben Section liegen
+ * \param along_x	True: die Felder liegen in X-Richtung hintereinander, False: in Y-Richtung
+ * \param min_val	minimaler Feldwert
+ * \param max_val	maximaler Feldwert
+ * \return			Anzahl der Felder im Wertebereich
+ */
+static uint8_t ratio_run(int16_t x, int16_t y, uint8_t n, uint8_t along_x, int8_t min_val, int8_t max_val) {
+	const map_section_t* p_section = get_section_read(x, y);
+	if (! p_section) {
+		LOG_DEBUG("map::ratio_run(%d,%d): get_section failed", x, y);
+		return (uint8_t) (0 >= min_val && 0 <= max_val ? n : 0); // Felder ausserhalb der Karte zaehlen als 0
+	}
+
+#if defined MAP_SECTION_STATS && ! defined DEBUG_GET_RATIO_VERBOSE
+	switch (stat_classify(get_section_stat(x, y), min_val, max_val)) {
+	case STAT_ALL_IN:
+		return n;
+	case STAT_ALL_OUT:
+		return 0;
+	default:
+		break;
+	}
+#endif // MAP_SECTION_STATS && ! DEBUG_GET_RATIO_VERBOSE
+
+	const int8_t* p_data = &p_section->section[(uint16_t) x % MAP_SECTION_POINTS][(uint16_t) y % MAP_SECTION_POINTS];
+	const uint8_t stride = (uint8_t) (along_x ? MAP_SECTION_POINTS : 1);
+	uint8_t count = 0;
+	uint8_t i;
+	for (i = 0; i < n; ++i, p_data += stride) {
+		if (*p_data >= min_val && *p_data <= max_val) {
+			count++;
+#ifdef DEBUG_GET_RATIO_VERBOSE
+			position_t tmp;
+			tmp.x = along_x ? x + i : x;
+			tmp.y = along_x ? y : y + i;
+			map_draw_line(tmp, tmp, 0);
+		} else {
+			position_t tmp;
+			tmp.x = along_x ? x + i : x;
+			tmp.y = along_x ? y : y + i;
+			map_draw_line(tmp, tmp, 1);
+#endif // DEBUG_GET_RATIO_VERBOSE
+		}
+	}
+	return count;
+}
+
 /**
  * Berechnet das Verhaeltnis der Felder einer Region R die ausschliesslich mit Werten zwischen
  * min und max belegt sind und allen Feldern von R.
@@ -1054,6 +1980,7 @@ static uint8_t get_ratio(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t
 	int16_t dY = abs(y2 - y1);	// Laenge der Linie in Y-Richtung
 
 	int16_t w = 0;
+	uint8_t n;
 	uint8_t corr = (uint8_t) (width & 1); // LSB von width, falls width ungerade ist, muss die Schleife eins weiter laufen
 	width /= 2;
 	if (width == 0) {
@@ -1064,26 +1991,16 @@ static uint8_t get_ratio(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t
 	command_write(CMD_MAP, SUB_MAP_CLEAR_LINES, 4, 0, 0);
 #endif // DEBUG_GET_RATIO_VERBOSE
 
-	/* Hangle Dich an der laengeren Achse entlang */
+	/* Hangle Dich an der laengeren Achse entlang, quer dazu wird Section fuer Section gezaehlt */
 	if (dX >= dY) {
 		int16_t lh = dX / 2;
 		for (i = 0; i < dX; i++) {
-			for (w = -width; w < width + corr; w++) {
-				int8_t field = access_field(lX + i * sX, lY + w, 0, 0);
-				if (field >= min_val && field <= max_val) {
-					count++;
-#ifdef DEBUG_GET_RATIO_VERBOSE
-					position_t tmp;
-					tmp.x = lX + i * sX;
-					tmp.y = lY + w;
-					map_draw_line(tmp, tmp, 0);
-				} else {
-					position_t tmp;
-					tmp.x = lX + i * sX;
-					tmp.y = lY + w;
-					map_draw_line(tmp, tmp, 1);
-#endif // DEBUG_GET_RATIO_VERBOSE
+			for (w = -width; w < width + corr; w += n) {
+				n = (uint8_t) (MAP_SECTION_POINTS - (uint16_t) (lY + w) % MAP_SECTION_POINTS);
+				if (n > width + corr - w) {
+					n = (uint8_t) (width + corr - w);
 				}
+				count += ratio_run(lX + i * sX, lY + w, n, False, min_val, max_val);
 			}
 
 			lh += dY;
@@ -1095,22 +2012,12 @@ static uint8_t get_ratio(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t
 	} else {
 		int16_t lh = dY / 2;
 		for (i = 0; i < dY; i++) {
-			for (w = -width; w < width + corr; w++) {
-				int8_t field = access_field(lX + w, lY + i * sY, 0, 0);
-				if (field >= min_val && field <= max_val) {
-					count++;
-#ifdef DEBUG_GET_RATIO_VERBOSE
-					position_t tmp;
-					tmp.x = lX + w;
-					tmp.y = lY + i * sY;
-					map_draw_line(tmp, tmp, 0);
-				} else {
-					position_t tmp;
-					tmp.x = lX + w;
-					tmp.y = lY + i * sY;
-					map_draw_line(tmp, tmp, 1);
-#endif // DEBUG_GET_RATIO_VERBOSE
+			for (w = -width; w < width + corr; w += n) {
+				n = (uint8_t) (MAP_SECTION_POINTS - (uint16_t) (lX + w) % MAP_SECTION_POINTS);
+				if (n > width + corr - w) {
+					n = (uint8_t) (width + corr - w);
 				}
+				count += ratio_run(lX + w, lY + i * sY, n, True, min_val, max_val);
 			}
 
 			lh += dX;
@@ -1164,11 +2071,10 @@ static uint8_t get_ratio(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t
  * 					MAP_RATIO_FULL	-> alle Felder liegen im gewuenschten Bereich
  */
 uint8_t map_get_ratio(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t width, int8_t min_val, int8_t max_val) {
-	/* warten bis Karte frei ist */
-	map_flush_cache();
-
 	/* Ergebnis berechnen */
+	read_lock();
 	uint8_t result = get_ratio(world_to_map(x1), world_to_map(y1), world_to_map(x2), world_to_map(y2), width / (1000 / MAP_RESOLUTION), min_val, max_val);
+	read_unlock();
 
 	return result;
 }
@@ -1277,6 +2183,110 @@ void map_draw_circle(position_t center, int16_t radius, uint8_t color) {
 #endif // MAP_2_SIM_AVAILABLE
 
 
+/**
+ * Liefert den Betrag, um den die Grundflaeche des Bots bei einem Eintrag im location-mode freier wird
+ * \param *cache_tmp	Eintrag des Map-Caches
+ * \return			Betrag fuer update_location()
+ */
+static inline int8_t location_value(const map_cache_t* cache_tmp) {
+#ifdef MEASURE_POSITION_ERRORS_AVAILABLE
+	const uint8_t location_prob = cache_tmp->loc_prob;
+#else
+	(void) cache_tmp;
+	const uint8_t location_prob = 255;
+#endif
+	return (int8_t) ((MAP_STEP_FREE_LOCATION - 1) * location_prob / 255 + 1);
+}
+
+/**
+ * Traegt einen Eintrag des Map-Caches in die Karte ein
+ * \param *cache_tmp		Eintrag des Map-Caches
+ * \param location_value	Betrag fuer das Update der Grundflaeche, falls location-mode
+ */
+static void update_entry(map_cache_t* cache_tmp, int8_t location_value) {
+#ifdef DEBUG_SCAN_OTF
+	LOG_DEBUG("lese Cache: x= %d y= %d head= %f distance= %d loaction=%d border=%d", cache_tmp->x_pos, cache_tmp->y_pos, cache_tmp->heading / 10.0f, cache_tmp->mode.data.distance, cache_tmp->mode.data.location, cache_tmp->mode.data.border);
+
+	if ((cache_tmp->mode.data.distance || cache_tmp->mode.data.location || cache_tmp->mode.data.border) == 0)
+	LOG_DEBUG("Achtung: Dieser Eintrag ergibt keinen Sinn, kein einziges mode-bit gesetzt");
+#endif
+
+#ifdef MEASURE_POSITION_ERRORS_AVAILABLE
+	const uint8_t location_prob = cache_tmp->loc_prob;
+#else
+	const uint8_t location_prob = 255;
+#endif
+
+	/* Grundflaeche updaten, falls location-mode */
+	if (cache_tmp->mode.data.location) {
+		update_location(cache_tmp->x_pos, cache_tmp->y_pos, location_value);
+	}
+
+#ifdef MAP_USE_TRIG_CACHE
+	float* sin_head = &cache_tmp->sin;
+	float* cos_head = &cache_tmp->cos;
+#else
+	float* sin_head = NULL;
+	float* cos_head = NULL;
+	if (cache_tmp->mode.data.border || cache_tmp->mode.data.distance) {
+		const float head = rad(cache_tmp->heading / 10.f);
+		float sin_tmp = sinf(head);
+		float cos_tmp = cosf(head);
+		sin_head = &sin_tmp;
+		cos_head = &cos_tmp;
+	}
+#endif // MAP_USE_TRIG_CACHE
+
+	/* Abgrundsensoren updaten, falls border-mode */
+	if (cache_tmp->mode.data.border) {
+		update_border(cache_tmp->x_pos, cache_tmp->y_pos, *sin_head, *cos_head, cache_tmp->dataL, cache_tmp->dataR);
+	}
+
+	else // border-mode schliesst distance-mode aus, weil Felder der Struktur gemeinsam verwendet werden
+
+	/* Strahlen updaten, falls distance-mode und der aktuelle Eintrag Daten dazu hat */
+	if (cache_tmp->mode.data.distance) {
+		update_distance(cache_tmp->x_pos, cache_tmp->y_pos, *sin_head, *cos_head, cache_tmp->dataL * 5, cache_tmp->dataR * 5, location_prob);
+	}
+}
+
+#ifdef MAP_UPDATE_BATCH
+/**
+ * Fasst die Updates der Grundflaeche folgender Eintraege mit dem eines Eintrags zusammen, solange sie dieselbe
+ * Kartenposition betreffen und dazwischen nichts anderes eingetragen wird. Das Ergebnis ist dasselbe wie
+ * beim einzelnen Eintragen, denn Betraege gleichen Vorzeichens lassen sich saturiert addieren.
+ * \param *p_tail	Index des Eintrags, danach Index des letzten zusammengefassten Eintrags
+ * \param head		Index hinter dem neuesten Eintrag
+ * \return			Betrag fuer das Update der Grundflaeche
+ */
+static int8_t coalesce_location(uint16_t* p_tail, uint16_t head) {
+	map_cache_t* cache_tmp = &map_update_cache[*p_tail & (MAP_UPDATE_CACHE_SIZE - 1)];
+	int8_t value = location_value(cache_tmp);
+	if (! cache_tmp->mode.data.location || cache_tmp->mode.data.distance || cache_tmp->mode.data.border) {
+		return value;
+	}
+
+	const int16_t x_map = world_to_map(cache_tmp->x_pos);
+	const int16_t y_map = world_to_map(cache_tmp->y_pos);
+	while ((uint16_t) (*p_tail + 1) != head) {
+		map_cache_t* p_next = &map_update_cache[(*p_tail + 1) & (MAP_UPDATE_CACHE_SIZE - 1)];
+		const int8_t next_value = location_value(p_next);
+		if (! p_next->mode.data.location || world_to_map(p_next->x_pos) != x_map || world_to_map(p_next->y_pos) != y_map
+			|| value + next_value > 127) {
+			break;
+		}
+		value = (int8_t) (value + next_value);
+		if (p_next->mode.data.distance || p_next->mode.data.border) {
+			/* Grundflaeche ist schon erledigt, der Rest des Eintrags nicht */
+			p_next->mode.data.location = 0;
+			break;
+		}
+		++*p_tail;
+	}
+	return value;
+}
+#endif // MAP_UPDATE_BATCH
+
 /**
  * Main-Funktion des Map-Update-Threads
  */
@@ -1284,102 +2294,233 @@ void map_update_main(void) {
 	/* Endlosschleife -> Thread wird vom OS blockiert / gibt die Kontrolle ab,
 	 * wenn der Puffer leer ist */
 	while (1) {
+#ifdef MAP_UPDATE_BATCH
+		/* Thread blockiert hier, falls Cache leer */
+		uint16_t head = map_update_wait();
+
+		os_signal_lock(&lock_signal); // Zugriff auf die Map sperren
+
+		/* alle wartenden Eintraege abarbeiten, auch die, die inzwischen dazukommen */
+		uint16_t tail = map_update_tail;
+		do {
+			map_cache_t* cache_tmp = &map_update_cache[tail & (MAP_UPDATE_CACHE_SIZE - 1)];
+			const int8_t value = coalesce_location(&tail, head);
+			write_lock(); // Abfragen muessen nur auf diesen einen Eintrag warten
+			update_entry(cache_tmp, value);
+			write_unlock();
+			/* Eintrag (und zusammengefasste) freigeben */
+			__atomic_store_n(&map_update_tail, ++tail, __ATOMIC_RELEASE);
+			if (tail == head) {
+				head = __atomic_load_n(&map_update_head, __ATOMIC_ACQUIRE);
+			}
+		} while (tail != head);
+#else
 		/* Cache-Eintrag holen
 		 * Thread blockiert hier, falls Fifo leer */
 		uint8_t index = _inline_fifo_get(&map_update_fifo, False);
 		map_cache_t* cache_tmp = &map_update_cache[index];
 
 		os_signal_lock(&lock_signal); // Zugriff auf die Map sperren
-#ifdef DEBUG_SCAN_OTF
-		LOG_DEBUG("lese Cache: x= %d y= %d head= %f distance= %d loaction=%d border=%d", cache_tmp->x_pos, cache_tmp->y_pos, cache_tmp->heading / 10.0f, cache_tmp->mode.data.distance, cache_tmp->mode.data.location, cache_tmp->mode.data.border);
-
-		if ((cache_tmp->mode.data.distance || cache_tmp->mode.data.location || cache_tmp->mode.data.border) == 0)
-		LOG_DEBUG("Achtung: Dieser Eintrag ergibt keinen Sinn, kein einziges mode-bit gesetzt");
+		update_entry(cache_tmp, location_value(cache_tmp));
+#endif // MAP_UPDATE_BATCH
+
+		/* Falls Cache leer, used-blocks zurueckschreiben und Sperre aufheben */
+		if (map_update_pending() == 0) {
+			write_lock();
+#if (MAP_CACHE_BLOCKS > 1 || defined MAP_USE_MMAP) && defined MAP_2_SIM_AVAILABLE
+			/* Map-2-Sim liest aus der Map-Datei, also veraenderte Bloecke dorthin zurueckschreiben */
+			write_back_blocks();
 #endif
-
-#ifdef MEASURE_POSITION_ERRORS_AVAILABLE
-		const uint8_t location_prob = cache_tmp->loc_prob;
-#else
-		const uint8_t location_prob = 255;
+			/* belegten Bereich nur ab und zu sichern, map_flush_cache() schreibt ihn sofort */
+			if (min_max_updated == True && timer_ms_passed_32(&map_header_last_write, MAP_HEADER_INTERVAL)) {
+				if (write_header()) {
+					LOG_DEBUG("map_update_main(): write_header() failed");
+				}
+			}
+#ifdef MAP_SECTION_STATS
+			stats_refresh();
 #endif
-
-		/* Grundflaeche updaten, falls location-mode */
-		if (cache_tmp->mode.data.location) {
-			update_location(cache_tmp->x_pos, cache_tmp->y_pos, location_prob);
+			write_unlock();
 		}
+		os_signal_unlock(&lock_signal); // Zugriff auf Map wieder freigeben
+	}
+}
 
-#ifdef MAP_USE_TRIG_CACHE
-		float* sin_head = &cache_tmp->sin;
-		float* cos_head = &cache_tmp->cos;
+//#define MAP_2_SIM_DEBUG
+#ifdef MAP_2_SIM_AVAILABLE
+/**
+ * Begrenzt die Datenrate von Map-2-Sim auf MAP_2_SIM_BANDWIDTH. Es wird nur so lange gewartet, wie
+ * das Guthaben aus der seit dem letzten Aufruf vergangenen Zeit nicht fuer die naechsten Daten reicht.
+ * \param bytes	Anzahl der Bytes, die als naechstes gesendet werden
+ */
+static void map_2_sim_throttle(uint16_t bytes) {
+	static uint32_t last_ticks = 0;
+	static int32_t credit = 0; // Guthaben [Byte], hoechstens fuer 100 ms
+	const uint32_t now = TIMER_GET_TICKCOUNT_32;
+	uint32_t ms = TICKS_TO_MS(now - last_ticks);
+	if (ms > 100) {
+		ms = 100;
+		last_ticks = now;
+	} else {
+		last_ticks += MS_TO_TICKS(ms); // Rest unter 1 ms nicht verlieren
+	}
+	credit += (int32_t) (ms * MAP_2_SIM_BANDWIDTH / 1000);
+	if (credit > MAP_2_SIM_BANDWIDTH / 10) {
+		credit = MAP_2_SIM_BANDWIDTH / 10;
+	}
+	credit -= bytes;
+	if (credit < 0) {
+#ifdef PC
+		/* die Bandbreite zum Sim ist eine Echtzeit-Groesse, daher in Echtzeit warten */
+		delay((uint16_t) (-credit * 1000L / MAP_2_SIM_BANDWIDTH + 1));
 #else
-		float* sin_head = NULL;
-		float* cos_head = NULL;
-		if (cache_tmp->mode.data.border || cache_tmp->mode.data.distance) {
-			const float head = rad(cache_tmp->heading / 10.f);
-			float sin_tmp = sinf(head);
-			float cos_tmp = cosf(head);
-			sin_head = &sin_tmp;
-			cos_head = &cos_tmp;
-		}
-#endif // MAP_USE_TRIG_CACHE
+		os_thread_sleep((uint32_t) (-credit * 1000L / MAP_2_SIM_BANDWIDTH + 1));
+#endif // PC
+	}
+}
 
-		/* Abgrundsensoren updaten, falls border-mode */
-		if (cache_tmp->mode.data.border) {
-			update_border(cache_tmp->x_pos, cache_tmp->y_pos, *sin_head, *cos_head, cache_tmp->dataL, cache_tmp->dataR);
-		}
+#ifdef MAP_2_SIM_DELTA
+/**
+ * Sendet die gesammelten Aenderungen eines Blocks als SUB_MAP_DELTA-Paket
+ * \param block		Nummer des Blocks
+ * \param offset	Offset des ersten Bytes im Block, das das Paket beschreibt
+ * \param *p_packet	Paketdaten
+ * \param length	Laenge der Paketdaten [Byte]
+ */
+static void map_2_sim_flush(int16_t block, uint16_t offset, const uint8_t* p_packet, uint8_t length) {
+	if (length) {
+		map_2_sim_throttle((uint16_t) (sizeof(command_t) + length));
+		command_write_rawdata(CMD_MAP, SUB_MAP_DELTA, block, (int16_t) offset, length, p_packet);
+	}
+}
 
-		else // border-mode schliesst distance-mode aus, weil Felder der Struktur gemeinsam verwendet werden
+/**
+ * Sendet einen Block im Delta-Format. Ein SUB_MAP_DELTA-Paket beschreibt den Block ab Offset data_r
+ * mit folgenden Anweisungen (wie bei der Sparse-Kartendatei, erweitert um Code 128):
+ * Code n < 128: n + 1 Bytes folgen unveraendert, Code 128: Anzahl n folgt, n + 1 Bytes bleiben wie sie sind,
+ * Code n > 128: das folgende Byte wiederholt sich n - 126 mal.
+ * Kennt der Sim den Block schon, werden nur die geaenderten Bereiche uebertragen.
+ * \param block		Nummer des Blocks
+ * \param *p_data	aktuelle Daten des Blocks (MAP_BLOCK_SIZE Byte)
+ */
+static void map_2_sim_send_delta(int16_t block, const uint8_t* p_data) {
+	uint8_t* p_shadow = map_2_sim_shadow[block];
+	const uint8_t mask = (uint8_t) (1 << (block & 7));
+	const uint8_t valid = (uint8_t) (map_2_sim_valid[block / 8] & mask);
+	uint8_t packet[MAX_PAYLOAD];
+	uint8_t length = 0;
+	uint16_t offset = 0, i = 0;
+	while (i < MAP_BLOCK_SIZE) {
+		if (valid) {
+			/* unveraenderte Bytes auslassen */
+			uint16_t skip = 0;
+			while (i + skip < MAP_BLOCK_SIZE && p_data[i + skip] == p_shadow[i + skip]) {
+				++skip;
+			}
+			if (i + skip == MAP_BLOCK_SIZE) {
+				break;
+			}
+			if (skip) {
+				if (length && skip <= 256 && length <= MAX_PAYLOAD - 2) {
+					packet[length++] = 128;
+					packet[length++] = (uint8_t) (skip - 1);
+				} else {
+					/* neues Paket ab dem naechsten geaenderten Byte */
+					map_2_sim_flush(block, offset, packet, length);
+					length = 0;
+					offset = (uint16_t) (i + skip);
+				}
+				i = (uint16_t) (i + skip);
+			}
+		}
+		if (length > MAX_PAYLOAD - 2) {
+			map_2_sim_flush(block, offset, packet, length);
+			length = 0;
+			offset = i;
+		}
 
-		/* Strahlen updaten, falls distance-mode und der aktuelle Eintrag Daten dazu hat */
-		if (cache_tmp->mode.data.distance) {
-			update_distance(cache_tmp->x_pos, cache_tmp->y_pos, *sin_head, *cos_head, cache_tmp->dataL * 5, cache_tmp->dataR * 5, location_prob);
+		uint16_t run = 1;
+		while (i + run < MAP_BLOCK_SIZE && run < 129 && p_data[i + run] == p_data[i]) {
+			++run;
+		}
+		if (run >= 3) {
+			packet[length++] = (uint8_t) (run + 126);
+			packet[length++] = p_data[i];
+			i = (uint16_t) (i + run);
+			continue;
 		}
 
-		/* Falls Fifo leer, used-blocks zurueckschreiben und Sperre aufheben */
-		if (map_update_fifo.count == 0) {
-			if (min_max_updated == True) {
-				if (map_current_block.updated == True) {
-					/* letzten Block sichern */
-					if (sdfat_seek(map_file_desc, (int32_t) ((map_current_block.block + alignment_offset) * MAP_BLOCK_SIZE) + sizeof(map_header_t), SEEK_SET)) {
-						LOG_DEBUG("map_update_main(): sdfat_seek(0x%x) failed", map_current_block.block + alignment_offset);
-					}
-					if (sdfat_write(map_file_desc, map_buffer, MAP_BLOCK_SIZE) != MAP_BLOCK_SIZE) {
-						LOG_DEBUG("map_update_main(): sdfat_write(0x%x) failed", map_current_block.block + alignment_offset);
-					}
-					map_current_block.updated = False;
-				}
+		/* geaenderte Bytes bis zum naechsten Lauf oder unveraenderten Bereich (jeweils mindestens 3 Bytes) */
+		const uint16_t start = i;
+		const uint16_t max = (uint16_t) (MAX_PAYLOAD - 1 - length) < 128 ? (uint16_t) (MAX_PAYLOAD - 1 - length) : 128;
+		do {
+			++i;
+		} while (i < MAP_BLOCK_SIZE && i - start < max && (i + 2 >= MAP_BLOCK_SIZE
+			|| ((p_data[i] != p_data[i + 1] || p_data[i] != p_data[i + 2])
+			&& (! valid || p_data[i] != p_shadow[i] || p_data[i + 1] != p_shadow[i + 1] || p_data[i + 2] != p_shadow[i + 2]))));
+		packet[length++] = (uint8_t) (i - start - 1);
+		memcpy(&packet[length], &p_data[start], i - start);
+		length = (uint8_t) (length + i - start);
+	}
+	map_2_sim_flush(block, offset, packet, length);
+
+	memcpy(p_shadow, p_data, MAP_BLOCK_SIZE);
+	map_2_sim_valid[block / 8] |= mask;
+}
+#endif // MAP_2_SIM_DELTA
 
-				min_max_updated = False;
-				map_header_t* p_head_data = (map_header_t*) map_buffer;
-				sdfat_rewind(map_file_desc);
-				if (sdfat_read(map_file_desc, p_head_data, sizeof(map_header_t)) != sizeof(map_header_t)) {
-					LOG_DEBUG("map_update_main(): sdfat_read(header) failed");
-				}
-				/* Min- / Max-Werte speichern */
-				p_head_data->map_min_x = map_min_x;
-				p_head_data->map_max_x = map_max_x;
-				p_head_data->map_min_y = map_min_y;
-				p_head_data->map_max_y = map_max_y;
-				sdfat_rewind(map_file_desc);
-				if (sdfat_write(map_file_desc, p_head_data, sizeof(map_header_t)) != sizeof(map_header_t)) {
-					LOG_DEBUG("map_update_main(): sdfat_write(header) failed");
-				}
+/**
+ * Liest einen Block aus der Map-Datei und sendet ihn an den Sim
+ * \param block	Nummer des Blocks
+ */
+static void map_2_sim_block(int16_t block) {
+	if (block < 0 || block >= MAP_SECTIONS * MAP_SECTIONS / 2) {
+		LOG_ERROR("map_2_sim_main(): Block %u ausserhalb der Karte!", block);
+		return;
+	}
+#ifdef MAP_2_SIM_DELTA
+	/* vor dem Lesen freigeben, damit spaetere Aenderungen den Block erneut eintragen */
+	__atomic_fetch_and(&map_2_sim_pending[block / 8], (uint8_t) ~(1 << (block & 7)), __ATOMIC_ACQ_REL);
+#endif
+
+#ifdef MAP_USE_MMAP
+	/* direkt aus dem Mapping kopieren, der Block ist dort immer aktuell */
+	memcpy(map_2_sim_buffer, &map_mmap[((uint32_t) block + alignment_offset) * MAP_BLOCK_SIZE + sizeof(map_header_t)], MAP_BLOCK_SIZE);
+#else
+#ifdef PC
+	/* gepufferte Daten verwerfen, sonst liefert sdfat_read() nach sdfat_seek() innerhalb des Puffers veraltete Daten */
+	sdfat_flush(map_2_sim_file_desc);
+#endif
+	if (sdfat_seek(map_2_sim_file_desc, ((int32_t) block + (int32_t) alignment_offset) * MAP_BLOCK_SIZE + sizeof(map_header_t), SEEK_SET)) {
+		LOG_DEBUG("map_2_sim_main(): sdfat_seek(0x%x) failed", block + alignment_offset);
+		return;
+	}
+	if (sdfat_read(map_2_sim_file_desc, map_2_sim_buffer, MAP_BLOCK_SIZE) != MAP_BLOCK_SIZE) {
+		LOG_DEBUG("map_2_sim_main(): sdfat_read(0x%x) failed", block + alignment_offset);
+		return;
+	}
+#endif // MAP_USE_MMAP
 
-				/* letzen Block wieder laden */
-				if (sdfat_seek(map_file_desc, (int32_t) ((map_current_block.block + alignment_offset) * MAP_BLOCK_SIZE) + sizeof(map_header_t), SEEK_SET)) {
-					LOG_DEBUG("map_update_main(): sdfat_seek(0x%x) failed", map_current_block.block + alignment_offset);
-				}
-				if (sdfat_read(map_file_desc, map_buffer, MAP_BLOCK_SIZE) != MAP_BLOCK_SIZE) {
-					LOG_DEBUG("map_update_main(): sdfat_read(0x%x) failed", map_current_block.block + alignment_offset);
-				}
-			}
-		}
-		os_signal_unlock(&lock_signal); // Zugriff auf Map wieder freigeben
+#ifdef MAP_2_SIM_DELTA
+	if (__atomic_exchange_n(&map_2_sim_reset, False, __ATOMIC_ACQ_REL)) {
+		/* Sim hat die komplette Karte angefordert, sein Stand ist unbekannt */
+		memset(map_2_sim_valid, 0, sizeof(map_2_sim_valid));
 	}
+	if (map_2_sim_delta) {
+		map_2_sim_send_delta(block, map_2_sim_buffer);
+		return;
+	}
+#endif
+	map_2_sim_throttle(sizeof(command_t) + 128);
+	command_write_rawdata(CMD_MAP, SUB_MAP_DATA_1, block, map_2_sim_data.pos.x, 128, map_2_sim_buffer);
+	map_2_sim_throttle(sizeof(command_t) + 128);
+	command_write_rawdata(CMD_MAP, SUB_MAP_DATA_2, block, map_2_sim_data.pos.y, 128, &map_2_sim_buffer[128]);
+	map_2_sim_throttle(sizeof(command_t) + 128);
+	command_write_rawdata(CMD_MAP, SUB_MAP_DATA_3, block, map_2_sim_data.heading, 128, &map_2_sim_buffer[256]);
+	map_2_sim_throttle(sizeof(command_t) + 128);
+	command_write_rawdata(CMD_MAP, SUB_MAP_DATA_4, block, 0, 128, &map_2_sim_buffer[384]);
 }
 
-//#define MAP_2_SIM_DEBUG
-#ifdef MAP_2_SIM_AVAILABLE
 /**
  * Main-Funktion des Map-2-Sim-Threads
  */
@@ -1392,9 +2533,13 @@ void map_2_sim_main(void) {
 	/* Endlosschleife -> Thread wird vom OS blockiert / gibt die Kontrolle ab,
 	 * wenn der Puffer leer ist */
 	while (1) {
-		/* Daten aus Fifo holen
+		/* alle vorhandenen Daten aus Fifo holen, mindestens einen Eintrag
 		 * Thread blockiert hier, falls Fifo leer */
-		uint8_t size = (uint8_t) fifo_get_data(&map_2_sim_fifo, &cache_copy, MAP_2_SIM_BUFFER_SIZE * sizeof(cache_copy[0]));
+		uint8_t size = (uint8_t) (map_2_sim_fifo.count & ~(sizeof(cache_copy[0]) - 1));
+		if (size < sizeof(cache_copy[0])) {
+			size = sizeof(cache_copy[0]);
+		}
+		size = (uint8_t) fifo_get_data(&map_2_sim_fifo, &cache_copy, size);
 		os_signal_set(&map_2_sim_signal);
 		os_signal_release(&map_2_sim_signal);
 		const int8_t count = (int8_t) (size / sizeof(cache_copy[0])); // Anzahl der Eintraege
@@ -1416,34 +2561,28 @@ void map_2_sim_main(void) {
 				}
 			}
 			if (j == i) {
-				const int16_t max_block = MAP_SECTIONS * MAP_SECTIONS / 2;
-				const int16_t block = (int16_t) cache_copy[i];
-				cache_copy[i] = 0;
-				if (block > max_block) {
-					LOG_ERROR("map_2_sim_main(): Block %u ausserhalb der Karte!", block);
-					continue;
-				}
 				/* Block nicht gefunden -> wurde noch nicht gesendet, also jetzt senden */
-//				printf("sende Block %u\n", block);
-				if (sdfat_seek(map_2_sim_file_desc, ((int32_t) block + (int32_t) alignment_offset) * MAP_BLOCK_SIZE + sizeof(map_header_t), SEEK_SET)) {
-					LOG_DEBUG("map_2_sim_main(): sdfat_seek(0x%x) failed", block + alignment_offset);
-					continue;
-				}
-				if (sdfat_read(map_2_sim_file_desc, map_2_sim_buffer, MAP_BLOCK_SIZE) != MAP_BLOCK_SIZE) {
-					LOG_DEBUG("map_2_sim_main(): sdfat_read(0x%x) failed", block + alignment_offset);
-					continue;
+//				printf("sende Block %u\n", cache_copy[i]);
+				map_2_sim_block((int16_t) cache_copy[i]);
+				cache_copy[i] = 0;
+			}
+		}
+#ifdef MAP_2_SIM_DELTA
+		if (__atomic_exchange_n(&map_2_sim_lost, False, __ATOMIC_ACQ_REL)) {
+			/* Bloecke, die nicht mehr in die Fifo gepasst haben */
+			uint16_t block;
+			for (block = 0; block < MAP_BLOCKS; ++block) {
+				if (__atomic_load_n(&map_2_sim_pending[block / 8], __ATOMIC_ACQUIRE) & (1 << (block & 7))) {
+					map_2_sim_block((int16_t) block);
 				}
-
-				os_thread_sleep(20);
-				command_write_rawdata(CMD_MAP, SUB_MAP_DATA_1, block, map_2_sim_data.pos.x, 128, map_2_sim_buffer);
-				os_thread_sleep(20);
-				command_write_rawdata(CMD_MAP, SUB_MAP_DATA_2, block, map_2_sim_data.pos.y, 128, &map_2_sim_buffer[128]);
-				os_thread_sleep(20);
-				command_write_rawdata(CMD_MAP, SUB_MAP_DATA_3, block, map_2_sim_data.heading, 128, &map_2_sim_buffer[256]);
-				os_thread_sleep(20);
-				command_write_rawdata(CMD_MAP, SUB_MAP_DATA_4, block, 0, 128, &map_2_sim_buffer[384]);
 			}
 		}
+		if (map_2_sim_delta) {
+			map_2_sim_throttle(sizeof(command_t) + sizeof(map_2_sim_data.heading));
+			command_write_rawdata(CMD_MAP, SUB_MAP_POSITION, map_2_sim_data.pos.x, map_2_sim_data.pos.y, sizeof(map_2_sim_data.heading),
+				&map_2_sim_data.heading);
+		}
+#endif // MAP_2_SIM_DELTA
 #ifdef MEASURE_POSITION_ERRORS_AVAILABLE
 		command_write(CMD_MAP, SUB_MAP_CLEAR_CIRCLES, 0, 0, 0);
 		map_draw_circle(map_2_sim_data.pos, map_2_sim_data.error, 0);
@@ -1459,6 +2598,7 @@ void map_2_sim_send(void) {
 	/* Warten, bis Map-Update fertig */
 	map_flush_cache();
 	os_signal_lock(&lock_signal);
+	write_lock();
 	os_signal_lock(&map_2_sim_signal);
 
 	/* Belegte Bloecke uebertragen */
@@ -1469,19 +2609,58 @@ void map_2_sim_send(void) {
 	}
 	for (x = map_min_x; x < max_x; x += MAP_SECTION_POINTS * 2) { // in einem Block liegen 2 Sections in x-Richtung aneinander
 		for (y = map_min_y; y <= map_max_y; y += MAP_SECTION_POINTS) {
-			access_field(x, y, 0, 0); // Block in Puffer laden
+#ifdef MAP_2_SIM_DELTA
+			if (map_2_sim_delta) {
+				/* der Worker liest die Bloecke aus der Map-Datei und sendet nur, was dem Sim fehlt */
+				map_2_sim_queue(get_block(x, y));
+				continue;
+			}
+#endif
+			get_section(x, y); // Block in Puffer laden
+#ifdef MAP_USE_MMAP
+			const int16_t block = (int16_t) map_current_block.block;
+			uint8_t* p_data = map_current_block.data;
+#elif MAP_CACHE_BLOCKS == 1
 			const int16_t block = (int16_t) map_current_block.block;
-			command_write_rawdata(CMD_MAP, SUB_MAP_DATA_1, block, map_2_sim_data.pos.x, 128, map_buffer);
-			command_write_rawdata(CMD_MAP, SUB_MAP_DATA_2, block, map_2_sim_data.pos.y, 128, &map_buffer[128]);
-			command_write_rawdata(CMD_MAP, SUB_MAP_DATA_3, block, map_2_sim_data.heading, 128, &map_buffer[256]);
-			command_write_rawdata(CMD_MAP, SUB_MAP_DATA_4, block, 0, 128, &map_buffer[384]);
+			uint8_t* p_data = map_buffer;
+#else
+			const int16_t block = (int16_t) map_current_block->block;
+			uint8_t* p_data = map_current_block->data;
+#endif
+			command_write_rawdata(CMD_MAP, SUB_MAP_DATA_1, block, map_2_sim_data.pos.x, 128, p_data);
+			command_write_rawdata(CMD_MAP, SUB_MAP_DATA_2, block, map_2_sim_data.pos.y, 128, &p_data[128]);
+			command_write_rawdata(CMD_MAP, SUB_MAP_DATA_3, block, map_2_sim_data.heading, 128, &p_data[256]);
+			command_write_rawdata(CMD_MAP, SUB_MAP_DATA_4, block, 0, 128, &p_data[384]);
 		}
 	}
 
 	/* Sperre wieder freigeben */
 	os_signal_unlock(&map_2_sim_signal);
+	write_unlock();
 	os_signal_unlock(&lock_signal);
 }
+
+/**
+ * Bearbeitet die Anforderung der kompletten Karte durch den Sim
+ * \param format	SUB_MAP_DELTA, falls der Sim das Delta-Format versteht, sonst 0
+ */
+void map_2_sim_request(int16_t format) {
+#ifdef MAP_2_SIM_DELTA
+	map_2_sim_delta = format == SUB_MAP_DELTA;
+	__atomic_store_n(&map_2_sim_reset, True, __ATOMIC_RELEASE);
+#else
+	(void) format;
+#endif
+	map_2_sim_send();
+}
+
+/**
+ * Wertet die Aufforderung des Sim aus, die Karte zu uebertragen (SUB_MAP_REQUEST)
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void map_2_sim_handle_request(command_t * cmd) {
+	map_2_sim_request(cmd->data_l);
+}
 #endif // MAP_2_SIM_AVAILABLE
 
 /**
@@ -1500,6 +2679,7 @@ static void delete(void) {
 	/* warten bis Karte frei ist */
 	map_flush_cache();
 	os_signal_lock(&lock_signal);
+	write_lock();
 
 	/* alle Felder zuruecksetzen */
 	int16_t x, y;
@@ -1515,7 +2695,11 @@ static void delete(void) {
 	map_min_y = (int16_t) (MAP_SIZE * MAP_RESOLUTION / 2);
 	map_max_y = (int16_t) (MAP_SIZE * MAP_RESOLUTION / 2);
 	min_max_updated = True;
+#ifdef MAP_SECTION_STATS
+	stats_refresh();
+#endif
 
+	write_unlock();
 	os_signal_unlock(&lock_signal);
 
 #if defined PC && defined MAP_2_SIM_AVAILABLE
@@ -1531,6 +2715,7 @@ void map_clean(void) {
 	/* warten bis Karte frei ist */
 	map_flush_cache();
 	os_signal_lock(&lock_signal);
+	write_lock();
 
 	/* Alle positiven Werte auf 0 setzen */
 	int16_t x, y;
@@ -1542,7 +2727,11 @@ void map_clean(void) {
 			}
 		}
 	}
+#ifdef MAP_SECTION_STATS
+	stats_refresh();
+#endif
 
+	write_unlock();
 	os_signal_unlock(&lock_signal);
 
 #if defined PC && defined MAP_2_SIM_AVAILABLE
@@ -1550,6 +2739,300 @@ void map_clean(void) {
 #endif
 }
 
+#ifdef MAP_SPARSE_FILES
+#define SPARSE_BUFFER_SIZE	(sizeof(map_section_t) + sizeof(map_section_t) / 128)	/**< Groesse des Puffers fuer eine komprimierte Section [Byte] */
+
+/**
+ * Komprimiert die Felder einer Section per RLE (PackBits): Laenge n < 128 => n + 1 Felder folgen unkomprimiert,
+ * Laenge n >= 128 => das folgende Feld wiederholt sich n - 126 mal
+ * \param *p_section	Section
+ * \param *p_data		Zielpuffer mit mindestens SPARSE_BUFFER_SIZE Byte
+ * \return				Laenge der komprimierten Daten [Byte]
+ */
+static uint16_t sparse_encode(const map_section_t* p_section, uint8_t* p_data) {
+	const int8_t* p_src = &p_section->section[0][0];
+	const uint16_t n = sizeof(map_section_t);
+	uint16_t i = 0, length = 0;
+	while (i < n) {
+		uint16_t run = 1;
+		while (i + run < n && run < 129 && p_src[i + run] == p_src[i]) {
+			++run;
+		}
+		if (run >= 3) {
+			p_data[length++] = (uint8_t) (run + 126);
+			p_data[length++] = (uint8_t) p_src[i];
+			i = (uint16_t) (i + run);
+		} else {
+			/* unkomprimiert bis zum naechsten Lauf von mindestens 3 gleichen Feldern */
+			const uint16_t start = i;
+			do {
+				++i;
+			} while (i < n && i - start < 128 && (i + 2 >= n || p_src[i] != p_src[i + 1] || p_src[i] != p_src[i + 2]));
+			p_data[length++] = (uint8_t) (i - start - 1);
+			memcpy(&p_data[length], &p_src[start], i - start);
+			length = (uint16_t) (length + i - start);
+		}
+	}
+	return length;
+}
+
+/**
+ * Entpackt die per sparse_encode() komprimierten Felder einer Section
+ * \param *p_data		komprimierte Daten
+ * \param length		Laenge der komprimierten Daten [Byte]
+ * \param *p_section	Ziel-Section
+ * \return				0 falls alles OK, sonst Daten fehlerhaft
+ */
+static uint8_t sparse_decode(const uint8_t* p_data, uint16_t length, map_section_t* p_section) {
+	int8_t* p_dst = &p_section->section[0][0];
+	const uint16_t n = sizeof(map_section_t);
+	uint16_t i = 0, pos = 0;
+	while (i < length) {
+		const uint8_t c = p_data[i++];
+		if (c < 128) {
+			const uint16_t count = (uint16_t) (c + 1);
+			if (i + count > length || pos + count > n) {
+				return 1;
+			}
+			memcpy(&p_dst[pos], &p_data[i], count);
+			i = (uint16_t) (i + count);
+			pos = (uint16_t) (pos + count);
+		} else {
+			const uint16_t count = (uint16_t) (c - 126);
+			if (i >= length || pos + count > n) {
+				return 1;
+			}
+			memset(&p_dst[pos], p_data[i++], count);
+			pos = (uint16_t) (pos + count);
+		}
+	}
+	return pos == n ? 0 : 2;
+}
+
+/**
+ * Exportiert alle Sections im belegten Bereich der Karte, die nicht leer sind
+ * \param dest	Zieldatei
+ * \return		0 falls kein Fehler, sonst Fehlercode
+ */
+static int8_t export_sparse(pFatFile dest) {
+	map_sparse_header_t head = { MAP_SPARSE_MAGIC, MAP_SPARSE_VERSION, MAP_SECTION_POINTS, MAP_SECTIONS, map_min_x, map_max_x, map_min_y, map_max_y, 0 };
+	if (sdfat_write(dest, &head, sizeof(head)) != sizeof(head)) {
+		LOG_ERROR("export_sparse(): sdfat_write(head) failed");
+		return 2;
+	}
+
+	uint8_t buffer[sizeof(map_sparse_section_t) + SPARSE_BUFFER_SIZE];
+	map_sparse_section_t* p_entry = (map_sparse_section_t*) buffer;
+	int16_t x, y;
+	for (y = map_min_y & ~(MAP_SECTION_POINTS - 1); y <= map_max_y; y += MAP_SECTION_POINTS) {
+		for (x = map_min_x & ~(MAP_SECTION_POINTS - 1); x <= map_max_x; x += MAP_SECTION_POINTS) {
+			const map_section_t* p_section = get_section_read(x, y);
+			if (! p_section) {
+				return 3;
+			}
+
+			/* leere Sections auslassen */
+			const int8_t* p_src = &p_section->section[0][0];
+			uint16_t i;
+			for (i = 0; i < sizeof(map_section_t) && p_src[i] == 0; ++i) {}
+			if (i == sizeof(map_section_t)) {
+				continue;
+			}
+
+			p_entry->index = (uint16_t) ((uint16_t) y / MAP_SECTION_POINTS * MAP_SECTIONS + (uint16_t) x / MAP_SECTION_POINTS);
+			p_entry->length = sparse_encode(p_section, &buffer[sizeof(map_sparse_section_t)]);
+			const uint16_t size = (uint16_t) (sizeof(map_sparse_section_t) + p_entry->length);
+			if (sdfat_write(dest, buffer, size) != size) {
+				LOG_ERROR("export_sparse(): sdfat_write() failed, index=%u", p_entry->index);
+				return 2;
+			}
+			++head.count;
+		}
+	}
+
+	/* Anzahl der Sections nachtragen */
+	sdfat_rewind(dest);
+	if (sdfat_write(dest, &head, sizeof(head)) != sizeof(head)) {
+		LOG_ERROR("export_sparse(): sdfat_write(head) failed");
+		return 2;
+	}
+	LOG_INFO("export_sparse(): %u Sections exportiert", head.count);
+
+	return 0;
+}
+
+/**
+ * Uebernimmt die Felder einer Section in die Karte
+ * \param x				X-Ordinate der Section in der Karte
+ * \param y				Y-Ordinate der Section in der Karte
+ * \param *p_section	Quelle, NULL: Daten per sparse_decode() aus p_data entpacken
+ * \param *p_data		komprimierte Daten, falls p_section == NULL
+ * \param length		Laenge der komprimierten Daten [Byte]
+ * \return				0 falls alles OK
+ */
+static uint8_t import_section(int16_t x, int16_t y, const map_section_t* p_section, const uint8_t* p_data, uint16_t length) {
+	map_section_t* p_dst = get_section(x, y);
+	if (! p_dst) {
+		return 1;
+	}
+	if (p_section) {
+		memcpy(p_dst, p_section, sizeof(map_section_t));
+	} else {
+		map_section_t section;
+		if (sparse_decode(p_data, length, &section)) {
+			return 2;
+		}
+		memcpy(p_dst, &section, sizeof(map_section_t));
+	}
+	current_block_updated();
+#ifdef MAP_SECTION_STATS
+	stat_compute((uint16_t) ((uint16_t) y / MAP_SECTION_POINTS * MAP_SECTIONS + (uint16_t) x / MAP_SECTION_POINTS));
+#endif
+
+	return 0;
+}
+
+/**
+ * Importiert eine Karte im Sparse-Format
+ * \param src	Quelldatei, Dateizeiger steht hinter dem Header
+ * \param count	Anzahl der Sections laut Header
+ * \return		0 falls kein Fehler, sonst Fehlercode
+ */
+static uint8_t import_sparse(pFatFile src, uint16_t count) {
+	uint8_t buffer[SPARSE_BUFFER_SIZE];
+	uint16_t i;
+	for (i = 0; i < count; ++i) {
+		map_sparse_section_t entry;
+		if (sdfat_read(src, &entry, sizeof(entry)) != sizeof(entry)) {
+			LOG_ERROR("import_sparse(): sdfat_read() failed, i=%u", i);
+			return 7;
+		}
+		if (entry.index >= MAP_SECTIONS * MAP_SECTIONS || entry.length > sizeof(buffer)) {
+			LOG_ERROR("import_sparse(): Eintrag %u ungueltig", i);
+			return 8;
+		}
+		if (sdfat_read(src, buffer, entry.length) != entry.length) {
+			LOG_ERROR("import_sparse(): sdfat_read() failed, i=%u", i);
+			return 7;
+		}
+		const int16_t x = (int16_t) (entry.index % MAP_SECTIONS * MAP_SECTION_POINTS);
+		const int16_t y = (int16_t) (entry.index / MAP_SECTIONS * MAP_SECTION_POINTS);
+		if (import_section(x, y, NULL, buffer, entry.length)) {
+			LOG_ERROR("import_sparse(): import_section() failed, index=%u", entry.index);
+			return 8;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Importiert eine Karte im alten Format (komplette Map-Datei), dabei werden nur die Bloecke im belegten Bereich gelesen
+ * \param src				Quelldatei
+ * \param src_alignment_offset	Offset des Kartenanfangs in der Quelldatei [Bloecke]
+ * \return					0 falls kein Fehler, sonst Fehlercode
+ */
+static uint8_t import_blocks(pFatFile src, uint16_t src_alignment_offset) {
+	map_section_t block[2];
+	int16_t x, y;
+	for (y = map_min_y & ~(MAP_SECTION_POINTS - 1); y <= map_max_y; y += MAP_SECTION_POINTS) {
+		for (x = map_min_x & ~((MAP_SECTION_POINTS * 2) - 1); x <= map_max_x; x += MAP_SECTION_POINTS * 2) {
+			const int32_t offset = ((int32_t) get_block(x, y) + src_alignment_offset) * MAP_BLOCK_SIZE + sizeof(map_header_t);
+			if (sdfat_seek(src, offset, SEEK_SET)) {
+				LOG_ERROR("import_blocks(): sdfat_seek(0x%x) failed", offset);
+				return 5;
+			}
+			if (sdfat_read(src, block, MAP_BLOCK_SIZE) != MAP_BLOCK_SIZE) {
+				LOG_ERROR("import_blocks(): sdfat_read() failed, offset=0x%x", offset);
+				return 7;
+			}
+
+			/* leere Bloecke auslassen, die Karte ist bereits geloescht */
+			const int8_t* p_src = &block[0].section[0][0];
+			uint16_t i;
+			for (i = 0; i < MAP_BLOCK_SIZE && p_src[i] == 0; ++i) {}
+			if (i == MAP_BLOCK_SIZE) {
+				continue;
+			}
+
+			if (import_section(x, y, &block[0], NULL, 0) || import_section((int16_t) (x + MAP_SECTION_POINTS), y, &block[1], NULL, 0)) {
+				LOG_ERROR("import_blocks(): import_section() failed, x=%d y=%d", x, y);
+				return 8;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Importiert eine Karte im Sparse- oder im alten Format, die Karte muss bereits geloescht sein.
+ * Die Laufzeit haengt nur von der Groesse des belegten Bereichs ab.
+ * \param src	Quelldatei
+ * \return		0 falls kein Fehler, sonst Fehlercode
+ */
+static uint8_t import_file(pFatFile src) {
+	map_header_t head;
+	map_sparse_header_t* p_sparse = (map_sparse_header_t*) &head;
+	if (sdfat_read(src, p_sparse, sizeof(map_sparse_header_t)) != sizeof(map_sparse_header_t)) {
+		LOG_ERROR("import_file(): sdfat_read(head) failed");
+		return 3;
+	}
+
+	uint8_t sparse = False;
+	int16_t min_x, max_x, min_y, max_y;
+	if (memcmp(p_sparse->magic, MAP_SPARSE_MAGIC, sizeof(p_sparse->magic)) == 0) {
+		if (p_sparse->version != MAP_SPARSE_VERSION || p_sparse->section_points != MAP_SECTION_POINTS || p_sparse->sections != MAP_SECTIONS) {
+			LOG_ERROR("import_file(): Format nicht unterstuetzt (Version %u)", p_sparse->version);
+			return 4;
+		}
+		sparse = True;
+		min_x = p_sparse->map_min_x;
+		max_x = p_sparse->map_max_x;
+		min_y = p_sparse->map_min_y;
+		max_y = p_sparse->map_max_y;
+	} else {
+		/* altes Format, kompletten Header lesen */
+		sdfat_rewind(src);
+		if (sdfat_read(src, &head, sizeof(map_header_t)) != sizeof(map_header_t)) {
+			LOG_ERROR("import_file(): sdfat_read(head) failed");
+			return 3;
+		}
+		LOG_INFO("import_file(): altes Format, src_alignment_offset=0x%x", head.alignment_offset);
+		min_x = head.map_min_x;
+		max_x = head.map_max_x;
+		min_y = head.map_min_y;
+		max_y = head.map_max_y;
+	}
+
+	if (min_x < 0 || min_y < 0 || max_x >= (int16_t) (MAP_SIZE * MAP_RESOLUTION) || max_y >= (int16_t) (MAP_SIZE * MAP_RESOLUTION)
+		|| min_x > max_x || min_y > max_y) {
+		LOG_ERROR("import_file(): belegter Bereich ungueltig");
+		return 6;
+	}
+
+	/* Groesse aus Quelle initialisieren */
+	map_min_x = min_x;
+	map_max_x = max_x;
+	map_min_y = min_y;
+	map_max_y = max_y;
+	min_max_updated = True;
+	LOG_INFO("import_file(): min_x=%u, max_x=%u, min_y=%u, max_y=%u", map_min_x, map_max_x, map_min_y, map_max_y);
+
+	const uint8_t res = sparse ? import_sparse(src, p_sparse->count) : import_blocks(src, head.alignment_offset);
+	if (res) {
+		return res;
+	}
+
+	if (write_header()) {
+		LOG_ERROR("import_file(): write_header() failed");
+		return 9;
+	}
+
+	return 0;
+}
+#endif // MAP_SPARSE_FILES
+
 /**
  * Exportiert die aktuelle Karte in eine Datei
  * \param *file Name der Zieldatei (wird geloescht, falls sie schon existiert)
@@ -1573,6 +3056,13 @@ int8_t map_save_to_file(const char* file) {
 		return 1;
 	}
 
+#ifdef MAP_SPARSE_FILES
+	read_lock();
+	const int8_t res = export_sparse(dest);
+	read_unlock();
+	sdfat_close(dest);
+	return res;
+#else
 	const uint32_t size = sdfat_get_filesize(map_file_desc) / MAP_BLOCK_SIZE;
 	LOG_INFO("map_save_to_file(): size=0x%x blocks", size - alignment_offset - sizeof(map_header_t) / MAP_BLOCK_SIZE);
 	sdfat_rewind(map_file_desc);
@@ -1589,15 +3079,13 @@ int8_t map_save_to_file(const char* file) {
 	}
 
 	/* aktuellen Block wieder laden */
-	if (sdfat_seek(map_file_desc, (int32_t) ((map_current_block.block + alignment_offset) * MAP_BLOCK_SIZE) + sizeof(map_header_t), SEEK_SET)) {
-		LOG_DEBUG("map_load_from_file(): sdfat_seek(0x%x) failed", map_current_block.block + alignment_offset);
-	}
-	if (sdfat_read(map_file_desc, map_buffer, MAP_BLOCK_SIZE) != MAP_BLOCK_SIZE) {
-		LOG_DEBUG("map_load_from_file(): sdfat_read(0x%x) failed", map_current_block.block + alignment_offset);
+	if (reload_current_block()) {
+		LOG_DEBUG("map_save_to_file(): reload_current_block() failed");
 		return 4;
 	}
 
 	return 0;
+#endif // MAP_SPARSE_FILES
 }
 
 /**
@@ -1630,10 +3118,23 @@ int8_t map_load_from_file(const char* file) {
 	delete();
 
 	os_signal_lock(&lock_signal);
+	write_lock();
+#ifdef MAP_SPARSE_FILES
+	res = import_file(src_file);
+	sdfat_close(src_file);
+	write_unlock();
+	os_signal_unlock(&lock_signal);
+	if (res) {
+		LOG_ERROR("map_load_from_file(): import_file()=%u", res);
+		return (int8_t) res;
+	}
+#else
 	map_header_t* p_head_buffer = (map_header_t*) map_buffer;
 	if (sdfat_read(src_file, p_head_buffer, sizeof(map_header_t)) != sizeof(map_header_t)) {
 		LOG_ERROR("map_load_from_file(): sdfat_read(head) failed");
 		sdfat_close(src_file);
+		write_unlock();
+		os_signal_unlock(&lock_signal);
 		return 3;
 	}
 
@@ -1652,6 +3153,7 @@ int8_t map_load_from_file(const char* file) {
 	if (sdfat_write(map_file_desc, p_head_buffer, sizeof(map_header_t)) != sizeof(map_header_t)) {
 		LOG_ERROR("map_load_from_file(): sdfat_write(head) failed");
 		sdfat_close(src_file);
+		write_unlock();
 		os_signal_unlock(&lock_signal);
 		return 4;
 	}
@@ -1663,6 +3165,7 @@ int8_t map_load_from_file(const char* file) {
 	if (sdfat_seek(src_file, src_alignment_offset * MAP_BLOCK_SIZE + sizeof(map_header_t), SEEK_SET)) {
 		LOG_ERROR("map_load_from_file(): sdfat_seek(0x%x) failed", src_alignment_offset * MAP_BLOCK_SIZE + sizeof(map_header_t));
 		sdfat_close(src_file);
+		write_unlock();
 		os_signal_unlock(&lock_signal);
 		return 5;
 	}
@@ -1670,6 +3173,7 @@ int8_t map_load_from_file(const char* file) {
 	if (sdfat_seek(map_file_desc, alignment_offset * MAP_BLOCK_SIZE + sizeof(map_header_t), SEEK_SET)) {
 		LOG_ERROR("map_load_from_file(): sdfat_seek(0x%x) failed", alignment_offset * MAP_BLOCK_SIZE + sizeof(map_header_t));
 		sdfat_close(src_file);
+		write_unlock();
 		os_signal_unlock(&lock_signal);
 		return 6;
 	}
@@ -1679,12 +3183,14 @@ int8_t map_load_from_file(const char* file) {
 		if (sdfat_read(src_file, map_buffer, MAP_BLOCK_SIZE) != MAP_BLOCK_SIZE) {
 			LOG_ERROR("map_load_from_file(): sdfat_read() failed, i=0x%x", i);
 			sdfat_close(src_file);
+			write_unlock();
 			os_signal_unlock(&lock_signal);
 			return 7;
 		}
 		if (sdfat_write(map_file_desc, map_buffer, MAP_BLOCK_SIZE) != MAP_BLOCK_SIZE) {
 			LOG_ERROR("map_load_from_file(): sdfat_write() failed, i=0x%x", i);
 			sdfat_close(src_file);
+			write_unlock();
 			os_signal_unlock(&lock_signal);
 			return 8;
 		}
@@ -1693,22 +3199,20 @@ int8_t map_load_from_file(const char* file) {
 	LOG_INFO("map_load_from_file(): filesize=0x%x blocks", size);
 	sdfat_close(src_file);
 
-	map_current_block.updated = False;
-	map_current_block.block = 0;
-
-	/* Block 0 laden */
-	if (sdfat_seek(map_file_desc, (int32_t) ((map_current_block.block + alignment_offset) * MAP_BLOCK_SIZE) + sizeof(map_header_t), SEEK_SET)) {
-		LOG_DEBUG("map_load_from_file(): sdfat_seek(0x%x) failed", map_current_block.block + alignment_offset);
+	/* Bloecke im RAM sind veraltet */
+	if (invalidate_blocks()) {
+		LOG_ERROR("map_load_from_file(): invalidate_blocks() failed");
+		write_unlock();
 		os_signal_unlock(&lock_signal);
 		return 9;
 	}
-	if (sdfat_read(map_file_desc, map_buffer, MAP_BLOCK_SIZE) != MAP_BLOCK_SIZE) {
-		LOG_ERROR("map_load_from_file(): sdfat_read(0x%x) failed", map_current_block.block + alignment_offset);
-		os_signal_unlock(&lock_signal);
-		return 10;
-	}
+#ifdef MAP_SECTION_STATS
+	stats_rebuild();
+#endif
 
+	write_unlock();
 	os_signal_unlock(&lock_signal);
+#endif // MAP_SPARSE_FILES
 
 #if defined PC && defined MAP_2_SIM_AVAILABLE
 	map_2_sim_send();
@@ -1729,6 +3233,7 @@ static void draw_test_scheme(void) {
 	/* warten bis Karte frei ist */
 	map_flush_cache();
 	os_signal_lock(&lock_signal);
+	write_lock();
 
 	int16_t x, y;
 	LOG_DEBUG("Linie");
@@ -1770,6 +3275,7 @@ static void draw_test_scheme(void) {
 	}
 
 	LOG_DEBUG("fertig.");
+	write_unlock();
 	os_signal_unlock(&lock_signal);
 }
 #endif // PC
@@ -1796,6 +3302,7 @@ static void shrink(int16_t * min_x, int16_t * max_x, int16_t * min_y, int16_t *
 	/* warten bis Karte frei ist */
 	map_flush_cache();
 	os_signal_lock(&lock_signal);
+	write_lock();
 
 	// Kartengroesse reduzieren
 	int8_t free = 1;
@@ -1840,6 +3347,7 @@ static void shrink(int16_t * min_x, int16_t * max_x, int16_t * min_y, int16_t *
 		}
 		*max_x -= 1;
 	}
+	write_unlock();
 	os_signal_unlock(&lock_signal);
 }
 #endif // 0
@@ -1875,6 +3383,7 @@ void map_to_pgm(const char* filename) {
 	/* warten bis Karte frei ist */
 	map_flush_cache();
 	os_signal_lock(&lock_signal);
+	write_lock();
 
 	uint8_t tmp;
 	int16_t x, y;
@@ -1896,6 +3405,7 @@ void map_to_pgm(const char* filename) {
 		}
 #endif // MAP_PRINT_SCALE
 	}
+	write_unlock();
 	os_signal_unlock(&lock_signal);
 
 #ifdef MAP_PRINT_SCALE
@@ -2005,6 +3515,216 @@ static int map_test_get_ratio(void) {
 		return 1;
 	}
 }
+
+/**
+ * Aendert den Wert eines Feldes um den angegebenen Betrag, Referenz fuer map_test_rays()
+ * \param x		x-Ordinate der Karte (nicht der Welt!!!)
+ * \param y		y-Ordinate der Karte (nicht der Welt!!!)
+ * \param value	Betrag um den das Feld veraendert wird (>0 heisst freier, <0 heisst belegter)
+ */
+static void update_field(int16_t x, int16_t y, int8_t value) {
+	int8_t tmp = access_field(x, y, 0, 0);
+	if (tmp == -128) {
+		// Nicht aktualiseren, wenn es sich um ein Loch handelt
+		return;
+	}
+
+	access_field(x, y, add_saturated(tmp, value), 1);
+}
+
+/**
+ * Markiert die Felder eines Sensorstrahls feldweise per update_field() als frei (Verfahren ohne
+ * Section-weise Bearbeitung), Referenz fuer map_test_rays()
+ * \param x		X-Achse der Position des Sensors
+ * \param y 	Y-Achse der Position des Sensors
+ * \param h_sin sin(Blickrichtung)
+ * \param h_cos	cos(Blickrichtung)
+ * \param dist 	Sensorwert
+ * \return		Anzahl der aktualisierten Felder
+ */
+static int16_t update_ray_per_field(int16_t x, int16_t y, float h_sin, float h_cos, int16_t dist) {
+	const int16_t X = world_to_map(x);
+	const int16_t Y = world_to_map(y);
+	const int16_t d = dist == SENS_IR_INFINITE ? SENS_IR_MAX_DIST : dist;
+	const int16_t PH_X = world_to_map(x + (int16_t) (d * h_cos));
+	const int16_t PH_Y = world_to_map(y + (int16_t) (d * h_sin));
+
+	int16_t lX = X;
+	int16_t lY = Y;
+	const int8_t sX = (int8_t) (PH_X < X ? -1 : 1);
+	int8_t dX = (int8_t) abs(PH_X - X);
+	const int8_t sY = (int8_t) (PH_Y < Y ? -1 : 1);
+	int8_t dY = (int8_t) abs(PH_Y - Y);
+
+	int16_t i, lh;
+	if (dX >= dY) {
+		if (dY > 0) dY--;
+		lh = dX / 2;
+		for (i = 0; i < dX; ++i) {
+			update_field(lX, lY, MAP_STEP_FREE_SENSOR);
+			lX += sX;
+			lh += dY;
+			if (lh >= dX) {
+				lh -= dX;
+				lY += sY;
+			}
+		}
+		return dX;
+	} else {
+		if (dX > 0) dX--;
+		lh = dY / 2;
+		for (i = 0; i < dY; ++i) {
+			update_field(lX, lY, MAP_STEP_FREE_SENSOR);
+			lY += sY;
+			lh += dX;
+			if (lh >= dY) {
+				lh -= dY;
+				lX += sX;
+			}
+		}
+		return dY;
+	}
+}
+
+/**
+ * Sichert den vom Strahl-Benchmark benutzten Bereich der Karte samt belegtem Bereich oder stellt ihn wieder her
+ * \param *backup	Puffer fuer alle Felder des Bereichs
+ * \param restore	0: Felder in den Puffer kopieren, 1: Felder aus dem Puffer zurueckschreiben
+ */
+static void map_test_rays_backup(int8_t * backup, uint8_t restore) {
+	static int16_t bounds[4];
+	map_flush_cache();
+	if (! restore) {
+		bounds[0] = map_min_x;
+		bounds[1] = map_max_x;
+		bounds[2] = map_min_y;
+		bounds[3] = map_max_y;
+	}
+	os_signal_lock(&lock_signal);
+	write_lock();
+	int16_t X, Y;
+	for (X = world_to_map(-MAP_TEST_RAYS_RANGE); X <= world_to_map(MAP_TEST_RAYS_RANGE); ++X) {
+		for (Y = world_to_map(-MAP_TEST_RAYS_RANGE); Y <= world_to_map(MAP_TEST_RAYS_RANGE); ++Y) {
+			if (restore) {
+				access_field(X, Y, *backup, 1);
+			} else {
+				*backup = access_field(X, Y, 0, 0);
+			}
+			++backup;
+		}
+	}
+	write_unlock();
+	os_signal_unlock(&lock_signal);
+	map_flush_cache();
+	if (restore) {
+		/* beim Zurueckschreiben hat swap_out() den belegten Bereich vergroessert */
+		map_min_x = bounds[0];
+		map_max_x = bounds[1];
+		map_min_y = bounds[2];
+		map_max_y = bounds[3];
+		min_max_updated = True;
+		map_flush_cache();
+	}
+}
+
+/**
+ * Micro-Benchmark fuer die Strahl-Aktualisierung: vergleicht die Section-weise Bearbeitung beider
+ * Sensorstrahlen (ray_update_section()) mit der feldweisen Bearbeitung per update_field() in Feldern / s
+ * und prueft, ob beide Verfahren dieselbe Karte erzeugen. Der benutzte Bereich der Karte wird vorher
+ * gesichert und danach wiederhergestellt.
+ * \return 0 falls alles OK, 1 falls Fehler
+ */
+static int map_test_rays(void) {
+	const int32_t count = 20000;
+	const size_t size = (size_t) (world_to_map(MAP_TEST_RAYS_RANGE) - world_to_map(-MAP_TEST_RAYS_RANGE) + 1);
+	int8_t * backup = malloc(size * size);
+	if (backup == NULL) {
+		LOG_ERROR("map_test_rays(): kein Speicher fuer die Sicherung der Karte");
+		return 1;
+	}
+	map_test_rays_backup(backup, 0);
+
+	uint32_t cells = 0;
+	uint32_t sum[2];
+	double duration[2];
+	uint8_t pass;
+	for (pass = 0; pass < 2; ++pass) {
+		map_flush_cache();
+		os_signal_lock(&lock_signal);
+		write_lock();
+
+		/* benutzten Bereich leeren */
+		int16_t X, Y;
+		for (X = world_to_map(-MAP_TEST_RAYS_RANGE); X <= world_to_map(MAP_TEST_RAYS_RANGE); ++X) {
+			for (Y = world_to_map(-MAP_TEST_RAYS_RANGE); Y <= world_to_map(MAP_TEST_RAYS_RANGE); ++Y) {
+				access_field(X, Y, 0, 1);
+			}
+		}
+
+		uint32_t seed = 1;
+		struct timeval start, end;
+		gettimeofday(&start, NULL);
+		int32_t i;
+		for (i = 0; i < count; ++i) {
+			/* reproduzierbare Posen und Sensorwerte im Bereich +/- 2 m */
+			seed = seed * 1103515245UL + 12345UL;
+			const int16_t x = (int16_t) ((seed >> 8) % 4000) - 2000;
+			seed = seed * 1103515245UL + 12345UL;
+			const int16_t y = (int16_t) ((seed >> 8) % 4000) - 2000;
+			seed = seed * 1103515245UL + 12345UL;
+			const float head = (float) ((seed >> 8) % 3600) * (float) (M_PI / 1800.0);
+			seed = seed * 1103515245UL + 12345UL;
+			const int16_t dist = (int16_t) (80 + (seed >> 8) % (SENS_IR_MAX_DIST - 80));
+			const float sin_head = sinf(head);
+			const float cos_head = cosf(head);
+			const int16_t y_l = (int16_t) (y + DISTSENSOR_POS_SW);
+			const int16_t y_r = (int16_t) (y - DISTSENSOR_POS_SW);
+
+			if (pass == 0) {
+				cells += (uint32_t) update_ray_per_field(x, y_l, sin_head, cos_head, dist);
+				cells += (uint32_t) update_ray_per_field(x, y_r, sin_head, cos_head, dist);
+			} else {
+				map_ray_t ray_l, ray_r;
+				position_t end_l, end_r;
+				ray_init(&ray_l, x, y_l, sin_head, cos_head, dist, &end_l);
+				ray_init(&ray_r, x, y_r, sin_head, cos_head, dist, &end_r);
+				while (ray_l.steps > 0 || ray_r.steps > 0) {
+					if (ray_l.steps > 0) {
+						ray_update_section(&ray_l, MAP_STEP_FREE_SENSOR);
+					}
+					if (ray_r.steps > 0) {
+						ray_update_section(&ray_r, MAP_STEP_FREE_SENSOR);
+					}
+				}
+			}
+		}
+		gettimeofday(&end, NULL);
+		duration[pass] = (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_usec - start.tv_usec) / 1000000.0;
+
+		/* Pruefsumme ueber den benutzten Bereich */
+		sum[pass] = 0;
+		for (X = world_to_map(-MAP_TEST_RAYS_RANGE); X <= world_to_map(MAP_TEST_RAYS_RANGE); ++X) {
+			for (Y = world_to_map(-MAP_TEST_RAYS_RANGE); Y <= world_to_map(MAP_TEST_RAYS_RANGE); ++Y) {
+				sum[pass] = sum[pass] * 31 + (uint8_t) access_field(X, Y, 0, 0);
+			}
+		}
+		write_unlock();
+		os_signal_unlock(&lock_signal);
+	}
+
+	map_test_rays_backup(backup, 1);
+	free(backup);
+
+	LOG_INFO("map_test_rays(): %ld Strahlen, %lu Felder", (long) (count * 2), (unsigned long) cells);
+	LOG_INFO("  feldweise:     %8.3f s, %10.0f Felder/s", duration[0], cells / duration[0]);
+	LOG_INFO("  Section-weise: %8.3f s, %10.0f Felder/s (Faktor %.2f)", duration[1], cells / duration[1], duration[0] / duration[1]);
+	if (sum[0] != sum[1]) {
+		LOG_ERROR("Pruefsumme abweichend: 0x%08lx != 0x%08lx\tFAILED", (unsigned long) sum[0], (unsigned long) sum[1]);
+		return 1;
+	}
+	LOG_INFO("Pruefsumme 0x%08lx\tPASSED", (unsigned long) sum[1]);
+	return 0;
+}
 #endif // MAP_TESTS_AVAILABLE
 #endif // PC
 
@@ -2031,6 +3751,12 @@ static void info(void) {
 	LOG_INFO("%u\t Laenge eine Macroblocks in Punkten (MACRO_BLOCK_LENGTH)", MACRO_BLOCK_LENGTH);
 	LOG_INFO("%u\t Anzahl der Macroblocks in einer Zeile (MAP_LENGTH_IN_MACRO_BLOCKS)", MAP_LENGTH_IN_MACRO_BLOCKS);
 	LOG_INFO("alignment_offset=0x%x", alignment_offset);
+#ifdef MAP_USE_MMAP
+	LOG_INFO("Map-Datei per mmap eingeblendet, %u Byte", map_mmap_size);
+#elif MAP_CACHE_BLOCKS > 1
+	LOG_INFO("%u\t Bloecke im Cache (MAP_CACHE_BLOCKS)", MAP_CACHE_BLOCKS);
+	LOG_INFO("Cache: %u hits, %u misses, %u writes", map_cache_stat.hits, map_cache_stat.misses, map_cache_stat.writes);
+#endif
 }
 #endif // MAP_INFO_AVAILABLE
 
@@ -2085,6 +3811,11 @@ void map_display(void) {
 		map_test_get_ratio();
 		RC5_Code = 0;
 		break;
+
+	case RC5_CODE_6:
+		map_test_rays();
+		RC5_Code = 0;
+		break;
 #endif // MAP_TESTS_AVAILABLE
 #endif // PC
 
@@ -63,26 +63,29 @@ void bot_2_sim_listen(void) {
  * Diese Funktion informiert den PC ueber alle Sensor und Aktuator-Werte
  */
 void bot_2_sim_inform(void) {
-	command_write(CMD_AKT_MOT, SUB_CMD_NORM, speed_l, speed_r, 0);
-	command_write(CMD_SENS_IR, SUB_CMD_NORM, sensDistL, sensDistR, 0);
-	command_write(CMD_SENS_ENC, SUB_CMD_NORM, sensEncL, sensEncR, 0);
-	command_write(CMD_SENS_BORDER, SUB_CMD_NORM, sensBorderL, sensBorderR, 0);
-	command_write(CMD_SENS_LINE, SUB_CMD_NORM, sensLineL, sensLineR, 0);
-	command_write(CMD_SENS_LDR, SUB_CMD_NORM , sensLDRL, sensLDRR, 0);
+	if (command_write_snapshot() != 0) {
+		/* Sim kennt (noch) keine Snapshots, einzelne Kommandos senden */
+		command_write(CMD_AKT_MOT, SUB_CMD_NORM, speed_l, speed_r, 0);
+		command_write(CMD_SENS_IR, SUB_CMD_NORM, sensDistL, sensDistR, 0);
+		command_write(CMD_SENS_ENC, SUB_CMD_NORM, sensEncL, sensEncR, 0);
+		command_write(CMD_SENS_BORDER, SUB_CMD_NORM, sensBorderL, sensBorderR, 0);
+		command_write(CMD_SENS_LINE, SUB_CMD_NORM, sensLineL, sensLineR, 0);
+		command_write(CMD_SENS_LDR, SUB_CMD_NORM , sensLDRL, sensLDRR, 0);
 #ifdef BPS_AVAILABLE
-	command_write(CMD_SENS_BPS, SUB_CMD_NORM , (int16_t) sensBPS, 0, 0);
+		command_write(CMD_SENS_BPS, SUB_CMD_NORM , (int16_t) sensBPS, 0, 0);
 #endif // BPS_AVAILABLE
 
 #ifdef LED_AVAILABLE
-	command_write(CMD_AKT_LED, SUB_CMD_NORM, led, 0, 0);
+		command_write(CMD_AKT_LED, SUB_CMD_NORM, led, 0, 0);
 #endif
-	command_write(CMD_SENS_TRANS, SUB_CMD_NORM, sensTrans, 0, 0);
-	command_write(CMD_SENS_DOOR, SUB_CMD_NORM, sensDoor, 0, 0);
-	command_write(CMD_SENS_ERROR, SUB_CMD_NORM, sensError, 0, 0);
+		command_write(CMD_SENS_TRANS, SUB_CMD_NORM, sensTrans, 0, 0);
+		command_write(CMD_SENS_DOOR, SUB_CMD_NORM, sensDoor, 0, 0);
+		command_write(CMD_SENS_ERROR, SUB_CMD_NORM, sensError, 0, 0);
 
 #ifdef MOUSE_AVAILABLE
-	command_write(CMD_SENS_MOUSE, SUB_CMD_NORM, sensMouseDX, sensMouseDY, 0);
+		command_write(CMD_SENS_MOUSE, SUB_CMD_NORM, sensMouseDX, sensMouseDY, 0);
 #endif
+	}
 
 	command_write(CMD_DONE, SUB_CMD_NORM, 0, 0, 0);
 }
@@ -120,6 +123,22 @@ void set_bot_2_sim(void) {
 	cmd_functions.read = uart_read;
 	cmd_functions.crc_check = check_crc_dummy;
 	cmd_functions.crc_calc = calc_crc_dummy;
+	cmd_functions.peek = NULL;
+	cmd_functions.skip = NULL;
+}
+
+/**
+ * Sim bietet dem Bot eine Adresse an (SUB_ID_OFFER)
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void bot_2_sim_id_offer(command_t * cmd) {
+	LOG_DEBUG("Bekomme eine Adresse angeboten: %u", (uint8_t) cmd->data_l);
+	set_bot_address((uint8_t) cmd->data_l); // Setze Adresse
+	command_write(CMD_ID, SUB_ID_SET, cmd->data_l, 0, 0); // Und bestaetige dem Sim das ganze
+#ifdef BOT_2_BOT_AVAILABLE
+	/* hello (bot-)world! */
+	command_write_to(BOT_CMD_WELCOME, SUB_CMD_NORM, CMD_BROADCAST, 0, 0, 0);
+#endif // BOT_2_BOT_AVAILABLE
 }
 
 #endif // BOT_2_SIM_AVAILABLE
@@ -0,0 +1,219 @@
+/*
+ * c't-Bot
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ * This program is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307, USA.
+ *
+ */
+
+/**
+ * \file 	os_timer.c
+ * \brief 	Verzoegerte Ausfuehrung von Funktionen per hierarchischem Timer-Rad
+ * \date 	18.10.2026
+ */
+
+#include "ct-Bot.h"
+
+#if defined OS_AVAILABLE && defined PC
+#include "os_thread.h"
+#include "os_timer.h"
+#include <stddef.h>
+
+#define OS_TIMER_MASK	(OS_TIMER_SLOTS - 1)	/**< Maske fuer den Slot-Index einer Ebene */
+#define OS_TIMER_RANGE	((uint32_t) 1 << (OS_TIMER_BITS * OS_TIMER_LEVELS))	/**< Anzahl der Rad-Ticks, die das Rad abdeckt */
+
+static os_timer_t * wheel[OS_TIMER_LEVELS][OS_TIMER_SLOTS];	/**< Slots aller Ebenen, jeweils einfach verkettete Liste */
+static uint32_t wheel_tick = 0;		/**< naechster abzuarbeitender Rad-Tick */
+static uint16_t timer_count = 0;	/**< Anzahl der laufenden Timer */
+static os_timer_t delayed_func[OS_DELAYED_FUNC_CNT];	/**< Timer fuer os_delay_func() */
+
+/**
+ * Haengt einen Timer vorne in einen Slot ein
+ * \param **slot	Slot
+ * \param *timer	Timer
+ */
+static void timer_link(os_timer_t ** slot, os_timer_t * timer) {
+	timer->next = *slot;
+	if (*slot) {
+		(*slot)->pprev = &timer->next;
+	}
+	*slot = timer;
+	timer->pprev = slot;
+}
+
+/**
+ * Haengt einen Timer aus seinem Slot aus
+ * \param *timer	Timer
+ */
+static void timer_unlink(os_timer_t * timer) {
+	*timer->pprev = timer->next;
+	if (timer->next) {
+		timer->next->pprev = timer->pprev;
+	}
+	timer->next = NULL;
+	timer->pprev = NULL;
+}
+
+/**
+ * Sortiert einen Timer anhand seiner Restlaufzeit in die passende Ebene ein
+ * \param *timer	Timer mit gesetztem expires
+ */
+static void timer_insert(os_timer_t * timer) {
+	const int32_t remaining = (int32_t) (timer->expires - (wheel_tick << OS_TIMER_SHIFT));
+	/* aufrunden, damit die Funktion nie zu frueh laeuft */
+	uint32_t delta = remaining > 0 ? ((uint32_t) remaining + (1 << OS_TIMER_SHIFT) - 1) >> OS_TIMER_SHIFT : 0;
+	if (delta >= OS_TIMER_RANGE) {
+		delta = OS_TIMER_RANGE - 1; // wird beim Weiterschalten der obersten Ebene erneut einsortiert
+	}
+	const uint32_t target = wheel_tick + delta;
+	uint8_t level = 0;
+	while (level < OS_TIMER_LEVELS - 1 && delta >= ((uint32_t) 1 << (OS_TIMER_BITS * (level + 1)))) {
+		++level;
+	}
+	timer_link(&wheel[level][(target >> (OS_TIMER_BITS * level)) & OS_TIMER_MASK], timer);
+}
+
+/**
+ * Startet einen Timer, os_enterCS() muss bereits aufgerufen sein
+ * \param *timer	Timer, der nicht laufen darf
+ * \param now		aktuelle Systemzeit in Timer-Ticks
+ * \param delay_ms	Verzoegerung [ms]
+ */
+static void timer_add(os_timer_t * timer, uint32_t now, uint32_t delay_ms) {
+	if (timer_count == 0) {
+		/* Rad ist leer, also ohne Weiterschalten auf die aktuelle Zeit setzen */
+		wheel_tick = now >> OS_TIMER_SHIFT;
+	}
+	timer->expires = now + MS_TO_TICKS(delay_ms);
+	timer_insert(timer);
+	++timer_count;
+}
+
+/**
+ * Initialisiert einen Timer, muss vor der ersten Verwendung aufgerufen werden
+ * \param *timer	Timer
+ * \param p_func	Funktion, die beim Ablauf aufgerufen wird
+ * \param *p_data	Daten fuer die Funktion oder NULL
+ */
+void os_timer_init(os_timer_t * timer, os_delayed_func_ptr_t p_func, void * p_data) {
+	timer->next = NULL;
+	timer->pprev = NULL;
+	timer->expires = 0;
+	timer->p_func = p_func;
+	timer->p_data = p_data;
+}
+
+/**
+ * Startet einen Timer, ein bereits laufender Timer wird dabei neu gestartet
+ * \param *timer	Timer
+ * \param delay_ms	Zeit in ms, nach der die Funktion (fruehestens) ausgefuehrt werden soll
+ */
+void os_timer_start(os_timer_t * timer, uint32_t delay_ms) {
+	const uint32_t now = TIMER_GET_TICKCOUNT_32;
+	os_enterCS();
+	if (timer->pprev) {
+		timer_unlink(timer);
+		--timer_count;
+	}
+	timer_add(timer, now, delay_ms);
+	os_exitCS();
+}
+
+/**
+ * Haelt einen Timer an, bevor seine Funktion ausgefuehrt wird
+ * \param *timer	Timer
+ * \return			1, falls der Timer lief, 0 sonst
+ */
+uint8_t os_timer_cancel(os_timer_t * timer) {
+	uint8_t result = 0;
+	os_enterCS();
+	if (timer->pprev) {
+		timer_unlink(timer);
+		--timer_count;
+		result = 1;
+	}
+	os_exitCS();
+	return result;
+}
+
+/**
+ * Fuehrt alle Funktionen aus, deren Zeit abgelaufen ist
+ * \param now	aktuelle Systemzeit in Timer-Ticks
+ */
+void os_timer_run(uint32_t now) {
+	if (timer_count == 0) {
+		return;
+	}
+
+	os_enterCS();
+	while (timer_count && (int32_t) (now - (wheel_tick << OS_TIMER_SHIFT)) >= 0) {
+		const uint8_t index = (uint8_t) (wheel_tick & OS_TIMER_MASK);
+		if (index == 0) {
+			/* Ebene 0 ist uebergelaufen, naechsten Slot der Ebenen darueber verteilen */
+			uint8_t level;
+			for (level = 1; level < OS_TIMER_LEVELS; ++level) {
+				const uint8_t slot = (uint8_t) ((wheel_tick >> (OS_TIMER_BITS * level)) & OS_TIMER_MASK);
+				os_timer_t * timer;
+				while ((timer = wheel[level][slot]) != NULL) {
+					timer_unlink(timer);
+					timer_insert(timer);
+				}
+				if (slot != 0) {
+					break;
+				}
+			}
+		}
+
+		os_timer_t * timer;
+		while ((timer = wheel[0][index]) != NULL) {
+			timer_unlink(timer);
+			--timer_count;
+			/* Funktion ausserhalb des kritischen Abschnitts ausfuehren, sie darf selbst Timer starten */
+			const os_delayed_func_ptr_t p_func = timer->p_func;
+			void * const p_data = timer->p_data;
+			os_exitCS();
+			p_func(p_data);
+			os_enterCS();
+		}
+		++wheel_tick;
+	}
+	os_exitCS();
+}
+
+/**
+ * Registriert eine Funktion zur spaeteren Ausfuehrung.
+ * @param p_func Zeiger auf die Funktion
+ * @param p_data Zeiger auf Daten fuer die Funktion oder NULL
+ * @param delay_ms Zeit in ms, nach der die Funktion (fruehestens) ausgefuehrt werden soll
+ * @return 0, falls Funktion korrekt registriert werden konnte, 1 sonst
+ */
+uint8_t os_delay_func(os_delayed_func_ptr_t p_func, void* p_data, uint32_t delay_ms) {
+	const uint32_t now = TIMER_GET_TICKCOUNT_32;
+	uint8_t i;
+	os_enterCS();
+	for (i = 0; i < OS_DELAYED_FUNC_CNT; ++i) { // freien Platz suchen
+		os_timer_t * timer = &delayed_func[i];
+		if (! os_timer_pending(timer)) {
+			timer->p_func = p_func;
+			timer->p_data = p_data;
+			timer_add(timer, now, delay_ms);
+			os_exitCS();
+			return 0;
+		}
+	}
+	os_exitCS();
+	return 1;
+}
+
+#endif // OS_AVAILABLE && PC
@@ -156,6 +156,8 @@ void set_bot_2_atmega(void) {
 	cmd_functions.read = uart_read;
 	cmd_functions.crc_check = uart_check_crc;
 	cmd_functions.crc_calc = uart_calc_crc;
+	cmd_functions.peek = NULL;
+	cmd_functions.skip = NULL;
 }
 
 /**
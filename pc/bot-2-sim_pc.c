@@ -47,6 +47,7 @@
 #include "bot-2-atmega.h"
 #include "log.h"
 #include "led.h"
+#include "timer.h"
 
 
 //#define DEBUG_BOT_2_SIM       // Schalter, um auf einmal alle Debugs an oder aus zu machen
@@ -93,6 +94,45 @@ void gettimeofday_win(struct timeval * p, void * tz /* IGNORED */) {
 }
 #endif // WIN32
 
+#ifndef ARM_LINUX_BOARD
+uint8_t bot_2_sim_window = 0; /**< Pipeline-Fenster in Zyklen, 0: Lockstep */
+uint8_t bot_2_sim_free_running = 0; /**< Freilaufender Modus mit Systemzeit aus der Echtzeit */
+
+/**
+ * Verarbeitet im freilaufenden Modus alle Kommandos, die bis zum Ende des aktuellen Zyklus
+ * (BOT_2_SIM_FREE_CYCLE ms) eintreffen, und aktualisiert danach die Systemzeit
+ */
+static void bot_2_sim_listen_free(void) {
+	static struct timeval deadline = { 0, 0 };
+	struct timeval now;
+	GETTIMEOFDAY(&now, NULL);
+	long remaining = (deadline.tv_sec - now.tv_sec) * 1000L + (deadline.tv_usec - now.tv_usec) / 1000L;
+	if (remaining < -BOT_2_SIM_FREE_CYCLE || remaining > BOT_2_SIM_FREE_CYCLE) {
+		/* erster Aufruf oder zu weit hinterher, neu aufsetzen */
+		deadline = now;
+	}
+	deadline.tv_usec += BOT_2_SIM_FREE_CYCLE * 1000L;
+	if (deadline.tv_usec >= 1000000L) {
+		deadline.tv_usec -= 1000000L;
+		deadline.tv_sec++;
+	}
+
+	for (;;) {
+		GETTIMEOFDAY(&now, NULL);
+		remaining = (deadline.tv_sec - now.tv_sec) * 1000L + (deadline.tv_usec - now.tv_usec) / 1000L;
+		if (remaining <= 0) {
+			/* noch Gepuffertes kommt im naechsten Zyklus dran */
+			break;
+		}
+		if (tcp_data_wait((int) remaining) >= (int) sizeof(command_t) && command_read() == 0) {
+			command_evaluate();
+		}
+	}
+
+	system_time_realtime();
+}
+#endif // ! ARM_LINUX_BOARD
+
 /**
  * Empfaengt alle Kommondos vom Sim
  */
@@ -100,9 +140,21 @@ void bot_2_sim_listen(void) {
 	set_bot_2_sim();
 
 #ifndef ARM_LINUX_BOARD
+	if (bot_2_sim_free_running) {
+		bot_2_sim_listen_free();
+		return;
+	}
+	/* im Pipeline-Modus liegt der naechste Zyklus meist schon im Empfangspuffer */
 	while (receive_until_frame(CMD_DONE) != 0) {}
 #else
-	if (tcp_client_connected() && tcp_data_available() >= (int) sizeof(command_t)) {
+	const int avail = tcp_data_available();
+	if (tcp_client_accepted()) {
+		/* neuer Client (z.B. Sim nach Reconnect), Bot anmelden */
+		LOG_DEBUG("New TCP client, registering bot");
+		register_bot();
+		flushSendBuffer();
+	}
+	if (avail >= (int) sizeof(command_t)) {
 		LOG_DEBUG("Data from Sim available");
 		if (command_read() == 0) {
 			LOG_DEBUG("Sim command read");
@@ -120,8 +172,24 @@ void set_bot_2_sim(void) {
 	cmd_functions.read = tcp_read;
 	cmd_functions.crc_check = tcp_check_crc;
 	cmd_functions.crc_calc = tcp_calc_crc;
+	cmd_functions.peek = tcp_peek;
+	cmd_functions.skip = tcp_skip;
 }
 
+#if ! defined ARM_LINUX_BOARD || defined BOT_2_BOT_AVAILABLE
+/**
+ * Wartet auf das Ende des naechsten Sim-Zyklus (CMD_DONE), im freilaufenden Modus wird nicht gewartet
+ */
+static void bot_2_sim_wait_done(void) {
+#ifndef ARM_LINUX_BOARD
+	if (bot_2_sim_free_running) {
+		return;
+	}
+#endif // ! ARM_LINUX_BOARD
+	receive_until_frame(CMD_DONE);
+}
+#endif // ! ARM_LINUX_BOARD || BOT_2_BOT_AVAILABLE
+
 /**
  * Initialisiert die Kommunikation mit dem Sim
  */
@@ -136,17 +204,17 @@ void bot_2_sim_init(void) {
 	flushSendBuffer();
 
 #ifndef ARM_LINUX_BOARD
-	receive_until_frame(CMD_DONE);
-	command_write(CMD_DONE, SUB_CMD_NORM, simultime, 0, 0);
+	bot_2_sim_wait_done();
+	command_write(CMD_DONE, SUB_CMD_NORM, simultime, simulcycle, 0);
 #endif // ARM_LINUX_BOARD
 
 #ifdef BOT_2_BOT_AVAILABLE
-	receive_until_frame(CMD_DONE);
+	bot_2_sim_wait_done();
 	/* hello (bot-)world! */
 	if (get_bot_address() <= 127) {
 		command_write_to(BOT_CMD_WELCOME, SUB_CMD_NORM, CMD_BROADCAST, 0, 0, 0);
 	}
-	command_write(CMD_DONE, SUB_CMD_NORM, simultime, 0, 0);
+	command_write(CMD_DONE, SUB_CMD_NORM, simultime, simulcycle, 0);
 #endif // BOT_2_BOT_AVAILABLE
 }
 
@@ -162,31 +230,48 @@ void bot_2_sim_inform(void) {
 	cmd_func_t old_func = cmd_functions;
 	set_bot_2_sim();
 
-	command_write(CMD_AKT_MOT, SUB_CMD_NORM, speed_l, speed_r, 0);
-	command_write(CMD_SENS_IR, SUB_CMD_NORM, sensDistL, sensDistR, 0);
-	command_write(CMD_SENS_ENC, SUB_CMD_NORM, sensEncL, sensEncR, 0);
-	command_write(CMD_SENS_BORDER, SUB_CMD_NORM, sensBorderL, sensBorderR, 0);
-	command_write(CMD_SENS_LINE, SUB_CMD_NORM, sensLineL, sensLineR, 0);
-	command_write(CMD_SENS_LDR, SUB_CMD_NORM , sensLDRL, sensLDRR, 0);
+	if (command_write_snapshot() != 0) {
+		/* Sim kennt (noch) keine Snapshots, einzelne Kommandos senden */
+		command_write(CMD_AKT_MOT, SUB_CMD_NORM, speed_l, speed_r, 0);
+		command_write(CMD_SENS_IR, SUB_CMD_NORM, sensDistL, sensDistR, 0);
+		command_write(CMD_SENS_ENC, SUB_CMD_NORM, sensEncL, sensEncR, 0);
+		command_write(CMD_SENS_BORDER, SUB_CMD_NORM, sensBorderL, sensBorderR, 0);
+		command_write(CMD_SENS_LINE, SUB_CMD_NORM, sensLineL, sensLineR, 0);
+		command_write(CMD_SENS_LDR, SUB_CMD_NORM , sensLDRL, sensLDRR, 0);
 #ifdef BPS_AVAILABLE
-	command_write(CMD_SENS_BPS, SUB_CMD_NORM , (int16_t) sensBPS, 0, 0);
+		command_write(CMD_SENS_BPS, SUB_CMD_NORM , (int16_t) sensBPS, 0, 0);
 #endif // BPS_AVAILABLE
 
 #ifdef LED_AVAILABLE
-	command_write(CMD_AKT_LED, SUB_CMD_NORM, led, 0, 0);
+		command_write(CMD_AKT_LED, SUB_CMD_NORM, led, 0, 0);
 #endif
-	command_write(CMD_SENS_TRANS, SUB_CMD_NORM, sensTrans, 0, 0);
-	command_write(CMD_SENS_DOOR, SUB_CMD_NORM, sensDoor, 0, 0);
-	command_write(CMD_SENS_ERROR, SUB_CMD_NORM, sensError, 0, 0);
+		command_write(CMD_SENS_TRANS, SUB_CMD_NORM, sensTrans, 0, 0);
+		command_write(CMD_SENS_DOOR, SUB_CMD_NORM, sensDoor, 0, 0);
+		command_write(CMD_SENS_ERROR, SUB_CMD_NORM, sensError, 0, 0);
 
 #ifdef MOUSE_AVAILABLE
-	command_write(CMD_SENS_MOUSE, SUB_CMD_NORM, sensMouseDX, sensMouseDY, 0);
+		command_write(CMD_SENS_MOUSE, SUB_CMD_NORM, sensMouseDX, sensMouseDY, 0);
 #endif
+	}
 
 	command_write(CMD_DONE, SUB_CMD_NORM, 0, 0, 0);
 	cmd_functions = old_func;
 #endif // ARM_LINUX_BOARD
 }
 
+/**
+ * Sim bietet dem Bot eine Adresse an (SUB_ID_OFFER)
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void bot_2_sim_id_offer(command_t * cmd) {
+	LOG_DEBUG("Bekomme eine Adresse angeboten: %u", (uint8_t) cmd->data_l);
+	set_bot_address((uint8_t) cmd->data_l); // Setze Adresse
+	command_write(CMD_ID, SUB_ID_SET, cmd->data_l, 0, 0); // Und bestaetige dem Sim das ganze
+#ifdef BOT_2_BOT_AVAILABLE
+	/* hello (bot-)world! */
+	command_write_to(BOT_CMD_WELCOME, SUB_CMD_NORM, CMD_BROADCAST, 0, 0, 0);
+#endif // BOT_2_BOT_AVAILABLE
+}
+
 #endif // BOT_2_SIM_AVAILABLE
 #endif // PC
@@ -28,6 +28,9 @@
 #include "ct-Bot.h"
 #include "cmd_tools.h"
 #include "tcp-server.h"
+#include "bot-2-sim.h"
+#include "sim-headless.h"
+#include "sim-swarm.h"
 #include "map.h"
 #include "eeprom.h"
 #include "command.h"
@@ -53,17 +56,34 @@ static pthread_t cmd_thread; /**< Thread fuer die RemoteCall-Auswertung per Komm
  * Zeigt Informationen zu den moeglichen Kommandozeilenargumenten an.
  */
 static void usage(void) {
-	puts("USAGE: ct-Bot [-t host] [-a address] [-T] [-s] [-u RUNS] [-M FILE] [-m FILE] [-h]");
+	puts("USAGE: ct-Bot [-t host] [-U PATH] [-S WORLD] [-N COUNT] [-P N] [-R] [-a address] [-T] [-s] [-B SPEC] [-u RUNS] [-M FILE] [-m FILE] [-h]");
 	puts("\t-t\tHostname oder IP Adresse zu der Verbunden werden soll");
+	puts("\t-U PATH\tVerbindet sich ueber den Unix-Domain-Socket PATH mit einem Sim auf demselben Rechner statt per TCP/IP");
+#ifndef ARM_LINUX_BOARD
+	puts("\t-S WORLD\tStartet den eingebauten Sim ohne GUI mit der Welt aus PGM-Datei WORLD (\"-\" fuer die Test-Arena), simuliert schneller als Echtzeit");
+#ifndef WIN32
+	puts("\t-N COUNT\tForkt COUNT Bot-Prozesse mit eingebautem Sim (nur mit -S, nicht mit -m), Adressen ab -a, vermittelt Bot-2-Bot-Kommandos, simulierte Uhren im Gleichschritt");
+	puts("\t\tZeilen \"ADRESSE:RemoteCall\" auf stdin gehen an einen Bot, alle anderen an alle Bots");
+#endif
+	puts("\t-P N\tPipeline-Modus: Der Sim darf bis zu N Zyklen vorauslaufen, bevor er auf die Quittung des Bots wartet");
+	puts("\t-R\tFreilaufender Modus: Systemzeit aus der Echtzeit, der Bot wartet nicht auf den Sim (Hardware-in-the-Loop)");
+#endif
 	puts("\t-a\tAdresse des Bots (fuer Bot-2-Bot-Kommunikation), default: 0");
 	puts("\t-T\tTestClient");
 	puts("\t-s\tServermodus");
+#ifndef WIN32
+	puts("\t-B SPEC\tBenchmark fuer Transport und Parser mit Echo-Clients, SPEC: key=value[,...] oder \"-\"");
+	puts("\t\truns, warmup, clients, payload, mix (Kommandos einer Runde), format (csv / json), out (Datei), label");
+#endif
 #ifdef ARM_LINUX_BOARD
 	puts("\t-u RUNS\tUART-Test");
 #endif
 #ifdef MAP_AVAILABLE
 	puts("\t-M FILE\tKonvertiert eine Bot-Map aus Datei FILE in eine PGM-Datei");
 	puts("\t-m FILE\tGibt den Pfad zu einer Datei FILE an, die vom Map-Code verwendet wird (Ex- und Import)");
+#ifdef MAP_SPARSE_FILES
+	puts("\t\tExportierte Karten enthalten nur die belegten Sections, Karten im alten Format (komplette Map-Datei) werden weiterhin gelesen");
+#endif
 #else
 	puts("\t\tACHTUNG, das Programm wurde ohne MAP_AVAILABLE uebersetzt, die Optionen -M / -m stehen derzeit also NICHT zur Verfuegung");
 #endif
@@ -85,11 +105,11 @@ void hand_cmd_args(int argc, char * argv[]) {
 	strcpy(tcp_hostname, IP);
 
 	int ch;
+	int swarm = 0;
+	uint8_t headless = 0;
+	uint8_t map_loaded = 0;
 	/* Die Kommandozeilenargumente komplett verarbeiten */
-	while ((ch = getopt(argc, argv, "hsTu:Et:M:m:c:l:e:d:a:i:fk:o:F:")) != -1) {
-		argc -= optind;
-		argv += optind;
-
+	while ((ch = getopt(argc, argv, "hsTB:u:U:S:N:P:REt:M:m:c:l:e:d:a:i:fk:o:F:")) != -1) {
 		switch (ch) {
 		case 's': {
 #ifdef BOT_2_SIM_AVAILABLE
@@ -116,6 +136,17 @@ void hand_cmd_args(int argc, char * argv[]) {
 			break;
 		}
 
+		case 'B': {
+#if defined BOT_2_SIM_AVAILABLE && ! defined WIN32
+			/* Benchmark starten */
+			tcp_benchmark_run(optarg); // beendet per exit()
+#else
+			puts("Fehler, Binary wurde ohne BOT_2_SIM_AVAILABLE compiliert oder Benchmark unter Windows nicht verfuegbar!");
+			exit(1);
+#endif // BOT_2_SIM_AVAILABLE && ! WIN32
+			break;
+		}
+
 		case 'u': {
 #ifdef ARM_LINUX_BOARD
 			long long int n = atoll(optarg);
@@ -139,6 +170,76 @@ void hand_cmd_args(int argc, char * argv[]) {
 			break;
 		}
 
+		case 'U': {
+#ifndef WIN32
+			/* Pfad zum Unix-Domain-Socket des Sims wurde uebergeben */
+			tcp_unix_path = strdup(optarg);
+			if (tcp_unix_path == NULL) {
+				exit(1);
+			}
+#else
+			puts("Unix-Domain-Sockets werden unter Windows nicht unterstuetzt");
+			exit(1);
+#endif // ! WIN32
+			break;
+		}
+
+		case 'S': {
+#if defined BOT_2_SIM_AVAILABLE && ! defined ARM_LINUX_BOARD
+			/* Eingebauten Sim mit der uebergebenen Welt verwenden */
+			if (sim_headless_init(optarg) != 0) {
+				exit(1);
+			}
+			headless = 1;
+#else
+			puts("Fehler, der eingebaute Sim steht in diesem Binary nicht zur Verfuegung!");
+			exit(1);
+#endif // BOT_2_SIM_AVAILABLE && ! ARM_LINUX_BOARD
+			break;
+		}
+
+		case 'N': {
+#if defined BOT_2_SIM_AVAILABLE && ! defined ARM_LINUX_BOARD && ! defined WIN32
+			/* Anzahl der Bots im Schwarm, gestartet wird erst nach allen anderen Argumenten */
+			swarm = atoi(optarg);
+			if (swarm < 1 || swarm > SIM_SWARM_MAX_BOTS) {
+				printf("Anzahl der Bots muss zwischen 1 und %d liegen\n", SIM_SWARM_MAX_BOTS);
+				exit(1);
+			}
+#else
+			puts("Fehler, der Schwarm-Modus steht in diesem Binary nicht zur Verfuegung!");
+			exit(1);
+#endif // BOT_2_SIM_AVAILABLE && ! ARM_LINUX_BOARD && ! WIN32
+			break;
+		}
+
+		case 'P': {
+#if defined BOT_2_SIM_AVAILABLE && ! defined ARM_LINUX_BOARD
+			/* Pipeline-Fenster fuer den Sim */
+			const int window = atoi(optarg);
+			if (window < 1 || window > BOT_2_SIM_MAX_WINDOW) {
+				printf("Pipeline-Fenster muss zwischen 1 und %d liegen\n", BOT_2_SIM_MAX_WINDOW);
+				exit(1);
+			}
+			bot_2_sim_window = (uint8_t) window;
+#else
+			puts("Fehler, der Pipeline-Modus steht in diesem Binary nicht zur Verfuegung!");
+			exit(1);
+#endif // BOT_2_SIM_AVAILABLE && ! ARM_LINUX_BOARD
+			break;
+		}
+
+		case 'R': {
+#if defined BOT_2_SIM_AVAILABLE && ! defined ARM_LINUX_BOARD
+			/* Systemzeit aus der Echtzeit statt aus simultime */
+			bot_2_sim_free_running = 1;
+#else
+			puts("Fehler, der freilaufende Modus steht in diesem Binary nicht zur Verfuegung!");
+			exit(1);
+#endif // BOT_2_SIM_AVAILABLE && ! ARM_LINUX_BOARD
+			break;
+		}
+
 		case 'a': {
 			/* Bot-Adresse wurde uebergeben */
 			int addr = atoi(optarg);
@@ -191,6 +292,7 @@ void hand_cmd_args(int argc, char * argv[]) {
 			printf("Lese Karte von \"%s\" ein\n", optarg);
 			map_init();
 			map_load_from_file(optarg);
+			map_loaded = 1;
 #endif // MAP_AVAILABLE
 			break;
 		}
@@ -202,6 +304,23 @@ void hand_cmd_args(int argc, char * argv[]) {
 			exit(0);
 		}
 	}
+
+#if defined BOT_2_SIM_AVAILABLE && ! defined ARM_LINUX_BOARD && ! defined WIN32
+	if (swarm) {
+		/* Erst hier forken, damit alle Bots dieselben Argumente haben. Vor dem Fork darf kein Thread laufen. */
+		if (! headless || map_loaded) {
+			puts("Der Schwarm-Modus braucht den eingebauten Sim (-S) und ist nicht mit -m kombinierbar");
+			exit(1);
+		}
+		if (sim_swarm_start((uint8_t) swarm) != 0) {
+			exit(1);
+		}
+	}
+#else
+	(void) swarm;
+	(void) headless;
+	(void) map_loaded;
+#endif // BOT_2_SIM_AVAILABLE && ! ARM_LINUX_BOARD && ! WIN32
 }
 
 #ifdef BEHAVIOUR_REMOTECALL_AVAILABLE
@@ -33,9 +33,11 @@
 #include "command.h"
 #include "bot-2-atmega.h"
 #include "uart.h"
+#include "tcp.h"
 #include "botcontrol.h"
 #include "delay.h"
 #include "sensor.h"
+#include "os_thread.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -71,6 +73,10 @@ void ctbot_init_low_1st(int argc, char * argv[]) {
 
 	printf("c't-Bot\n");
 
+#ifdef OS_AVAILABLE
+	os_create_thread(NULL, NULL); // Hauptthread anlegen
+#endif
+
 #ifdef CREATE_TRACEFILE_AVAILABLE
 	trace_init();
 #endif // CREATE_TRACEFILE_AVAILABLE
@@ -105,6 +111,9 @@ void ctbot_shutdown_low(void) {
 	uart_flush();
 	uart_close();
 #endif // ARM_LINUX_BOARD
+#ifdef BOT_2_SIM_AVAILABLE
+	tcp_wait_sent(); // noch wartende Daten an den Sim uebertragen
+#endif
 	puts("c't-Bot shutdown. So long, and thanks for all the fish.");
 	exit(0);
 }
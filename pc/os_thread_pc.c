@@ -29,7 +29,17 @@
 
 #ifdef OS_AVAILABLE
 #include "os_thread.h"
+#include "os_timer.h"
 #include "log.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#endif
 
 //#define DEBUG_THREADING	/**< Schalter fuer Debug-Ausgaben */
 #define DEBUG_THREAD_N	-1	/**< Thread, dessen Vorgaenge debuggt werden sollen (0-based), -1 fuer alle */
@@ -42,24 +52,75 @@
 #define LOG_DEBUG(...) {}
 #endif
 
+#define OS_NICE_STEP	5	/**< Abstand der nice-Werte zweier Threads mit benachbarter Prioritaet */
+
 
-Tcb_t os_threads[OS_MAX_THREADS];	/**< Array aller Threads */
+Tcb_t os_threads[OS_MAX_THREADS];	/**< Array aller Threads, Eintrag 0 ist der Hauptthread */
 Tcb_t * os_thread_running = NULL;	/**< Zeiger auf den Thread, der gerade laeuft */
 pthread_mutex_t os_enterCS_mutex = PTHREAD_MUTEX_INITIALIZER;	/**< Mutex fuer os_enterCS() / os_exitCS() auf PC */
 
+static pthread_mutex_t sched_mutex = PTHREAD_MUTEX_INITIALIZER;	/**< schuetzt state und nextSchedule aller TCBs */
+static pthread_cond_t sched_cond = PTHREAD_COND_INITIALIZER;	/**< signalisiert neue Systemzeit oder Zustandswechsel eines Threads */
+static void (* thread_main[OS_MAX_THREADS])(void);				/**< Main-Funktionen der angelegten Threads */
+
 /**
  * Gibt einen Zeiger auf den TCB des aktuellen Threads zurueck
- * \return	Zeiger auf TCB aus os_threads[]
+ * \return	Zeiger auf TCB aus os_threads[] oder NULL, falls der Thread nicht per os_create_thread() angelegt wurde
  */
 static Tcb_t * get_this_thread(void) {
-#ifndef WIN32
+	const pthread_t self = pthread_self();
 	uint8_t i;
-	for (i=0; i<OS_MAX_THREADS-1; i++) {
-		if (os_threads[i] == pthread_self()) {
+	for (i = 0; i < OS_MAX_THREADS; ++i) {
+		if (os_threads[i].state != OS_THREAD_FREE && pthread_equal(os_threads[i].thread, self)) {
 			return &os_threads[i];
 		}
 	}
-#endif	// WIN32
+	return NULL;
+}
+
+/**
+ * Setzt den Zustand eines Threads und benachrichtigt einen wartenden Hauptthread
+ * \param *thread	TCB des Threads oder NULL
+ * \param state		neuer Zustand
+ */
+static void set_state(Tcb_t * thread, uint8_t state) {
+	if (thread == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&sched_mutex);
+	thread->state = state;
+	pthread_cond_broadcast(&sched_cond);
+	pthread_mutex_unlock(&sched_mutex);
+}
+
+/**
+ * Startfunktion aller per os_create_thread() angelegten Threads. Traegt den Thread in seinen TCB ein,
+ * setzt seine Prioritaet und springt dann in seine Main-Funktion.
+ * \param *arg	Zeiger auf den TCB des Threads
+ * \return		NULL
+ */
+static void * thread_start(void * arg) {
+	Tcb_t * thread = arg;
+	const uint8_t index = (uint8_t) (thread - os_threads);
+	pthread_mutex_lock(&sched_mutex);
+	thread->thread = pthread_self();
+	thread->state = OS_THREAD_RUNNING;
+	pthread_mutex_unlock(&sched_mutex);
+
+#ifdef __linux__
+	/* Prioritaet wie auf dem MCU nach Reihenfolge der Erzeugung, dazu den nice-Wert des Threads erhoehen
+	 * (das darf jeder Prozess, senken duerfte nur root) */
+	const id_t tid = (id_t) syscall(SYS_gettid);
+	errno = 0;
+	const int nice = getpriority(PRIO_PROCESS, tid);
+	if (errno == 0 && setpriority(PRIO_PROCESS, tid, nice + index * OS_NICE_STEP) != 0) {
+		LOG_DEBUG("Prioritaet von Thread %u konnte nicht gesetzt werden", index);
+	}
+#endif // __linux__
+
+	LOG_DEBUG("Thread %u gestartet", index);
+	thread_main[index]();
+	set_state(thread, OS_THREAD_FREE);
 	return NULL;
 }
 
@@ -68,6 +129,7 @@ static Tcb_t * get_this_thread(void) {
  * Der zuerst angelegt Thread bekommt die hoechste Prioritaet,
  * je spaeter ein Thread erzeugt wird, desto niedriger ist seine
  * Prioritaet, das laesst sich auch nicht mehr aendern!
+ * Wie auf dem MCU traegt ein Aufruf mit pIp == NULL den aufrufenden Thread als Hauptthread ein.
  * \param *pStack	Zeiger auf den Stack (Ende!) des neuen Threads
  * \param *pIp		Zeiger auf die Main-Funktion des Threads (Instruction-Pointer)
  * \return			Zeiger auf den TCB des angelegten Threads
@@ -75,41 +137,150 @@ static Tcb_t * get_this_thread(void) {
 Tcb_t * os_create_thread(void * pStack, void (* pIp)(void)) {
 	static uint8_t thread_count = 0;
 	(void) pStack; // kein warning
-	if (thread_count == OS_MAX_THREADS - 1) {	// Main-Thread existiert fuer PC nicht im Array
+	if (thread_count == OS_MAX_THREADS) {
 		/* kein Thread mehr moeglich */
 		LOG_ERROR("Thread konnte nicht angelegt werden");
 		return NULL;
 	}
-	uint8_t i = thread_count;
+	if (thread_count == 0 && pIp != NULL) {
+		/* Hauptthread wurde noch nicht eingetragen, Eintrag 0 bleibt fuer ihn reserviert */
+		thread_count = 1;
+	}
+	const uint8_t i = thread_count;
+	Tcb_t * thread = &os_threads[i];
+	thread->nextSchedule = 0;
+	thread->lastSchedule = 0;
+#ifdef MEASURE_UTILIZATION
+	thread->cpu_time = 0;
+	memset(&thread->statistics, 0, sizeof(thread->statistics));
+#endif
+
+	if (pIp == NULL) {
+		pthread_mutex_lock(&sched_mutex);
+		thread->thread = pthread_self();
+		thread->state = OS_THREAD_RUNNING;
+		pthread_mutex_unlock(&sched_mutex);
+		os_thread_running = thread;
+	} else {
+		thread_main[i] = pIp;
+		pthread_t tid;
+		if (pthread_create(&tid, NULL, thread_start, thread) != 0) {
+			LOG_ERROR("Thread konnte nicht angelegt werden");
+			return NULL;
+		}
+		pthread_detach(tid);
+	}
 	thread_count++;
-	pthread_create(&os_threads[i], NULL, (void * (*)(void *)) pIp, NULL);
-	LOG_DEBUG("Thread 0x%08x als Thread Nr. %u angelegt", &os_threads[i], i);
+	LOG_DEBUG("Thread %p als Thread Nr. %u angelegt", thread, i);
 	/* Zeiger auf TCB des Threads zurueckgeben */
-	return &os_threads[i];
+	return thread;
 }
 
 /**
  * Schaltet auf den Thread mit der naechst niedrigeren Prioritaet um, der lauffaehig ist,
  * indem diesem der Rest der Zeitscheibe geschenkt wird.
- * Auf PC ueberlassen wir diese Aufgabe dem Scheduler
+ * Auf PC ueberlassen wir das Umschalten dem Scheduler des Betriebssystems, zaehlen aber wie auf dem
+ * MCU eine verpasste Deadline, wenn der Thread seit dem letzten Aufruf mehr als OS_TIME_SLICE ms
+ * gerechnet hat. Die Systemzeit taugt dafuer nicht, sie laeuft mit simultime immer um einen Zyklus weiter.
  */
 void os_thread_yield(void) {
+#if defined MEASURE_UTILIZATION && ! defined WIN32
+	Tcb_t * thread = get_this_thread();
+	struct timespec ts;
+	if (thread && clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+		const uint32_t now = (uint32_t) ts.tv_sec * 1000000UL + (uint32_t) (ts.tv_nsec / 1000L);
+		if (now - thread->lastSchedule > OS_TIME_SLICE * 1000UL) {
+			/* Zaehler fuer verpasste Deadlines erhoehen */
+			os_enterCS();
+			thread->statistics.missed_deadlines++;
+			os_exitCS();
+		}
+		thread->lastSchedule = now;
+	}
+#endif // MEASURE_UTILIZATION && ! WIN32
 	sched_yield();
 }
 
+/**
+ * Prueft, ob alle Threads ausser dem Hauptthread gerade schlafen oder blockiert sind
+ * \return	1, falls kein anderer Thread mehr rechnen moechte, sonst 0
+ */
+static uint8_t others_idle(void) {
+	uint8_t i;
+	for (i = 1; i < OS_MAX_THREADS; ++i) {
+		if (os_threads[i].state == OS_THREAD_RUNNING) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
 /**
  * Blockiert den aktuellten Thread fuer die angegebene Zeit und schaltet
  * auf einen anderen Thread um
  * => coorporative threadswitch
+ *
+ * Andere Threads schlafen gegen die Systemzeit (tickCount), die mit simultime weiterzaehlt, und werden von
+ * os_time_update() geweckt. Der Hauptthread zaehlt die Systemzeit aber selbst weiter und kann nicht auf sie
+ * warten. Er ueberlaesst die CPU stattdessen den Threads mit niedrigerer Prioritaet, bis diese alle schlafen
+ * oder blockiert sind, hoechstens aber fuer ms Echtzeit.
  * \param ms	Zeit in ms, die der aktuelle Thread blockiert wird
  */
 void os_thread_sleep(uint32_t ms) {
-	(void) ms; // kein warning
-	// NOP
 	Tcb_t * thread = get_this_thread();
 	if (DEBUG_THREAD_N == -1 || thread == &os_threads[DEBUG_THREAD_N]) {
-		LOG_DEBUG("Thread %p soll %u ms schlafen, os_thread_sleep() ist aber nicht implementiert", thread, ms);
+		LOG_DEBUG("Thread %p soll %u ms schlafen", thread, ms);
+	}
+
+	pthread_mutex_lock(&sched_mutex);
+	if (thread == NULL || thread == &os_threads[0]) {
+		struct timespec until;
+		clock_gettime(CLOCK_REALTIME, &until);
+		until.tv_sec += (time_t) (ms / 1000U);
+		until.tv_nsec += (long) (ms % 1000U) * 1000000L;
+		if (until.tv_nsec >= 1000000000L) {
+			until.tv_sec++;
+			until.tv_nsec -= 1000000000L;
+		}
+		while (! others_idle()) {
+			if (pthread_cond_timedwait(&sched_cond, &sched_mutex, &until) == ETIMEDOUT) {
+				break;
+			}
+		}
+	} else {
+		thread->nextSchedule = TIMER_GET_TICKCOUNT_32 + MS_TO_TICKS(ms);
+		thread->state = OS_THREAD_SLEEPING;
+		pthread_cond_broadcast(&sched_cond);
+		while ((int32_t) (thread->nextSchedule - TIMER_GET_TICKCOUNT_32) > 0) {
+			pthread_cond_wait(&sched_cond, &sched_mutex);
+		}
+		thread->state = OS_THREAD_RUNNING;
+	}
+	pthread_mutex_unlock(&sched_mutex);
+
+	if (DEBUG_THREAD_N == -1 || thread == &os_threads[DEBUG_THREAD_N]) {
+		LOG_DEBUG("Thread %p laeuft weiter", thread);
+	}
+}
+
+/**
+ * Weckt alle Threads, deren Schlafenszeit abgelaufen ist, und fuehrt abgelaufene verzoegerte Funktionen
+ * aus. Wird im Hauptthread aufgerufen, nachdem die Systemzeit weitergezaehlt wurde.
+ */
+void os_time_update(void) {
+	const uint32_t now = TIMER_GET_TICKCOUNT_32;
+	uint8_t i;
+	pthread_mutex_lock(&sched_mutex);
+	for (i = 1; i < OS_MAX_THREADS; ++i) {
+		if (os_threads[i].state == OS_THREAD_SLEEPING && (int32_t) (os_threads[i].nextSchedule - now) <= 0) {
+			pthread_cond_broadcast(&sched_cond);
+			break;
+		}
 	}
+	pthread_mutex_unlock(&sched_mutex);
+
+	/* abgelaufene verzoegerte Funktionen ausfuehren */
+	os_timer_run(now);
 }
 
 /**
@@ -126,7 +297,11 @@ void os_signal_set(os_signal_t * signal) {
 		if (DEBUG_THREAD_N == -1 || thread == &os_threads[DEBUG_THREAD_N]) {
 			LOG_DEBUG("Thread %p wird blockiert", thread);
 		}
-		pthread_cond_wait(&signal->cond, &signal->mutex);
+		set_state(thread, OS_THREAD_BLOCKED);
+		while (signal->value == 1) {
+			pthread_cond_wait(&signal->cond, &signal->mutex);
+		}
+		set_state(thread, OS_THREAD_RUNNING);
 		if (DEBUG_THREAD_N == -1 || thread == &os_threads[DEBUG_THREAD_N]) {
 			LOG_DEBUG("Thread %p laeuft weiter", thread);
 		}
@@ -174,5 +349,129 @@ void os_signal_unlock(os_signal_t * signal) {
 	}
 }
 
+#ifdef MEASURE_UTILIZATION
+#define UTIL_LOG_TIME		25  /**< Zeitintervall zwischen zwei Auslastungsberechnungen [ms] */
+#define MAX_UTIL_ENTRIES	256 /**< Maximale Anzahl an Auslastungsdatensaetzen (muss 2er-Potenz sein!) */
+
+static uint8_t util_data[MAX_UTIL_ENTRIES][OS_MAX_THREADS]; /**< Puffer fuer Auslastungsstatistik */
+static uint16_t missed_deadlines[OS_MAX_THREADS]; /**< Anzahl der nicht eingehaltenen Deadlines */
+static uint16_t util_count = 0;		 /**< Anzahl der Eintraege im Puffer */
+static uint16_t last_util_time = 0;  /**< Zeitpunkt der letzten Erstellung einer Auslastungsstatistik */
+static uint32_t first_util_time = 0; /**< Zeitpunkt der ersten Erstellung einer Auslastungsstatistik */
+static uint32_t util_runtime = 0;	 /**< CPU-Zeit aller Threads seit os_clear_utilization() [176 us] */
+
+/**
+ * Ermittelt die CPU-Zeit, die ein Thread bisher verbraucht hat
+ * \param *thread	TCB des Threads
+ * \return			CPU-Zeit [ns] oder 0, falls nicht verfuegbar
+ */
+static uint64_t get_cpu_time(const Tcb_t * thread) {
+#ifndef WIN32
+	clockid_t cid;
+	struct timespec ts;
+	if (thread->state != OS_THREAD_FREE && pthread_getcpuclockid(thread->thread, &cid) == 0 && clock_gettime(cid, &ts) == 0) {
+		return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+	}
+#else
+	(void) thread; // kein warning
+#endif // ! WIN32
+	return 0;
+}
+
+/**
+ * Aktualisiert die Statistikdaten zur CPU-Auslastung.
+ * Anders als auf dem MCU laufen die Threads auf dem PC parallel, die Laufzeit ist daher die CPU-Zeit
+ * jedes Threads und die Anteile beziehen sich auf die Summe aller Threads.
+ */
+void os_calc_utilization(void) {
+	if (timer_ms_passed_16(&last_util_time, UTIL_LOG_TIME)) {
+		os_stat_data_t data[OS_MAX_THREADS];
+		uint8_t i;
+
+		/* Daten aus den TCBs holen */
+		uint32_t sum = 0;
+		os_enterCS();
+		for (i = 0; i < OS_MAX_THREADS; ++i) {
+			const uint64_t cpu = get_cpu_time(&os_threads[i]);
+			uint64_t ticks = 0;
+			if (cpu > os_threads[i].cpu_time) {
+				/* Rest unter einem Tick fuer das naechste Mal aufheben */
+				ticks = (cpu - os_threads[i].cpu_time) / (TIMER_STEPS * 1000ULL);
+				if (ticks > UINT16_MAX) {
+					ticks = UINT16_MAX;
+				}
+				os_threads[i].cpu_time += ticks * TIMER_STEPS * 1000ULL;
+			} else {
+				os_threads[i].cpu_time = cpu;
+			}
+			os_threads[i].statistics.runtime = (uint16_t) ticks;
+			data[i] = os_threads[i].statistics;
+			sum += data[i].runtime;
+			os_threads[i].statistics.runtime = 0;
+			os_threads[i].statistics.missed_deadlines = 0;
+		}
+		os_exitCS();
+
+		if (sum == 0) {
+			return; // keine neuen Daten vorhanden
+		}
+		util_runtime += sum;
+
+		/* Auslastung in % berechnen */
+		for (i = 0; i < OS_MAX_THREADS; ++i) {
+			missed_deadlines[i] += data[i].missed_deadlines;
+			util_data[util_count][i] = (uint8_t) (data[i].runtime * 100UL / sum);
+		}
+		util_count++;
+		util_count &= MAX_UTIL_ENTRIES - 1;
+	}
+}
+
+/**
+ * Loescht alle Statistikdaten zur CPU-Auslastung
+ */
+void os_clear_utilization(void) {
+	uint8_t i;
+	os_enterCS();
+	for (i = 0; i < OS_MAX_THREADS; ++i) {
+		os_threads[i].cpu_time = get_cpu_time(&os_threads[i]);
+		os_threads[i].statistics.runtime = 0;
+		os_threads[i].statistics.missed_deadlines = 0;
+		missed_deadlines[i] = 0;
+	}
+	first_util_time = TIMER_GET_TICKCOUNT_32;
+	util_runtime = 0;
+	util_count = 0;
+	os_exitCS();
+}
+
+/**
+ * Gibt die gesammelten Statistikdaten zur CPU-Auslastung per LOG aus
+ */
+void os_print_utilization(void) {
+	char line[OS_MAX_THREADS * 8 + 1];
+	uint16_t i;
+	uint8_t j;
+	size_t len;
+	for (i = 0; i < util_count; ++i) {
+		len = 0;
+		for (j = 0; j < OS_MAX_THREADS; ++j) {
+			len += (size_t) snprintf(&line[len], sizeof(line) - len, "%3u\t", util_data[i][j]);
+		}
+		LOG_INFO("%s", line);
+	}
+
+	LOG_INFO("Missed deadlines:");
+	len = 0;
+	for (j = 0; j < OS_MAX_THREADS; ++j) {
+		len += (size_t) snprintf(&line[len], sizeof(line) - len, "%5u\t", missed_deadlines[j]);
+	}
+	LOG_INFO("%s", line);
+
+	const uint32_t runtime = TIMER_GET_TICKCOUNT_32 - first_util_time;
+	LOG_INFO("%lu ms CPU-Zeit in %lu ms Systemzeit", (unsigned long) TICKS_TO_MS(util_runtime), (unsigned long) TICKS_TO_MS(runtime));
+}
+#endif // MEASURE_UTILIZATION
+
 #endif // OS_AVAILABLE
 #endif // PC
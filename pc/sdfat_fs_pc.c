@@ -31,6 +31,9 @@
 #include "log.h"
 #include <stdlib.h>
 #include <stdio.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
 
 uint8_t sdfat_open(const char* filename, pFatFile* p_file, uint8_t mode) {
 	char* file_mode;
@@ -191,6 +194,45 @@ uint8_t sdfat_sync_vol(pSdFat p_instance) {
 	return 0;
 }
 
+#ifndef WIN32
+void* sdfat_mmap(pFatFile p_file, uint32_t size) {
+	if (! p_file || ! size) {
+		return NULL;
+	}
+
+	/* gepufferte Daten zuerst in die Datei schreiben, sonst sieht das Mapping einen alten Stand */
+	fflush(p_file);
+	void* p_addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fileno(p_file), 0);
+	if (p_addr == MAP_FAILED) {
+		LOG_ERROR("sdfat_mmap(%u): mmap failed:", size);
+		perror(NULL);
+		return NULL;
+	}
+	return p_addr;
+}
+
+uint8_t sdfat_msync(void* p_addr, uint32_t size) {
+	if (! p_addr) {
+		return 1;
+	}
+
+	if (msync(p_addr, size, MS_SYNC)) {
+		LOG_ERROR("sdfat_msync(%u): msync failed:", size);
+		perror(NULL);
+		return 1;
+	}
+	return 0;
+}
+
+uint8_t sdfat_munmap(void* p_addr, uint32_t size) {
+	if (! p_addr) {
+		return 1;
+	}
+
+	return ! munmap(p_addr, size) ? 0 : 1;
+}
+#endif // WIN32
+
 void sdfat_test(void) {
 	pFatFile file;
 	if (sdfat_open("test.txt", &file, SDFAT_O_RDWR | SDFAT_O_TRUNC) != 0) {
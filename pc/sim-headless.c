@@ -0,0 +1,763 @@
+/*
+ * c't-Bot
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ * This program is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307, USA.
+ *
+ */
+
+/**
+ * \file 	sim-headless.c
+ * \brief 	Eingebauter Sim ohne GUI fuer Testlaeufe schneller als Echtzeit
+ *
+ * Pro Zyklus schickt der Sim alle Sensorwerte als CMD_SENS_SNAPSHOT und CMD_DONE mit der neuen simultime
+ * und der Zyklusnummer, wartet auf das CMD_DONE des Bots (im Pipeline-Modus erst, wenn so viele Zyklen
+ * unquittiert sind, wie der Bot bei der Anmeldung als Fenster angegeben hat), uebernimmt die Motorgeschwindigkeiten aus CMD_AKT_MOT und bewegt
+ * den Bot um SIM_CYCLE_MS weiter. Die simulierte Zeit laeuft also so schnell, wie Bot und Sim rechnen koennen.
+ * Im Schwarm gibt der Vermittler jeden SIM_SWARM_SYNC_CYCLES-ten Zyklus erst frei, wenn alle Sims so weit sind,
+ * damit die simulierten Uhren aller Bots gleich laufen.
+ * \date 	18.10.2026
+ */
+
+#ifdef PC
+
+#include "ct-Bot.h"
+
+#if defined BOT_2_SIM_AVAILABLE && ! defined ARM_LINUX_BOARD
+#include "sim-headless.h"
+#include "command.h"
+#include "bot-2-sim.h"
+#include "sensor.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#ifndef WIN32
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <poll.h>
+#endif // ! WIN32
+
+#define SIM_IR_STEP			(SIM_WORLD_RES / 2.0)	/**< Schrittweite fuer die Abstandsmessung [mm] */
+#define SIM_BODY_POINTS		24						/**< Anzahl der Punkte auf dem Umfang fuer die Kollisionspruefung */
+#define SIM_SENS_ACTIVE		0x3ff					/**< Wert der Abgrund- und Liniensensoren ueber Abgrund bzw. Linie */
+#define SIM_ARENA_SIZE		300						/**< Kantenlaenge der eingebauten Arena [Pixel] */
+
+/** Art eines Pixels der Welt */
+typedef enum {
+	SIM_FLOOR,	/**< freie Flaeche */
+	SIM_LINE,	/**< Linie auf dem Boden */
+	SIM_HOLE,	/**< Abgrund */
+	SIM_WALL,	/**< Hindernis */
+} sim_field_t;
+
+static uint8_t * world = NULL;	/**< Grauwerte der Welt, zeilenweise wie im PGM (Zeile 0 = groesstes Y) */
+static int world_width = 0;		/**< Breite der Welt [Pixel] */
+static int world_height = 0;	/**< Hoehe der Welt [Pixel] */
+
+static double sim_x;			/**< X-Position des Bots [mm] */
+static double sim_y;			/**< Y-Position des Bots [mm] */
+static double sim_heading;		/**< Blickrichtung des Bots [rad], 0 = X-Achse, gegen den Uhrzeigersinn positiv */
+static int16_t sim_speed[2];	/**< Geschwindigkeit links / rechts aus CMD_AKT_MOT [mm/s] */
+static double enc_rest[2];		/**< noch nicht gemeldete Bruchteile der Encoder-Ticks links / rechts */
+static double mouse_rest[2];	/**< noch nicht gemeldete Bruchteile der Maus-Werte dX / dY */
+static uint8_t sim_fallen = 0;	/**< Bot ist in einen Abgrund gefallen */
+static char sim_name[32] = "Eingebauter Sim";	/**< Name des Sims fuer Ausgaben */
+
+#ifndef WIN32
+static int sim_sock = -1;		/**< Socket des Sims */
+static uint8_t sim_seq = 0;		/**< Sequenznummer der Sim-Kommandos */
+
+static uint8_t recv_buffer[1024];	/**< Empfangspuffer des Sims */
+static size_t recv_pos = 0;			/**< Leseposition in recv_buffer */
+static size_t recv_len = 0;			/**< Anzahl gueltiger Bytes in recv_buffer */
+
+static int swarm_link = -1;			/**< Verbindung zum Vermittler des Schwarms oder -1 */
+static uint8_t swarm_released = 0;	/**< Vermittler hat den naechsten Zyklus freigegeben */
+#endif // ! WIN32
+
+/**
+ * Liefert die Art des Feldes an einer Position
+ * \param x	X-Koordinate [mm]
+ * \param y	Y-Koordinate [mm]
+ * \return	Art des Feldes, ausserhalb der Welt SIM_WALL
+ */
+static sim_field_t sim_field(double x, double y) {
+	const int px = (int) floor(x / SIM_WORLD_RES);
+	const int py = (int) floor(y / SIM_WORLD_RES);
+	if (px < 0 || py < 0 || px >= world_width || py >= world_height) {
+		return SIM_WALL;
+	}
+	const uint8_t value = world[(world_height - 1 - py) * world_width + px];
+	if (value < SIM_WORLD_WALL) {
+		return SIM_WALL;
+	}
+	if (value < SIM_WORLD_HOLE) {
+		return SIM_HOLE;
+	}
+	if (value < SIM_WORLD_LINE) {
+		return SIM_LINE;
+	}
+	return SIM_FLOOR;
+}
+
+/**
+ * Fuellt ein Rechteck der Welt
+ * \param x0	linke Kante [Pixel]
+ * \param y0	untere Kante [Pixel]
+ * \param x1	rechte Kante (exklusiv) [Pixel]
+ * \param y1	obere Kante (exklusiv) [Pixel]
+ * \param value	Grauwert
+ */
+static void world_fill(int x0, int y0, int x1, int y1, uint8_t value) {
+	int x, y;
+	for (y = y0; y < y1; ++y) {
+		for (x = x0; x < x1; ++x) {
+			world[(world_height - 1 - y) * world_width + x] = value;
+		}
+	}
+}
+
+/**
+ * Erzeugt die eingebaute Test-Arena: 3 m x 3 m mit Rand, einem Hindernis vor dem Startplatz,
+ * einem Abgrund und einer abknickenden Linie
+ * \return	0, falls alles OK
+ */
+static int8_t world_create_arena(void) {
+	world_width = SIM_ARENA_SIZE;
+	world_height = SIM_ARENA_SIZE;
+	world = malloc((size_t) (world_width * world_height));
+	if (world == NULL) {
+		return -1;
+	}
+	memset(world, 255, (size_t) (world_width * world_height));
+
+	world_fill(0, 0, SIM_ARENA_SIZE, 3, 0);
+	world_fill(0, SIM_ARENA_SIZE - 3, SIM_ARENA_SIZE, SIM_ARENA_SIZE, 0);
+	world_fill(0, 0, 3, SIM_ARENA_SIZE, 0);
+	world_fill(SIM_ARENA_SIZE - 3, 0, SIM_ARENA_SIZE, SIM_ARENA_SIZE, 0);
+	world_fill(200, 130, 230, 170, 0); // Hindernis 50 cm vor dem Startplatz
+	world_fill(40, 40, 80, 80, 80); // Abgrund
+	world_fill(60, 230, 240, 232, 112); // Linie
+	world_fill(60, 100, 62, 232, 112);
+	return 0;
+}
+
+/**
+ * Liest die naechste Zahl aus dem Kopf einer PGM-Datei, Kommentare werden uebersprungen
+ * \param *fp	Datei
+ * \return		Zahl oder -1 bei Fehlern
+ */
+static int pgm_read_int(FILE * fp) {
+	int c;
+	do {
+		c = fgetc(fp);
+		if (c == '#') {
+			while (c != '\n' && c != EOF) {
+				c = fgetc(fp);
+			}
+		}
+	} while (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+
+	int value = 0;
+	if (c < '0' || c > '9') {
+		return -1;
+	}
+	while (c >= '0' && c <= '9') {
+		value = value * 10 + (c - '0');
+		c = fgetc(fp);
+	}
+	return value;
+}
+
+/**
+ * Laedt die Welt aus einer PGM-Datei
+ * \param *filename	Dateiname
+ * \return			0, falls alles OK, sonst Fehlercode
+ */
+static int8_t world_load(const char * filename) {
+	FILE * fp = fopen(filename, "rb");
+	if (fp == NULL) {
+		LOG_ERROR("Konnte Welt \"%s\" nicht oeffnen", filename);
+		return -1;
+	}
+	char magic[2];
+	if (fread(magic, 1, 2, fp) != 2 || magic[0] != 'P' || (magic[1] != '2' && magic[1] != '5')) {
+		LOG_ERROR("\"%s\" ist keine PGM-Datei", filename);
+		fclose(fp);
+		return -2;
+	}
+	world_width = pgm_read_int(fp);
+	world_height = pgm_read_int(fp);
+	const int max = pgm_read_int(fp); // nach dem Maximalwert folgt genau ein Whitespace
+	if (world_width <= 0 || world_height <= 0 || max <= 0 || max > 255) {
+		LOG_ERROR("PGM-Kopf von \"%s\" ungueltig oder nicht unterstuetzt", filename);
+		fclose(fp);
+		return -3;
+	}
+
+	const size_t size = (size_t) world_width * (size_t) world_height;
+	world = malloc(size);
+	if (world == NULL) {
+		fclose(fp);
+		return -4;
+	}
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		const int value = magic[1] == '5' ? fgetc(fp) : pgm_read_int(fp);
+		if (value < 0) {
+			LOG_ERROR("PGM-Daten von \"%s\" unvollstaendig", filename);
+			fclose(fp);
+			free(world);
+			world = NULL;
+			return -5;
+		}
+		world[i] = (uint8_t) ((value < max ? value : max) * 255 / max);
+	}
+	fclose(fp);
+	return 0;
+}
+
+/**
+ * Laedt die Welt fuer den eingebauten Sim und aktiviert ihn.
+ * \param *filename	Pfad zu einer PGM-Datei (P2 oder P5, SIM_WORLD_RES mm pro Pixel, oberste Zeile = groesstes Y)
+ * 					oder "-" fuer die eingebaute Test-Arena
+ * \return			0, falls alles OK, sonst Fehlercode
+ */
+int8_t sim_headless_init(const char * filename) {
+	free(world);
+	world = NULL;
+	const int8_t res = strcmp(filename, "-") == 0 ? world_create_arena() : world_load(filename);
+	if (res != 0) {
+		return res;
+	}
+
+	/* Start in der Mitte der Welt, Blick entlang der X-Achse */
+	sim_x = world_width * SIM_WORLD_RES / 2.0;
+	sim_y = world_height * SIM_WORLD_RES / 2.0;
+	sim_heading = 0.0;
+	LOG_INFO("Eingebauter Sim: Welt %d x %d mm, Start bei (%d|%d)", world_width * SIM_WORLD_RES, world_height * SIM_WORLD_RES,
+		(int) sim_x, (int) sim_y);
+	return 0;
+}
+
+/**
+ * Prueft, ob der Bot an einer Position mit einem Hindernis kollidiert
+ * \param x	X-Koordinate des Mittelpunkts [mm]
+ * \param y	Y-Koordinate des Mittelpunkts [mm]
+ * \return	1, falls der Bot ein Hindernis beruehrt, sonst 0
+ */
+static uint8_t sim_collision(double x, double y) {
+	if (sim_field(x, y) == SIM_WALL) {
+		return 1;
+	}
+	int i;
+	for (i = 0; i < SIM_BODY_POINTS; ++i) {
+		const double a = i * 2.0 * M_PI / SIM_BODY_POINTS;
+		if (sim_field(x + cos(a) * (BOT_DIAMETER / 2.0), y + sin(a) * (BOT_DIAMETER / 2.0)) == SIM_WALL) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Berechnet die Position eines Sensors
+ * \param fw	Abstand von der Radachse in Fahrtrichtung [mm]
+ * \param sw	Abstand von der Mittelachse, links positiv [mm]
+ * \param *x	Zeiger fuer die X-Koordinate [mm]
+ * \param *y	Zeiger fuer die Y-Koordinate [mm]
+ */
+static void sim_sensor_pos(double fw, double sw, double * x, double * y) {
+	const double c = cos(sim_heading);
+	const double s = sin(sim_heading);
+	*x = sim_x + c * fw - s * sw;
+	*y = sim_y + s * fw + c * sw;
+}
+
+/**
+ * Misst den Abstand eines IR-Sensors zum naechsten Hindernis in Blickrichtung
+ * \param sw	Abstand des Sensors von der Mittelachse, links positiv [mm]
+ * \return		Abstand [mm] oder SENS_IR_INFINITE
+ */
+static int16_t sim_distance(double sw) {
+	double x, y;
+	sim_sensor_pos(DISTSENSOR_POS_FW, sw, &x, &y);
+	const double dx = cos(sim_heading) * SIM_IR_STEP;
+	const double dy = sin(sim_heading) * SIM_IR_STEP;
+	double d;
+	for (d = 0.0; d <= SENS_IR_MAX_DIST; d += SIM_IR_STEP) {
+		if (sim_field(x, y) == SIM_WALL) {
+			return (int16_t) d;
+		}
+		x += dx;
+		y += dy;
+	}
+	return SENS_IR_INFINITE;
+}
+
+/**
+ * Liefert den Wert eines Boden-Sensors
+ * \param fw	Abstand von der Radachse in Fahrtrichtung [mm]
+ * \param sw	Abstand von der Mittelachse, links positiv [mm]
+ * \param type	Art des Feldes, auf die der Sensor anspricht
+ * \return		SIM_SENS_ACTIVE, falls der Sensor ueber einem Feld dieser Art ist, sonst 0
+ */
+static int16_t sim_floor_sensor(double fw, double sw, sim_field_t type) {
+	double x, y;
+	sim_sensor_pos(fw, sw, &x, &y);
+	return sim_field(x, y) == type ? SIM_SENS_ACTIVE : 0;
+}
+
+/**
+ * Rundet einen Wert und behaelt den Rest fuer den naechsten Zyklus
+ * \param value	Wert
+ * \param *rest	Zeiger auf den Rest aus dem letzten Zyklus
+ * \param limit	Betragsmaessige Obergrenze des Ergebnisses
+ * \return		ganzzahliger Anteil
+ */
+static int16_t sim_round(double value, double * rest, int16_t limit) {
+	value += *rest;
+	int16_t result = (int16_t) lround(value);
+	if (result > limit) {
+		result = limit;
+	} else if (result < -limit) {
+		result = (int16_t) -limit;
+	}
+	*rest = value - result;
+	return result;
+}
+
+/**
+ * Bewegt den Bot um einen Zyklus weiter und bestimmt die Aenderungen von Encodern und Maus
+ * \param *snapshot	Snapshot fuer Encoder- und Mauswerte
+ */
+static void sim_move(sensor_snapshot_t * snapshot) {
+	const double dt = SIM_CYCLE_MS / 1000.0;
+	const double s_l = sim_speed[0] * dt;
+	const double s_r = sim_speed[1] * dt;
+
+	/* Die Encoder zaehlen auch dann, wenn die Raeder durchdrehen */
+	snapshot->enc[0] = sim_round(s_l * (ENCODER_MARKS / WHEEL_PERIMETER), &enc_rest[0], INT16_MAX);
+	snapshot->enc[1] = sim_round(s_r * (ENCODER_MARKS / WHEEL_PERIMETER), &enc_rest[1], INT16_MAX);
+
+	const double ds = (s_l + s_r) / 2.0;
+	const double dh = (s_r - s_l) / WHEEL_TO_WHEEL_DIAMETER;
+	const double h = sim_heading + dh / 2.0;
+	const double x = sim_x + cos(h) * ds;
+	const double y = sim_y + sin(h) * ds;
+	if (sim_fallen || sim_collision(x, y)) {
+		return;
+	}
+	sim_x = x;
+	sim_y = y;
+	sim_heading = fmod(sim_heading + dh, 2.0 * M_PI);
+
+#ifdef MOUSE_AVAILABLE
+	snapshot->mouse[0] = sim_round(dh * (MOUSE_FULL_TURN / (2.0 * M_PI)), &mouse_rest[0], INT8_MAX);
+	snapshot->mouse[1] = sim_round(ds * (MOUSE_CPI / 25.4), &mouse_rest[1], INT8_MAX);
+#else
+	(void) mouse_rest;
+#endif
+
+	if (sim_field(sim_x, sim_y) == SIM_HOLE) {
+		sim_fallen = 1;
+		LOG_INFO("%s: Bot bei (%d|%d) in einen Abgrund gefallen", sim_name, (int) sim_x, (int) sim_y);
+	}
+}
+
+#ifndef WIN32
+/**
+ * Schreibt ein Kommando im Little-Endian-Format des Protokolls in einen Puffer
+ * \param *buffer	Zielpuffer, mindestens sizeof(command_t) Bytes
+ * \param command	Kommando
+ * \param payload	Anzahl der Bytes im Anhang
+ * \param data_l	Daten links
+ * \param data_r	Daten rechts
+ * \return			Anzahl der geschriebenen Bytes
+ */
+static size_t sim_put_command(uint8_t * buffer, uint8_t command, uint8_t payload, int16_t data_l, int16_t data_r) {
+	buffer[0] = CMD_STARTCODE;
+	buffer[1] = command;
+	buffer[2] = SUB_CMD_NORM; // direction = DIR_REQUEST
+	buffer[3] = payload;
+	buffer[4] = (uint8_t) data_l;
+	buffer[5] = (uint8_t) ((uint16_t) data_l >> 8);
+	buffer[6] = (uint8_t) data_r;
+	buffer[7] = (uint8_t) ((uint16_t) data_r >> 8);
+	buffer[8] = sim_seq++;
+	buffer[9] = CMD_SIM_ADDR;
+	buffer[10] = CMD_BROADCAST;
+	buffer[11] = CMD_STOPCODE;
+	return sizeof(command_t);
+}
+
+/**
+ * Schickt Daten an den Bot
+ * \param *data	Daten
+ * \param len	Anzahl der Bytes
+ * \return		0, falls alles OK, sonst -1
+ */
+static int8_t sim_write(const uint8_t * data, size_t len) {
+	size_t done = 0;
+	while (done < len) {
+		const ssize_t n = send(sim_sock, &data[done], len - done, 0);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return -1;
+		}
+		done += (size_t) n;
+	}
+	return 0;
+}
+
+/**
+ * Schickt alle Sensorwerte und das Ende des Zyklus an den Bot
+ * \param *snapshot	Sensorwerte
+ * \param simultime	Simulierte Zeit [ms], laeuft alle 10 s ueber
+ * \param cycle		Nummer des Zyklus, der Bot quittiert sie mit seinem CMD_DONE
+ * \return			0, falls alles OK, sonst -1
+ */
+static int8_t sim_send(const sensor_snapshot_t * snapshot, int16_t simultime, uint16_t cycle) {
+	uint8_t buffer[2 * sizeof(command_t) + sizeof(sensor_snapshot_t)];
+	size_t len = sim_put_command(buffer, CMD_SENS_SNAPSHOT, sizeof(sensor_snapshot_t), SENSOR_SNAPSHOT_VERSION, 0);
+
+	/* 16 Bit Werte im Little-Endian-Format, dann die 8 Bit Werte */
+	int16_t data[offsetof(sensor_snapshot_t, trans) / sizeof(int16_t)];
+	memcpy(data, snapshot, sizeof(data));
+	size_t i;
+	for (i = 0; i < sizeof(data) / sizeof(data[0]); ++i) {
+		buffer[len++] = (uint8_t) data[i];
+		buffer[len++] = (uint8_t) ((uint16_t) data[i] >> 8);
+	}
+	memcpy(&buffer[len], &snapshot->trans, sizeof(sensor_snapshot_t) - offsetof(sensor_snapshot_t, trans));
+	len += sizeof(sensor_snapshot_t) - offsetof(sensor_snapshot_t, trans);
+
+	len += sim_put_command(&buffer[len], CMD_DONE, 0, simultime, (int16_t) cycle);
+	return sim_write(buffer, len);
+}
+
+/**
+ * Reicht alle vom Vermittler des Schwarms empfangenen Kommandos an den Bot weiter und merkt sich Freigaben
+ * \return	0, falls alles OK, sonst -1
+ */
+static int8_t sim_swarm_deliver(void) {
+	uint8_t packet[sizeof(command_t) + UINT8_MAX];
+	ssize_t n;
+	while ((n = recv(swarm_link, packet, sizeof(packet), MSG_DONTWAIT)) > 0) {
+		if (n < (ssize_t) sizeof(command_t)) {
+			/* kein Kommando, sondern die Freigabe des naechsten Zyklus */
+			swarm_released = 1;
+			continue;
+		}
+		if (sim_write(packet, (size_t) n) != 0) {
+			return -1;
+		}
+	}
+	if (n == 0) {
+		/* Vermittler beendet, Bot ohne Schwarm weitersimulieren */
+		close(swarm_link);
+		swarm_link = -1;
+	}
+	return 0;
+}
+
+/**
+ * Wartet auf Daten vom Bot und reicht solange Kommandos vom Vermittler des Schwarms weiter,
+ * denn ein Bot wartet z.B. beim Payload-Versand mitten im Zyklus auf die Antwort eines anderen Bots
+ * \return	0, falls Daten vom Bot anliegen, sonst -1
+ */
+static int8_t sim_swarm_wait(void) {
+	while (swarm_link >= 0) {
+		struct pollfd fds[2] = {{sim_sock, POLLIN, 0}, {swarm_link, POLLIN, 0}};
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		if (fds[1].revents && sim_swarm_deliver() != 0) {
+			return -1;
+		}
+		if (fds[0].revents) {
+			return 0;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Liefert die naechsten Bytes vom Bot
+ * \param *data	Zielpuffer oder NULL zum Verwerfen
+ * \param len	Anzahl der Bytes
+ * \return		0, falls alles OK, -1 falls die Verbindung beendet wurde
+ */
+static int8_t sim_recv(uint8_t * data, size_t len) {
+	while (len) {
+		if (recv_pos == recv_len) {
+			if (sim_swarm_wait() != 0) {
+				return -1;
+			}
+			const ssize_t n = recv(sim_sock, recv_buffer, sizeof(recv_buffer), 0);
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			if (n <= 0) {
+				return -1;
+			}
+			recv_pos = 0;
+			recv_len = (size_t) n;
+		}
+		size_t n = recv_len - recv_pos;
+		if (n > len) {
+			n = len;
+		}
+		if (data) {
+			memcpy(data, &recv_buffer[recv_pos], n);
+			data += n;
+		}
+		recv_pos += n;
+		len -= n;
+	}
+	return 0;
+}
+
+/**
+ * Empfaengt ein Kommando des Bots und uebernimmt Motorgeschwindigkeiten und Pipeline-Fenster
+ * \param *acked	Zeiger auf die Nummer des zuletzt vom Bot quittierten Zyklus
+ * \param *window	Zeiger auf das Pipeline-Fenster, wird bei der Anmeldung des Bots (CMD_WELCOME) gesetzt
+ * \return			1 bei CMD_DONE, 0 bei allen anderen Kommandos, -1 falls die Verbindung beendet wurde
+ */
+static int8_t sim_receive_command(uint16_t * acked, uint16_t * window) {
+	uint8_t frame[sizeof(command_t)];
+	if (sim_recv(frame, sizeof(frame)) != 0) {
+		return -1;
+	}
+	while (frame[0] != CMD_STARTCODE || frame[sizeof(frame) - 1] != CMD_STOPCODE) {
+		/* nicht synchron, um ein Byte weiterschieben */
+		memmove(frame, &frame[1], sizeof(frame) - 1);
+		if (sim_recv(&frame[sizeof(frame) - 1], 1) != 0) {
+			return -1;
+		}
+	}
+	if (swarm_link >= 0 && frame[10] != CMD_SIM_ADDR && frame[10] != CMD_IGNORE_ADDR) {
+		/* Bot-2-Bot-Kommando samt Anhang an den Vermittler, das Kommando zaehlt nicht fuer den Sim */
+		uint8_t packet[sizeof(command_t) + UINT8_MAX];
+		memcpy(packet, frame, sizeof(frame));
+		if (frame[3] && sim_recv(&packet[sizeof(frame)], frame[3]) != 0) {
+			return -1;
+		}
+		send(swarm_link, packet, sizeof(frame) + frame[3], MSG_NOSIGNAL);
+		return 0;
+	}
+	if (frame[3] && sim_recv(NULL, frame[3]) != 0) {
+		return -1;
+	}
+
+	const int16_t data_l = (int16_t) (frame[4] | (frame[5] << 8));
+	const int16_t data_r = (int16_t) (frame[6] | (frame[7] << 8));
+	if (frame[1] == CMD_DONE) {
+		*acked = (uint16_t) data_r;
+		return 1;
+	}
+	if (frame[1] == CMD_AKT_MOT) {
+		sim_speed[0] = data_l;
+		sim_speed[1] = data_r;
+	} else if (frame[1] == CMD_WELCOME) {
+		*window = data_r > 1 ? (uint16_t) data_r : 1;
+	}
+	return 0;
+}
+
+/**
+ * Empfaengt die Kommandos des Bots bis zu dessen CMD_DONE
+ * \param *acked	Zeiger auf die Nummer des zuletzt vom Bot quittierten Zyklus
+ * \param *window	Zeiger auf das Pipeline-Fenster, wird bei der Anmeldung des Bots (CMD_WELCOME) gesetzt
+ * \return			0, falls alles OK, -1 falls die Verbindung beendet wurde
+ */
+static int8_t sim_receive_until_done(uint16_t * acked, uint16_t * window) {
+	int8_t res;
+	while ((res = sim_receive_command(acked, window)) == 0) {}
+	return (int8_t) (res < 0 ? -1 : 0);
+}
+
+/**
+ * Meldet dem Vermittler, dass der Sim den naechsten Zyklus rechnen moechte, und wartet auf dessen Freigabe.
+ * Solange werden Kommandos in beide Richtungen weitergereicht, denn ein anderer Bot kann gerade mitten in
+ * seinem Zyklus auf eine Antwort dieses Bots warten.
+ * \param *acked	Zeiger auf die Nummer des zuletzt vom Bot quittierten Zyklus
+ * \param *window	Zeiger auf das Pipeline-Fenster
+ * \return			0, falls alles OK, -1 falls die Verbindung zum Bot beendet wurde
+ */
+static int8_t sim_swarm_sync(uint16_t * acked, uint16_t * window) {
+	const uint8_t request = 0;
+	swarm_released = 0;
+	if (send(swarm_link, &request, sizeof(request), MSG_NOSIGNAL) != (ssize_t) sizeof(request)) {
+		return 0; // Vermittler beendet, ohne Synchronisation weiter
+	}
+	while (! swarm_released && swarm_link >= 0) {
+		if (recv_pos == recv_len) {
+			struct pollfd fds[2] = {{sim_sock, POLLIN, 0}, {swarm_link, POLLIN, 0}};
+			if (poll(fds, 2, -1) < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return -1;
+			}
+			if (fds[1].revents && sim_swarm_deliver() != 0) {
+				return -1;
+			}
+			if (! fds[0].revents) {
+				continue;
+			}
+		}
+		if (sim_receive_command(acked, window) < 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Berechnet einen Zyklus und schickt ihn an den Bot
+ * \param simultime	Simulierte Zeit am Ende des Zyklus [ms]
+ * \param cycle		Nummer des Zyklus
+ * \return			0, falls alles OK, sonst -1
+ */
+static int8_t sim_step(int16_t simultime, uint16_t cycle) {
+	sensor_snapshot_t snapshot;
+	memset(&snapshot, 0, sizeof(snapshot));
+	sim_move(&snapshot);
+	snapshot.dist[0] = sim_distance(DISTSENSOR_POS_SW);
+	snapshot.dist[1] = sim_distance(-DISTSENSOR_POS_SW);
+	snapshot.border[0] = sim_floor_sensor(BORDERSENSOR_POS_FW, BORDERSENSOR_POS_SW, SIM_HOLE);
+	snapshot.border[1] = sim_floor_sensor(BORDERSENSOR_POS_FW, -BORDERSENSOR_POS_SW, SIM_HOLE);
+	snapshot.line[0] = sim_floor_sensor(DISTSENSOR_POS_FW, 5, SIM_LINE);
+	snapshot.line[1] = sim_floor_sensor(DISTSENSOR_POS_FW, -5, SIM_LINE);
+	snapshot.motor[0] = sim_speed[0];
+	snapshot.motor[1] = sim_speed[1];
+	return sim_send(&snapshot, simultime, cycle);
+}
+
+/**
+ * Hauptschleife des eingebauten Sims
+ * \param *arg	unbenutzt
+ * \return		NULL
+ */
+static void * sim_headless_thread(void * arg) {
+	(void) arg;
+	int16_t simultime = 0;
+	uint16_t cycle = 0;
+	uint16_t acked = 0;
+	uint16_t window = 1;
+	long sim_ms = 0;
+	struct timeval start, now;
+	GETTIMEOFDAY(&start, NULL);
+
+	int8_t res = 0;
+	while (res == 0) {
+		if (swarm_link >= 0) {
+			res = sim_swarm_deliver();
+		}
+		/* Zyklen verschicken, bis das Fenster voll ist, im Lockstep also genau einen */
+		while (res == 0 && (uint16_t) (cycle - acked) < window) {
+			if (swarm_link >= 0 && cycle % SIM_SWARM_SYNC_CYCLES == 0) {
+				res = sim_swarm_sync(&acked, &window);
+				if (res != 0) {
+					break;
+				}
+			}
+			simultime = (int16_t) ((simultime + SIM_CYCLE_MS) % 10000); // wie beim ct-Sim Ueberlauf alle 10 s
+			res = sim_step(simultime, ++cycle);
+
+			sim_ms += SIM_CYCLE_MS;
+			if (sim_ms % SIM_REPORT_MS == 0) {
+				GETTIMEOFDAY(&now, NULL);
+				const double real = (double) (now.tv_sec - start.tv_sec) + (double) (now.tv_usec - start.tv_usec) / 1000000.0;
+				printf("%s: %ld s simuliert in %.1f s (%.1f x Echtzeit), Bot bei (%d|%d)\n", sim_name, sim_ms / 1000, real,
+					real > 0.0 ? (double) sim_ms / 1000.0 / real : 0.0, (int) sim_x, (int) sim_y);
+				fflush(stdout);
+			}
+		}
+
+		if (res == 0) {
+			res = sim_receive_until_done(&acked, &window);
+		}
+	}
+
+	close(sim_sock);
+	sim_sock = -1;
+	return NULL;
+}
+#endif // ! WIN32
+
+/**
+ * Startet den eingebauten Sim, falls er mit sim_headless_init() aktiviert wurde
+ * \return	Socket des Bots fuer die Verbindung zum Sim oder -1, falls der eingebaute Sim nicht aktiv ist
+ */
+int sim_headless_connect(void) {
+#ifndef WIN32
+	if (world == NULL) {
+		return -1;
+	}
+	int socks[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, socks) != 0) {
+		LOG_ERROR("socketpair() fuer den eingebauten Sim fehlgeschlagen");
+		return -1;
+	}
+	sim_sock = socks[1];
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, sim_headless_thread, NULL) != 0) {
+		LOG_ERROR("Thread fuer den eingebauten Sim konnte nicht gestartet werden");
+		close(socks[0]);
+		close(socks[1]);
+		return -1;
+	}
+	pthread_detach(thread);
+	return socks[0];
+#else
+	return -1;
+#endif // ! WIN32
+}
+
+#ifndef WIN32
+/**
+ * Haengt den eingebauten Sim an den Vermittler eines Schwarms und verschiebt den Startplatz des Bots
+ * \param link	Socket (SOCK_SEQPACKET) zum Vermittler, ein Paket enthaelt genau ein Kommando samt Anhang
+ * \param index	Nummer des Bots im Schwarm
+ * \param count	Anzahl der Bots im Schwarm
+ */
+void sim_headless_join_swarm(int link, uint8_t index, uint8_t count) {
+	swarm_link = link;
+	snprintf(sim_name, sizeof(sim_name), "Eingebauter Sim (Bot %u)", get_bot_address());
+
+	/* Startplaetze symmetrisch um die Mitte der Welt verteilen */
+	const double y = sim_y + (index - (count - 1) / 2.0) * SIM_SWARM_SPACING;
+	if (world && ! sim_collision(sim_x, y) && sim_field(sim_x, y) == SIM_FLOOR) {
+		sim_y = y;
+	} else {
+		LOG_INFO("%s: Startplatz (%d|%d) nicht frei, starte in der Mitte", sim_name, (int) sim_x, (int) y);
+	}
+}
+#endif // ! WIN32
+
+#endif // BOT_2_SIM_AVAILABLE && ! ARM_LINUX_BOARD
+#endif // PC
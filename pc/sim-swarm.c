@@ -0,0 +1,358 @@
+/*
+ * c't-Bot
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ * This program is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307, USA.
+ *
+ */
+
+/**
+ * \file 	sim-swarm.c
+ * \brief 	Schwarm-Starter: forkt pro Bot einen Prozess mit eingebautem Sim
+ *
+ * Der Vermittler haelt zu jedem Bot-Prozess ein Socket-Paar (SOCK_SEQPACKET, ein Paket pro Kommando) und
+ * eine Pipe fuer stdin. Er schreibt nie blockierend an einen Bot: Ist dessen Puffer voll, geht das Kommando
+ * verloren wie bei einer gestoerten Funkverbindung, Bot-2-Bot-Uebertragungen wiederholen es dann.
+ * Nur die Freigaben der Zyklen schickt er blockierend, denn ohne sie steht der Schwarm.
+ * \date 	18.10.2026
+ */
+
+#ifdef PC
+
+#include "ct-Bot.h"
+
+#if defined BOT_2_SIM_AVAILABLE && ! defined ARM_LINUX_BOARD && ! defined WIN32
+#include "sim-swarm.h"
+#include "sim-headless.h"
+#include "command.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+/** Ein Bot-Prozess aus Sicht des Vermittlers */
+typedef struct {
+	pid_t pid;		/**< Prozess-ID */
+	int link;		/**< Socket fuer Bot-2-Bot-Kommandos oder -1, falls der Bot beendet ist */
+	int input;		/**< Schreibseite der stdin-Pipe des Bots */
+	uint8_t addr;	/**< Adresse des Bots */
+	uint8_t sync;	/**< Sim des Bots wartet auf die Freigabe des naechsten Zyklus */
+} swarm_bot_t;
+
+static swarm_bot_t bots[SIM_SWARM_MAX_BOTS];	/**< alle Bots des Schwarms */
+static uint8_t bot_count = 0;					/**< Anzahl der Bots */
+static unsigned long routed = 0;				/**< Anzahl der vermittelten Kommandos */
+static unsigned long dropped = 0;				/**< Anzahl der verworfenen Kommandos */
+static uint8_t sync_count = 0;					/**< Anzahl der Sims, die auf die Freigabe des naechsten Zyklus warten */
+
+/**
+ * Schickt ein Kommando an einen Bot, ohne zu blockieren
+ * \param *bot		Empfaenger
+ * \param *packet	Kommando samt Anhang
+ * \param len		Laenge des Pakets
+ */
+static void swarm_forward(swarm_bot_t * bot, const uint8_t * packet, size_t len) {
+	if (bot->link < 0) {
+		return;
+	}
+	if (send(bot->link, packet, len, MSG_DONTWAIT) == (ssize_t) len) {
+		++routed;
+	} else {
+		++dropped;
+	}
+}
+
+/**
+ * Vermittelt ein Bot-2-Bot-Kommando an seinen Empfaenger oder bei CMD_BROADCAST an alle anderen Bots
+ * \param *from		Absender
+ * \param *packet	Kommando samt Anhang
+ * \param len		Laenge des Pakets
+ */
+static void swarm_route(const swarm_bot_t * from, const uint8_t * packet, size_t len) {
+	if (len < sizeof(command_t)) {
+		return;
+	}
+	const uint8_t to = packet[offsetof(command_t, to)];
+	uint8_t i;
+	for (i = 0; i < bot_count; ++i) {
+		if (&bots[i] != from && (to == CMD_BROADCAST || to == bots[i].addr)) {
+			swarm_forward(&bots[i], packet, len);
+		}
+	}
+}
+
+/**
+ * Gibt den naechsten Zyklus frei, sobald alle laufenden Sims darum gebeten haben
+ * \param running	Anzahl der laufenden Bots
+ */
+static void swarm_release(uint8_t running) {
+	if (running == 0 || sync_count < running) {
+		return;
+	}
+	const uint8_t release = 0;
+	uint8_t i;
+	for (i = 0; i < bot_count; ++i) {
+		if (bots[i].link >= 0 && bots[i].sync) {
+			send(bots[i].link, &release, sizeof(release), 0);
+			bots[i].sync = 0;
+		}
+	}
+	sync_count = 0;
+}
+
+/**
+ * Schreibt eine Zeile komplett in die stdin-Pipe eines Bots
+ * \param *bot	Empfaenger
+ * \param *line	Zeile inkl. '\n'
+ * \param len	Laenge der Zeile
+ */
+static void swarm_write_line(const swarm_bot_t * bot, const char * line, size_t len) {
+	while (len && bot->link >= 0) {
+		const ssize_t n = write(bot->input, line, len);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return;
+		}
+		line += n;
+		len -= (size_t) n;
+	}
+}
+
+/**
+ * Verteilt eine Zeile von stdin: "ADRESSE:Zeile" an den Bot mit dieser Adresse, alles andere an alle Bots
+ * \param *line	Zeile inkl. '\n'
+ * \param len	Laenge der Zeile
+ */
+static void swarm_dispatch_line(char * line, size_t len) {
+	char * end;
+	const long addr = strtol(line, &end, 10);
+	uint8_t i;
+	if (end != line && *end == ':') {
+		++end;
+		for (i = 0; i < bot_count; ++i) {
+			if (bots[i].addr == addr) {
+				swarm_write_line(&bots[i], end, len - (size_t) (end - line));
+				return;
+			}
+		}
+		printf("Kein Bot mit Adresse %ld im Schwarm\n", addr);
+		return;
+	}
+	for (i = 0; i < bot_count; ++i) {
+		swarm_write_line(&bots[i], line, len);
+	}
+}
+
+/**
+ * Hauptschleife des Vermittlers, kehrt zurueck, sobald alle Bots beendet sind
+ */
+static void swarm_run(void) {
+	struct pollfd fds[SIM_SWARM_MAX_BOTS + 1];
+	char line[256];
+	size_t line_len = 0;
+	uint8_t input_open = 1;
+	uint8_t running = bot_count;
+
+	while (running) {
+		nfds_t n = 0;
+		uint8_t i;
+		for (i = 0; i < bot_count; ++i) {
+			fds[n].fd = bots[i].link; // negative Deskriptoren ignoriert poll()
+			fds[n].events = POLLIN;
+			++n;
+		}
+		if (input_open) {
+			fds[n].fd = STDIN_FILENO;
+			fds[n].events = POLLIN;
+			++n;
+		}
+		if (poll(fds, n, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			LOG_ERROR("Schwarm: poll() fehlgeschlagen");
+			return;
+		}
+
+		for (i = 0; i < bot_count; ++i) {
+			if (bots[i].link < 0 || fds[i].revents == 0) {
+				continue;
+			}
+			uint8_t packet[sizeof(command_t) + UINT8_MAX];
+			const ssize_t len = recv(bots[i].link, packet, sizeof(packet), 0);
+			if (len >= (ssize_t) sizeof(command_t)) {
+				swarm_route(&bots[i], packet, (size_t) len);
+			} else if (len > 0) {
+				/* Sim bittet um Freigabe des naechsten Zyklus */
+				if (! bots[i].sync) {
+					bots[i].sync = 1;
+					++sync_count;
+				}
+				swarm_release(running);
+			} else if (len == 0 || errno != EINTR) {
+				/* Bot beendet, auf ihn muss niemand mehr warten */
+				close(bots[i].link);
+				close(bots[i].input);
+				bots[i].link = -1;
+				if (bots[i].sync) {
+					bots[i].sync = 0;
+					--sync_count;
+				}
+				--running;
+				swarm_release(running);
+			}
+		}
+
+		if (input_open && fds[bot_count].revents) {
+			const ssize_t len = read(STDIN_FILENO, &line[line_len], sizeof(line) - 1 - line_len);
+			if (len <= 0) {
+				/* Pipes offen lassen, sonst lesen die Bots endlos EOF */
+				input_open = 0;
+				continue;
+			}
+			line_len += (size_t) len;
+			char * nl;
+			while ((nl = memchr(line, '\n', line_len)) != NULL) {
+				const size_t used = (size_t) (nl - line) + 1;
+				swarm_dispatch_line(line, used);
+				memmove(line, &line[used], line_len - used);
+				line_len -= used;
+			}
+			if (line_len == sizeof(line) - 1) {
+				/* ueberlange Zeile verwerfen */
+				line_len = 0;
+			}
+		}
+	}
+}
+
+/**
+ * Beendet alle bereits gestarteten Bots, nachdem der Start des Schwarms fehlgeschlagen ist
+ */
+static void swarm_abort(void) {
+	uint8_t i;
+	for (i = 0; i < bot_count; ++i) {
+		close(bots[i].link);
+		close(bots[i].input);
+		kill(bots[i].pid, SIGTERM);
+		waitpid(bots[i].pid, NULL, 0);
+	}
+	bot_count = 0;
+}
+
+/**
+ * Startet count Bots mit den Adressen ab get_bot_address() (0, falls keine gesetzt ist).
+ * Kehrt nur in den Bot-Prozessen zurueck, der Startprozess vermittelt bis zum Ende aller Bots und beendet sich dann.
+ * \param count	Anzahl der Bots
+ * \return		0 im Bot-Prozess, sonst Fehlercode
+ */
+int8_t sim_swarm_start(uint8_t count) {
+	const uint8_t base = get_bot_address() == CMD_BROADCAST ? 0 : get_bot_address();
+	if (count == 0 || count > SIM_SWARM_MAX_BOTS || base + count - 1 > SIM_SWARM_MAX_ADDR) {
+		printf("Schwarm: Anzahl der Bots muss zwischen 1 und %d liegen, hoechste Adresse %d\n", SIM_SWARM_MAX_BOTS,
+			SIM_SWARM_MAX_ADDR);
+		return -1;
+	}
+	fflush(stdout); // sonst gibt jeder Bot-Prozess den Puffer erneut aus
+	const pid_t parent = getpid();
+
+	uint8_t i;
+	for (i = 0; i < count; ++i) {
+		int link[2];
+		int input[2];
+		if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, link) != 0) {
+			LOG_ERROR("Schwarm: socketpair() fehlgeschlagen");
+			swarm_abort();
+			return -2;
+		}
+		if (pipe(input) != 0) {
+			LOG_ERROR("Schwarm: pipe() fehlgeschlagen");
+			close(link[0]);
+			close(link[1]);
+			swarm_abort();
+			return -3;
+		}
+
+		const pid_t pid = fork();
+		if (pid < 0) {
+			LOG_ERROR("Schwarm: fork() fehlgeschlagen");
+			close(link[0]);
+			close(link[1]);
+			close(input[0]);
+			close(input[1]);
+			swarm_abort();
+			return -4;
+		}
+		if (pid == 0) {
+			/* Bot-Prozess: mit dem Vermittler beenden, dessen Deskriptoren schliessen, Pipe wird stdin */
+#ifdef __linux__
+			prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+			if (getppid() != parent) {
+				exit(1);
+			}
+			uint8_t j;
+			for (j = 0; j < i; ++j) {
+				close(bots[j].link);
+				close(bots[j].input);
+			}
+			close(link[0]);
+			close(input[1]);
+			dup2(input[0], STDIN_FILENO);
+			close(input[0]);
+			bot_count = 0;
+			set_bot_address((uint8_t) (base + i));
+			sim_headless_join_swarm(link[1], i, count);
+			return 0;
+		}
+
+		close(link[1]);
+		close(input[0]);
+		bots[i].pid = pid;
+		bots[i].link = link[0];
+		bots[i].input = input[1];
+		bots[i].addr = (uint8_t) (base + i);
+		bots[i].sync = 0;
+		bot_count = (uint8_t) (i + 1);
+	}
+
+	/* Vermittler: CTRL+C beendet die Bots, der Vermittler wartet auf sie */
+	signal(SIGINT, SIG_IGN);
+	signal(SIGPIPE, SIG_IGN);
+	printf("Schwarm: %u Bots mit den Adressen %u bis %u gestartet\n", count, base, base + count - 1);
+	fflush(stdout);
+	swarm_run();
+
+	for (i = 0; i < bot_count; ++i) {
+		waitpid(bots[i].pid, NULL, 0);
+	}
+	printf("Schwarm beendet, %lu Kommandos vermittelt, %lu verworfen\n", routed, dropped);
+	exit(0);
+}
+
+#endif // BOT_2_SIM_AVAILABLE && ! ARM_LINUX_BOARD && ! WIN32
+#endif // PC
@@ -58,6 +58,10 @@ typedef int socklen_t;
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/wait.h>
+#include <pthread.h>
+#include <errno.h>
 #endif
 
 #include <stdio.h>      // for printf() and fprintf()
@@ -65,6 +69,10 @@ typedef int socklen_t;
 #include <string.h>     // for memset()
 #include <unistd.h>     // for close()
 
+#define BENCH_MAX_CLIENTS	16	/**< Maximale Anzahl gleichzeitiger Clients im Benchmark */
+#define BENCH_MAX_MIX		64	/**< Maximale Anzahl Kommandos pro Runde (ohne CMD_DONE) */
+#define BENCH_HIST_BUCKETS	24	/**< Anzahl der Histogramm-Klassen, Klasse i umfasst [2^i, 2^(i+1)) us */
+
 static int server;                    /**< Server-Socket */
 
 static struct sockaddr_in serverAddr; /**< Lokale Adresse  */
@@ -180,7 +188,9 @@ void tcp_server_run(int runs) {
 				/* Alles ok, evtl. muessen wir aber eine Payload abholen */
 				if (received_command.payload != 0) {
 					printf("fetching payload (%u bytes)\n", received_command.payload);
-					cmd_functions.read(buffer, received_command.payload);
+					if (! command_payload()) {
+						cmd_functions.read(buffer, received_command.payload);
+					}
 				}
 				if (received_command.seq != seq) {
 					printf("Sequenzzaehler falsch! Erwartet: %u Empfangen %u\n", seq, received_command.seq);
@@ -256,5 +266,426 @@ void tcp_test_client_run(int runs) {
 	exit(0);
 }
 
+#ifndef WIN32
+/** Konfiguration des Benchmarks */
+typedef struct {
+	int runs;					/**< gemessene Runden pro Client */
+	int warmup;					/**< ungemessene Runden pro Client vor der Messung */
+	int clients;				/**< Anzahl gleichzeitiger Clients */
+	int payload;				/**< Bytes Payload pro Kommando (ausser CMD_DONE) */
+	char mix[BENCH_MAX_MIX + 1];	/**< Kommandos einer Runde, CMD_DONE wird angehaengt */
+	char format[8];				/**< Ausgabeformat zusaetzlich zum Text: "", "csv" oder "json" */
+	char out[256];				/**< Datei fuer CSV / JSON (wird ergaenzt), leer fuer stdout */
+	char label[64];				/**< Bezeichnung des Laufs, z.B. Commit-ID */
+} bench_config_t;
+
+/** Zustand eines Benchmark-Clients */
+typedef struct {
+	const bench_config_t * cfg;	/**< Konfiguration */
+	int sock;					/**< Verbindung zum Client */
+	uint32_t * samples;			/**< gemessene Round-Trip-Zeiten [us] */
+	int count;					/**< Anzahl der Messwerte */
+	int errors;					/**< Runden mit falschem Echo */
+	double elapsed;				/**< Dauer der Messphase [s] */
+} bench_client_t;
+
+static pthread_mutex_t bench_mutex = PTHREAD_MUTEX_INITIALIZER;	/**< Schuetzt bench_ready */
+static pthread_cond_t bench_cond = PTHREAD_COND_INITIALIZER;	/**< Startsignal fuer alle Clients */
+static int bench_ready = 0;	/**< Anzahl der Clients, die auf den Start warten */
+
+/**
+ * Zeit in Mikrosekunden
+ * \return	Zeit seit einem beliebigen, festen Zeitpunkt [us]
+ */
+static uint64_t bench_now(void) {
+	struct timeval tv;
+	GETTIMEOFDAY(&tv, NULL);
+	return (uint64_t) tv.tv_sec * 1000000ULL + (uint64_t) tv.tv_usec;
+}
+
+/**
+ * Schreibt einen Frame im Little-Endian-Format des Protokolls in einen Puffer
+ * \param *buffer	Zielpuffer
+ * \param command	Kommando
+ * \param payload	Anzahl der Bytes im Anhang
+ * \param data_l	Daten links
+ * \param seq		Sequenznummer
+ */
+static void bench_put_frame(uint8_t * buffer, uint8_t command, uint8_t payload, int16_t data_l, uint8_t seq) {
+	buffer[0] = CMD_STARTCODE;
+	buffer[1] = command;
+	buffer[2] = SUB_CMD_NORM;
+	buffer[3] = payload;
+	buffer[4] = (uint8_t) data_l;
+	buffer[5] = (uint8_t) ((uint16_t) data_l >> 8);
+	buffer[6] = 0;
+	buffer[7] = 0;
+	buffer[8] = seq;
+	buffer[9] = CMD_SIM_ADDR;
+	buffer[10] = CMD_BROADCAST;
+	buffer[11] = CMD_STOPCODE;
+}
+
+/**
+ * Sendet einen Puffer komplett
+ * \param sock		Socket
+ * \param *data		Daten
+ * \param length	Anzahl der Bytes
+ * \return			0, falls alles OK, sonst -1
+ */
+static int bench_send(int sock, const uint8_t * data, size_t length) {
+	while (length) {
+		const ssize_t n = send(sock, data, length, 0);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return -1;
+		}
+		data += n;
+		length -= (size_t) n;
+	}
+	return 0;
+}
+
+/**
+ * Empfaengt genau length Bytes
+ * \param sock		Socket
+ * \param *data		Zielpuffer
+ * \param length	Anzahl der Bytes
+ * \return			0, falls alles OK, sonst -1
+ */
+static int bench_recv(int sock, uint8_t * data, size_t length) {
+	while (length) {
+		const ssize_t n = recv(sock, data, length, 0);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return -1;
+		}
+		data += n;
+		length -= (size_t) n;
+	}
+	return 0;
+}
+
+/**
+ * Echo-Client fuer den Benchmark, verwendet den normalen Empfangs- und Sendeweg des Bots
+ * (command_read(), command_payload(), tcp_write()) und schickt jedes Kommando samt Payload zurueck.
+ * Endet mit CMD_SHUTDOWN.
+ */
+static void bench_echo_client(void) {
+	uint8_t buffer[sizeof(command_t) + MAX_PAYLOAD];
+	tcp_init();
+	set_bot_2_sim();
+	for (;;) {
+		if (command_read() != 0) {
+			continue;
+		}
+		if (received_command.request.command == CMD_SHUTDOWN) {
+			break;
+		}
+		memcpy(buffer, &received_command, sizeof(command_t));
+		const uint8_t len = received_command.payload;
+		if (len) {
+			const void * data = command_payload();
+			if (data) {
+				memcpy(&buffer[sizeof(command_t)], data, len);
+			} else {
+				cmd_functions.read(&buffer[sizeof(command_t)], len);
+			}
+		}
+		tcp_write(buffer, (int16_t) (sizeof(command_t) + len));
+		tcp_commit(received_command.request.command == CMD_DONE);
+	}
+	tcp_closeConnection(tcp_sock);
+	exit(0);
+}
+
+/**
+ * Treibt einen Client: schickt pro Runde den Kommando-Mix samt CMD_DONE am Stueck und wartet auf das komplette Echo
+ * \param *arg	Zeiger auf bench_client_t
+ * \return		NULL
+ */
+static void * bench_client_thread(void * arg) {
+	bench_client_t * client = arg;
+	const bench_config_t * cfg = client->cfg;
+	const size_t frames = strlen(cfg->mix);
+	const size_t length = frames * (sizeof(command_t) + (size_t) cfg->payload) + sizeof(command_t);
+	uint8_t * round = malloc(length);
+	uint8_t * echo = malloc(length);
+	if (round == NULL || echo == NULL) {
+		client->errors = cfg->runs;
+		free(round);
+		free(echo);
+		return NULL;
+	}
+
+	size_t pos = 0;
+	size_t i;
+	for (i = 0; i < frames; ++i) {
+		bench_put_frame(&round[pos], (uint8_t) cfg->mix[i], (uint8_t) cfg->payload, (int16_t) i, 0);
+		pos += sizeof(command_t);
+		int j;
+		for (j = 0; j < cfg->payload; ++j) {
+			round[pos++] = (uint8_t) (i + (size_t) j);
+		}
+	}
+
+	/* alle Clients gleichzeitig starten */
+	pthread_mutex_lock(&bench_mutex);
+	++bench_ready;
+	pthread_cond_broadcast(&bench_cond);
+	while (bench_ready < cfg->clients) {
+		pthread_cond_wait(&bench_cond, &bench_mutex);
+	}
+	pthread_mutex_unlock(&bench_mutex);
+
+	uint64_t start = 0;
+	int r;
+	for (r = 0; r < cfg->warmup + cfg->runs; ++r) {
+		if (r == cfg->warmup) {
+			start = bench_now();
+		}
+		bench_put_frame(&round[pos], CMD_DONE, 0, (int16_t) (r & 0x7fff), (uint8_t) r);
+		const uint64_t t0 = bench_now();
+		if (bench_send(client->sock, round, length) != 0 || bench_recv(client->sock, echo, length) != 0) {
+			printf("Benchmark: Verbindung zu Client %d verloren\n", client->sock);
+			client->errors += cfg->warmup + cfg->runs - r;
+			break;
+		}
+		const uint64_t t1 = bench_now();
+		if (memcmp(round, echo, length) != 0) {
+			++client->errors;
+		}
+		if (r >= cfg->warmup) {
+			client->samples[client->count++] = (uint32_t) (t1 - t0);
+		}
+	}
+	client->elapsed = (double) (bench_now() - start) / 1000000.0;
+
+	uint8_t shutdown[sizeof(command_t)];
+	bench_put_frame(shutdown, CMD_SHUTDOWN, 0, 0, 0);
+	bench_send(client->sock, shutdown, sizeof(shutdown));
+	free(round);
+	free(echo);
+	return NULL;
+}
+
+/**
+ * Vergleichsfunktion fuer qsort()
+ * \param *a	erster Messwert
+ * \param *b	zweiter Messwert
+ * \return		<0, 0 oder >0
+ */
+static int bench_compare(const void * a, const void * b) {
+	const uint32_t x = *(const uint32_t *) a;
+	const uint32_t y = *(const uint32_t *) b;
+	return x < y ? -1 : x > y;
+}
+
+/**
+ * Liest die Konfiguration des Benchmarks aus einer Liste key=value[,key=value...]
+ * \param *spec	Konfiguration, "-" fuer die Voreinstellungen
+ * \param *cfg	Zielstruktur
+ * \return		0, falls alles OK, sonst -1
+ */
+static int bench_parse(const char * spec, bench_config_t * cfg) {
+	memset(cfg, 0, sizeof(bench_config_t));
+	cfg->runs = 10000;
+	cfg->warmup = 1000;
+	cfg->clients = 1;
+	strcpy(cfg->mix, "IEBLHTDmeR"); // wie tcp_server_run()
+
+	char buffer[512];
+	if (strcmp(spec, "-") == 0) {
+		return 0;
+	}
+	if (strlen(spec) >= sizeof(buffer)) {
+		return -1;
+	}
+	strcpy(buffer, spec);
+	char * item;
+	for (item = strtok(buffer, ","); item != NULL; item = strtok(NULL, ",")) {
+		char * value = strchr(item, '=');
+		if (value == NULL) {
+			printf("Benchmark: \"%s\" ist kein key=value\n", item);
+			return -1;
+		}
+		*value++ = 0;
+		if (strcmp(item, "runs") == 0) {
+			cfg->runs = atoi(value);
+		} else if (strcmp(item, "warmup") == 0) {
+			cfg->warmup = atoi(value);
+		} else if (strcmp(item, "clients") == 0) {
+			cfg->clients = atoi(value);
+		} else if (strcmp(item, "payload") == 0) {
+			cfg->payload = atoi(value);
+		} else if (strcmp(item, "mix") == 0 && strlen(value) <= BENCH_MAX_MIX) {
+			strcpy(cfg->mix, value);
+		} else if (strcmp(item, "format") == 0 && (strcmp(value, "csv") == 0 || strcmp(value, "json") == 0)) {
+			strcpy(cfg->format, value);
+		} else if (strcmp(item, "out") == 0 && strlen(value) < sizeof(cfg->out)) {
+			strcpy(cfg->out, value);
+		} else if (strcmp(item, "label") == 0 && strlen(value) < sizeof(cfg->label)) {
+			strcpy(cfg->label, value);
+		} else {
+			printf("Benchmark: Option \"%s=%s\" ungueltig\n", item, value);
+			return -1;
+		}
+	}
+
+	if (cfg->runs < 1 || cfg->warmup < 0 || cfg->clients < 1 || cfg->clients > BENCH_MAX_CLIENTS
+		|| cfg->payload < 0 || cfg->payload > MAX_PAYLOAD || strpbrk(cfg->mix, "Xq") != NULL) {
+		printf("Benchmark: ungueltige Werte (1 <= clients <= %d, 0 <= payload <= %d, mix ohne X und q)\n", BENCH_MAX_CLIENTS,
+			MAX_PAYLOAD);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Fuehrt den Benchmark aus: startet die Echo-Clients als eigene Prozesse, misst die Round-Trip-Zeiten
+ * aller Runden und gibt Perzentile, Histogramm und Durchsatz aus. Beendet das Programm per exit().
+ * \param *spec	Konfiguration als key=value[,key=value...], "-" fuer die Voreinstellungen:
+ * 				runs, warmup, clients, payload (Bytes pro Kommando), mix (Kommandos einer Runde),
+ * 				format (csv oder json), out (Datei, wird ergaenzt), label (z.B. Commit-ID)
+ */
+void tcp_benchmark_run(const char * spec) {
+	bench_config_t cfg;
+	if (bench_parse(spec, &cfg) != 0) {
+		exit(1);
+	}
+
+	tcp_server_init();
+	int i;
+	pid_t pids[BENCH_MAX_CLIENTS];
+	for (i = 0; i < cfg.clients; ++i) {
+		pids[i] = fork();
+		if (pids[i] == 0) {
+			close(server);
+			bench_echo_client(); // beendet per exit()
+		}
+		if (pids[i] < 0) {
+			printf("fork() failed\n");
+			exit(1);
+		}
+	}
+
+	bench_client_t clients[BENCH_MAX_CLIENTS];
+	pthread_t threads[BENCH_MAX_CLIENTS];
+	memset(clients, 0, sizeof(clients));
+	uint32_t * samples = malloc((size_t) cfg.clients * (size_t) cfg.runs * sizeof(uint32_t));
+	if (samples == NULL) {
+		exit(1);
+	}
+	for (i = 0; i < cfg.clients; ++i) {
+		clntLen = sizeof(clientAddr);
+		const int sock = accept(server, (struct sockaddr *) &clientAddr, &clntLen);
+		if (sock < 0) {
+			printf("accept() failed\n");
+			exit(1);
+		}
+		int flag = 1;
+		setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (char *) &flag, sizeof(flag));
+		clients[i].cfg = &cfg;
+		clients[i].sock = sock;
+		clients[i].samples = &samples[i * cfg.runs];
+	}
+	for (i = 0; i < cfg.clients; ++i) {
+		pthread_create(&threads[i], NULL, bench_client_thread, &clients[i]);
+	}
+
+	int count = 0, errors = 0;
+	double elapsed = 0.0;
+	for (i = 0; i < cfg.clients; ++i) {
+		pthread_join(threads[i], NULL);
+		close(clients[i].sock);
+		waitpid(pids[i], NULL, 0);
+		/* Messwerte zusammenschieben, falls ein Client vorzeitig aufgehoert hat */
+		memmove(&samples[count], clients[i].samples, (size_t) clients[i].count * sizeof(uint32_t));
+		count += clients[i].count;
+		errors += clients[i].errors;
+		if (clients[i].elapsed > elapsed) {
+			elapsed = clients[i].elapsed;
+		}
+	}
+	close(server);
+	if (count == 0) {
+		printf("Benchmark: keine Messwerte\n");
+		exit(1);
+	}
+
+	qsort(samples, (size_t) count, sizeof(uint32_t), bench_compare);
+	uint32_t hist[BENCH_HIST_BUCKETS];
+	memset(hist, 0, sizeof(hist));
+	uint64_t sum = 0;
+	for (i = 0; i < count; ++i) {
+		sum += samples[i];
+		int bucket = 0;
+		while (bucket < BENCH_HIST_BUCKETS - 1 && samples[i] >= (2U << bucket)) {
+			++bucket;
+		}
+		++hist[bucket];
+	}
+
+	const int frames = (int) strlen(cfg.mix) + 1;
+	const int bytes = (frames - 1) * ((int) sizeof(command_t) + cfg.payload) + (int) sizeof(command_t);
+	const double rounds_s = elapsed > 0.0 ? count / elapsed : 0.0;
+	const double mean = (double) sum / count;
+	const uint32_t p50 = samples[(count - 1) * 50 / 100];
+	const uint32_t p99 = samples[(count - 1) * 99 / 100];
+	const uint32_t p999 = samples[(int) ((int64_t) (count - 1) * 999 / 1000)];
+
+	printf("\nBenchmark %s: %d Client(s), %d Runden + %d Warm-up, %d Frames / %d Bytes pro Runde, Payload %d Bytes\n",
+		cfg.label, cfg.clients, cfg.runs, cfg.warmup, frames, bytes, cfg.payload);
+	printf("Round-Trip [us]: min %u  p50 %u  p99 %u  p999 %u  max %u  mean %.1f\n", samples[0], p50, p99, p999,
+		samples[count - 1], mean);
+	printf("Durchsatz: %.0f Runden/s, %.0f Frames/s, %.2f MByte/s (je Richtung), %d Fehler\n", rounds_s, rounds_s * frames,
+		rounds_s * bytes / 1e6, errors);
+	for (i = 0; i < BENCH_HIST_BUCKETS; ++i) {
+		if (hist[i]) {
+			printf("  < %7u us: %8u ", 2U << i, hist[i]);
+			int j;
+			for (j = 0; j < (int) (hist[i] * 50ULL / (uint64_t) count); ++j) {
+				putchar('#');
+			}
+			putchar('\n');
+		}
+	}
+
+	if (cfg.format[0]) {
+		FILE * fp = cfg.out[0] ? fopen(cfg.out, "a") : stdout;
+		if (fp == NULL) {
+			printf("Benchmark: Konnte \"%s\" nicht oeffnen\n", cfg.out);
+			exit(1);
+		}
+		if (strcmp(cfg.format, "csv") == 0) {
+			if (ftell(fp) <= 0) {
+				fprintf(fp, "label,clients,runs,warmup,frames,payload,bytes,rounds_s,frames_s,min_us,p50_us,p99_us,p999_us,max_us,mean_us,errors\n");
+			}
+			fprintf(fp, "%s,%d,%d,%d,%d,%d,%d,%.1f,%.1f,%u,%u,%u,%u,%u,%.1f,%d\n", cfg.label, cfg.clients, cfg.runs, cfg.warmup,
+				frames, cfg.payload, bytes, rounds_s, rounds_s * frames, samples[0], p50, p99, p999, samples[count - 1], mean, errors);
+		} else {
+			fprintf(fp, "{\"label\":\"%s\",\"clients\":%d,\"runs\":%d,\"warmup\":%d,\"mix\":\"%s\",\"frames\":%d,\"payload\":%d,"
+				"\"bytes\":%d,\"rounds_s\":%.1f,\"frames_s\":%.1f,\"latency_us\":{\"min\":%u,\"p50\":%u,\"p99\":%u,\"p999\":%u,"
+				"\"max\":%u,\"mean\":%.1f},\"errors\":%d,\"histogram\":[", cfg.label, cfg.clients, cfg.runs, cfg.warmup, cfg.mix,
+				frames, cfg.payload, bytes, rounds_s, rounds_s * frames, samples[0], p50, p99, p999, samples[count - 1], mean, errors);
+			for (i = 0; i < BENCH_HIST_BUCKETS; ++i) {
+				fprintf(fp, "%s%u", i ? "," : "", hist[i]);
+			}
+			fprintf(fp, "]}\n");
+		}
+		if (fp != stdout) {
+			fclose(fp);
+		}
+	}
+
+	free(samples);
+	exit(errors ? 1 : 0);
+}
+#endif // ! WIN32
+
 #endif // BOT_2_SIM_AVAILABLE
 #endif // PC
@@ -30,9 +30,17 @@
 #include "display.h"
 #include "log.h"
 #include "command.h"
+#include "sim-headless.h"
 
 #define USE_SEND_BUFFER				/**< Schalter fuer Sendepuffer an/aus */
-#define TCP_SEND_BUFFER_SIZE 4096	/**< Groesse des Sendepuffers / Byte */
+#define TCP_SEND_BUFFER_SIZE 4096	/**< Groesse des threadlokalen Sendepuffers / Byte, ab so vielen wartenden Bytes wird der Sende-Thread auch ohne Flush geweckt */
+#define TCP_SEND_QUEUE_LIMIT 1048576	/**< Maximale Anzahl wartender Bytes in der Sendewarteschlange, darueber blockieren die Erzeuger */
+#define TCP_SEND_INTERVAL 10		/**< Spaetestens nach so vielen ms schaut der Sende-Thread auch ungeweckt in die Warteschlange */
+#define TCP_SEND_IOV_MAX 64			/**< Maximale Anzahl an Bloecken pro writev() */
+#define TCP_MAX_CLIENTS 4			/**< Maximale Anzahl gleichzeitiger Clients des TCP-Servers (ARM_LINUX_BOARD) */
+#define TCP_CLIENT_BACKLOG 65536	/**< Groesse des Rueckstaupuffers pro Client / Byte, was nicht mehr passt, wird fuer diesen Client verworfen */
+#define TCP_RECV_TIMEOUT 1000		/**< Timeout / ms fuer den Rest eines angefangenen Frames, danach gilt der Client als getrennt */
+#define TCP_RECV_BUFFER_SIZE 16384	/**< Groesse des Empfangspuffers / Byte */
 
 //#define DEBUG_TCP	/**< Schalter fuer Debug-Ausgaben */
 
@@ -61,28 +69,82 @@
 #include <netinet/in.h>
 #include <netdb.h>		// for gethostbyname()
 #include <netinet/tcp.h>
+#include <sys/un.h>
 #include <sys/ioctl.h>
 #include <errno.h>
 #include <signal.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <sys/select.h>
+#ifdef ARM_LINUX_BOARD
+#include <sys/epoll.h>
+#include <fcntl.h>
+#endif
 #endif // WIN32
 
 #include <stdio.h>      // for printf() and fprintf()
 #include <stdlib.h>     // for atoi() and exit()
 #include <string.h>     // for memset()
+#include <stddef.h>     // for offsetof()
 #include <unistd.h>     // for close()
+#include <sys/time.h>   // for gettimeofday()
 
 int tcp_sock = 0;			/**< Unser TCP-Socket */
 char * tcp_hostname = NULL;	/**< Hostname, auf dem ct-Sim laeuft */
+char * tcp_unix_path = NULL;	/**< Pfad zum Unix-Domain-Socket eines lokalen Sims, NULL fuer TCP/IP */
+
+/** Threadlokaler Sendepuffer, in dem ein Kommando samt Payload zusammengesetzt wird */
+static __thread struct {
+	int length;									/**< Anzahl der Bytes im Puffer */
+	uint8_t data[TCP_SEND_BUFFER_SIZE];			/**< Daten */
+	int seq_count;								/**< Anzahl der Kommandos im Puffer, deren Sequenznummer noch fehlt */
+	uint16_t seq_pos[TCP_SEND_BUFFER_SIZE / sizeof(command_t)];	/**< Positionen der fehlenden Sequenznummern im Puffer */
+} sendStage;
+
+/** Block in der Sendewarteschlange */
+typedef struct send_chunk {
+	struct send_chunk * next;	/**< naechster Block (in der Warteschlange der zuvor eingereihte) */
+	int length;					/**< Anzahl der Bytes */
+	uint8_t data[];				/**< Daten */
+} send_chunk_t;
+
+static send_chunk_t * sendQueue = NULL;					/**< Sendewarteschlange (LIFO, neuester Block zuerst) */
+static uint8_t sendSeq = 1;								/**< Zaehler fuer Paket-Sequenznummern, geschuetzt durch queueMutex */
+static pthread_mutex_t queueMutex = PTHREAD_MUTEX_INITIALIZER;	/**< Mutex fuer sendSeq und das Einreihen, damit die Sequenznummern in Sendereihenfolge vergeben werden */
+static uint64_t sendQueued = 0;							/**< Anzahl der bisher eingereihten Bytes */
+static uint64_t sendDone = 0;							/**< Anzahl der bisher vom Sende-Thread abgearbeiteten Bytes */
+static int sendWakeup = 0;								/**< Flag, ob der Sende-Thread sofort senden soll, geschuetzt durch sendMutex */
+static pthread_mutex_t sendMutex = PTHREAD_MUTEX_INITIALIZER;	/**< Mutex fuer sendWakeup und die Bedingungsvariablen */
+static pthread_cond_t sendCond = PTHREAD_COND_INITIALIZER;		/**< weckt den Sende-Thread */
+static pthread_cond_t sendDoneCond = PTHREAD_COND_INITIALIZER;	/**< signalisiert Fortschritt des Sende-Threads */
+static pthread_once_t sendThreadOnce = PTHREAD_ONCE_INIT;		/**< zum einmaligen Starten des Sende-Threads */
+
+static uint8_t recvBuffer[TCP_RECV_BUFFER_SIZE];	/**< Empfangspuffer, wird mit moeglichst grossen recv()-Aufrufen gefuellt */
+static int recvBufferRead = 0;						/**< Index des naechsten ungelesenen Bytes im Empfangspuffer */
+static int recvBufferWrite = 0;						/**< Index hinter dem letzten empfangenen Byte im Empfangspuffer */
+static int recvBufferSock = 0;						/**< Socket, zu dem die Daten im Empfangspuffer gehoeren */
+
+#ifdef ARM_LINUX_BOARD
+/** Client des TCP-Servers */
+typedef struct {
+	int sock;				/**< Socket, 0 falls der Eintrag frei ist */
+	uint8_t dead;			/**< Verbindung getrennt, der Socket wird in tcp_data_available() geschlossen */
+	uint8_t readable;		/**< epoll hat neue Daten gemeldet */
+	int backlog_len;		/**< Anzahl der Bytes im Rueckstaupuffer */
+	uint8_t * backlog;		/**< Rueckstaupuffer fuer Daten, die der Client noch nicht abgenommen hat */
+} tcp_client_t;
 
-static uint8_t sendBuffer[TCP_SEND_BUFFER_SIZE];	/**< Sendepuffer fuer ausgehende Packete */
-static int sendBufferPtr = 0;						/**< Index in den Sendepuffer */
+static int server;											/**< Server-Socket */
+static int epoll_fd;										/**< epoll-Instanz des Servers */
+static tcp_client_t tcpClients[TCP_MAX_CLIENTS];			/**< verbundene Clients, geschuetzt durch clientMutex */
+static pthread_mutex_t clientMutex = PTHREAD_MUTEX_INITIALIZER;	/**< Mutex fuer tcpClients */
+static uint8_t clientAccepted = False;						/**< Flag, ob seit tcp_client_accepted() ein neuer Client verbunden wurde */
+static unsigned clientNext = 0;								/**< Startindex fuer die Round-Robin-Auswahl des naechsten lesenden Clients */
 
-#ifndef __WIN32__
-static int server; /**< Server-Socket */
-static struct sockaddr_in serverAddr; /**< lokale Adresse */
-static struct sockaddr_in clientAddr; /**< Client-Adresse  */
-static socklen_t clntLen; /**< Laenge der Datenstruktur der Client-Adresse */
-#endif // __WIN32__
+static void tcp_client_lost(int sock);
+static void tcp_clients_send(const struct iovec * iov, int count);
+static void tcp_clients_flush(void);
+#endif // ARM_LINUX_BOARD
 
 
 /**
@@ -132,11 +194,48 @@ int tcp_openConnection(const char * hostname) {
 	return sock;
 }
 
+#ifndef WIN32
+/**
+ * Oeffnet eine Verbindung zu einem Sim auf demselben Rechner ueber einen Unix-Domain-Socket.
+ * Spart gegenueber TCP/IP ueber Loopback den kompletten TCP-Stack, der Rest (Puffer, Sende-Thread,
+ * tcp_read() / tcp_write()) arbeitet unveraendert auf dem Socket.
+ * \param *path	Pfad des Sockets
+ * \return		Der Socket
+ */
+int tcp_openUnixConnection(const char * path) {
+	struct sockaddr_un addr;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		printf("Unix domain socket path %s too long\n", path);
+		exit(1);
+	}
+
+	const int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0) {
+		printf("socket() failed\n");
+		exit(1);
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	if (connect(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		printf("tcp_openUnixConnection() to %s failed\n", path);
+		exit(1);
+	}
+
+	return sock;
+}
+#endif // ! WIN32
+
 /**
  * Schliesst eine TCP-Connection
  * \param sock	Der Socket
  */
 void tcp_closeConnection(int sock) {
+	if (sock == tcp_sock) {
+		tcp_wait_sent();
+	}
 	close(sock);
 #ifdef WIN32
 	WSACleanup();
@@ -144,34 +243,234 @@ void tcp_closeConnection(int sock) {
 }
 
 /**
- * Puffert Daten im Sendepuffer zwischen
- * \param *data		Zeiger auf die Daten
- * \param length	Anzahl der Bytes
- * \return 			Anzahl der kopierten Bytes, -1 wenn Puffer zu klein
- */
-static inline int16_t copy2Buffer(const void * data, unsigned length) {
-	if ((sendBufferPtr + length) > sizeof(sendBuffer)) {
-		LOG_DEBUG("Sendbuffer filled with %u/%u bytes, another %d bytes pending.", sendBufferPtr, (unsigned int)sizeof(sendBuffer), length);
-		LOG_DEBUG("  ==> Trying to recover by calling flushSendBuffer()...");
-		flushSendBuffer();
-		if ((sendBufferPtr + length) > sizeof(sendBuffer)) {
-			printf("ERROR - Not enough space in sendbuffer!\n");
-			LOG_DEBUG("  ==> Failed, Aborting");
+ * Schreibt eine Liste von Bloecken raus, behandelt dabei unvollstaendige Sendevorgaenge, EINTR und EAGAIN
+ * und gibt die Bloecke anschliessend frei
+ * \param *list	Erster Block, weitere ueber next verkettet
+ */
+static void send_chunks(send_chunk_t * list) {
+	while (list) {
+		send_chunk_t * chunk = list;
+		uint64_t total = 0;
+		const int sock = tcp_sock;
+#ifdef WIN32
+		list = chunk->next;
+		total = (uint64_t) chunk->length;
+		if (sock != 0) {
+			const int n = send(sock, (char *) chunk->data, chunk->length, 0);
+			if (n != chunk->length) {
+				LOG_ERROR("send_chunks(): send() sent a different number of bytes (%d) than expected (%d)", n, chunk->length);
+			}
+		}
+		free(chunk);
+#else
+		struct iovec iov[TCP_SEND_IOV_MAX];
+		int count = 0;
+		for (; list && count < TCP_SEND_IOV_MAX; list = list->next) {
+			iov[count].iov_base = list->data;
+			iov[count].iov_len = (size_t) list->length;
+			total += (uint64_t) list->length;
+			++count;
+		}
+#ifdef ARM_LINUX_BOARD
+		/* Server: an alle Clients verteilen, ohne auf langsame zu warten */
+		(void) sock;
+		tcp_clients_send(iov, count);
+#else
+		int first = 0;
+		while (sock != 0 && first < count) {
+			ssize_t n = writev(sock, &iov[first], count - first);
+			if (n < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				if (errno == EAGAIN || errno == EWOULDBLOCK) {
+					struct pollfd pfd = { sock, POLLOUT, 0 };
+					poll(&pfd, 1, 100);
+					continue;
+				}
+				LOG_ERROR("send_chunks(): writev() failed: %d", errno);
+				break;
+			}
+			/* bereits gesendete Bloecke ueberspringen, angefangenen Block kuerzen */
+			while (n > 0) {
+				if ((size_t) n >= iov[first].iov_len) {
+					n -= (ssize_t) iov[first].iov_len;
+					++first;
+				} else {
+					iov[first].iov_base = (uint8_t *) iov[first].iov_base + n;
+					iov[first].iov_len -= (size_t) n;
+					n = 0;
+				}
+			}
+		}
+#endif // ARM_LINUX_BOARD
+		while (chunk != list) {
+			send_chunk_t * next = chunk->next;
+			free(chunk);
+			chunk = next;
+		}
+#endif // WIN32
+		pthread_mutex_lock(&sendMutex);
+		__atomic_add_fetch(&sendDone, total, __ATOMIC_RELEASE);
+		pthread_cond_broadcast(&sendDoneCond);
+		pthread_mutex_unlock(&sendMutex);
+	}
+}
+
+/**
+ * Sende-Thread: Holt alle eingereihten Bloecke auf einmal aus der Warteschlange und schreibt sie
+ * per writev() raus. Wird durch tcp_commit(True) sofort geweckt, spaetestens aber nach TCP_SEND_INTERVAL ms,
+ * damit auch Daten von Threads, die nie flushen (Log, Map-2-Sim), zeitnah rausgehen.
+ * \param *arg	wird nicht verwendet
+ * \return		NULL
+ */
+static void * tcp_sender_thread(void * arg) {
+	(void) arg;
+	for (;;) {
+		pthread_mutex_lock(&sendMutex);
+		if (! sendWakeup) {
+			struct timeval now;
+			gettimeofday(&now, NULL);
+			struct timespec until;
+			until.tv_sec = now.tv_sec;
+			until.tv_nsec = (now.tv_usec + TCP_SEND_INTERVAL * 1000L) * 1000L;
+			if (until.tv_nsec >= 1000000000L) {
+				until.tv_sec++;
+				until.tv_nsec -= 1000000000L;
+			}
+			pthread_cond_timedwait(&sendCond, &sendMutex, &until);
+		}
+		sendWakeup = 0;
+		pthread_mutex_unlock(&sendMutex);
+
+		/* komplette Warteschlange uebernehmen und in Einreihungsreihenfolge bringen */
+		send_chunk_t * chunk = __atomic_exchange_n(&sendQueue, NULL, __ATOMIC_ACQUIRE);
+		send_chunk_t * list = NULL;
+		while (chunk) {
+			send_chunk_t * next = chunk->next;
+			chunk->next = list;
+			list = chunk;
+			chunk = next;
+		}
+		if (list) {
+			send_chunks(list);
+		}
+#ifdef ARM_LINUX_BOARD
+		tcp_clients_flush();
+#endif
+	}
+	return NULL;
+}
+
+/**
+ * Startet den Sende-Thread, wird per pthread_once() genau einmal aufgerufen
+ */
+static void tcp_sender_start(void) {
+	static pthread_t thread;
+	if (pthread_create(&thread, NULL, tcp_sender_thread, NULL) != 0) {
+		printf("ERROR - Could not start TCP sender thread!\n");
+		exit(1);
+	}
+	pthread_detach(thread);
+}
+
+/**
+ * Weckt den Sende-Thread auf
+ */
+static void tcp_sender_wakeup(void) {
+	pthread_mutex_lock(&sendMutex);
+	sendWakeup = 1;
+	pthread_cond_signal(&sendCond);
+	pthread_mutex_unlock(&sendMutex);
+}
+
+/**
+ * Wartet, bis der Sende-Thread mindestens die ersten target eingereihten Bytes uebertragen (oder verworfen) hat
+ * \param target	Stand von sendQueued, bis zu dem gewartet wird
+ */
+static void tcp_wait_done(uint64_t target) {
+	pthread_mutex_lock(&sendMutex);
+	while (__atomic_load_n(&sendDone, __ATOMIC_ACQUIRE) < target) {
+		sendWakeup = 1;
+		pthread_cond_signal(&sendCond);
+		pthread_cond_wait(&sendDoneCond, &sendMutex);
+	}
+	pthread_mutex_unlock(&sendMutex);
+}
+
+/**
+ * Reiht die seit dem letzten Aufruf per tcp_write() geschriebenen Daten des aufrufenden Threads
+ * als zusammenhaengenden Block in die Sendewarteschlange ein. Bloecke verschiedener Threads werden
+ * nie vermischt, ein Kommando samt Payload kommt also am Stueck beim Empfaenger an.
+ * \param flush	True, falls der Sende-Thread sofort senden soll (z.B. nach CMD_DONE)
+ * \return		Anzahl der eingereihten Bytes
+ */
+int16_t tcp_commit(uint8_t flush) {
+	const int16_t length = (int16_t) sendStage.length;
+	if (length > 0) {
+		send_chunk_t * chunk = malloc(sizeof(send_chunk_t) + (size_t) length);
+		if (chunk == NULL) {
+			printf("ERROR - Out of memory for sendqueue!\n");
+			sendStage.length = 0;
+			sendStage.seq_count = 0;
 			return -1;
-		} else {
-			LOG_DEBUG("  ==> Succeeded, data copied");
+		}
+		chunk->length = length;
+		memcpy(chunk->data, sendStage.data, (size_t) length);
+		sendStage.length = 0;
+
+		pthread_once(&sendThreadOnce, tcp_sender_start);
+
+		/* Sequenznummern erst beim Einreihen vergeben, sonst koennten sie bei mehreren Threads vertauscht ankommen.
+		 * Einreihen per CAS (LIFO, der Sende-Thread dreht die Reihenfolge wieder um), weil der Sende-Thread
+		 * die Warteschlange ohne queueMutex uebernimmt. */
+		pthread_mutex_lock(&queueMutex);
+		int i;
+		for (i = 0; i < sendStage.seq_count; ++i) {
+			chunk->data[sendStage.seq_pos[i]] = sendSeq++;
+		}
+		chunk->next = __atomic_load_n(&sendQueue, __ATOMIC_RELAXED);
+		while (! __atomic_compare_exchange_n(&sendQueue, &chunk->next, chunk, True, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {}
+		pthread_mutex_unlock(&queueMutex);
+		sendStage.seq_count = 0;
+
+		const uint64_t queued = __atomic_add_fetch(&sendQueued, (uint64_t) length, __ATOMIC_ACQ_REL);
+		const uint64_t pending = queued - __atomic_load_n(&sendDone, __ATOMIC_ACQUIRE);
+		if (pending > TCP_SEND_QUEUE_LIMIT) {
+			/* Gegendruck: Erzeuger bremsen, wenn der Empfaenger nicht hinterherkommt */
+			LOG_DEBUG("Sendqueue full with %llu bytes, waiting", (unsigned long long) pending);
+			tcp_wait_done(queued - TCP_SEND_QUEUE_LIMIT / 2);
+			return length;
+		}
+		if (pending >= TCP_SEND_BUFFER_SIZE) {
+			flush = True;
 		}
 	}
-	LOG_DEBUG("Store %d bytes", length);
-	// Auf dem PC kopieren wir nur alles in den Ausgangspuffer
-	memcpy(&sendBuffer[sendBufferPtr], data, length);
-	sendBufferPtr += length;
-	LOG_DEBUG(" %d bytes now in buffer", sendBufferPtr);
+	if (flush && __atomic_load_n(&sendQueued, __ATOMIC_ACQUIRE) != __atomic_load_n(&sendDone, __ATOMIC_ACQUIRE)) {
+		tcp_sender_wakeup();
+	}
 	return length;
 }
 
 /**
- * Uebertrage Daten per TCP/IP
+ * Ueberlaesst die Sequenznummer des zuletzt per tcp_write() geschriebenen Kommandos tcp_commit(),
+ * die sie beim Einreihen eintraegt
+ */
+void tcp_defer_seq(void) {
+	sendStage.seq_pos[sendStage.seq_count++] = (uint16_t) (sendStage.length - (int) sizeof(command_t) + (int) offsetof(command_t, seq));
+}
+
+/**
+ * Wartet, bis alle bisher eingereihten Daten uebertragen wurden
+ */
+void tcp_wait_sent(void) {
+	tcp_commit(True);
+	tcp_wait_done(__atomic_load_n(&sendQueued, __ATOMIC_ACQUIRE));
+}
+
+/**
+ * Uebertrage Daten per TCP/IP. Die Daten landen zunaechst im threadlokalen Sendepuffer und
+ * werden mit tcp_commit() bzw. flushSendBuffer() an den Sende-Thread uebergeben.
  * \param *data		Zeiger auf die Daten
  * \param length	Anzahl der Bytes
  * \return 			Anzahl der gesendeten Byte, -1 wenn Fehler
@@ -184,7 +483,17 @@ int16_t tcp_write(const void * data, int16_t length) {
 #endif // ARM_LINUX_BOARD
 	int16_t bytes_sent;
 #ifdef USE_SEND_BUFFER
-	bytes_sent = copy2Buffer(data, length);
+	if (length < 0 || length > (int16_t) sizeof(sendStage.data)) {
+		return -1;
+	}
+	if (sendStage.length + length > (int) sizeof(sendStage.data)) {
+		/* passiert nur, wenn jemand ohne tcp_commit() schreibt, dann gibt es aber auch keine Kommandogrenzen zu beachten */
+		LOG_DEBUG("Sendbuffer filled with %d bytes, another %d bytes pending, committing", sendStage.length, length);
+		tcp_commit(False);
+	}
+	memcpy(&sendStage.data[sendStage.length], data, (size_t) length);
+	sendStage.length += length;
+	bytes_sent = length;
 #else
 	bytes_sent = length;
 	if (send(tcp_sock, data, length, 0) != length) {
@@ -196,6 +505,56 @@ int16_t tcp_write(const void * data, int16_t length) {
 	return bytes_sent;
 }
 
+/**
+ * Liest so viele Daten wie moeglich in den Empfangspuffer, blockiert, bis mindestens ein Byte empfangen wurde
+ * \param min	Anzahl der Bytes, die danach mindestens zusammenhaengend im Puffer liegen sollen
+ * \return		0 falls alles ok, -1 falls die Verbindung getrennt wurde (nur als Server, als Client wird das Programm beendet)
+ */
+static int fillRecvBuffer(int min) {
+	if (recvBufferSock != tcp_sock) {
+		/* neue Verbindung, alte Daten verwerfen */
+		recvBufferRead = recvBufferWrite = 0;
+		recvBufferSock = tcp_sock;
+	}
+	if (recvBufferRead == recvBufferWrite) {
+		recvBufferRead = recvBufferWrite = 0;
+	}
+#ifdef ARM_LINUX_BOARD
+	int waited = 0;
+#endif
+	while (recvBufferWrite - recvBufferRead < min) {
+		if (recvBufferRead > 0 && recvBufferWrite + (min - (recvBufferWrite - recvBufferRead)) > (int) sizeof(recvBuffer)) {
+			/* ungelesene Daten an den Pufferanfang schieben */
+			memmove(recvBuffer, &recvBuffer[recvBufferRead], recvBufferWrite - recvBufferRead);
+			recvBufferWrite -= recvBufferRead;
+			recvBufferRead = 0;
+		}
+		const int n = recv(tcp_sock, (char *) &recvBuffer[recvBufferWrite], sizeof(recvBuffer) - recvBufferWrite, 0);
+#ifdef ARM_LINUX_BOARD
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) && waited < TCP_RECV_TIMEOUT) {
+			/* nicht-blockierender Socket, auf den Rest des Frames warten */
+			struct pollfd pfd = { tcp_sock, POLLIN, 0 };
+			poll(&pfd, 1, 100);
+			waited += 100;
+			continue;
+		}
+		if (n <= 0) {
+			LOG_INFO("TCP client disconnected");
+			tcp_client_lost(tcp_sock);
+			return -1;
+		}
+#else
+		if (n <= 0) {
+			printf("recv() failed or connection closed prematurely\n");
+			exit(1);
+		}
+#endif // ARM_LINUX_BOARD
+		LOG_DEBUG("received %d bytes", n);
+		recvBufferWrite += n;
+	}
+	return 0;
+}
+
 /**
  * Lese Daten von TCP/IP-Verbindung.
  * Achtung: blockierend!
@@ -204,19 +563,99 @@ int16_t tcp_write(const void * data, int16_t length) {
  * \return 			Anzahl der uebertragenen Bytes
  */
 int16_t tcp_read(void * data, int16_t length) {
-	if (tcp_sock == 0 || length == 0) {
+	if (tcp_sock == 0 || length <= 0) {
 		return 0; // NOP, aber auch kein Programmabbruch noetig
 	}
-	int16_t bytesReceived = 0;
 
-	if ((bytesReceived = recv(tcp_sock, data, length, 0)) <= 0) {
-		printf("recv() failed or connection closed prematurely\n");
-	    exit(1);
+	uint8_t * dest = data;
+	int16_t done = 0;
+	while (done < length) {
+		if (recvBufferSock != tcp_sock || recvBufferRead == recvBufferWrite) {
+			if (fillRecvBuffer(1) != 0) {
+				break;
+			}
+		}
+		int n = recvBufferWrite - recvBufferRead;
+		if (n > length - done) {
+			n = length - done;
+		}
+		memcpy(&dest[done], &recvBuffer[recvBufferRead], n);
+		recvBufferRead += n;
+		done = (int16_t) (done + n);
 	}
 
-	return bytesReceived;
+	return done;
 }
 
+/**
+ * Liefert die naechsten Bytes der TCP/IP-Verbindung, ohne sie aus dem Empfangspuffer zu entfernen.
+ * Achtung: blockierend!
+ * \param length	Anzahl der gewuenschten Bytes, hoechstens TCP_RECV_BUFFER_SIZE
+ * \return 			Zeiger auf die Daten im Empfangspuffer, gueltig bis zum naechsten Lesen; NULL falls keine Verbindung
+ */
+const void * tcp_peek(int16_t length) {
+	if (tcp_sock == 0 || length > (int16_t) sizeof(recvBuffer)) {
+		return NULL;
+	}
+	if (fillRecvBuffer(length) != 0) {
+		return NULL;
+	}
+
+	return &recvBuffer[recvBufferRead];
+}
+
+/**
+ * Entfernt Bytes aus dem Empfangspuffer, die zuvor per tcp_peek() geholt wurden
+ * \param length	Anzahl der Bytes
+ */
+void tcp_skip(int16_t length) {
+	recvBufferRead += length;
+	if (recvBufferRead >= recvBufferWrite) {
+		recvBufferRead = recvBufferWrite = 0;
+	}
+}
+
+#ifndef ARM_LINUX_BOARD
+/**
+ * Wartet hoechstens timeout ms auf Daten vom Sim und liest das Verfuegbare in den Empfangspuffer.
+ * Liegt dort bereits ein komplettes Kommando, wird nicht gewartet.
+ * \param timeout	maximale Wartezeit [ms], 0 fuer nicht blockierend
+ * \return			Anzahl der Bytes im Empfangspuffer
+ */
+int tcp_data_wait(int timeout) {
+	if (recvBufferSock != tcp_sock) {
+		/* neue Verbindung, alte Daten verwerfen */
+		recvBufferRead = recvBufferWrite = 0;
+		recvBufferSock = tcp_sock;
+	}
+	if (recvBufferWrite - recvBufferRead >= (int) sizeof(command_t)) {
+		timeout = 0;
+	}
+
+	fd_set fds;
+	FD_ZERO(&fds);
+	FD_SET(tcp_sock, &fds);
+	struct timeval tv = { timeout / 1000, (timeout % 1000) * 1000 };
+	if (select(tcp_sock + 1, &fds, NULL, NULL, &tv) > 0) {
+		if (recvBufferRead > 0) {
+			memmove(recvBuffer, &recvBuffer[recvBufferRead], recvBufferWrite - recvBufferRead);
+			recvBufferWrite -= recvBufferRead;
+			recvBufferRead = 0;
+		}
+		if (recvBufferWrite < (int) sizeof(recvBuffer)) {
+			const int n = recv(tcp_sock, (char *) &recvBuffer[recvBufferWrite], sizeof(recvBuffer) - recvBufferWrite, 0);
+			if (n <= 0) {
+				printf("recv() failed or connection closed prematurely\n");
+				exit(1);
+			}
+			recvBufferWrite += n;
+		}
+	}
+
+	return recvBufferWrite - recvBufferRead;
+}
+#endif // ! ARM_LINUX_BOARD
+
 /**
  * Initialisiere TCP/IP Verbindung
  */
@@ -229,9 +668,190 @@ void tcp_init(void) {
 #endif // ARM_LINUX_BOARD
 }
 
-#ifndef __WIN32__
+#ifdef ARM_LINUX_BOARD
 /**
- * Initialisiere TCP/IP Verbindung als Server
+ * Sucht den Client zu einem Socket, clientMutex muss gesperrt sein
+ * \param sock	Socket
+ * \return		Zeiger auf den Client oder NULL
+ */
+static tcp_client_t * tcp_client_find(int sock) {
+	unsigned i;
+	for (i = 0; i < TCP_MAX_CLIENTS; ++i) {
+		if (sock != 0 && tcpClients[i].sock == sock) {
+			return &tcpClients[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Markiert die Verbindung eines Clients als getrennt, geschlossen wird sie in tcp_data_available()
+ * \param sock	Socket des Clients
+ */
+static void tcp_client_lost(int sock) {
+	pthread_mutex_lock(&clientMutex);
+	tcp_client_t * client = tcp_client_find(sock);
+	if (client) {
+		client->dead = True;
+	}
+	pthread_mutex_unlock(&clientMutex);
+}
+
+/**
+ * Versucht, den Rueckstaupuffer eines Clients zu senden, ohne zu blockieren. clientMutex muss gesperrt sein.
+ * \param *client	Client
+ */
+static void tcp_client_flush(tcp_client_t * client) {
+	if (client->dead || client->backlog_len == 0) {
+		return;
+	}
+	const ssize_t n = send(client->sock, client->backlog, (size_t) client->backlog_len, MSG_DONTWAIT | MSG_NOSIGNAL);
+	if (n < 0) {
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+			client->dead = True;
+		}
+		return;
+	}
+	client->backlog_len -= (int) n;
+	memmove(client->backlog, &client->backlog[n], (size_t) client->backlog_len);
+}
+
+/**
+ * Haengt Daten an den Rueckstaupuffer eines Clients an. clientMutex muss gesperrt sein.
+ * \param *client	Client
+ * \param *data		Daten
+ * \param length	Anzahl der Bytes
+ * \return			True, falls die Daten gepuffert wurden, False falls kein Platz mehr war
+ */
+static uint8_t tcp_client_queue(tcp_client_t * client, const void * data, size_t length) {
+	if (client->backlog_len + length > TCP_CLIENT_BACKLOG) {
+		return False;
+	}
+	memcpy(&client->backlog[client->backlog_len], data, length);
+	client->backlog_len += (int) length;
+	return True;
+}
+
+/**
+ * Verteilt Bloecke an alle verbundenen Clients, ohne zu blockieren. Was ein Client nicht sofort abnimmt,
+ * landet in seinem Rueckstaupuffer; ist dieser voll, werden ganze Bloecke (also ganze Kommandos) fuer ihn verworfen.
+ * \param *iov	Bloecke
+ * \param count	Anzahl der Bloecke
+ */
+static void tcp_clients_send(const struct iovec * iov, int count) {
+	pthread_mutex_lock(&clientMutex);
+	unsigned i;
+	for (i = 0; i < TCP_MAX_CLIENTS; ++i) {
+		tcp_client_t * const client = &tcpClients[i];
+		if (client->sock == 0 || client->dead) {
+			continue;
+		}
+		tcp_client_flush(client);
+
+		int first = 0;
+		if (client->backlog_len == 0) {
+			struct iovec v[TCP_SEND_IOV_MAX];
+			memcpy(v, iov, sizeof(struct iovec) * (size_t) count);
+			ssize_t n = writev(client->sock, v, count);
+			if (n < 0) {
+				if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+					client->dead = True;
+					continue;
+				}
+				n = 0;
+			}
+			while (first < count && (size_t) n >= v[first].iov_len) {
+				n -= (ssize_t) v[first].iov_len;
+				++first;
+			}
+			if (first < count && n > 0) {
+				/* Rest des angefangenen Blocks muss noch raus, sonst zerfaellt der Datenstrom */
+				if (! tcp_client_queue(client, (const uint8_t *) v[first].iov_base + n, v[first].iov_len - (size_t) n)) {
+					client->dead = True;
+					continue;
+				}
+				++first;
+			}
+		}
+		for (; first < count; ++first) {
+			if (! tcp_client_queue(client, iov[first].iov_base, iov[first].iov_len)) {
+				LOG_DEBUG("client %d too slow, dropping %u bytes", client->sock, (unsigned) iov[first].iov_len);
+			}
+		}
+	}
+	pthread_mutex_unlock(&clientMutex);
+}
+
+/**
+ * Versucht, die Rueckstaupuffer aller Clients zu senden
+ */
+static void tcp_clients_flush(void) {
+	pthread_mutex_lock(&clientMutex);
+	unsigned i;
+	for (i = 0; i < TCP_MAX_CLIENTS; ++i) {
+		if (tcpClients[i].sock != 0) {
+			tcp_client_flush(&tcpClients[i]);
+		}
+	}
+	pthread_mutex_unlock(&clientMutex);
+}
+
+/**
+ * Nimmt alle wartenden Verbindungen an
+ */
+static void tcp_server_accept(void) {
+	for (;;) {
+		struct sockaddr_in addr;
+		socklen_t len = sizeof(addr);
+		const int sock = accept(server, (struct sockaddr *) &addr, &len);
+		if (sock < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				LOG_ERROR("accept() failed: %d", errno);
+			}
+			return;
+		}
+		fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+		int flag = 1;
+		setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (char *) &flag, sizeof(int));
+
+		pthread_mutex_lock(&clientMutex);
+		tcp_client_t * client = NULL;
+		unsigned i;
+		for (i = 0; i < TCP_MAX_CLIENTS && ! client; ++i) {
+			if (tcpClients[i].sock == 0) {
+				client = &tcpClients[i];
+			}
+		}
+		uint8_t * backlog = client ? malloc(TCP_CLIENT_BACKLOG) : NULL;
+		if (! backlog) {
+			pthread_mutex_unlock(&clientMutex);
+			LOG_ERROR("TCP client %s rejected, too many clients", inet_ntoa(addr.sin_addr));
+			close(sock);
+			continue;
+		}
+		memset(client, 0, sizeof(tcp_client_t));
+		client->sock = sock;
+		client->backlog = backlog;
+		struct epoll_event ev;
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+		ev.data.fd = sock;
+		epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock, &ev);
+		pthread_mutex_unlock(&clientMutex);
+
+		__atomic_store_n(&clientAccepted, True, __ATOMIC_RELEASE);
+#ifndef LOG_CTSIM_AVAILABLE
+		LOG_INFO("TCP Client %s connected on port %u.", inet_ntoa(addr.sin_addr), SERVERPORT);
+#endif
+	}
+}
+
+/**
+ * Initialisiere TCP/IP Verbindung als Server. Laeuft danach als Thread weiter, nimmt per epoll
+ * bis zu TCP_MAX_CLIENTS Verbindungen an und meldet neue Daten bzw. getrennte Verbindungen.
  * \param *ptr Datenparameter fuer pthread, wird nicht verwendet
  * \return NULL
  */
@@ -246,8 +866,9 @@ void * tcp_init_server(void * ptr) {
 	int i = 1;
 	setsockopt(server, SOL_SOCKET, SO_REUSEADDR, (char *) &i, sizeof(i));
 
-//	fcntl(server, F_SETFL, O_NONBLOCK); // non-blocking
+	fcntl(server, F_SETFL, O_NONBLOCK); // non-blocking
 
+	struct sockaddr_in serverAddr;
 	memset(&serverAddr, 0, sizeof(serverAddr)); // clean up
 	serverAddr.sin_family = AF_INET; // internet address family
 	serverAddr.sin_addr.s_addr = htonl(INADDR_ANY); // any incoming interface
@@ -265,42 +886,172 @@ void * tcp_init_server(void * ptr) {
 		exit(1);
 	}
 
-	/* set the size of the in-out parameter */
-	clntLen = sizeof(clientAddr);
-
-	/* wait for a client to connect */
-	LOG_INFO("Waiting for TCP client (in background)...");
-	if ((tcp_sock = accept(server, (struct sockaddr *) &clientAddr, &clntLen)) < 0) {
-		LOG_ERROR("accept() failed");
+	if ((epoll_fd = epoll_create1(0)) < 0) {
+		LOG_ERROR("epoll_create1() failed");
+		exit(1);
 	}
-#ifndef LOG_CTSIM_AVAILABLE
-	LOG_INFO("TCP Client %s connected on port %u.", inet_ntoa(clientAddr.sin_addr), SERVERPORT);
-#endif
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = server;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server, &ev);
 
-#ifndef __WIN32__
 	signal(SIGPIPE, SIG_IGN); // ignore SIGPIPE signal
-#endif
+
+	LOG_INFO("Waiting for TCP clients (in background)...");
+	struct epoll_event events[TCP_MAX_CLIENTS + 1];
+	for (;;) {
+		const int n = epoll_wait(epoll_fd, events, TCP_MAX_CLIENTS + 1, -1);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			LOG_ERROR("epoll_wait() failed: %d", errno);
+			break;
+		}
+		int j;
+		for (j = 0; j < n; ++j) {
+			if (events[j].data.fd == server) {
+				tcp_server_accept();
+				continue;
+			}
+			pthread_mutex_lock(&clientMutex);
+			tcp_client_t * client = tcp_client_find(events[j].data.fd);
+			if (client) {
+				if (events[j].events & (EPOLLERR | EPOLLHUP)) {
+					client->dead = True;
+				} else {
+					/* auch EPOLLRDHUP: evtl. noch Daten im Socket, recv() liefert danach 0 */
+					client->readable = True;
+				}
+			}
+			pthread_mutex_unlock(&clientMutex);
+		}
+	}
 
 	return NULL;
 }
 
 /**
- * Ermittelt wie viele Bytes auf dem TCP-Server Socket zur Verfuegung stehen
+ * Liest ohne zu blockieren alles, was der aktive Client geschickt hat, in den Empfangspuffer
+ */
+static void tcp_receive_available(void) {
+	for (;;) {
+		if (recvBufferRead > 0) {
+			memmove(recvBuffer, &recvBuffer[recvBufferRead], recvBufferWrite - recvBufferRead);
+			recvBufferWrite -= recvBufferRead;
+			recvBufferRead = 0;
+		}
+		if (recvBufferWrite == (int) sizeof(recvBuffer)) {
+			/* Puffer voll, Rest beim naechsten Mal */
+			pthread_mutex_lock(&clientMutex);
+			tcp_client_t * client = tcp_client_find(tcp_sock);
+			if (client) {
+				client->readable = True;
+			}
+			pthread_mutex_unlock(&clientMutex);
+			return;
+		}
+		const int n = recv(tcp_sock, (char *) &recvBuffer[recvBufferWrite], sizeof(recvBuffer) - recvBufferWrite, MSG_DONTWAIT);
+		if (n > 0) {
+			recvBufferWrite += n;
+			continue;
+		}
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+			return;
+		}
+		LOG_INFO("TCP client disconnected");
+		tcp_client_lost(tcp_sock);
+		return;
+	}
+}
+
+/**
+ * Schliesst getrennte Verbindungen und waehlt den Client aus, von dem als naechstes gelesen wird.
+ * Gewechselt wird nur, wenn vom bisherigen Client keine ungelesenen Daten mehr im Empfangspuffer liegen.
+ * \return True, falls der ausgewaehlte Client neue Daten gemeldet hat
+ */
+static uint8_t tcp_server_select(void) {
+	pthread_mutex_lock(&clientMutex);
+	unsigned i;
+	for (i = 0; i < TCP_MAX_CLIENTS; ++i) {
+		tcp_client_t * const client = &tcpClients[i];
+		if (client->sock != 0 && client->dead) {
+			epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client->sock, NULL);
+			close(client->sock);
+			if (client->sock == tcp_sock) {
+				tcp_sock = 0;
+			}
+			if (client->sock == recvBufferSock) {
+				recvBufferRead = recvBufferWrite = recvBufferSock = 0;
+			}
+			free(client->backlog);
+			memset(client, 0, sizeof(tcp_client_t));
+		}
+	}
+
+	const uint8_t pending = recvBufferSock == tcp_sock && recvBufferWrite != recvBufferRead;
+	if (tcp_sock == 0 || ! pending) {
+		/* Round-Robin ueber alle Clients mit neuen Daten, sonst irgendein verbundener */
+		int fallback = tcp_sock;
+		for (i = 0; i < TCP_MAX_CLIENTS; ++i) {
+			tcp_client_t * const client = &tcpClients[(clientNext + i) % TCP_MAX_CLIENTS];
+			if (client->sock == 0) {
+				continue;
+			}
+			if (client->readable) {
+				tcp_sock = client->sock;
+				clientNext = (clientNext + i + 1) % TCP_MAX_CLIENTS;
+				break;
+			}
+			if (fallback == 0) {
+				fallback = client->sock;
+			}
+		}
+		if (i == TCP_MAX_CLIENTS) {
+			tcp_sock = fallback;
+		}
+	}
+
+	uint8_t readable = False;
+	tcp_client_t * client = tcp_client_find(tcp_sock);
+	if (client) {
+		readable = client->readable;
+		client->readable = False;
+	}
+	pthread_mutex_unlock(&clientMutex);
+	return readable;
+}
+
+/**
+ * Ermittelt wie viele Bytes vom aktiven Client des TCP-Servers zur Verfuegung stehen, blockiert nicht.
+ * Schliesst nebenbei getrennte Verbindungen und wechselt reihum zu Clients mit neuen Daten.
  * \return Bytes verfuegbar
  */
 int tcp_data_available(void) {
-	int bytes_avail;
-	int ret = ioctl(tcp_sock, FIONREAD, &bytes_avail);
-	if (ret < 0)	{
-		int err = errno;
-		LOG_ERROR("tcp_data_available(): ioctl() failed: %d; %d", ret, err);
-		(void) err;
-		return -1;
+	const uint8_t readable = tcp_server_select();
+	if (tcp_sock == 0) {
+		return 0;
+	}
+	if (recvBufferSock != tcp_sock) {
+		recvBufferRead = recvBufferWrite = 0;
+		recvBufferSock = tcp_sock;
+	}
+	if (readable) {
+		tcp_receive_available();
 	}
 
-	return bytes_avail;
+	return recvBufferWrite - recvBufferRead;
+}
+
+/**
+ * Gibt an, ob seit dem letzten Aufruf ein neuer Client mit dem TCP-Server verbunden wurde
+ * \return True oder False
+ */
+uint8_t tcp_client_accepted(void) {
+	return __atomic_exchange_n(&clientAccepted, False, __ATOMIC_ACQ_REL);
 }
-#endif // __WIN32__
+#endif // ARM_LINUX_BOARD
 
 /**
  * Initialisiere TCP/IP Verbindung als Client (Verbindung zum Sim)
@@ -319,6 +1070,25 @@ void tcp_init_client(void) {
 	}
 #endif	// WIN32
 
+#ifndef ARM_LINUX_BOARD
+	if ((tcp_sock = sim_headless_connect()) != -1) {
+		printf("Connection to built-in sim established\n");
+		sendStage.length = 0; // Puffer leeren
+		sendStage.seq_count = 0;
+		return;
+	}
+#endif // ! ARM_LINUX_BOARD
+
+#ifndef WIN32
+	if (tcp_unix_path) {
+		tcp_sock = tcp_openUnixConnection(tcp_unix_path);
+		printf("Connection to %s established (Unix domain socket)\n", tcp_unix_path);
+		sendStage.length = 0; // Puffer leeren
+		sendStage.seq_count = 0;
+		return;
+	}
+#endif // ! WIN32
+
 	if ((tcp_sock = tcp_openConnection(tcp_hostname)) != -1) {
 		printf("Connection to %s established on Port: %u\n", tcp_hostname, PORT);
 	} else {
@@ -326,30 +1096,17 @@ void tcp_init_client(void) {
 		exit(1);
 	}
 
-	sendBufferPtr = 0; // Puffer leeren
+	sendStage.length = 0; // Puffer leeren
+	sendStage.seq_count = 0;
 }
 
 /**
- * Schreibt den Sendepuffer auf einen Schlag raus
- * \return -1 bei Fehlern, sonst Anzahl der uebertragenen Bytes
+ * Uebergibt den Sendepuffer des aufrufenden Threads an den Sende-Thread und weckt diesen
+ * \return -1 bei Fehlern, sonst Anzahl der uebergebenen Bytes
  */
 int16_t flushSendBuffer(void) {
-	int16_t length = 0;
-#ifdef USE_SEND_BUFFER
-	LOG_DEBUG("Flushing Buffer with %d bytes", sendBufferPtr);
-
-	length = sendBufferPtr;
-	if (length == 0) {
-		return 0;
-	}
-	sendBufferPtr = 0; // Puffer auf jedenfall leeren
-	const int n = send(tcp_sock, (char *) &sendBuffer, length, 0);
-	if (n != length) {
-		LOG_ERROR("flushSendBuffer(): send() sent a different number of bytes (%d) than expected (%d)", n, length);
-		length = -1;
-	}
-#endif // USE_SEND_BUFFER
-	return length;
+	LOG_DEBUG("Flushing Buffer with %d bytes", sendStage.length);
+	return tcp_commit(True);
 }
 
 /**
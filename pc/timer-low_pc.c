@@ -29,6 +29,8 @@
 #include "ct-Bot.h"
 #include "timer.h"
 #include "sensor.h"
+#include "bot-2-sim.h"
+#include "os_thread.h"
 
 /**
  * initialisiert Timer 2 und startet ihn
@@ -52,7 +54,29 @@ void system_time_isr(void) {
 	tickCount += MS_TO_TICKS((float) tmp);
 #endif
 	last_simultime = simultime;
+#ifdef OS_AVAILABLE
+	os_time_update(); // schlafende Threads wecken
+#endif
+}
+
+#if defined BOT_2_SIM_AVAILABLE && ! defined ARM_LINUX_BOARD
+/**
+ * Funktion, die die TickCounts um die seit dem letzten Aufruf vergangene Echtzeit erhoeht (freilaufender Modus)
+ */
+void system_time_realtime(void) {
+	static struct timeval last = { 0, 0 };
+	struct timeval now;
+	GETTIMEOFDAY(&now, NULL);
+	if (last.tv_sec != 0 || last.tv_usec != 0) {
+		const float ms = (float) (now.tv_sec - last.tv_sec) * 1000.0f + (float) (now.tv_usec - last.tv_usec) / 1000.0f;
+		tickCount += MS_TO_TICKS(ms);
+	}
+	last = now;
+#ifdef OS_AVAILABLE
+	os_time_update(); // schlafende Threads wecken
+#endif
 }
+#endif // BOT_2_SIM_AVAILABLE && ! ARM_LINUX_BOARD
 
 /**
  * Setzt die Systemzeit zurueck auf 0
@@ -102,6 +102,7 @@ int16_t v_enc_center = 0;	/**< Schnittgeschwindigkeit ueber beide Raeder */
 
 #ifdef PC
 int16_t simultime = 0;	/**< Simulierte Zeit */
+int16_t simulcycle = 0;	/**< Nummer des letzten Zyklus vom Sim, wird mit CMD_DONE quittiert */
 #endif
 
 #ifdef MEASURE_MOUSE_AVAILABLE
@@ -129,6 +129,7 @@
 #define BEHAVIOUR_DELAY_AVAILABLE 					/**< Delay-Routine als Verhalten */
 #define BEHAVIOUR_CANCEL_BEHAVIOUR_AVAILABLE 		/**< Deaktivieren von Verhalten, wenn eine Abbruchbedingung erfuellt ist */
 #undef  BEHAVIOUR_GET_UTILIZATION_AVAILABLE			/**< CPU-Auslastung eines Verhaltens messen */
+#undef  BEHAVIOUR_PROFILE_AVAILABLE					/**< Laufzeitstatistik aller Verhalten in bot_behave() */
 #undef  BEHAVIOUR_HW_TEST_AVAILABLE 				/**< Testverhalten (ehemals TEST_AVAILABLE_ANALOG, _DIGITAL, _MOTOR) */
 
 #endif /* INCLUDE_BOT_LOCAL_OVERRIDE_H_ */
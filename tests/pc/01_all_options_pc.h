@@ -48,6 +48,7 @@
 /* Umgebungskarte */
 #define MAP_AVAILABLE						/**< Aktiviert die Kartographie */
 #define MAP_2_SIM_AVAILABLE					/**< Sendet die Map zur Anzeige an den Sim */
+#define MAP_TESTS_AVAILABLE					/**< Test-Code der Karte (nur PC) */
 
 /* MMC-/SD-Karte als Speichererweiterung (Erweiterungsmodul) */
 #define SDFAT_AVAILABLE						/**< Unterstuetzung fuer FAT-Dateisystem (FAT16 und FAT32) auf MMC/SD-Karte */
@@ -355,4 +355,30 @@ void rc5_control(void) {
 #endif // ! DISPLAY_AVAILABLE
 }
 
+#ifdef COMMAND_AVAILABLE
+/**
+ * Uebernimmt einen vom Sim empfangenen RC5-Code
+ * \param code	RC5-Code, 0 falls keine Taste gedrueckt ist
+ */
+void rc5_receive(int16_t code) {
+	static uint16_t sim_toggle = 0xffff; /**< Toggle-Bit fuer die vom Sim empfangenen RC5-Codes */
+	rc5_ir_data.ir_data = (uint16_t) code
+#ifndef ARM_LINUX_BOARD
+		| (sim_toggle & RC5_TOGGLE)
+#endif
+		;
+	if (code != 0) {
+		sim_toggle = 0xffff ^ (sim_toggle & RC5_TOGGLE);
+	}
+}
+
+/**
+ * Code der IR-Fernbedienung vom Sim (CMD_SENS_RC5)
+ * \param *cmd	Zeiger auf das empfangene Kommando
+ */
+void rc5_handle_command(command_t * cmd) {
+	rc5_receive(cmd->data_l);
+}
+#endif // COMMAND_AVAILABLE
+
 #endif // RC5_AVAILABLE